@@ -23,9 +23,47 @@
 
 
 #include "AudioComponent.h"
+#include "ProcessingThread.h"
+#include "../Processors/ProcessorGraph/ProcessorGraph.h"
+#include "../Processors/AudioNode/AudioNode.h"
 #include <stdio.h>
 
-AudioComponent::AudioComponent() : isPlaying(false)
+AudioMonitorCallback::AudioMonitorCallback(AudioNode* audioNode_) : audioNode(audioNode_)
+{
+}
+
+AudioMonitorCallback::~AudioMonitorCallback()
+{
+}
+
+void AudioMonitorCallback::audioDeviceIOCallback(const float** inputChannelData, int numInputChannels,
+                                                 float** outputChannelData, int numOutputChannels,
+                                                 int numSamples)
+{
+    if (numOutputChannels == 0)
+        return;
+
+    const int numRead = audioNode->readMonitorBuffer(outputChannelData[0], numSamples);
+
+    // silence if the graph fell behind
+    FloatVectorOperations::clear(outputChannelData[0] + numRead, numSamples - numRead);
+
+    for (int i = 1; i < numOutputChannels; i++)
+    {
+        if (outputChannelData[i] != nullptr)
+            FloatVectorOperations::copy(outputChannelData[i], outputChannelData[0], numSamples);
+    }
+}
+
+void AudioMonitorCallback::audioDeviceAboutToStart(AudioIODevice* device)
+{
+}
+
+void AudioMonitorCallback::audioDeviceStopped()
+{
+}
+
+AudioComponent::AudioComponent() : isPlaying(false), graph(nullptr), processingPeriodMs(-1)
 {
     // if this is nonempty, we got an error
     String error = deviceManager.initialise(0,  // numInputChannelsNeeded
@@ -105,6 +143,18 @@ AudioComponent::AudioComponent() : isPlaying(false)
 
     graphPlayer = new AudioProcessorPlayer();
 
+    String processingPeriod = SystemStats::getEnvironmentVariable("OPEN_EPHYS_PROCESSING_PERIOD_MS", String::empty);
+
+    if (processingPeriod.isNotEmpty())
+    {
+        processingPeriodMs = jmax(0.0, processingPeriod.getDoubleValue());
+
+        if (processingPeriodMs == 0)
+            std::cout << "Processing runs whenever new data arrive." << std::endl;
+        else
+            std::cout << "Processing runs every " << processingPeriodMs << " ms." << std::endl;
+    }
+
     stopDevice(); // reduces the amount of background processing when
     // device is not in use
 
@@ -157,6 +207,16 @@ void AudioComponent::connectToProcessorGraph(AudioProcessorGraph* processorGraph
 
     graphPlayer->setProcessor(processorGraph);
 
+    graph = processorGraph;
+
+    if (usesProcessingThread())
+    {
+        AudioNode* audioNode = ((ProcessorGraph*) processorGraph)->getAudioNode();
+
+        audioNode->setUsesMonitorBuffer(true);
+        monitorCallback = new AudioMonitorCallback(audioNode);
+    }
+
 }
 
 void AudioComponent::disconnectProcessorGraph()
@@ -164,6 +224,21 @@ void AudioComponent::disconnectProcessorGraph()
 
     graphPlayer->setProcessor(0);
 
+    graph = nullptr;
+
+}
+
+bool AudioComponent::usesProcessingThread()
+{
+    return processingPeriodMs >= 0;
+}
+
+WaitableEvent* AudioComponent::getDataAddedEvent()
+{
+    if (usesProcessingThread())
+        return &dataAdded;
+    else
+        return nullptr;
 }
 
 bool AudioComponent::callbacksAreActive()
@@ -220,8 +295,24 @@ void AudioComponent::beginCallbacks()
         }
 
 
-        std::cout << std::endl << "Adding audio callback." << std::endl;
-        deviceManager.addAudioCallback(graphPlayer);
+        if (usesProcessingThread() && graph != nullptr)
+        {
+            AudioIODevice* device = deviceManager.getCurrentAudioDevice();
+            const double sampleRate = (device != nullptr) ? device->getCurrentSampleRate() : 44100.0;
+
+            std::cout << std::endl << "Starting processing thread." << std::endl;
+            processingThread = new ProcessingThread(graph, dataAdded, processingPeriodMs,
+                                                    getBufferSize(), sampleRate);
+            processingThread->startProcessing();
+
+            deviceManager.addAudioCallback(monitorCallback);
+        }
+        else
+        {
+            std::cout << std::endl << "Adding audio callback." << std::endl;
+            deviceManager.addAudioCallback(graphPlayer);
+        }
+
         isPlaying = true;
     }
     else
@@ -259,8 +350,19 @@ void AudioComponent::endCallbacks()
     //     std::cout << "NOT THE MESSAGE THREAD -- AUDIO COMPONENT" << std::endl;
 
 
-    std::cout << std::endl << "Removing audio callback." << std::endl;
-    deviceManager.removeAudioCallback(graphPlayer);
+    if (processingThread != nullptr)
+    {
+        std::cout << std::endl << "Stopping processing thread." << std::endl;
+        deviceManager.removeAudioCallback(monitorCallback);
+        processingThread->stopProcessing();
+        processingThread = nullptr;
+    }
+    else
+    {
+        std::cout << std::endl << "Removing audio callback." << std::endl;
+        deviceManager.removeAudioCallback(graphPlayer);
+    }
+
     isPlaying = false;
 
     stopDevice();
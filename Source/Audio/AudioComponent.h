@@ -26,6 +26,36 @@
 
 #include "../../JuceLibraryCode/JuceHeader.h"
 
+class AudioNode;
+class ProcessingThread;
+
+/**
+
+  Plays the AudioNode's monitor buffer when the graph runs on its own
+  thread.
+
+  @see AudioComponent, AudioNode::readMonitorBuffer()
+
+*/
+
+class AudioMonitorCallback : public AudioIODeviceCallback
+{
+public:
+    AudioMonitorCallback(AudioNode* audioNode);
+    ~AudioMonitorCallback();
+
+    void audioDeviceIOCallback(const float** inputChannelData, int numInputChannels,
+                               float** outputChannelData, int numOutputChannels,
+                               int numSamples);
+    void audioDeviceAboutToStart(AudioIODevice* device);
+    void audioDeviceStopped();
+
+private:
+    AudioNode* audioNode;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioMonitorCallback);
+};
+
 /**
 
   Interfaces with system audio hardware.
@@ -38,6 +68,12 @@
   Determines the initial size of the sample buffer (crucial for
   real-time feedback latency).
 
+  If the OPEN_EPHYS_PROCESSING_PERIOD_MS environment variable is set, the
+  graph is run by a ProcessingThread instead: every N ms, or whenever new
+  data arrive if it is 0. The audio card then only plays the monitored
+  channels, and the buffer size is the largest number of samples processed
+  in one pass.
+
   @see MainWindow, ProcessorGraph
 
 */
@@ -85,6 +121,14 @@ public:
     /** Sets the buffer size in samples.*/
     void setBufferSize(int);
 
+    /** Returns true if the graph runs on a ProcessingThread rather than on the
+    audio callbacks.*/
+    bool usesProcessingThread();
+
+    /** Returns the event that DataBuffers signal when new data arrive, or
+    nullptr if the graph runs on the audio callbacks.*/
+    WaitableEvent* getDataAddedEvent();
+
     AudioDeviceManager deviceManager;
 
 private:
@@ -93,6 +137,14 @@ private:
 
     ScopedPointer<AudioProcessorPlayer> graphPlayer;
 
+    AudioProcessorGraph* graph;
+
+    /** Negative if the graph runs on the audio callbacks */
+    double processingPeriodMs;
+    WaitableEvent dataAdded;
+    ScopedPointer<ProcessingThread> processingThread;
+    ScopedPointer<AudioMonitorCallback> monitorCallback;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioComponent);
 
 };
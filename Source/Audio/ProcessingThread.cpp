@@ -0,0 +1,142 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ProcessingThread.h"
+
+#define REPORT_INTERVAL_SECONDS 10
+#define DATA_TIMEOUT_MS 10
+
+ProcessingThread::ProcessingThread(AudioProcessorGraph* graph_, WaitableEvent& dataAdded_,
+                                   double periodMs_, int blockSize_, double monitorSampleRate_)
+    : Thread("Processing Thread"), graph(graph_), dataAdded(dataAdded_), periodMs(periodMs_),
+      blockSize(blockSize_), monitorSampleRate(monitorSampleRate_),
+      buffer(jmax(2, jmax(graph_->getNumInputChannels(), graph_->getNumOutputChannels())), blockSize_)
+{
+}
+
+ProcessingThread::~ProcessingThread()
+{
+    stopThread(1000);
+}
+
+void ProcessingThread::startProcessing()
+{
+    graph->setPlayConfigDetails(graph->getNumInputChannels(), graph->getNumOutputChannels(),
+                                monitorSampleRate, blockSize);
+    graph->prepareToPlay(monitorSampleRate, blockSize);
+
+    dataAdded.reset();
+
+    startThread(8);
+}
+
+void ProcessingThread::stopProcessing()
+{
+    dataAdded.signal();
+    stopThread(1000);
+
+    graph->releaseResources();
+}
+
+void ProcessingThread::waitForNextPass(int64& nextPass, int64 periodTicks)
+{
+    if (periodTicks == 0)
+    {
+        dataAdded.wait(DATA_TIMEOUT_MS);
+        return;
+    }
+
+    nextPass += periodTicks;
+
+    int64 now = Time::getHighResolutionTicks();
+
+    if (now > nextPass + 10 * periodTicks)
+    {
+        // fell far behind (e.g. the graph was suspended); don't try to catch up
+        nextPass = now;
+        return;
+    }
+
+    while (now < nextPass && !threadShouldExit())
+    {
+        const int msLeft = (int)(Time::highResolutionTicksToSeconds(nextPass - now) * 1000.0);
+
+        if (msLeft > 0)
+            wait(msLeft);
+        else
+            Thread::yield();
+
+        now = Time::getHighResolutionTicks();
+    }
+}
+
+void ProcessingThread::run()
+{
+    const int64 periodTicks = (int64)(periodMs / 1000.0 * Time::getHighResolutionTicksPerSecond());
+    const int64 reportTicks = Time::secondsToHighResolutionTicks(REPORT_INTERVAL_SECONDS);
+
+    int64 nextPass = Time::getHighResolutionTicks();
+    int64 nextReport = nextPass + reportTicks;
+
+    int64 numPasses = 0;
+    int64 busyTicks = 0;
+    int64 maxPassTicks = 0;
+
+    while (!threadShouldExit())
+    {
+        waitForNextPass(nextPass, periodTicks);
+
+        if (threadShouldExit())
+            break;
+
+        const int64 start = Time::getHighResolutionTicks();
+
+        {
+            const ScopedLock sl(graph->getCallbackLock());
+
+            if (!graph->isSuspended())
+            {
+                buffer.clear();
+                midiMessages.clear();
+                graph->processBlock(buffer, midiMessages);
+            }
+        }
+
+        const int64 end = Time::getHighResolutionTicks();
+
+        numPasses++;
+        busyTicks += end - start;
+        maxPassTicks = jmax(maxPassTicks, end - start);
+
+        if (end >= nextReport)
+        {
+            std::cout << "Processing thread: " << numPasses / REPORT_INTERVAL_SECONDS << " passes/s, mean "
+                      << Time::highResolutionTicksToSeconds(busyTicks) * 1000.0 / jmax<int64>(1, numPasses)
+                      << " ms, max " << Time::highResolutionTicksToSeconds(maxPassTicks) * 1000.0
+                      << " ms, load " << 100.0 * busyTicks / reportTicks << "%" << std::endl;
+
+            numPasses = busyTicks = maxPassTicks = 0;
+            nextReport += reportTicks;
+        }
+    }
+}
@@ -0,0 +1,83 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PROCESSINGTHREAD_H_5B7E20C4__
+#define __PROCESSINGTHREAD_H_5B7E20C4__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Runs the ProcessorGraph on its own clock instead of the audio callback.
+
+  With the audio card as the clock, the graph only runs once per audio
+  buffer (23 ms at 1024 samples and 44.1 kHz), so every sample waits up to
+  a whole buffer before it is processed. This thread instead runs the graph
+  either at a fixed period (e.g. every 1 ms), or whenever a DataBuffer
+  signals that new data have arrived (period 0). Each pass processes all
+  the samples that are waiting, up to the block size.
+
+  The audio device still plays the monitored channels: the AudioNode writes
+  them into a ring buffer, which the device callback reads on its own
+  schedule (@see AudioComponent).
+
+  @see AudioComponent, AudioNode, DataBuffer
+
+*/
+
+class ProcessingThread : public Thread
+{
+public:
+    /** periodMs = 0 runs the graph whenever dataAdded is signalled (with a
+        10 ms timeout, for sources without a DataBuffer).*/
+    ProcessingThread(AudioProcessorGraph* graph, WaitableEvent& dataAdded,
+                     double periodMs, int blockSize, double monitorSampleRate);
+    ~ProcessingThread();
+
+    /** Prepares the graph and starts the thread.*/
+    void startProcessing();
+
+    /** Stops the thread and releases the graph's resources.*/
+    void stopProcessing();
+
+    void run();
+
+private:
+
+    /** Waits until the next pass is due.*/
+    void waitForNextPass(int64& nextPass, int64 periodTicks);
+
+    AudioProcessorGraph* graph;
+    WaitableEvent& dataAdded;
+
+    double periodMs;
+    int blockSize;
+    double monitorSampleRate;
+
+    AudioSampleBuffer buffer;
+    MidiBuffer midiMessages;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProcessingThread);
+};
+
+#endif  // __PROCESSINGTHREAD_H_5B7E20C4__
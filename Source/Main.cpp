@@ -85,8 +85,17 @@ public:
         customLookAndFeel = new CustomLookAndFeel();
         LookAndFeel::setDefaultLookAndFeel(customLookAndFeel);
 
-        mainWindow = new MainWindow();
+        // OPEN_EPHYS_LOAD_BENCHMARK runs the load benchmark without showing
+        // a window, and quits with a non-zero status if it fails
+        const String benchmarkSettings = SystemStats::getEnvironmentVariable("OPEN_EPHYS_LOAD_BENCHMARK", String::empty);
 
+        mainWindow = new MainWindow(benchmarkSettings.isEmpty());
+
+        if (benchmarkSettings.isNotEmpty())
+        {
+            setApplicationReturnValue(mainWindow->runLoadBenchmark(benchmarkSettings) ? 0 : 1);
+            quit();
+        }
 
 
     }
@@ -25,10 +25,20 @@
 #include <stdio.h>
 //-----------------------------------------------------------------------
 
-MainWindow::MainWindow()
+/** Returns the milliseconds since ticks, and resets ticks to now. */
+static double lapMilliseconds(int64& ticks)
+{
+    const int64 now = Time::getHighResolutionTicks();
+    const double ms = Time::highResolutionTicksToSeconds(now - ticks) * 1000.0;
+    ticks = now;
+    return ms;
+}
+
+MainWindow::MainWindow(bool isShown_)
     : DocumentWindow(JUCEApplication::getInstance()->getApplicationName(),
                      Colour(Colours::black),
-                     DocumentWindow::allButtons)
+                     DocumentWindow::allButtons),
+      isShown(isShown_)
 {
 
     setResizable(true,      // isResizable
@@ -36,6 +46,9 @@ MainWindow::MainWindow()
 
     shouldReloadOnStartup = false;
 
+    const int64 startTicks = Time::getHighResolutionTicks();
+    int64 ticks = startTicks;
+
     // Create ProcessorGraph and AudioComponent, and connect them.
     // Callbacks will be set by the play button in the control panel
 
@@ -49,8 +62,12 @@ MainWindow::MainWindow()
 
     audioComponent->connectToProcessorGraph(processorGraph);
 
+    const double audioTime = lapMilliseconds(ticks);
+
     setContentOwned(new UIComponent(this, processorGraph, audioComponent), true);
 
+    const double interfaceTime = lapMilliseconds(ticks);
+
     UIComponent* ui = (UIComponent*) getContentComponent();
 
     commandManager.registerAllCommandsForTarget(ui);
@@ -60,16 +77,21 @@ MainWindow::MainWindow()
 
     addKeyListener(commandManager.getKeyMappings());
 
-    loadWindowBounds();
-    setUsingNativeTitleBar(true);
-    Component::addToDesktop(getDesktopWindowStyleFlags());  // prevents the maximize
-    // button from randomly disappearing
-    setVisible(true);
+    if (isShown)
+    {
+        loadWindowBounds();
+        setUsingNativeTitleBar(true);
+        Component::addToDesktop(getDesktopWindowStyleFlags());  // prevents the maximize
+        // button from randomly disappearing
+        setVisible(true);
+    }
 
     // Constraining the window's size doesn't seem to work:
     setResizeLimits(300, 200, 10000, 10000);
 
-    if (shouldReloadOnStartup)
+    const double windowTime = lapMilliseconds(ticks);
+
+    if (isShown && shouldReloadOnStartup)
     {
         File executable = File::getSpecialLocation(File::currentExecutableFile);
         File executableDirectory = executable.getParentDirectory();
@@ -78,7 +100,12 @@ MainWindow::MainWindow()
         ui->getEditorViewport()->loadState(file);
     }
 
+    const double configurationTime = lapMilliseconds(ticks);
 
+    std::cout << "Started in "
+              << Time::highResolutionTicksToSeconds(ticks - startTicks) * 1000.0 << " ms: audio "
+              << audioTime << ", interface " << interfaceTime << ", window "
+              << windowTime << ", configuration " << configurationTime << std::endl;
 
 }
 
@@ -91,17 +118,21 @@ MainWindow::~MainWindow()
         processorGraph->disableProcessors();
     }
 
-    saveWindowBounds();
+    if (isShown)
+        saveWindowBounds();
 
     audioComponent->disconnectProcessorGraph();
     UIComponent* ui = (UIComponent*) getContentComponent();
     ui->disableDataViewport();
 
-    File executable = File::getSpecialLocation(File::currentExecutableFile);
-    File executableDirectory = executable.getParentDirectory();
-    File file = executableDirectory.getChildFile("lastConfig.xml");
+    if (isShown)
+    {
+        File executable = File::getSpecialLocation(File::currentExecutableFile);
+        File executableDirectory = executable.getParentDirectory();
+        File file = executableDirectory.getChildFile("lastConfig.xml");
 
-    ui->getEditorViewport()->saveState(file);
+        ui->getEditorViewport()->saveState(file);
+    }
 
     setMenuBar(0);
 
@@ -111,6 +142,47 @@ MainWindow::~MainWindow()
 
 }
 
+bool MainWindow::runLoadBenchmark(const String& settings)
+{
+    File directory;
+    File baseline;
+    double tolerance = 50.0;
+    int runs = 3;
+
+    StringArray tokens;
+    tokens.addTokens(settings, " ;", "\"");
+    tokens.removeEmptyStrings();
+
+    for (int i = 0; i < tokens.size(); i++)
+    {
+        const String token = tokens[i].trim().unquoted();
+        const String value = token.fromFirstOccurrenceOf("=", false, false);
+
+        if (token.startsWithIgnoreCase("dir="))
+            directory = File::getCurrentWorkingDirectory().getChildFile(value);
+        else if (token.startsWithIgnoreCase("baseline="))
+            baseline = File::getCurrentWorkingDirectory().getChildFile(value);
+        else if (token.startsWithIgnoreCase("tolerance="))
+            tolerance = value.getDoubleValue();
+        else if (token.startsWithIgnoreCase("runs="))
+            runs = jmax(1, value.getIntValue());
+        else if (! token.containsChar('='))
+            directory = File::getCurrentWorkingDirectory().getChildFile(token);
+        else
+            std::cout << "Unknown load benchmark setting: " << token << std::endl;
+    }
+
+    if (! directory.isDirectory())
+    {
+        std::cout << "Load benchmark: no directory of configurations given." << std::endl;
+        return false;
+    }
+
+    UIComponent* ui = (UIComponent*) getContentComponent();
+
+    return ui->getEditorViewport()->runLoadBenchmark(directory, runs, baseline, tolerance);
+}
+
 void MainWindow::closeButtonPressed()
 {
     if (audioComponent->callbacksAreActive())
@@ -45,8 +45,10 @@ class MainWindow   : public DocumentWindow
 public:
 
     /** Initializes the MainWindow, creates the AudioComponent, ProcessorGraph,
-        and UIComponent, and sets the window boundaries. */
-    MainWindow();
+        and UIComponent, and sets the window boundaries. A hidden window
+        (e.g. for the load benchmark) isn't put on screen, doesn't reload
+        the last configuration, and doesn't save its state. */
+    MainWindow(bool isShown = true);
 
     /** Destroys the AudioComponent, ProcessorGraph, and UIComponent, and saves the window boundaries. */
     ~MainWindow();
@@ -62,6 +64,19 @@ public:
     /** Determines whether the last used configuration reloads upon startup. */
     bool shouldReloadOnStartup;
 
+    /** Runs the load benchmark described by the OPEN_EPHYS_LOAD_BENCHMARK
+        environment variable, a list of space-separated tokens:
+
+        - dir=PATH: the directory of configurations (or just PATH);
+        - baseline=FILE: compare with, or record, the load times in FILE;
+        - tolerance=PERCENT: how much slower than the baseline a
+          configuration may load (default 50);
+        - runs=N: loads of each configuration (default 3).
+
+        Returns false if a configuration failed to load or is slower than
+        its baseline allows. */
+    bool runLoadBenchmark(const String& settings);
+
 private:
 
     /** Saves the MainWindow's boundaries into the file "windowState.xml", located in the directory
@@ -78,6 +93,8 @@ private:
     /** A pointer to the application's ProcessorGraph (owned by the MainWindow). */
     ScopedPointer<ProcessorGraph> processorGraph;
 
+    bool isShown;
+
 
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainWindow)
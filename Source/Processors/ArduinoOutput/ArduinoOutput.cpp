@@ -163,17 +163,17 @@ void ArduinoOutput::setParameter(int parameterIndex, float newValue)
 
 void ArduinoOutput::setOutputChannel(int chan)
 {
-    setParameter(0, chan);
+    queueParameterChange(0, chan);
 }
 
 void ArduinoOutput::setInputChannel(int chan)
 {
-    setParameter(1, chan-1);
+    queueParameterChange(1, chan-1);
 }
 
 void ArduinoOutput::setGateChannel(int chan)
 {
-    setParameter(2, chan-1);
+    queueParameterChange(2, chan-1);
 }
 
 bool ArduinoOutput::enable()
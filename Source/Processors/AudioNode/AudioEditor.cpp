@@ -177,12 +177,12 @@ void AudioEditor::buttonClicked(Button* button)
         if (muteButton->getToggleState())
         {
             lastValue = volumeSlider->getValue();
-            getAudioProcessor()->setParameter(1,0.0f);
+            ((AudioNode*) getAudioProcessor())->queueParameterChange(1,0.0f);
             std::cout << "Mute on." << std::endl;
         }
         else
         {
-            getAudioProcessor()->setParameter(1,lastValue);
+            ((AudioNode*) getAudioProcessor())->queueParameterChange(1,lastValue);
             std::cout << "Mute off." << std::endl;
         }
     }
@@ -220,9 +220,9 @@ void AudioEditor::buttonClicked(Button* button)
 void AudioEditor::sliderValueChanged(Slider* slider)
 {
     if (slider == volumeSlider)
-        getAudioProcessor()->setParameter(1,slider->getValue());
+        ((AudioNode*) getAudioProcessor())->queueParameterChange(1,slider->getValue());
     else if (slider == noiseGateSlider)
-        getAudioProcessor()->setParameter(2,slider->getValue());
+        ((AudioNode*) getAudioProcessor())->queueParameterChange(2,slider->getValue());
 }
 
 void AudioEditor::paint(Graphics& g)
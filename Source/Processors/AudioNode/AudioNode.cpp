@@ -26,7 +26,9 @@
 #include "AudioNode.h"
 
 AudioNode::AudioNode()
-    : GenericProcessor("Audio Node"), audioEditor(0), volume(0.00001f), noiseGateLevel(0.0f)
+    : GenericProcessor("Audio Node"), audioEditor(0), volume(0.00001f), noiseGateLevel(0.0f),
+      destBufferSampleRate(44100.0), estimatedSamples(1024), usesMonitorBuffer(false),
+      monitorFifo(2), monitorScratchSize(0)
 {
 
     settings.numInputs = 4096;
@@ -37,8 +39,6 @@ AudioNode::AudioNode()
 
     nextAvailableChannel = 2; // keep first two channels empty
 
-    tempBuffer = new AudioSampleBuffer(16, 1024);
-
 }
 
 
@@ -96,11 +96,11 @@ void AudioNode::enableCurrentChannel(bool state)
 
     if (state)
     {
-        setParameter(100, 0.0f);
+        queueParameterChange(100, 0.0f);
     }
     else
     {
-        setParameter(-100, 0.0f);
+        queueParameterChange(-100, 0.0f);
     }
 }
 
@@ -165,59 +165,81 @@ void AudioNode::prepareToPlay(double sampleRate_, int estimatedSamplesPerBlock)
 
 void AudioNode::recreateBuffers()
 {
-	numSamplesExpected.clear();
-    samplesInBackupBuffer.clear();
-    samplesInOverflowBuffer.clear();
-    ratio.clear();
-    filters.clear();
-    bufferA.clear();
-    bufferB.clear();
-    bufferSwap.clear();
+    resamplers.clear();
+
+    monitorScratchSize = 0;
 
     for (int i = 0; i < channelPointers.size(); i++)
     {
         // processor sample rate divided by sound card sample rate
-        numSamplesExpected.add((int)(channelPointers[i]->sampleRate/destBufferSampleRate*float(estimatedSamples)) + 1);
-        samplesInBackupBuffer.add(0);
-        samplesInOverflowBuffer.add(0);
-        sourceBufferSampleRate.add(channelPointers[i]->sampleRate);
+        int numSamplesExpected = (int)(channelPointers[i]->sampleRate/destBufferSampleRate*float(estimatedSamples)) + 1;
 
-        filters.add(new Dsp::SmoothedFilterDesign<Dsp::RBJ::Design::LowPass, 1> (1024));
+        // without the audio callback as the clock, a block can hold up to
+        // estimatedSamples input samples
+        if (usesMonitorBuffer)
+            numSamplesExpected = jmax(numSamplesExpected, estimatedSamples + 1);
 
-        ratio.add(float(numSamplesExpected[i])/float(estimatedSamples));
-        updateFilter(i);
-
-        bufferA.add(new AudioSampleBuffer(1,10000));
-        bufferB.add(new AudioSampleBuffer(1,10000));
-        bufferSwap.add(false);
+        PolyphaseResampler* resampler = new PolyphaseResampler();
+        resampler->setRates(channelPointers[i]->sampleRate, destBufferSampleRate, 1, numSamplesExpected);
+        resamplers.add(resampler);
 
+        monitorScratchSize = jmax(monitorScratchSize, resampler->getMaxOutputSamples(numSamplesExpected));
     }
 
-    tempBuffer->setSize(getNumInputs(), 4096);
+    if (usesMonitorBuffer)
+    {
+        // half a second of output
+        const int monitorBufferSize = jmax(4 * estimatedSamples, (int)(destBufferSampleRate / 2));
+
+        if (monitorFifo.getTotalSize() != monitorBufferSize)
+        {
+            monitorFifo.setTotalSize(monitorBufferSize);
+            monitorBuffer.calloc(monitorBufferSize);
+        }
+
+        monitorFifo.reset();
+        reserveScratch(1, jmax(1, monitorScratchSize));
+    }
 }
 
-bool AudioNode::enable()
+void AudioNode::setUsesMonitorBuffer(bool shouldUseBuffer)
 {
-	recreateBuffers();
-	return true;
+    usesMonitorBuffer = shouldUseBuffer;
 }
 
-void AudioNode::updateFilter(int i)
+int AudioNode::readMonitorBuffer(float* dest, int numSamples)
 {
+    if (!usesMonitorBuffer || monitorBuffer == nullptr)
+        return 0;
 
-    double cutoffFreq = (ratio[i] > 1.0) ? 2 * destBufferSampleRate  // downsample
-                        : destBufferSampleRate / 2; // upsample
+    int start1, size1, start2, size2;
 
-    double sampleFreq = (ratio[i] > 1.0) ? sourceBufferSampleRate[i] // downsample
-                        : destBufferSampleRate;  // upsample
+    // the two clocks drift apart; drop the oldest output rather than let the delay grow
+    const int maxDelay = jmax(2 * numSamples, (int)(destBufferSampleRate / 20));
+    const int excess = monitorFifo.getNumReady() - maxDelay;
 
-    Dsp::Params params;
-    params[0] = sampleFreq; // sample rate
-    params[1] = cutoffFreq; // cutoff frequency
-    params[2] = 1.25; //Q //
+    if (excess > 0)
+    {
+        monitorFifo.prepareToRead(excess, start1, size1, start2, size2);
+        monitorFifo.finishedRead(size1 + size2);
+    }
+
+    monitorFifo.prepareToRead(numSamples, start1, size1, start2, size2);
+
+    if (size1 > 0)
+        memcpy(dest, monitorBuffer + start1, size1 * sizeof(float));
+    if (size2 > 0)
+        memcpy(dest + size1, monitorBuffer + start2, size2 * sizeof(float));
 
-    filters[i]->setParams(params);
+    monitorFifo.finishedRead(size1 + size2);
 
+    return size1 + size2;
+}
+
+bool AudioNode::enable()
+{
+	recreateBuffers();
+	return true;
 }
 
 void AudioNode::process(AudioSampleBuffer& buffer,
@@ -225,6 +247,7 @@ void AudioNode::process(AudioSampleBuffer& buffer,
 {
     float gain;
     int valuesNeeded = buffer.getNumSamples(); // samples needed to fill out the buffer
+    int valuesWritten = 0;
 
     //std::cout << "Buffer size: " << buffer.getNumChannels() << std::endl;
 
@@ -232,235 +255,92 @@ void AudioNode::process(AudioSampleBuffer& buffer,
     buffer.clear(0,0,buffer.getNumSamples());
     buffer.clear(1,0,buffer.getNumSamples());
 
-    if (1)
+    if (channelPointers.size() > 0) // we have some channels
     {
 
-        AudioSampleBuffer* overflowBuffer;
-        AudioSampleBuffer* backupBuffer;
+        float* output = buffer.getWritePointer(0);
 
-        if (channelPointers.size() > 0) // we have some channels
+        if (usesMonitorBuffer)
         {
+            // produce everything the new input allows, for the audio device to take later
+            output = getScratch(monitorScratchSize);
 
-            tempBuffer->clear();
+            if (output == nullptr)
+                return;
 
-            for (int i = 0; i < buffer.getNumChannels()-2; i++) // cycle through them all
-            {
+            valuesNeeded = 0;
 
+            for (int i = 0; i < buffer.getNumChannels()-2 && i < resamplers.size(); i++)
+            {
                 if (channelPointers[i]->isMonitored)
                 {
+                    int samplesAvailable = blockMetadata->getNumSamples(channelPointers[i]->sourceNodeId);
+                    valuesNeeded = jmax(valuesNeeded, resamplers[i]->getMaxOutputSamples(samplesAvailable));
+                }
+            }
 
-                    //std::cout << "Processing channel " << i << std::endl;
-
-                    if (!bufferSwap[i])
-                    {
-                        overflowBuffer = bufferA[i];
-                        backupBuffer = bufferB[i];
+            valuesNeeded = jmin(valuesNeeded, monitorScratchSize);
 
-                        bufferSwap.set(i,true);
-                    }
-                    else
-                    {
-                        overflowBuffer = bufferB[i];
-                        backupBuffer = bufferA[i];
-
-                        bufferSwap.set(i,false);
-                    }
-
-                    backupBuffer->clear();
-
-                    samplesInOverflowBuffer.set(i,samplesInBackupBuffer[i]); // size of buffer after last round
-                    samplesInBackupBuffer.set(i,0);
-
-                    int orphanedSamples = 0;
-
-                    // 1. copy overflow buffer
-
-                    int samplesToCopyFromOverflowBuffer =
-                        ((samplesInOverflowBuffer[i] <= numSamplesExpected[i]) ?
-                         samplesInOverflowBuffer[i] :
-                         numSamplesExpected[i]);
-
-                    //std::cout << "Copying " << samplesToCopyFromOverflowBuffer << " samples from overflow buffer of " << samplesInOverflowBuffer[i] << " samples." << std::endl;
-
-                    if (samplesToCopyFromOverflowBuffer > 0) // need to re-add samples from backup buffer
-                    {
-
-                        tempBuffer->addFrom(i,    // destination channel
-                                            0,                // destination start sample
-                                            *overflowBuffer,  // source
-                                            0,                // source channel
-                                            0,                // source start sample
-                                            samplesToCopyFromOverflowBuffer,    // number of samples
-                                            1.0f              // gain to apply
-                                           );
-
-                        int leftoverSamples = samplesInOverflowBuffer[i] - samplesToCopyFromOverflowBuffer;
-
-                        // std::cout << "Samples remaining in overflow buffer: " << leftoverSamples << std::endl;
-
-                        if (leftoverSamples > 0) // move remaining samples to the backup buffer
-                        {
-
-                            backupBuffer->addFrom(0, // destination channel
-                                                  0,                     // destination start sample
-                                                  *overflowBuffer,       // source
-                                                  0,                     // source channel
-                                                  samplesToCopyFromOverflowBuffer,         // source start sample
-                                                  leftoverSamples,       // number of samples
-                                                  1.0f                   // gain to apply
-                                                 );
-                        }
-
-                        samplesInBackupBuffer.set(i,leftoverSamples);
-                    }
-
-                    gain = volume/(float(0x7fff) * channelPointers[i]->bitVolts);
-                    // Data are floats in units of microvolts, so dividing by bitVolts and 0x7fff (max value for 16b signed)
-                    // rescales to between -1 and +1. Audio output starts So, maximum gain applied to maximum data would be 10.
-
-                    int remainingSamples = numSamplesExpected[i] - samplesToCopyFromOverflowBuffer;
-
-                    int samplesAvailable = numSamples.at(channelPointers[i]->sourceNodeId);
-
-                    int samplesToCopyFromIncomingBuffer = ((remainingSamples <= samplesAvailable) ?
-                                                           remainingSamples :
-                                                           samplesAvailable);
-
-                    //std::cout << "Copying " << samplesToCopyFromIncomingBuffer << " samples from incoming buffer of " << samplesAvailable << " samples." << std::endl;
+            FloatVectorOperations::clear(output, valuesNeeded);
+        }
 
+        for (int i = 0; i < buffer.getNumChannels()-2 && i < resamplers.size(); i++) // cycle through them all
+        {
 
-                    if (samplesToCopyFromIncomingBuffer > 0)
-                    {
+            PolyphaseResampler* resampler = resamplers[i];
 
-                        tempBuffer->addFrom(i,       // destination channel
-                                            samplesToCopyFromOverflowBuffer,           // destination start sample
-                                            buffer,      // source
-                                            i+2,           // source channel (add 2 to account for output channels)
-                                            0,           // source start sample
-                                            samplesToCopyFromIncomingBuffer, //  number of samples
-                                            gain       // gain to apply
-                                           );
+            if (channelPointers[i]->isMonitored)
+            {
 
-                        //if (destBufferPos == 0)
-                        //  std::cout << "Temp buffer 0 value: " << *tempBuffer->getReadPointer(i,0) << std::endl;
+                gain = volume/(float(0x7fff) * channelPointers[i]->bitVolts);
+                // Data are floats in units of microvolts, so dividing by bitVolts and 0x7fff (max value for 16b signed)
+                // rescales to between -1 and +1. Audio output starts So, maximum gain applied to maximum data would be 10.
 
-                    }
+                int samplesAvailable = blockMetadata->getNumSamples(channelPointers[i]->sourceNodeId);
 
-                    orphanedSamples = samplesAvailable - samplesToCopyFromIncomingBuffer;
+                const float* input = buffer.getReadPointer(i+2); // add 2 to account for output channels
 
-                    // std::cout << "Samples remaining in incoming buffer: " << orphanedSamples << std::endl;
+                // anything that doesn't fit into this callback stays in the resampler for the next one
+                valuesWritten = jmax(valuesWritten,
+                                     resampler->processAdding(&input, samplesAvailable, &output, valuesNeeded, gain));
 
-                    if (orphanedSamples > 0 && (samplesInBackupBuffer[i] + orphanedSamples < backupBuffer->getNumSamples()))
-                    {
+            }
+            else if (resampler->getNumPendingSamples() > 0)
+            {
+                // don't play stale data if the channel is monitored again later
+                resampler->reset();
+            }
+        } // end cycling through channels
 
-                        backupBuffer->addFrom(0,                            // destination channel
-                                              samplesInBackupBuffer[i],     // destination start sample
-                                              buffer,                       // source
-                                              i+2,                          // source channel (add 2 to account for output channels)
-                                              remainingSamples,             // source start sample
-                                              orphanedSamples,              //  number of samples
-                                              gain                          // gain to apply
-                                             );
+        if (usesMonitorBuffer)
+        {
+            expander.process(output, valuesWritten);
 
-                        samplesInBackupBuffer.set(i, samplesInBackupBuffer[i] + orphanedSamples);
+            int start1, size1, start2, size2;
+            monitorFifo.prepareToWrite(valuesWritten, start1, size1, start2, size2);
 
-                    }
+            if (size1 > 0)
+                memcpy(monitorBuffer + start1, output, size1 * sizeof(float));
+            if (size2 > 0)
+                memcpy(monitorBuffer + start2, output + size1, size2 * sizeof(float));
 
-                    // now that our tempBuffer is ready, we can filter it and copy it into the
-                    // original buffer
-
-                    //std::cout << "Ratio = " << ratio[i] << ", gain = " << gain << std::endl;
-                    //std::cout << "Values needed = " << valuesNeeded << ", channel = " << i << std::endl;
-
-                    if (ratio[i] > 1.00001)
-                    {
-                        // pre-apply filter before downsampling
-                        float* ptr = tempBuffer->getWritePointer(i);
-                        filters[i]->process(numSamplesExpected[i], &ptr);
-                    }
-
-                    // initialize variables
-                    int sourceBufferPos = 0;
-                    int sourceBufferSize = numSamplesExpected[i];
-                    float subSampleOffset = 0.0;
-                    int nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-
-                    int destBufferPos;
-
-                    // code modified from "juce_ResamplingAudioSource.cpp":
-
-                    for (destBufferPos = 0; destBufferPos < valuesNeeded; destBufferPos++)
-                    {
-                        float gain = 1.0;
-                        float alpha = (float) subSampleOffset;
-                        float invAlpha = 1.0f - alpha;
-
-                        // std::cout << "Copying sample " << sourceBufferPos << std::endl;
-
-                        buffer.addFrom(0,    // destChannel
-                                       destBufferPos,  // destSampleOffset
-                                       *tempBuffer,     // source
-                                       i,    // sourceChannel
-                                       sourceBufferPos,// sourceSampleOffset
-                                       1,        // number of samples
-                                       invAlpha*gain);      // gain to apply to source
-
-                        buffer.addFrom(0,    // destChannel
-                                       destBufferPos,   // destSampleOffset
-                                       *tempBuffer,     // source
-                                       i,      // sourceChannel
-                                       nextPos,      // sourceSampleOffset
-                                       1,        // number of samples
-                                       alpha*gain);       // gain to apply to source
-
-                        // if (destBufferPos == 0)
-                        //std::cout << "Output buffer 0 value: " << *buffer.getReadPointer(i+2,destBufferPos) << std::endl;
-
-                        subSampleOffset += ratio[i];
+            monitorFifo.finishedWrite(size1 + size2); // output that doesn't fit is dropped
 
-                        while (subSampleOffset >= 1.0)
-                        {
-                            if (++sourceBufferPos >= sourceBufferSize)
-                                sourceBufferPos = 0;
-
-                            nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-                            subSampleOffset -= 1.0;
-                        }
-                    }
-
-                    if (ratio[i] < 0.99999)
-                    {
-                        // apply the filter after upsampling
-                        float* ptr = buffer.getWritePointer(0);
-                        filters[i]->process(destBufferPos, &ptr);
-                    }
-
-                    // now copy the channel into the output zone
-
-                    // buffer.addFrom(0,    // destChannel
-                    //                0,  // destSampleOffset
-                    //                buffer,     // source
-                    //                 i+2,    // sourceChannel
-                    //                 0,// sourceSampleOffset
-                    //                 valuesNeeded,        // number of samples
-                    //                 1.0);      // gain to apply to source
-
-                } // if channelPointers[i]->isMonitored
-            } // end cycling through channels
-
-            // Simple implementation of a "noise gate" on audio output
-            expander.process(buffer.getWritePointer(0), // expand the left channel
-                             buffer.getNumSamples());
-
-            // copy the signal into the right channel (no stereo audio yet!)
-            buffer.addFrom(1,    // destChannel
-                           0,  // destSampleOffset
-                           buffer,     // source
-                           0,    // sourceChannel
-                           0,// sourceSampleOffset
-                           valuesNeeded,        // number of samples
-                           1.0);      // gain to apply to source
+            return;
         }
+
+        // Simple implementation of a "noise gate" on audio output
+        expander.process(buffer.getWritePointer(0), // expand the left channel
+                         buffer.getNumSamples());
+
+        // copy the signal into the right channel (no stereo audio yet!)
+        buffer.addFrom(1,    // destChannel
+                       0,  // destSampleOffset
+                       buffer,     // source
+                       0,    // sourceChannel
+                       0,// sourceSampleOffset
+                       valuesNeeded,        // number of samples
+                       1.0);      // gain to apply to source
     }
 }
 
@@ -528,4 +408,4 @@ void Expander::process(float* sampleData, int numSamples)
 
         sampleData[i] = sampleData[i] * gain;
     }
-}
\ No newline at end of file
+}
\ No newline at end of file
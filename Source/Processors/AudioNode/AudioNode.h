@@ -30,7 +30,7 @@
 
 #include "../GenericProcessor/GenericProcessor.h"
 #include "AudioEditor.h"
-#include "../Dsp/Dsp.h"
+#include "../ResamplingNode/PolyphaseResampler.h"
 
 #include "../Channel/Channel.h"
 
@@ -120,10 +120,18 @@ public:
 
     void prepareToPlay(double sampleRate_, int estimatedSamplesPerBlock);
 
-    void updateFilter(int i);
-
 	bool enable();
 
+    /** If enabled, the monitored output is written to a ring buffer instead
+        of the graph's output, for when the graph does not run on the audio
+        device's callback (@see ProcessingThread).*/
+    void setUsesMonitorBuffer(bool shouldUseBuffer);
+
+    /** Called by the audio device callback to take up to numSamples of
+        monitored output. Returns the number of samples copied; the rest of
+        dest should be filled with silence.*/
+    int readMonitorBuffer(float* dest, int numSamples);
+
 private:
 	void recreateBuffers();
 
@@ -135,29 +143,24 @@ private:
     /** An array of pointers to the channels that feed into the AudioNode. */
     Array<Channel*> channelPointers;
 
-    OwnedArray<AudioSampleBuffer> bufferA;
-    OwnedArray<AudioSampleBuffer> bufferB;
-
-    Array<int> numSamplesExpected;
-
-    Array<int> samplesInBackupBuffer;
-    Array<int> samplesInOverflowBuffer;
-    Array<double> sourceBufferSampleRate;
     double destBufferSampleRate;
 	int estimatedSamples;
 
-    Array<bool> bufferSwap;
-
     Expander expander;
 
-    // sample rate, timebase, and ratio info:
-    Array<double> ratio;
+    /** Converts each channel to the sound card's sample rate. Input that
+        arrives faster than the audio callback consumes it is kept inside
+        the resampler until the next callback. */
+    OwnedArray<PolyphaseResampler> resamplers;
 
-    // major objects:
-    OwnedArray<Dsp::Filter> filters;
+    /** Resampled output waiting for the audio device, when the graph runs
+        on its own clock */
+    bool usesMonitorBuffer;
+    AbstractFifo monitorFifo;
+    HeapBlock<float> monitorBuffer;
 
-    // Temporary buffer for data
-    ScopedPointer<AudioSampleBuffer> tempBuffer;
+    /** Samples of scratch space taken by process() for the resampled output */
+    int monitorScratchSize;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioNode);
 
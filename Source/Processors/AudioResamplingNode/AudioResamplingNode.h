@@ -25,21 +25,20 @@
 #define __AUDIORESAMPLINGNODE_H_CFAB182E__
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
-#include "../Dsp/Dsp.h"
 #include "../GenericProcessor/GenericProcessor.h"
+#include "../ResamplingNode/PolyphaseResampler.h"
 
 /**
 
   Changes the sample rate of continuous data, specialized for increasing
   the sample rate to 44.1 kHz for audio output.
 
-  Code is based on Juce's ResamplingAudioSource class.
+  The conversion is done by a PolyphaseResampler, which keeps any input
+  that has not been converted yet for the next buffer, so inputs that do not
+  provide the same number of samples in each buffer no longer shift the pitch
+  of the signal.
 
-  This processor could be vastly improved by implementing a scheme to handle
-  inputs that do not provide the same amount of samples in each buffer. At the
-  moment, the resampling process shifts the pitch of the incoming signal.
-
-  @see GenericProcessor
+  @see GenericProcessor, PolyphaseResampler
 
 */
 
@@ -55,7 +54,7 @@ public:
     {
         return destBuffer;
     }
-    void updateFilter();
+    void updateResampler();
 
     void prepareToPlay(double sampleRate, int estimatedSamplesPerBlock);
     void releaseResources();
@@ -72,12 +71,11 @@ private:
 
     // sample rate, timebase, and ratio info:
     double sourceBufferSampleRate, destBufferSampleRate;
-    double ratio, lastRatio;
     double destBufferTimebaseSecs;
     int destBufferWidth;
 
     // major objects:
-    Dsp::Filter* filter;
+    PolyphaseResampler resampler;
     AudioSampleBuffer* destBuffer;
     AudioSampleBuffer* tempBuffer;
 
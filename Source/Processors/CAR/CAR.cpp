@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include "CAR.h"
+#include "../GenericProcessor/ChannelBlock.h"
     
 CAR::CAR()
     : GenericProcessor("Common Avg Ref") //, threshold(200.0), state(true)
@@ -35,7 +36,7 @@ CAR::CAR()
 
     parameters.add(Parameter("Gain (%)", 0.0, 100.0, 100.0, 0));
 
-    avgBuffer = AudioSampleBuffer(1,10000); // 1-dimensional buffer to hold the avg
+    reserveScratch(1, 10000); // 1-dimensional buffer to hold the avg
 
 }
 
@@ -62,33 +63,46 @@ void CAR::process(AudioSampleBuffer& buffer,
                   MidiBuffer& events)
 {
 	int nChannels = buffer.getNumChannels();
+    int nSamples = getNumSamples(0); // all channels come from the same stream
 
     float gain = -1.0f * float(getParameterVar(0, 0)) / 100.0f; // just use channel 0, since we can't have individual channel settings at the moment
 
-    avgBuffer.clear();
+    float* avg = getScratch(nSamples);
 
-    for (int j = 0; j < nChannels; j++)
+    if (avg == nullptr || nChannels == 0)
+        return;
+
+    FloatVectorOperations::clear(avg, nSamples);
+
+    ChannelBlock::PlanarView view;
+    int first = 0;
+
+    if (ChannelBlock::getPlanarView(buffer, nChannels, nSamples, view))
+    {
+        // channels at a fixed stride: add four at a time, so the average is
+        // only read and written once for every four channels
+        for (; first + 4 <= nChannels; first += 4)
+        {
+            const float* c0 = view.getChannel(first);
+            const float* c1 = c0 + view.stride;
+            const float* c2 = c1 + view.stride;
+            const float* c3 = c2 + view.stride;
+
+            for (int i = 0; i < nSamples; i++)
+                avg[i] += (c0[i] + c1[i]) + (c2[i] + c3[i]);
+        }
+    }
+
+    for (int j = first; j < nChannels; j++)
 	{
-		avgBuffer.addFrom(0,           // destChannel 
-                          0,           // destStartSample
-                          buffer,      // source
-                          j,           // sourceChannel
-                          0,           // sourceStartSample
-                          buffer.getNumSamples(), // numSamples
-                          1.0f); // gain to apply       
+		FloatVectorOperations::add(avg, buffer.getReadPointer(j), nSamples);
 	}
 
-    avgBuffer.applyGain(1.0f/float(nChannels));
+    FloatVectorOperations::multiply(avg, 1.0f/float(nChannels), nSamples);
 
     for (int j = 0; j < nChannels; j++)
     {
-        buffer.addFrom(j,           // destChannel 
-                       0,           // destStartSample
-                       avgBuffer,   // source
-                       0,           // sourceChannel
-                       0,           // sourceStartSample
-                       buffer.getNumSamples(), // numSamples
-                       gain); // gain to apply            
+        FloatVectorOperations::addWithMultiply(buffer.getWritePointer(j), avg, gain, nSamples);
     }
 
 }
@@ -86,8 +86,6 @@ public:
         other way, the application will crash.  */
     void setParameter(int parameterIndex, float newValue);
 
-    AudioSampleBuffer avgBuffer;
-
 private:
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CAR);
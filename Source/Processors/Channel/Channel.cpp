@@ -37,6 +37,7 @@ void Channel::reset()
 
     sampleRate = 44100.0f;
     bitVolts = 1.0f;
+    offsetVolts = 0.0f;
     sourceNodeId = -1;
     isMonitored = false;
     isEnabled = true;
@@ -59,6 +60,7 @@ Channel::Channel(const Channel& ch)
     processor = ch.processor;
     sampleRate = ch.sampleRate;
     bitVolts = ch.bitVolts;
+    offsetVolts = ch.offsetVolts;
     type = ch.type;
     sourceNodeId = ch.sourceNodeId;
     isMonitored = ch.isMonitored;
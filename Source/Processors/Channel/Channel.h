@@ -125,6 +125,10 @@ public:
         convert to the original voltage measurement?). */
     float bitVolts;
 
+    /** The voltage of an ADC integer value of 0, taken as signed 16 bits, for
+        converters whose range is not centred on zero (0 otherwise). */
+    float offsetVolts;
+
     /** Channel "type": neural data, aux, adc, event **/
     ChannelType type;
 
@@ -0,0 +1,204 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ChannelGatherPlan.h"
+
+ChannelGatherPlan::ChannelGatherPlan(int maxReferences_, int maxBlockSize)
+    : maxReferences(maxReferences_), scratchBuffer(maxReferences_ + 1, maxBlockSize)
+{
+    saved.ensureStorageAllocated(maxReferences);
+}
+
+ChannelGatherPlan::~ChannelGatherPlan()
+{
+
+}
+
+void ChannelGatherPlan::prepare(int numChannels)
+{
+    ops.ensureStorageAllocated(2 * numChannels + maxReferences);
+    sources.ensureStorageAllocated(numChannels);
+    references.ensureStorageAllocated(numChannels);
+    readers.ensureStorageAllocated(numChannels);
+    ready.ensureStorageAllocated(numChannels);
+    pending.ensureStorageAllocated(numChannels);
+}
+
+int ChannelGatherPlan::getNumOps() const
+{
+    return ops.size();
+}
+
+void ChannelGatherPlan::build(const Array<int>& newSources, const Array<int>& newReferences, int numChannels)
+{
+    ops.clearQuick();
+    sources.clearQuick();
+    references.clearQuick();
+    readers.clearQuick();
+    ready.clearQuick();
+    pending.clearQuick();
+    saved.clearQuick();
+
+    sources.addArray(newSources);
+    references.addArray(newReferences);
+
+    const int numMapped = sources.size();
+
+    jassert(references.size() == numMapped && numMapped <= numChannels);
+
+    for (int j = 0; j < numChannels; j++)
+        readers.add(0);
+
+    // an output is written if it moves or is referenced
+    for (int j = 0; j < numMapped; j++)
+    {
+        if (sources[j] != j)
+            readers.set(sources[j], readers[sources[j]] + 1);
+    }
+
+    // references that will be overwritten are saved first
+    for (int j = 0; j < numMapped; j++)
+    {
+        int reference = references[j];
+
+        if (reference < 0)
+            continue;
+
+        bool isOverwritten = reference < numMapped
+                             && (sources[reference] != reference || references[reference] != -1);
+
+        if (isOverwritten)
+        {
+            int slot = saved.indexOf(reference);
+
+            if (slot < 0)
+            {
+                slot = saved.size();
+                jassert(slot < maxReferences);
+                saved.add(reference);
+
+                GatherOp save = { -(slot + 2), reference, -1 };
+                ops.add(save);
+            }
+
+            references.set(j, -(slot + 2));
+        }
+    }
+
+    // Each output is written once nothing else needs its old contents. When
+    // only cycles are left, one channel of a cycle is saved to the last
+    // scratch channel and its reader takes it from there.
+    const int cycleSlot = -(maxReferences + 2);
+
+    int numReady = 0;
+
+    ready.insertMultiple(0, 0, numMapped); // a stack, numReady deep
+
+    for (int j = 0; j < numMapped; j++)
+    {
+        pending.add(sources[j] != j || references[j] != -1);
+
+        if (pending[j] && readers[j] == 0)
+            ready.set(numReady++, j);
+    }
+
+    int next = 0;
+
+    while (true)
+    {
+        while (numReady > 0)
+        {
+            int j = ready[--numReady];
+
+            GatherOp op = { j, sources[j], references[j] };
+            ops.add(op);
+            pending.set(j, false);
+
+            int source = sources[j];
+
+            if (source >= 0 && source != j)
+            {
+                readers.set(source, readers[source] - 1);
+
+                if (source < numMapped && pending[source] && readers[source] == 0)
+                    ready.set(numReady++, source);
+            }
+        }
+
+        while (next < numMapped && ! pending[next])
+            next++;
+
+        if (next == numMapped)
+            break;
+
+        // every remaining output is read by exactly one other: a cycle
+        GatherOp save = { cycleSlot, next, -1 };
+        ops.add(save);
+
+        for (int k = 0; k < numMapped; k++)
+        {
+            if (pending[k] && sources[k] == next && k != next)
+                sources.set(k, cycleSlot);
+        }
+
+        readers.set(next, 0);
+        ready.set(numReady++, next);
+    }
+}
+
+float* ChannelGatherPlan::getChannel(AudioSampleBuffer& buffer, int channel)
+{
+    if (channel >= 0)
+        return buffer.getWritePointer(channel);
+    else
+        return scratchBuffer.getWritePointer(-channel - 2);
+}
+
+void ChannelGatherPlan::apply(AudioSampleBuffer& buffer, const int* numSamples)
+{
+    const int maxSamples = jmin(buffer.getNumSamples(), scratchBuffer.getNumSamples());
+
+    for (int i = 0; i < ops.size(); i++)
+    {
+        const GatherOp& op = ops.getReference(i);
+
+        int count = (op.dest >= 0) ? jmin(numSamples[op.dest], maxSamples) : maxSamples;
+
+        float* dest = getChannel(buffer, op.dest);
+        const float* source = getChannel(buffer, op.source);
+
+        if (op.reference == -1)
+        {
+            if (dest != source)
+                FloatVectorOperations::copy(dest, source, count);
+        }
+        else
+        {
+            // mapping and referencing in one pass
+            const float* reference = getChannel(buffer, op.reference);
+
+            for (int n = 0; n < count; n++)
+                dest[n] = source[n] - reference[n];
+        }
+    }
+}
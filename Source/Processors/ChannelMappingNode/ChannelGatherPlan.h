@@ -0,0 +1,101 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __CHANNELGATHERPLAN_H_8C41F2D6__
+#define __CHANNELGATHERPLAN_H_8C41F2D6__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  In-place channel remapping and referencing, as done by the ChannelMappingNode.
+
+  build() turns a mapping (output j = input sources[j] - input references[j])
+  into a list of copies, so that apply() only moves the channels that change
+  place. Reference channels that are overwritten, and one channel of each
+  cycle in the mapping, are first saved to a small scratch buffer; every other
+  output is written in one pass. The result is the same as copying the whole
+  buffer and then mapping from the copy.
+
+  All memory is allocated in the constructor and prepare(); build() and
+  apply() do not allocate.
+
+  @see ChannelMappingNode
+
+*/
+
+class ChannelGatherPlan
+{
+public:
+    /** maxReferences is the largest number of distinct reference channels
+        that will be passed to build(), and maxBlockSize the largest number
+        of samples per channel that apply() processes. */
+    ChannelGatherPlan(int maxReferences, int maxBlockSize);
+    ~ChannelGatherPlan();
+
+    /** Makes room for mappings of up to numChannels channels. */
+    void prepare(int numChannels);
+
+    /** Works out the copies for outputs 0 .. sources.size()-1: output j is
+        input channel sources[j], minus input channel references[j] unless
+        that is -1. Channels from sources.size() on are left as they are. */
+    void build(const Array<int>& sources, const Array<int>& references, int numChannels);
+
+    /** Maps the channels of the buffer in place. numSamples[j] is the number
+        of samples to write to output j. */
+    void apply(AudioSampleBuffer& buffer, const int* numSamples);
+
+    /** Number of copies made by apply(), including the saved channels. */
+    int getNumOps() const;
+
+private:
+
+    /** Writes dest from source (minus reference, unless it is -1). Scratch
+    channels are numbered -2, -3, ... */
+    struct GatherOp
+    {
+        int dest;
+        int source;
+        int reference;
+    };
+
+    float* getChannel(AudioSampleBuffer& buffer, int channel);
+
+    int maxReferences;
+
+    /** Saved references and cycle starts */
+    AudioSampleBuffer scratchBuffer;
+
+    Array<GatherOp> ops;
+    Array<int> sources;
+    Array<int> references;
+    Array<int> readers;
+    Array<int> ready;
+    Array<bool> pending;
+    Array<int> saved;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelGatherPlan);
+
+};
+
+#endif  // __CHANNELGATHERPLAN_H_8C41F2D6__
@@ -188,9 +188,9 @@ void ChannelMappingEditor::createElectrodeButtons(int numNeeded, bool clearPrevi
         referenceArray.add(-1);
 
         getProcessor()->setCurrentChannel(i);
-        getProcessor()->setParameter(0,i); // set channel mapping to standard channel
-        getProcessor()->setParameter(1,-1); // set reference to none
-        getProcessor()->setParameter(3,1); //enable channel
+        getProcessor()->queueParameterChange(0,i); // set channel mapping to standard channel
+        getProcessor()->queueParameterChange(1,-1); // set reference to none
+        getProcessor()->queueParameterChange(3,1); //enable channel
 
         channelArray.add(i+1);
         enabledChannelArray.add(true);
@@ -203,7 +203,7 @@ void ChannelMappingEditor::createElectrodeButtons(int numNeeded, bool clearPrevi
         for (int i = 0; i < NUM_REFERENCES; i++)
         {
 
-            getProcessor()->setParameter(2,i); //Clear reference
+            getProcessor()->queueParameterChange(2,i); //Clear reference
             referenceChannels.add(-1);
             referenceButtons[i]->setEnabled(true);
         }
@@ -307,7 +307,7 @@ void ChannelMappingEditor::buttonEvent(Button* button)
 				{
 					a.add(channelSelector->getNumChannels() - 1);
 					getProcessor()->setCurrentChannel(channelSelector->getNumChannels() - 1);
-					getProcessor()->setParameter(2, selectedReference);
+					getProcessor()->queueParameterChange(2, selectedReference);
 					referenceChannels.set(selectedReference, channelSelector->getNumChannels() - 1);
 				}
             }
@@ -600,12 +600,12 @@ void ChannelMappingEditor::setChannelReference(ElectrodeButton* button)
     if (button->getToggleState())
     {
         referenceArray.set(chan,selectedReference);
-        getProcessor()->setParameter(1,selectedReference);
+        getProcessor()->queueParameterChange(1,selectedReference);
     }
     else
     {
         referenceArray.set(chan,-1);
-        getProcessor()->setParameter(1,-1);
+        getProcessor()->queueParameterChange(1,-1);
     }
 
 }
@@ -616,7 +616,7 @@ void ChannelMappingEditor::channelChanged(int chan)
     {
         setConfigured(true);
         getProcessor()->setCurrentChannel(chan-1);
-        getProcessor()->setParameter(2,selectedReference);
+        getProcessor()->queueParameterChange(2,selectedReference);
         referenceChannels.set(selectedReference,chan-1);
     }
 }
@@ -682,13 +682,13 @@ void ChannelMappingEditor::loadCustomParameters(XmlElement* xml)
 
             getProcessor()->setCurrentChannel(i);
 
-            getProcessor()->setParameter(0, mapping-1); // set mapping
+            getProcessor()->queueParameterChange(0, mapping-1); // set mapping
 
             getProcessor()->setCurrentChannel(mapping-1);
 
-            getProcessor()->setParameter(1, reference); // set reference
+            getProcessor()->queueParameterChange(1, reference); // set reference
 
-            getProcessor()->setParameter(3,enabled ? 1 : 0); //set enabled
+            getProcessor()->queueParameterChange(3,enabled ? 1 : 0); //set enabled
         }
 
     }
@@ -705,7 +705,7 @@ void ChannelMappingEditor::loadCustomParameters(XmlElement* xml)
 
             getProcessor()->setCurrentChannel(channel);
 
-            getProcessor()->setParameter(2,i);
+            getProcessor()->queueParameterChange(2,i);
         }
     }
 
@@ -862,7 +862,7 @@ void ChannelMappingEditor::mouseUp(const MouseEvent& e)
 void ChannelMappingEditor::setChannelPosition(int position, int channel)
 {
     getProcessor()->setCurrentChannel(position);
-    getProcessor()->setParameter(0,channel-1);
+    getProcessor()->queueParameterChange(0,channel-1);
     channelArray.set(position,channel);
 }
 
@@ -877,14 +877,14 @@ void ChannelMappingEditor::mouseDoubleClick(const MouseEvent& e)
             button->setToggleState(false, dontSendNotification);
             enabledChannelArray.set(button->getChannelNum()-1,false);
             getProcessor()->setCurrentChannel(button->getChannelNum()-1);
-            getProcessor()->setParameter(3,0);
+            getProcessor()->queueParameterChange(3,0);
         }
         else
         {
             button->setToggleState(true, dontSendNotification);
             enabledChannelArray.set(button->getChannelNum()-1,true);
             getProcessor()->setCurrentChannel(button->getChannelNum()-1);
-            getProcessor()->setParameter(3,1);
+            getProcessor()->queueParameterChange(3,1);
         }
 		CoreServices::updateSignalChain(this);
     }
@@ -935,7 +935,7 @@ void ChannelMappingEditor::setConfigured(bool state)
     isConfigured = state;
     resetButton->setEnabled(state);
     resetButton->setToggleState(!state, dontSendNotification);
-    getProcessor()->setParameter(4,state?1:0);
+    getProcessor()->queueParameterChange(4,state?1:0);
 }
 
 void ChannelMappingEditor::startAcquisition()
@@ -1050,10 +1050,10 @@ String ChannelMappingEditor::loadPrbFile(File filename)
         electrodeButtons[i]->setEnabled(en);
 		
 		getProcessor()->setCurrentChannel(i);
-		getProcessor()->setParameter(0,ch-1);
+		getProcessor()->queueParameterChange(0,ch-1);
 		getProcessor()->setCurrentChannel(ch-1);
-		getProcessor()->setParameter(1, rf);
-		getProcessor()->setParameter(3, en ? 1 : 0);
+		getProcessor()->queueParameterChange(1, rf);
+		getProcessor()->queueParameterChange(3, en ? 1 : 0);
     }
 	checkUnusedChannels();
 
@@ -1066,7 +1066,7 @@ String ChannelMappingEditor::loadPrbFile(File filename)
         int ch = chans->getUnchecked(i);
         referenceChannels.set(i,ch);
         getProcessor()->setCurrentChannel(ch);
-        getProcessor()->setParameter(2,i);
+        getProcessor()->queueParameterChange(2,i);
     }
 
     referenceButtons[0]->setToggleState(true, sendNotificationSync);
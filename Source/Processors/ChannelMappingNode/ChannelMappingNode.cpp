@@ -28,7 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 
 ChannelMappingNode::ChannelMappingNode()
-    : GenericProcessor("Channel Map"), channelBuffer(1,10000)
+    : GenericProcessor("Channel Map"), gatherPlan(NUM_REFERENCES, 10000)
 {
     referenceArray.resize(1024); // make room for 1024 channels
     channelArray.resize(1024);
@@ -64,9 +64,6 @@ AudioProcessorEditor* ChannelMappingNode::createEditor()
 
 void ChannelMappingNode::updateSettings()
 {
-    if (getNumInputs() > 0)
-        channelBuffer.setSize(getNumInputs(), 10000);
-
 	if (editorIsConfigured)
 	{
 	    OwnedArray<Channel> oldChannels;
@@ -93,6 +90,50 @@ void ChannelMappingNode::updateSettings()
 			channels[i]->setRecordState(recordStates[i]);
 		}
 	}
+
+    // room for the plan of any mapping, so that parameter changes during
+    // acquisition don't allocate
+    gatherPlan.prepare(getNumInputs());
+    gatherSources.ensureStorageAllocated(getNumInputs());
+    gatherReferences.ensureStorageAllocated(getNumInputs());
+    gatherSamples.ensureStorageAllocated(getNumInputs());
+
+    buildGatherPlan();
+}
+
+void ChannelMappingNode::buildGatherPlan()
+{
+    const int numInputs = getNumInputs();
+    const int numOutputs = settings.numOutputs;
+
+    gatherSources.clearQuick();
+    gatherReferences.clearQuick();
+
+    // where each output comes from, in the same order as the channels
+    for (int i = 0; i < numInputs && gatherSources.size() < numOutputs; i++)
+    {
+        int realChan = channelArray[i];
+
+        if ((realChan < numInputs) && (enabledChannelArray[realChan]))
+        {
+            int reference = -1;
+            int group = referenceArray[realChan];
+
+            if ((group > -1) && (referenceChannels[group] > -1)
+                && (referenceChannels[group] < numInputs) && (referenceChannels[group] < channels.size()))
+            {
+                reference = channels[referenceChannels[group]]->index-1;
+
+                if (reference >= numInputs)
+                    reference = -1;
+            }
+
+            gatherSources.add(realChan);
+            gatherReferences.add(reference);
+        }
+    }
+
+    gatherPlan.build(gatherSources, gatherReferences, numInputs);
 }
 
 
@@ -120,51 +161,18 @@ void ChannelMappingNode::setParameter(int parameterIndex, float newValue)
         channelArray.set(currentChannel, (int) newValue);
     }
 
+    buildGatherPlan();
+
 }
 
 void ChannelMappingNode::process(AudioSampleBuffer& buffer,
                                  MidiBuffer& midiMessages)
 {
-    int j=0;
-    int i=0;
-    int realChan;
-
-    // use copy constructor to set the data to refer to
-    channelBuffer = buffer;
-
-   // buffer.clear();
+    gatherSamples.clearQuick();
 
-    while (j < settings.numOutputs)
-    {
-        realChan = channelArray[i];
-        if ((realChan < channelBuffer.getNumChannels()) && (enabledChannelArray[realChan]))
-        {
-            // copy it back into the buffer according to the channel mapping
-            buffer.copyFrom(j, // destChannel
-                           0, // destStartSample
-                           channelBuffer.getReadPointer(realChan), // source
-                           getNumSamples(j), // numSamples
-                           1.0f // gain to apply to source (positive for original signal)
-                          );
-
-            // now do the referencing
-            if ((referenceArray[realChan] > -1) && (referenceChannels[referenceArray[realChan]] > -1)
-                && (referenceChannels[referenceArray[realChan]] < channelBuffer.getNumChannels()))
-            {
-                buffer.addFrom(j, // destChannel
-                               0, // destStartSample
-                               channelBuffer, // source
-							   channels[referenceChannels[referenceArray[realChan]]]->index-1, // sourceChannel
-                               0, // sourceStartSample
-                               getNumSamples(j), // numSamples
-                               -1.0f // gain to apply to source (negative for reference)
-                              );
-            }
-            j++;
-        }
-        i++;
+    for (int j = 0; j < gatherSources.size(); j++)
+        gatherSamples.add(getNumSamples(j));
 
-    }
+    gatherPlan.apply(buffer, gatherSamples.getRawDataPointer());
 
 }
-
@@ -29,6 +29,7 @@
 
 
 #include "../GenericProcessor/GenericProcessor.h"
+#include "ChannelGatherPlan.h"
 
 
 /**
@@ -38,6 +39,9 @@
   Allows the user to select a subset of channels, remap their order, and reference them against
   any other channel.
 
+  The mapping is turned into a list of copies when the settings change, so each block only
+  moves the channels that change place (see ChannelGatherPlan).
+
   @see GenericProcessor
 
 */
@@ -64,6 +68,9 @@ public:
 
 private:
 
+    /** Passes the current mapping to the gather plan. */
+    void buildGatherPlan();
+
     Array<int> referenceArray;
     Array<int> referenceChannels;
     Array<int> channelArray;
@@ -71,7 +78,10 @@ private:
 
     bool editorIsConfigured;
 
-    AudioSampleBuffer channelBuffer;
+    ChannelGatherPlan gatherPlan;
+    Array<int> gatherSources;
+    Array<int> gatherReferences;
+    Array<int> gatherSamples;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelMappingNode);
 
@@ -24,10 +24,12 @@
 #include "DataBuffer.h"
 
 DataBuffer::DataBuffer(int chans, int size)
-    : abstractFifo(size), buffer(chans, size), numChans(chans)
+    : abstractFifo(size), recordsArrivalTimes(false), dataAddedEvent(nullptr), numChans(chans), totalSamplesAdded(0)
 {
+    buffer.setSize(chans, size);
     timestampBuffer.malloc(size);
     eventCodeBuffer.malloc(size);
+    arrivalBuffer.calloc(size);
 
 }
 
@@ -45,6 +47,7 @@ void DataBuffer::resize(int chans, int size)
     buffer.setSize(chans, size);
     timestampBuffer.malloc(size);
     eventCodeBuffer.malloc(size);
+    arrivalBuffer.calloc(size);
 
     numChans = chans;
 }
@@ -56,18 +59,63 @@ void DataBuffer::addToBuffer(float* data, int64* timestamps, uint64* eventCodes,
     abstractFifo.prepareToWrite(numItems, startIndex1, blockSize1, startIndex2, blockSize2);
 
     for (int chan = 0; chan < numChans; chan++)
-    {
-
-        buffer.copyFrom(chan, // int destChannel
-                        startIndex1, // int destStartSample
-                        data + chan,  // const float* source
-                        1); // int num samples
-    }
+        buffer.setSample(chan, startIndex1, data[chan]);
 
     *(timestampBuffer + startIndex1) = *timestamps;
     *(eventCodeBuffer + startIndex1) = *eventCodes;
 
+    if (recordsArrivalTimes)
+        arrivalBuffer[startIndex1] = Time::getHighResolutionTicks();
+
     abstractFifo.finishedWrite(numItems);
+    totalSamplesAdded += numItems;
+
+    if (dataAddedEvent != nullptr)
+        dataAddedEvent->signal();
+}
+
+int DataBuffer::addBlockToBuffer(const AudioSampleBuffer& data, const int64* timestamps, const uint64* eventCodes, int numItems)
+{
+    int startIndex1, blockSize1, startIndex2, blockSize2;
+    abstractFifo.prepareToWrite(numItems, startIndex1, blockSize1, startIndex2, blockSize2);
+
+    const int numChannels = jmin(numChans, data.getNumChannels());
+
+    if (blockSize1 > 0)
+    {
+        for (int chan = 0; chan < numChannels; chan++)
+            buffer.write(chan, startIndex1, data.getReadPointer(chan), blockSize1);
+
+        memcpy(timestampBuffer + startIndex1, timestamps, blockSize1*8);
+        memcpy(eventCodeBuffer + startIndex1, eventCodes, blockSize1*8);
+    }
+
+    if (blockSize2 > 0)
+    {
+        for (int chan = 0; chan < numChannels; chan++)
+            buffer.write(chan, startIndex2, data.getReadPointer(chan, blockSize1), blockSize2);
+
+        memcpy(timestampBuffer + startIndex2, timestamps + blockSize1, blockSize2*8);
+        memcpy(eventCodeBuffer + startIndex2, eventCodes + blockSize1, blockSize2*8);
+    }
+
+    if (recordsArrivalTimes)
+    {
+        const int64 now = Time::getHighResolutionTicks();
+
+        for (int i = 0; i < blockSize1; i++)
+            arrivalBuffer[startIndex1 + i] = now;
+        for (int i = 0; i < blockSize2; i++)
+            arrivalBuffer[startIndex2 + i] = now;
+    }
+
+    abstractFifo.finishedWrite(blockSize1 + blockSize2);
+    totalSamplesAdded += blockSize1 + blockSize2;
+
+    if (dataAddedEvent != nullptr)
+        dataAddedEvent->signal();
+
+    return blockSize1 + blockSize2;
 }
 
 int DataBuffer::getNumSamples()
@@ -75,60 +123,100 @@ int DataBuffer::getNumSamples()
     return abstractFifo.getNumReady();
 }
 
-
-int DataBuffer::readAllFromBuffer(AudioSampleBuffer& data, uint64* timestamp, uint64* eventCodes, int maxSize)
+int64 DataBuffer::getTotalSamplesAdded()
 {
-    // check to see if the maximum size is smaller than the total number of available ints
-
-    // Better version (1/27/14)?
-    int numReady = abstractFifo.getNumReady();
-    int numItems = (maxSize < numReady) ? maxSize : numReady;
+    return totalSamplesAdded;
+}
 
-    // Original version:
-    //int numItems = (maxSize < abstractFifo.getNumReady()) ?
-    //               maxSize : abstractFifo.getNumReady();
 
+int DataBuffer::readAllFromBuffer(AudioSampleBuffer& data, uint64* timestamp, uint64* eventCodes, int maxSize)
+{
     int startIndex1, blockSize1, startIndex2, blockSize2;
-    abstractFifo.prepareToRead(numItems, startIndex1, blockSize1, startIndex2, blockSize2);
+    const int numItems = prepareToRead(maxSize, startIndex1, blockSize1, startIndex2, blockSize2);
+
+    const int numChannels = jmin(numChans, data.getNumChannels());
 
     if (blockSize1 > 0)
     {
+        for (int chan = 0; chan < numChannels; chan++)
+            buffer.read(chan, startIndex1, data.getWritePointer(chan), blockSize1);
 
-        for (int chan = 0; chan < data.getNumChannels(); chan++)
-        {
-            data.copyFrom(chan, // destChan
-                          0,    // destStartSample
-                          buffer, // source
-                          chan,  // sourceChannel
-                          startIndex1,     // sourceStartSample
-                          blockSize1); // numSamples
-        }
-
-        memcpy(timestamp, timestampBuffer+startIndex1, 8);
-        memcpy(eventCodes, eventCodeBuffer+startIndex1, blockSize1*8);
+        *timestamp = timestampBuffer[startIndex1];
+        memcpy(eventCodes, eventCodeBuffer + startIndex1, blockSize1*8);
     }
     else
     {
-        memcpy(timestamp, timestampBuffer+startIndex2, 8);
+        *timestamp = timestampBuffer[startIndex2];
     }
 
     if (blockSize2 > 0)
     {
+        for (int chan = 0; chan < numChannels; chan++)
+            buffer.read(chan, startIndex2, data.getWritePointer(chan, blockSize1), blockSize2);
 
-        for (int chan = 0; chan < data.getNumChannels(); chan++)
-        {
-            data.copyFrom(chan, // destChan
-                          blockSize1,    // destStartSample
-                          buffer, // source
-                          chan,  // sourceChannel
-                          startIndex2,     // sourceStartSample
-                          blockSize2); // numSamples
-        }
-        memcpy(eventCodes + blockSize1, eventCodeBuffer+startIndex2, blockSize2*8);
+        memcpy(eventCodes + blockSize1, eventCodeBuffer + startIndex2, blockSize2*8);
     }
 
-    abstractFifo.finishedRead(numItems);
+    finishedRead(numItems);
 
     return numItems;
+}
+
+int DataBuffer::prepareToRead(int maxSize, int& startIndex1, int& blockSize1, int& startIndex2, int& blockSize2)
+{
+    const int numItems = jmin(maxSize, abstractFifo.getNumReady());
+
+    abstractFifo.prepareToRead(numItems, startIndex1, blockSize1, startIndex2, blockSize2);
 
-}
\ No newline at end of file
+    return blockSize1 + blockSize2;
+}
+
+void DataBuffer::finishedRead(int numItems)
+{
+    abstractFifo.finishedRead(numItems);
+}
+
+void DataBuffer::readSamples(int chan, int startIndex, float* dest, int numItems)
+{
+    buffer.read(chan, startIndex, dest, numItems);
+}
+
+const int64* DataBuffer::getTimestamps(int startIndex)
+{
+    return timestampBuffer + startIndex;
+}
+
+const uint64* DataBuffer::getEventCodes(int startIndex)
+{
+    return eventCodeBuffer + startIndex;
+}
+
+int DataBuffer::getNumChannels()
+{
+    return numChans;
+}
+
+void DataBuffer::setChannelStep(int chan, float step, float offset)
+{
+    buffer.setStep(chan, step, offset);
+}
+
+CompactSampleBuffer::Format DataBuffer::getFormat()
+{
+    return buffer.getFormat();
+}
+
+void DataBuffer::setRecordsArrivalTimes(bool shouldRecord)
+{
+    recordsArrivalTimes = shouldRecord;
+}
+
+const int64* DataBuffer::getArrivalTimes(int startIndex)
+{
+    return arrivalBuffer + startIndex;
+}
+
+void DataBuffer::setDataAddedEvent(WaitableEvent* event)
+{
+    dataAddedEvent = event;
+}
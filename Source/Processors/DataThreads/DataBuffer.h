@@ -25,11 +25,15 @@
 #define __DATABUFFER_H_11C6C591__
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../GenericProcessor/CompactSampleBuffer.h"
 
 /**
 
 	Manages reading and writing data to a circular buffer.
 
+    The samples can be held in 16 bits (see CompactSampleBuffer), in which
+    case they are converted as they are added and read.
+
     See @DataThread
 
 */
@@ -47,24 +51,75 @@ public:
     /** Add an array of floats to the buffer.*/
     void addToBuffer(float* data, int64* ts, uint64* eventCodes, int numItems);
 
+    /** Adds numItems samples from every channel of a (channel-major) block,
+        along with one timestamp and event code per sample. Returns the number
+        of samples that fit into the buffer.*/
+    int addBlockToBuffer(const AudioSampleBuffer& data, const int64* ts, const uint64* eventCodes, int numItems);
+
     /** Returns the number of samples currently available in the buffer.*/
     int getNumSamples();
 
+    /** Returns the number of samples added since the buffer was created. Only
+        meaningful on the thread that fills the buffer.*/
+    int64 getTotalSamplesAdded();
+
     /** Copies as many samples as possible from the DataBuffer to an AudioSampleBuffer.*/
     int readAllFromBuffer(AudioSampleBuffer& data, uint64* ts, uint64* eventCodes, int maxSize);
 
+    /** Gives access to up to maxSize waiting samples without copying them, as one
+        or two contiguous regions of the buffer (as in AbstractFifo::prepareToRead()).
+        The regions stay valid until finishedRead() is called. Returns the total
+        number of samples in the regions.*/
+    int prepareToRead(int maxSize, int& startIndex1, int& blockSize1, int& startIndex2, int& blockSize2);
+
+    /** Releases samples obtained with prepareToRead(), so they can be overwritten.*/
+    void finishedRead(int numItems);
+
+    /** Converts numItems samples of a channel, from a region returned by
+        prepareToRead(), into dest.*/
+    void readSamples(int chan, int startIndex, float* dest, int numItems);
+
+    /** Read-only pointers into the buffer, for regions returned by prepareToRead().*/
+    const int64* getTimestamps(int startIndex);
+    const uint64* getEventCodes(int startIndex);
+
+    /** Returns the number of channels in the buffer.*/
+    int getNumChannels();
+
+    /** Sets the value of one stored step of a channel (its bitVolts) and the
+        value of a stored 0 (its offsetVolts), for the int16 format. Not to be
+        called while the buffer is being filled.*/
+    void setChannelStep(int chan, float step, float offset = 0.0f);
+
+    CompactSampleBuffer::Format getFormat();
+
+    /** If enabled, every sample is tagged with the time (in high-resolution
+        ticks) it was added to the buffer.*/
+    void setRecordsArrivalTimes(bool shouldRecord);
+    const int64* getArrivalTimes(int startIndex);
+
+    /** Sets an event to signal whenever new samples are added (e.g. to wake
+        up the ProcessingThread), or nullptr for none.*/
+    void setDataAddedEvent(WaitableEvent* event);
+
     /** Resizes the data buffer */
     void resize(int chans, int size);
 
 private:
     AbstractFifo abstractFifo;
-    AudioSampleBuffer buffer;
+    CompactSampleBuffer buffer;
 
     HeapBlock<int64> timestampBuffer;
     HeapBlock<uint64> eventCodeBuffer;
+    HeapBlock<int64> arrivalBuffer;
+    bool recordsArrivalTimes;
+
+    WaitableEvent* dataAddedEvent;
 
     int numChans;
 
+    int64 totalSamplesAdded;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DataBuffer);
 
 };
@@ -24,12 +24,64 @@
 #include "DataThread.h"
 #include "../SourceNode/SourceNode.h"
 
+#ifdef WIN32
+#include <windows.h>
+#elif JUCE_MAC
+#include <mach/mach.h>
+#else
+#include <time.h>
+#endif
+
+#define METRICS_INTERVAL_SECONDS 10
+
+namespace
+{
+    /** CPU time used by the calling thread, in seconds */
+    double getThreadCpuSeconds()
+    {
+#ifdef WIN32
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+
+        if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+            return 0;
+
+        const uint64 kernel = ((uint64) kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime;
+        const uint64 user = ((uint64) userTime.dwHighDateTime << 32) | userTime.dwLowDateTime;
+
+        return (kernel + user) * 1.0e-7; // 100 ns units
+#elif JUCE_MAC
+        mach_port_t thread = mach_thread_self();
+        thread_basic_info_data_t info;
+        mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+
+        const kern_return_t result = thread_info(thread, THREAD_BASIC_INFO, (thread_info_t) &info, &count);
+        mach_port_deallocate(mach_task_self(), thread);
+
+        if (result != KERN_SUCCESS)
+            return 0;
+
+        return info.user_time.seconds + info.system_time.seconds
+               + (info.user_time.microseconds + info.system_time.microseconds) * 1.0e-6;
+#else
+        timespec t;
+
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t) != 0)
+            return 0;
+
+        return t.tv_sec + t.tv_nsec * 1.0e-9;
+#endif
+    }
+}
+
 
 DataThread::DataThread(SourceNode* s) : Thread("Data Thread"), dataBuffer(0)
 {
     sn = s;
     setPriority(10);
 
+    setWaitMode(WAIT_ADAPTIVE);
+    metricsValid = false;
+
     timestamp = 0; // set default to zero, so that sources that
     // do not generate their own timestamps can simply increment
     // this value
@@ -41,8 +93,43 @@ DataThread::~DataThread()
     //deleteAndZero(dataBuffer);
 }
 
+void DataThread::setWaitMode(DataThreadWaitMode mode, double spinMs)
+{
+    waitMode = mode;
+    spinTicks = (int64)(spinMs * 0.001 * Time::getHighResolutionTicksPerSecond());
+}
+
+bool DataThread::getMetrics(DataThreadMetrics& metrics)
+{
+    const ScopedLock sl(metricsLock);
+
+    metrics = lastMetrics;
+
+    return metricsValid;
+}
+
 void DataThread::run()
 {
+    const double ticksPerSample = getSampleRate() > 0 ? Time::getHighResolutionTicksPerSecond() / getSampleRate() : 0;
+    const int64 reportInterval = Time::secondsToHighResolutionTicks(METRICS_INTERVAL_SECONDS);
+
+    {
+        const ScopedLock sl(metricsLock);
+        metricsValid = false;
+    }
+
+    int64 samplesAdded = dataBuffer->getTotalSamplesAdded();
+    int64 nextBlockDue = 0;
+    int samplesPerBlock = 0;
+
+    // Each delivery is compared with the sample clock: (arrival time - samples
+    // delivered so far / sample rate) is constant if every block enters the
+    // DataBuffer as soon as it is available, and grows with any extra delay.
+    const int64 startTicks = Time::getHighResolutionTicks();
+    int64 intervalStart = startTicks;
+    double intervalCpuStart = getThreadCpuSeconds();
+    double minOffset = 0, maxOffset = 0, sumOffset = 0;
+    int numBlocks = 0, numUpdates = 0;
 
     while (!threadShouldExit())
     {
@@ -58,6 +145,93 @@ void DataThread::run()
             sn->acquisitionStopped();
         }
 
+        const int64 now = Time::getHighResolutionTicks();
+        const int64 total = dataBuffer->getTotalSamplesAdded();
+
+        numUpdates++;
+
+        if (total > samplesAdded)
+        {
+            samplesPerBlock = (int)(total - samplesAdded);
+            samplesAdded = total;
+            nextBlockDue = now + (int64)(samplesPerBlock * ticksPerSample);
+
+            const double offset = (now - startTicks) - samplesAdded * ticksPerSample;
+
+            if (numBlocks == 0 || offset < minOffset)
+                minOffset = offset;
+            if (numBlocks == 0 || offset > maxOffset)
+                maxOffset = offset;
+
+            sumOffset += offset;
+            numBlocks++;
+        }
+        else if (waitMode == WAIT_ADAPTIVE)
+        {
+            waitForNextBlock(now, ticksPerSample > 0 ? nextBlockDue : 0);
+        }
+
+        if (now - intervalStart >= reportInterval && numBlocks > 0)
+        {
+            const double cpuSeconds = getThreadCpuSeconds();
+            const double msPerTick = 1000.0 / Time::getHighResolutionTicksPerSecond();
+
+            DataThreadMetrics metrics;
+            metrics.cpuLoad = (cpuSeconds - intervalCpuStart) / Time::highResolutionTicksToSeconds(now - intervalStart);
+            metrics.meanLatencyMs = (sumOffset / numBlocks - minOffset) * msPerTick;
+            metrics.maxLatencyMs = (maxOffset - minOffset) * msPerTick;
+            metrics.updatesPerBlock = double(numUpdates) / numBlocks;
+            metrics.samplesPerBlock = samplesPerBlock;
+
+            {
+                const ScopedLock sl(metricsLock);
+                lastMetrics = metrics;
+                metricsValid = true;
+            }
+
+            std::cout << getThreadName() << ": CPU " << metrics.cpuLoad * 100.0 << "%, latency mean "
+                      << metrics.meanLatencyMs << " ms, max " << metrics.maxLatencyMs << " ms, "
+                      << metrics.updatesPerBlock << " updates per block of " << samplesPerBlock << " samples" << std::endl;
+
+            intervalStart = now;
+            intervalCpuStart = cpuSeconds;
+            sumOffset = 0;
+            numBlocks = 0;
+            numUpdates = 0;
+        }
+
+    }
+}
+
+void DataThread::waitForNextBlock(int64 now, int64 nextBlockDue)
+{
+    if (nextBlockDue == 0)
+    {
+        // no block size yet
+        wait(1);
+        return;
+    }
+
+    const int64 ticksToDue = nextBlockDue - now;
+
+    if (ticksToDue > spinTicks)
+    {
+        // sleep through most of the block, rounding down to whole ms
+        const int ms = (int)((ticksToDue - spinTicks) * 1000 / Time::getHighResolutionTicksPerSecond());
+
+        if (ms > 0)
+            wait(ms);
+        else
+            Thread::yield();
+    }
+    else if (ticksToDue > -spinTicks)
+    {
+        Thread::yield();
+    }
+    else
+    {
+        // the block is late, keep polling without spinning
+        wait(1);
     }
 }
 
@@ -90,6 +264,11 @@ void DataThread::updateChannels()
     }
 }
 
+float DataThread::getOffsetVolts(Channel* chan)
+{
+    return 0.0f;
+}
+
 void DataThread::setOutputHigh() {}
 
 void DataThread::setOutputLow() {}
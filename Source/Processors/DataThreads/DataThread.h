@@ -39,6 +39,31 @@ struct ChannelCustomInfo
     bool modified;
 };
 
+/** How DataThread::run() waits for new data between calls to updateBuffer(). */
+enum DataThreadWaitMode
+{
+    WAIT_ADAPTIVE = 0, /**< sleep until shortly before the next block is due, then poll */
+    WAIT_BLOCKING,     /**< updateBuffer() waits for the data itself */
+    WAIT_BUSY          /**< call updateBuffer() back to back */
+};
+
+/** Statistics of a DataThread over its last report interval. */
+struct DataThreadMetrics
+{
+    /** CPU time used by the thread, as a fraction of one core */
+    double cpuLoad;
+
+    /** Delay between the data becoming available and entering the DataBuffer.
+        Measured against the sample clock, relative to the fastest delivery
+        of the interval, so constant transfer delays are not included. */
+    double meanLatencyMs;
+    double maxLatencyMs;
+
+    /** Calls to updateBuffer() per delivered block, and the last block size */
+    double updatesPerBlock;
+    int samplesPerBlock;
+};
+
 /**
 
   Abstract base class for a data input thread owned by the SourceNode.
@@ -60,9 +85,20 @@ public:
     DataThread(SourceNode* sn);
     ~DataThread();
 
-    /** Calls 'updateBuffer()' continuously while the thread is being run.*/
+    /** Calls 'updateBuffer()' continuously while the thread is being run,
+    waiting between calls according to the wait mode.*/
     void run();
 
+    /** Sets how run() waits for data. In adaptive mode, the thread sleeps until
+    spinMs before the next block is expected (predicted from the sample rate and
+    the size of the previous block), and polls without sleeping from then until
+    spinMs after it. Larger values lower the latency at the cost of CPU time.*/
+    void setWaitMode(DataThreadWaitMode mode, double spinMs = 0.5);
+
+    /** Fills in the statistics of the last report interval. Returns false if
+    no interval has been completed since acquisition started.*/
+    bool getMetrics(DataThreadMetrics& metrics);
+
     /** Returns the address of the DataBuffer that the input source will fill.*/
     DataBuffer* getBufferAddress();
 
@@ -102,6 +138,10 @@ public:
     /** Returns the volts per bit of the data source.*/
     virtual float getBitVolts(Channel* chan) = 0;
 
+    /** Returns the voltage of an ADC value of 0 (as a signed 16-bit integer),
+        if the channel's range is not centred on zero. The default is 0.*/
+    virtual float getOffsetVolts(Channel* chan);
+
     /** Returns the number of event channels of the data source.*/
 	virtual int getNumEventChannels();
 
@@ -142,6 +182,16 @@ protected:
 private:
     Time timer;
 
+    /** Sleeps or spins after an updateBuffer() call that delivered no data.*/
+    void waitForNextBlock(int64 now, int64 nextBlockDue);
+
+    DataThreadWaitMode waitMode;
+    int64 spinTicks;
+
+    CriticalSection metricsLock;
+    DataThreadMetrics lastMetrics;
+    bool metricsValid;
+
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DataThread);
 
@@ -168,6 +168,8 @@ std::vector<std::wstring> GetEcubeModuleChannels(IEcubeModulePtr& mp)
 
 EcubeThread::EcubeThread(SourceNode* sn) : DataThread(sn), numberingScheme(1), acquisition_running(false)
 {
+    setWaitMode(WAIT_BLOCKING); // updateBuffer() waits in WaitForData()
+
     try
     {
         EcubeDialogComponent component;
@@ -35,6 +35,8 @@ FPGAThread::FPGAThread(SourceNode* sn)
       isTransmitting(false), deviceFound(false), bytesToRead(20000),
       ttlState(0), ttlOutputVal(0), bufferWasAligned(false), numchannels(32)
 {
+    setWaitMode(WAIT_BLOCKING); // ReadFromPipeOut() waits for the data
+
     //const char* bitfilename = "./pipetest.bit";
 #if JUCE_LINUX
     const char* bitfilename = "./pipetest.bit";
@@ -31,6 +31,8 @@ FileReaderThread::FileReaderThread(SourceNode* sn) :
     bufferSize = 1600;
     dataBuffer = new DataBuffer(16, bufferSize*3);
 
+    setWaitMode(WAIT_BLOCKING); // updateBuffer() paces itself by the buffer level
+
     eventCode = 0;
 
     std::cout << "File Reader Thread initialized." << std::endl;
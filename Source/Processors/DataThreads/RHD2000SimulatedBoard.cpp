@@ -0,0 +1,268 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RHD2000SimulatedBoard.h"
+#include "rhythm-api/rhd2000datablock.h"
+
+#define SINE_TABLE_SIZE 1024
+
+namespace
+{
+    const double boardSampleRates[] = { 1000.0, 1250.0, 1500.0, 2000.0, 2500.0, 3000.0, 3333.0, 4000.0,
+                                        5000.0, 6250.0, 8000.0, 10000.0, 12500.0, 15000.0, 20000.0,
+                                        25000.0, 30000.0
+                                      };
+
+    /** +/- 500 bits (about 100 uV), so that the traces are visible at the default LFP viewer range */
+    struct SineTable
+    {
+        SineTable()
+        {
+            for (int i = 0; i < SINE_TABLE_SIZE; i++)
+                values[i] = (int) (500.0 * std::sin(2.0 * double_Pi * i / SINE_TABLE_SIZE));
+        }
+
+        int values[SINE_TABLE_SIZE];
+    };
+
+    const SineTable sineTable;
+
+    inline void writeWord(unsigned char* p, uint16 word)
+    {
+        p[0] = (unsigned char)(word & 0xff);
+        p[1] = (unsigned char)(word >> 8);
+    }
+}
+
+RHD2000SimulationSettings::RHD2000SimulationSettings()
+    : usb3(true), realtime(true), sampleRateIndex(16)
+{
+}
+
+RHD2000SimulationSettings RHD2000SimulationSettings::fromString(const String& description)
+{
+    RHD2000SimulationSettings settings;
+
+    StringArray tokens;
+    tokens.addTokens(description, " ,;", String::empty);
+    tokens.removeEmptyStrings();
+
+    for (int i = 0; i < tokens.size(); i++)
+    {
+        const String token = tokens[i].trim().toLowerCase();
+
+        if (token == "2132")
+        {
+            settings.headstageChipId.add(CHIP_ID_RHD2132);
+            settings.headstageChannels.add(32);
+        }
+        else if (token == "2132/16")
+        {
+            settings.headstageChipId.add(CHIP_ID_RHD2132);
+            settings.headstageChannels.add(16);
+        }
+        else if (token == "2216")
+        {
+            settings.headstageChipId.add(CHIP_ID_RHD2216);
+            settings.headstageChannels.add(16);
+        }
+        else if (token == "2164")
+        {
+            settings.headstageChipId.add(CHIP_ID_RHD2164);
+            settings.headstageChannels.add(64);
+        }
+        else if (token.startsWith("rate="))
+        {
+            settings.sampleRateIndex = getSampleRateIndex(token.fromFirstOccurrenceOf("=", false, false).getDoubleValue());
+        }
+        else if (token == "usb2" || token == "usb3")
+        {
+            settings.usb3 = (token == "usb3");
+        }
+        else if (token == "realtime" || token == "unthrottled")
+        {
+            settings.realtime = (token == "realtime");
+        }
+        else
+        {
+            std::cout << "Unknown RHD2000 simulation setting: " << token << std::endl;
+        }
+    }
+
+    if (settings.headstageChipId.size() == 0)
+    {
+        settings.headstageChipId.add(CHIP_ID_RHD2132);
+        settings.headstageChannels.add(32);
+    }
+
+    return settings;
+}
+
+int RHD2000SimulationSettings::getSampleRateIndex(double rate)
+{
+    int index = 0;
+
+    for (int i = 1; i < numElementsInArray(boardSampleRates); i++)
+    {
+        if (std::abs(boardSampleRates[i] - rate) < std::abs(boardSampleRates[index] - rate))
+            index = i;
+    }
+
+    return index;
+}
+
+RHD2000SimulatedBoard::RHD2000SimulatedBoard(const RHD2000StreamLayout& layout, bool realtime_)
+    : usb3(layout.usb3), realtime(realtime_), sampleRate(layout.sampleRate), timestamp(0), startTicks(0)
+{
+    numStreams = layout.numChannels.size();
+
+    const int samplesPerBlock = Rhd2000DataBlock::getSamplesPerDataBlock(usb3);
+    bytesPerFrame = 2 * Rhd2000DataBlock::calculateDataBlockSizeInWords(numStreams, usb3) / samplesPerBlock;
+}
+
+RHD2000SimulatedBoard::~RHD2000SimulatedBoard() {}
+
+uint16 RHD2000SimulatedBoard::amplifierWord(int stream, int channel, uint32 ts)
+{
+    // a different frequency (29 - 469 Hz at 30 kHz) and offset for each channel
+    const uint32 id = stream * 32 + channel;
+    const uint32 step = id % 16 + 1;
+
+    return (uint16)(32768 + (id % 64) * 16 + sineTable.values[(ts * step + id * 37) & (SINE_TABLE_SIZE - 1)]);
+}
+
+uint16 RHD2000SimulatedBoard::auxWord(int stream, uint32 ts)
+{
+    // the three aux inputs are sampled in turn, one every 4th sample
+    return (uint16)(32768 + 1000 * (ts % 4) + 100 * stream);
+}
+
+uint16 RHD2000SimulatedBoard::adcWord(int adcChannel, uint32 ts)
+{
+    return (uint16)((ts * (adcChannel + 1) * 4) & 0xffff);
+}
+
+uint16 RHD2000SimulatedBoard::ttlInWord(uint32 ts)
+{
+    // input k toggles every 2^(10+k) samples
+    return (uint16)((ts >> 10) & 0xff);
+}
+
+void RHD2000SimulatedBoard::generateFrames(unsigned char* buffer, int numSamples)
+{
+    const uint64 magic = RHD2000_HEADER_MAGIC_NUMBER;
+
+    for (int samp = 0; samp < numSamples; samp++)
+    {
+        unsigned char* p = buffer + samp * bytesPerFrame;
+        const uint32 ts = timestamp++;
+
+        for (int i = 0; i < 8; i++)
+            *p++ = (unsigned char)(magic >> (8*i));
+
+        for (int i = 0; i < 4; i++)
+            *p++ = (unsigned char)(ts >> (8*i));
+
+        // aux command results (only the second command returns data)
+        for (int slot = 0; slot < 3; slot++)
+        {
+            for (int stream = 0; stream < numStreams; stream++)
+            {
+                writeWord(p, slot == 1 ? auxWord(stream, ts) : 0);
+                p += 2;
+            }
+        }
+
+        // amplifier channels, interleaved by data stream
+        for (int chan = 0; chan < 32; chan++)
+        {
+            for (int stream = 0; stream < numStreams; stream++)
+            {
+                writeWord(p, amplifierWord(stream, chan, ts));
+                p += 2;
+            }
+        }
+
+        // filler words
+        for (int stream = 0; stream < numStreams; stream++)
+        {
+            writeWord(p, 0);
+            p += 2;
+        }
+
+        for (int adcChan = 0; adcChan < 8; adcChan++)
+        {
+            writeWord(p, adcWord(adcChan, ts));
+            p += 2;
+        }
+
+        writeWord(p, ttlInWord(ts)); // TTL in
+        writeWord(p + 2, 0);         // TTL out
+    }
+}
+
+bool RHD2000SimulatedBoard::readBlock(unsigned char* buffer, int numBytes)
+{
+    const int numSamples = numBytes / bytesPerFrame;
+
+    if (startTicks == 0)
+        startTicks = Time::getHighResolutionTicks();
+
+    if (realtime && usb3)
+    {
+        // like the USB3 board, a read returns once the whole block has been acquired
+        const int64 due = startTicks + (int64)((timestamp + numSamples) / sampleRate
+                                               * Time::getHighResolutionTicksPerSecond());
+
+        int64 now;
+
+        while ((now = Time::getHighResolutionTicks()) < due)
+        {
+            const int msLeft = (int)(Time::highResolutionTicksToSeconds(due - now) * 1000.0);
+            Thread::sleep(jmax(1, msLeft));
+        }
+    }
+
+    generateFrames(buffer, numSamples);
+
+    return true;
+}
+
+unsigned int RHD2000SimulatedBoard::numWordsInFifo()
+{
+    if (!realtime)
+        return 0;
+
+    if (startTicks == 0)
+        startTicks = Time::getHighResolutionTicks();
+
+    const double elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+    const int64 samplesAvailable = (int64)(elapsed * sampleRate) - timestamp;
+
+    return (unsigned int) jmax<int64>(0, samplesAvailable * bytesPerFrame / 2);
+}
+
+bool RHD2000SimulatedBoard::needsFifoPolling()
+{
+    return realtime && !usb3;
+}
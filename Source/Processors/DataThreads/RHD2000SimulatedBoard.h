@@ -0,0 +1,129 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __RHD2000SIMULATEDBOARD_H_E41D08B6__
+#define __RHD2000SIMULATEDBOARD_H_E41D08B6__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+#include "RHD2000UsbPipeline.h"
+
+/**
+
+  Configuration of a simulated Rhythm board.
+
+  Can be parsed from a string of space-separated tokens, e.g.
+  "2164 2164 2132/16 2216 rate=20000 usb2 unthrottled":
+
+  - 2132, 2132/16 (RHD2132 used as a 16-channel headstage), 2216 and 2164
+    add a headstage of that type, starting at port A1;
+  - rate=N selects one of the board's sample rates;
+  - usb2 / usb3 select the USB frame format (default usb3);
+  - realtime / unthrottled select the data rate (default realtime).
+
+  RHD2000Thread uses the contents of the OPEN_EPHYS_RHD2000_SIMULATION
+  environment variable, if it is set. It connects the headstages to the
+  board's ports as a board would, so it simulates at most MAX_NUM_HEADSTAGES
+  headstages and MAX_NUM_DATA_STREAMS data streams (512 amplifier channels
+  over USB3, 256 over USB2), and skips the rest with a message. This is the
+  limit of a Rhythm board, not of the simulation: RHD2000SimulatedBoard and
+  RHD2000UsbPipeline take any number of data streams, and
+  Tests/RHD2000UsbPipelineTest.cpp runs them with up to 2048 channels.
+
+*/
+
+struct RHD2000SimulationSettings
+{
+    RHD2000SimulationSettings();
+
+    static RHD2000SimulationSettings fromString(const String& description);
+
+    /** Returns the index of the board sample rate closest to rate
+        (in the order of Rhd2000EvalBoard::AmplifierSampleRate) */
+    static int getSampleRateIndex(double rate);
+
+    bool usb3;
+    bool realtime;
+    int sampleRateIndex;
+
+    /** Chip ID (CHIP_ID_xxx) and number of amplifier channels of each headstage */
+    Array<int> headstageChipId;
+    Array<int> headstageChannels;
+};
+
+/**
+
+  Generates the USB frames of a Rhythm board in software.
+
+  Every frame has the same layout as the board's (magic number, 32-bit
+  timestamp, aux command results, amplifier words interleaved by data
+  stream, filler words, ADC words, TTL in and out), so everything
+  downstream of the USB read -- parsing, aux demultiplexing and DataBuffer
+  filling -- runs exactly as with a board. The signals are deterministic
+  functions of stream, channel and timestamp (see amplifierWord() etc.), so
+  parsed data can be checked sample by sample.
+
+  In real-time mode blocks are released at the sample rate (USB3 reads
+  wait for the data, USB2 reads are gated by numWordsInFifo()); otherwise
+  they are generated as fast as they are read.
+
+  The number of data streams is not limited to the board's.
+
+  @see RHD2000Thread, RHD2000UsbPipeline
+
+*/
+
+class RHD2000SimulatedBoard : public RHD2000BlockSource
+{
+public:
+    RHD2000SimulatedBoard(const RHD2000StreamLayout& layout, bool realtime);
+    ~RHD2000SimulatedBoard();
+
+    bool readBlock(unsigned char* buffer, int numBytes);
+    unsigned int numWordsInFifo();
+    bool needsFifoPolling();
+
+    /** Writes numSamples frames, starting at the current timestamp.*/
+    void generateFrames(unsigned char* buffer, int numSamples);
+
+    /** Simulated signals, as raw 16-bit words. Amplifier channels are chip
+        channels (0-31), i.e. before the offset of 16-channel RHD2132s.*/
+    static uint16 amplifierWord(int stream, int channel, uint32 timestamp);
+    static uint16 auxWord(int stream, uint32 timestamp);
+    static uint16 adcWord(int adcChannel, uint32 timestamp);
+    static uint16 ttlInWord(uint32 timestamp);
+
+private:
+    int numStreams;
+    int bytesPerFrame;
+    bool usb3;
+    bool realtime;
+    double sampleRate;
+
+    uint32 timestamp;
+    int64 startTicks;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RHD2000SimulatedBoard);
+};
+
+#endif  // __RHD2000SIMULATEDBOARD_H_E41D08B6__
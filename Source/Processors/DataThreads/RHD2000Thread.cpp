@@ -36,13 +36,8 @@
 #define okLIB_EXTENSION "*.so"
 #endif
 
-#define CHIP_ID_RHD2132  1
-#define CHIP_ID_RHD2216  2
-#define CHIP_ID_RHD2164  4
-#define CHIP_ID_RHD2164_B  1000
 #define REGISTER_59_MISO_A  53
 #define REGISTER_59_MISO_B  58
-#define RHD2132_16CH_OFFSET 8
 
 //#define DEBUG_EMULATE_HEADSTAGES 8
 //#define DEBUG_EMULATE_64CH
@@ -71,6 +66,7 @@ RHD2000Thread::RHD2000Thread(SourceNode* sn) : DataThread(sn),
     chipRegisters(30000.0f),
     numChannels(0),
     deviceFound(false),
+    simulated(false),
     isTransmitting(false),
     dacOutputShouldChange(false),
     acquireAdcChannels(false),
@@ -90,8 +86,8 @@ RHD2000Thread::RHD2000Thread(SourceNode* sn) : DataThread(sn),
 	newScan(true), ledsEnabled(true)
 {
 	impedanceThread = new RHDImpedanceMeasure(this);
-	memset(auxBuffer, 0, sizeof(auxBuffer));
-	memset(auxSamples, 0, sizeof(auxSamples));
+
+    setWaitMode(WAIT_BLOCKING); // updateBuffer() waits for the USB pipeline
 
     for (int i=0; i < MAX_NUM_HEADSTAGES; i++)
         headstagesArray.add(new RHDHeadstage(static_cast<Rhd2000EvalBoard::BoardDataSource>(i)));
@@ -124,7 +120,32 @@ RHD2000Thread::RHD2000Thread(SourceNode* sn) : DataThread(sn),
     dacChannels = nullptr;
     dacThresholds = nullptr;
     dacChannelsToUpdate = nullptr;
-    if (openBoard(libraryFilePath))
+
+    const String simulation = SystemStats::getEnvironmentVariable("OPEN_EPHYS_RHD2000_SIMULATION", String::empty);
+
+    if (simulation.isNotEmpty())
+    {
+        // no board is opened, so that acquisition can be benchmarked on any machine
+        std::cout << "Simulating an RHD2000 eval board: " << simulation << std::endl;
+
+        simulated = true;
+        simulationSettings = RHD2000SimulationSettings::fromString(simulation);
+
+        dacStream = new int[8];
+        dacChannels = new int[8];
+        dacThresholds = new float[8];
+        dacChannelsToUpdate = new bool[8];
+        for (int k = 0; k < 8; k++)
+        {
+            dacChannelsToUpdate[k] = true;
+            dacStream[k] = 0;
+            dacChannels[k] = 0;
+            dacThresholds[k] = 0;
+        }
+
+        startSimulation();
+    }
+    else if (openBoard(libraryFilePath))
     {
 		dataBlock = new Rhd2000DataBlock(1,evalBoard->isUSB3());
         // upload bitfile and restore default settings
@@ -430,8 +451,63 @@ void RHD2000Thread::initializeBoard()
 
 }
 
+void RHD2000Thread::startSimulation()
+{
+    enabledStreams.clear();
+    numChannelsPerDataStream.clear();
+    chipId.clear();
+
+    for (int hs = 0; hs < MAX_NUM_HEADSTAGES; ++hs)
+        enableHeadstage(hs, false);
+
+    const int maxStreams = MAX_NUM_DATA_STREAMS(simulationSettings.usb3);
+
+    for (int hs = 0; hs < simulationSettings.headstageChipId.size() && hs < MAX_NUM_HEADSTAGES; ++hs)
+    {
+        const int id = simulationSettings.headstageChipId[hs];
+
+        if (id == CHIP_ID_RHD2164 && enabledStreams.size() < maxStreams - 1)
+        {
+            chipId.add(CHIP_ID_RHD2164);
+            chipId.add(CHIP_ID_RHD2164_B);
+            enableHeadstage(hs, true, 2, 32);
+        }
+        else if (id != CHIP_ID_RHD2164 && enabledStreams.size() < maxStreams)
+        {
+            chipId.add(id);
+            enableHeadstage(hs, true, 1, id == CHIP_ID_RHD2132 ? 32 : 16);
+
+            if (id == CHIP_ID_RHD2132 && simulationSettings.headstageChannels[hs] == 16)
+                setNumChannels(hs, 16);
+        }
+        else
+        {
+            std::cout << "Too many data streams, not simulating headstage " << hs << std::endl;
+        }
+    }
+
+    chipId.insertMultiple(-1, -1, 8 - chipId.size());
+
+    setSampleRate(simulationSettings.sampleRateIndex);
+
+    std::cout << "Simulated data streams: " << enabledStreams.size() << ", channels: " << getNumChannels() << std::endl;
+
+    newScan = true;
+}
+
+bool RHD2000Thread::isSimulated()
+{
+    return simulated;
+}
+
 void RHD2000Thread::scanPorts()
 {
+    if (simulated)
+    {
+        startSimulation();
+        return;
+    }
+
 	if (!deviceFound) //Safety to avoid crashes if board not present
 	{
 		return;
@@ -930,6 +1006,9 @@ int RHD2000Thread::getNumEventChannels()
 
 float RHD2000Thread::getSampleRate()
 {
+    if (simulated)
+        return boardSampleRate;
+
     return evalBoard->getSampleRate();
 }
 
@@ -943,6 +1022,15 @@ float RHD2000Thread::getBitVolts(Channel* ch)
         return 0.195f;
 }
 
+float RHD2000Thread::getOffsetVolts(Channel* ch)
+{
+    // the ADCs are unsigned, scaled to +/-5V, with a DC offset (see RHD2000UsbPipeline)
+    if (ch->type == ADC_CHANNEL)
+        return getAdcBitVolts(ch->index) * 32768.0f - 5.0f - 0.4096f;
+    else
+        return 0.0f;
+}
+
 float RHD2000Thread::getAdcBitVolts(int chan)
 {
     if (chan < adcBitVolts.size())
@@ -1034,7 +1122,7 @@ int RHD2000Thread::setNoiseSlicerLevel(int level)
 bool RHD2000Thread::foundInputSource()
 {
 
-    return deviceFound;
+    return deviceFound || simulated;
 
 }
 
@@ -1113,7 +1201,7 @@ bool RHD2000Thread::isHeadstageEnabled(int hsNum)
 
 bool RHD2000Thread::isReady()
 {
-	return deviceFound && (getNumChannels() > 0);
+	return (deviceFound || simulated) && (getNumChannels() > 0);
 }
 
 int RHD2000Thread::getActiveChannelsInHeadstage(int hsNum)
@@ -1264,6 +1352,9 @@ void RHD2000Thread::setSampleRate(int sampleRateIndex, bool isTemporary)
     }
 
 
+    if (!deviceFound)
+        return;
+
     // Select per-channel amplifier sampling rate.
     evalBoard->setSampleRate(sampleRate);
 
@@ -1391,39 +1482,70 @@ void RHD2000Thread::setCableLength(int hsNum, float length)
 bool RHD2000Thread::startAcquisition()
 {
 	impedanceThread->waitSafely();
-    dataBlock = new Rhd2000DataBlock(evalBoard->getNumEnabledDataStreams(), evalBoard->isUSB3());
 
     std::cout << "Expecting " << getNumChannels() << " channels." << std::endl;
 
-    //memset(filter_states,0,256*sizeof(double));
+    if (!simulated)
+    {
+        dataBlock = new Rhd2000DataBlock(evalBoard->getNumEnabledDataStreams(), evalBoard->isUSB3());
 
-    int ledArray[8] = {1, 1, 0, 0, 0, 0, 0, 0};
-    evalBoard->setLedDisplay(ledArray);
+        //memset(filter_states,0,256*sizeof(double));
 
-    cout << "Number of 16-bit words in FIFO: " << evalBoard->numWordsInFifo() << endl;
-    cout << "Is eval board running: " << evalBoard->isRunning() << endl;
+        int ledArray[8] = {1, 1, 0, 0, 0, 0, 0, 0};
+        evalBoard->setLedDisplay(ledArray);
 
+        cout << "Number of 16-bit words in FIFO: " << evalBoard->numWordsInFifo() << endl;
+        cout << "Is eval board running: " << evalBoard->isRunning() << endl;
 
-    //std::cout << "Setting max timestep." << std::endl;
-    //evalBoard->setMaxTimeStep(100);
 
+        //std::cout << "Setting max timestep." << std::endl;
+        //evalBoard->setMaxTimeStep(100);
+
+
+        std::cout << "Starting acquisition." << std::endl;
 
-    std::cout << "Starting acquisition." << std::endl;
-    if (1)
-    {
         // evalBoard->setContinuousRunMode(false);
         //  evalBoard->setMaxTimeStep(0);
         std::cout << "Flushing FIFO." << std::endl;
         evalBoard->flush();
         evalBoard->setContinuousRunMode(true);
-		//evalBoard->printFIFOmetrics();
+        //evalBoard->printFIFOmetrics();
         evalBoard->run();
-		//evalBoard->printFIFOmetrics();
+        //evalBoard->printFIFOmetrics();
+    }
+
+    const bool usb3 = simulated ? simulationSettings.usb3 : evalBoard->isUSB3();
+
+    blockSize = Rhd2000DataBlock::calculateDataBlockSizeInWords(enabledStreams.size(), usb3);
+	std::cout << "Expecting blocksize of " << blockSize << " for " << enabledStreams.size() << " streams" << std::endl;
+
+    RHD2000StreamLayout layout;
+    layout.usb3 = usb3;
+    layout.acquireAdcChannels = acquireAdcChannels;
+    layout.sampleRate = getSampleRate();
+
+    for (int i = 0; i < enabledStreams.size(); i++)
+    {
+        layout.chipId.add(chipId[i]);
+        layout.numChannels.add(numChannelsPerDataStream[i]);
     }
 
-    blockSize = dataBlock->calculateDataBlockSizeInWords(evalBoard->getNumEnabledDataStreams(), evalBoard->isUSB3());
-	std::cout << "Expecting blocksize of " << blockSize << " for " << evalBoard->getNumEnabledDataStreams() << " streams" << std::endl;
-	//evalBoard->printFIFOmetrics();
+    // split the parsing by data stream if there are many streams and enough cores
+    int numParserThreads = jmin((enabledStreams.size() + RHD2000_STREAMS_PER_PARSER_THREAD - 1) / RHD2000_STREAMS_PER_PARSER_THREAD,
+                                SystemStats::getNumCpus() - 2);
+
+    RHD2000BlockSource* source;
+
+    if (simulated)
+        source = new RHD2000SimulatedBoard(layout, simulationSettings.realtime);
+    else
+        source = new RHDBoardSource(this);
+
+    usbPipeline = new RHD2000UsbPipeline(source, layout, jmax(1, numParserThreads));
+
+    std::cout << "Parsing USB data on " << usbPipeline->getNumParserThreads() << " thread(s)." << std::endl;
+
+    usbPipeline->start();
     startThread();
 
 
@@ -1448,11 +1570,25 @@ bool RHD2000Thread::stopAcquisition()
     {
         std::cout << "Thread exited." << std::endl;
     }
+    else if (usbPipeline != nullptr)
+    {
+        // updateBuffer() is still parsing from the pipeline, which is about
+        // to be deleted; parseNextBlock() returns within 100 ms
+        std::cout << "Thread failed to exit, waiting for it to leave the USB pipeline..." << std::endl;
+        waitForThreadToExit(-1);
+    }
     else
     {
         std::cout << "Thread failed to exit, continuing anyway..." << std::endl;
     }
 
+    if (usbPipeline != nullptr)
+    {
+        usbPipeline->stop();
+        usbPipeline->logMetrics();
+        usbPipeline = nullptr;
+    }
+
     if (deviceFound)
     {
         evalBoard->setContinuousRunMode(false);
@@ -1485,200 +1621,13 @@ bool RHD2000Thread::stopAcquisition()
 
 bool RHD2000Thread::updateBuffer()
 {
-	int chOffset;
-	unsigned char* bufferPtr;
-    //cout << "Number of 16-bit words in FIFO: " << evalBoard->numWordsInFifo() << endl;
-    //cout << "Block size: " << blockSize << endl;
-   
-	//std::cout << "Current number of words: " <<  evalBoard->numWordsInFifo() << " for " << blockSize << std::endl;
-    if (evalBoard->isUSB3() || evalBoard->numWordsInFifo() >= blockSize)
-    {
-		bool return_code;
-
-		return_code = evalBoard->readRawDataBlock(&bufferPtr);
-
-		int index = 0;
-		int auxIndex, chanIndex;
-		int numStreams = enabledStreams.size();
-		int nSamps = Rhd2000DataBlock::getSamplesPerDataBlock(evalBoard->isUSB3());
-		
-		//evalBoard->printFIFOmetrics();
-        for (int samp = 0; samp < nSamps; samp++)
-        {
-            int channel = -1;
-
-			if (!Rhd2000DataBlock::checkUsbHeader(bufferPtr, index))
-			{
-				cerr << "Error in Rhd2000EvalBoard::readDataBlock: Incorrect header." << endl;
-				break;
-			}
-
-			index += 8;
-			timestamp = Rhd2000DataBlock::convertUsbTimeStamp(bufferPtr,index);
-			index += 4;
-			auxIndex = index;
-			//skip the aux channels
-			index += numStreams * 6;
-			// do the neural data channels first
-			for (int dataStream = 0; dataStream < numStreams; dataStream++)
-			{
-				int nChans = numChannelsPerDataStream[dataStream];
-				chanIndex = index + 2*dataStream;
-				if ((chipId[dataStream] == CHIP_ID_RHD2132) && (nChans == 16)) //RHD2132 16ch. headstage
-				{
-					chanIndex += 2 * RHD2132_16CH_OFFSET*numStreams;
-				}
-				for (int chan = 0; chan < nChans; chan++)
-				{
-					channel++;
-					thisSample[channel] = float(*(uint16*)(bufferPtr + chanIndex) - 32768)*0.195f;
-					chanIndex += 2*numStreams;
-				}
-			}
-			index += 64 * numStreams;
-			//now we can do the aux channels
-			auxIndex += 2*numStreams;
-			for (int dataStream = 0; dataStream < numStreams; dataStream++)
-			{
-				if (chipId[dataStream] != CHIP_ID_RHD2164_B)
-				{
-					int auxNum = (samp+3) % 4;
-					if (auxNum < 3)
-					{
-						auxSamples[dataStream][auxNum] = float(*(uint16*)(bufferPtr + auxIndex) - 32768)*0.0000374;
-					}
-					for (int chan = 0; chan < 3; chan++)
-					{
-						channel++;
-						if (auxNum == 3)
-						{
-							auxBuffer[channel] = auxSamples[dataStream][chan];
-						}
-						thisSample[channel] = auxBuffer[channel];
-					}
-				}
-				auxIndex += 2;
-
-			}
-			index += 2 * numStreams;
-			if (acquireAdcChannels)
-			{
-				for (int adcChan = 0; adcChan < 8; ++adcChan)
-				{
-
-					channel++;
-					// ADC waveform units = volts
-					thisSample[channel] =
-						//0.000050354 * float(dataBlock->boardAdcData[adcChan][samp]);
-						0.00015258789 * float(*(uint16*)(bufferPtr + index)) - 5 - 0.4096; // account for +/-5V input range and DC offset
-					index += 2;
-				}
-			}
-			else
-			{
-				index += 16;
-			}
-			eventCode = *(uint16*)(bufferPtr + index);
-			index += 4;
-			dataBuffer->addToBuffer(thisSample, &timestamp, &eventCode, 1);
-#if 0
-            // do the neural data channels first
-            for (int dataStream = 0; dataStream < enabledStreams.size(); dataStream++)
-            {
-				if ((chipId[dataStream] == CHIP_ID_RHD2132) && (numChannelsPerDataStream[dataStream] == 16)) //RHD2132 16ch. headstage
-					chOffset = RHD2132_16CH_OFFSET;
-				else
-					chOffset = 0;
-                for (int chan = 0; chan < numChannelsPerDataStream[dataStream]; chan++)
-                {
-
-                    //  std::cout << "reading sample stream " << streamNumber << " chan " << chan << " sample "<< samp << std::endl;
-
-                    channel++;
-
-                    int value = dataBlock->amplifierData[dataStream][chan+chOffset][samp];
-
-                    thisSample[channel] = float(value-32768)*0.195f;
-                }
-
-
-            }
-
-
-            // then do the Intan AUX channels
-            for (int dataStream = 0; dataStream < enabledStreams.size(); dataStream++)
-            {
-                if (chipId[dataStream] != CHIP_ID_RHD2164_B) //Channel B of 2164 shouldn't be copied
-                {
-                    if (samp % 4 == 1)   // every 4th sample should have auxiliary input data
-                    {
-
-                        // std::cout << "reading sample stream " << streamNumber << " aux ADCs " << std::endl;
-
-                        channel++;
-						thisSample[channel] = 0.0000374 *
-							float(dataBlock->auxiliaryData[dataStream][1][samp + 0] - 32768);
-                        // constant offset keeps the values visible in the LFP Viewer
-
-                        auxBuffer[channel] = thisSample[channel];
-
-                        channel++;
-						thisSample[channel] = 0.0000374 *
-							float(dataBlock->auxiliaryData[dataStream][1][samp + 1] - 32768);
-                        // constant offset keeps the values visible in the LFP Viewer
-
-                        auxBuffer[channel] = thisSample[channel];
-
-
-                        channel++;
-						thisSample[channel] = 0.0000374 *
-							float(dataBlock->auxiliaryData[dataStream][1][samp + 2] - 32768);
-                        // constant offset keeps the values visible in the LFP Viewer
-
-                        auxBuffer[channel] = thisSample[channel];
-
-                    }
-                    else    // repeat last values from buffer
-                    {
-
-                        //std::cout << "reading sample stream " << streamNumber << " aux ADCs " << std::endl;
-
-                        channel++;
-                        thisSample[channel] = auxBuffer[channel];
-                        channel++;
-                        thisSample[channel] = auxBuffer[channel];
-                        channel++;
-                        thisSample[channel] = auxBuffer[channel];
-                    }
-                }
-
-            }
-
-            // finally, loop through acquisition board ADC channels if necessary
-            if (acquireAdcChannels)
-            {
-                for (int adcChan = 0; adcChan < 8; ++adcChan)
-                {
-
-                    channel++;
-                    // ADC waveform units = volts
-                    thisSample[channel] =
-                        //0.000050354 * float(dataBlock->boardAdcData[adcChan][samp]);
-                        0.00015258789 * float(dataBlock->boardAdcData[adcChan][samp]) - 5 - 0.4096; // account for +/-5V input range and DC offset
-                }
-            }
-            // std::cout << channel << std::endl;
-
-            timestamp = dataBlock->timeStamp[samp];
-            //timestamp = timestamp;
-            eventCode = dataBlock->ttlIn[samp];
-            dataBuffer->addToBuffer(thisSample, &timestamp, &eventCode, 1);
-#endif
-        }
-
-    }
+    // USB transfers happen on the pipeline's reader thread, so this thread
+    // only has to convert the blocks that have arrived
+    return usbPipeline->parseNextBlock(dataBuffer, 100);
+}
 
-	
+void RHD2000Thread::updateDacOutputs()
+{
     if (dacOutputShouldChange)
     {
 		std::cout << "DAC" << std::endl;
@@ -1711,9 +1660,34 @@ bool RHD2000Thread::updateBuffer()
 
         dacOutputShouldChange = false;
     }
-	
+}
+
+bool RHD2000Thread::getPipelineMetrics(RHD2000PipelineMetrics& metrics)
+{
+    if (usbPipeline == nullptr || !isThreadRunning())
+        return false;
+
+    usbPipeline->getMetrics(metrics);
     return true;
+}
+
+RHDBoardSource::RHDBoardSource(RHD2000Thread* b) : board(b) {}
+
+bool RHDBoardSource::readBlock(unsigned char* buffer, int numBytes)
+{
+    board->updateDacOutputs();
 
+    return board->evalBoard->readRawDataBlockInto(buffer);
+}
+
+unsigned int RHDBoardSource::numWordsInFifo()
+{
+    return board->evalBoard->numWordsInFifo();
+}
+
+bool RHDBoardSource::needsFifoPolling()
+{
+    return !board->evalBoard->isUSB3();
 }
 
 int RHD2000Thread::getChannelFromHeadstage(int hs, int ch)
@@ -1815,12 +1789,18 @@ void RHD2000Thread::enableBoardLeds(bool enable)
 	ledsEnabled = enable;
 	if (isAcquisitionActive())
 		dacOutputShouldChange = true;
-	else
+	else if (deviceFound)
 		evalBoard->enableBoardLeds(enable);
 }
 
 void RHD2000Thread::runImpedanceTest(ImpedanceData* data)
 {
+    if (!deviceFound)
+    {
+        data->valid = false;
+        return;
+    }
+
 	impedanceThread->stopThreadSafely();
 	impedanceThread->prepareData(data);
 	impedanceThread->startThread();
@@ -37,6 +37,8 @@
 #include "rhythm-api/okFrontPanelDLL.h"
 
 #include "DataThread.h"
+#include "RHD2000UsbPipeline.h"
+#include "RHD2000SimulatedBoard.h"
 #include "../GenericProcessor/GenericProcessor.h"
 
 #define MAX_NUM_DATA_STREAMS_USB2 8
@@ -48,6 +50,7 @@
 
 class SourceNode;
 class RHDHeadstage;
+class RHDBoardSource;
 class RHDImpedanceMeasure;
 
 struct ImpedanceData
@@ -70,6 +73,7 @@ struct ImpedanceData
 class RHD2000Thread : public DataThread, public Timer
 {
 	friend class RHDImpedanceMeasure;
+	friend class RHDBoardSource;
 public:
     RHD2000Thread(SourceNode* sn);
     ~RHD2000Thread();
@@ -83,6 +87,7 @@ public:
     float getSampleRate();
     float getBitVolts(Channel* chan);
     float getAdcBitVolts(int channelNum);
+    float getOffsetVolts(Channel* chan);
 
     bool isHeadstageEnabled(int hsNum);
     int getChannelsInHeadstage(int hsNum);
@@ -132,6 +137,12 @@ public:
 	void runImpedanceTest(ImpedanceData* data);
 	void enableBoardLeds(bool enable);
 
+    /** Gets the statistics of the USB pipeline. Returns false if acquisition isn't running.*/
+    bool getPipelineMetrics(RHD2000PipelineMetrics& metrics);
+
+    /** Returns true if data come from an RHD2000SimulatedBoard instead of a board.*/
+    bool isSimulated();
+
 private:
 
     bool enableHeadstage(int hsNum, bool enabled, int nStr = 1, int strChans = 32);
@@ -147,9 +158,10 @@ private:
 	int numChannels;
     bool deviceFound;
 
-	float thisSample[MAX_NUM_CHANNELS];
-	float auxBuffer[MAX_NUM_CHANNELS]; // aux inputs are only sampled every 4th sample, so use this to buffer the samples so they can be handles just like the regular neural channels later
-	float auxSamples[MAX_NUM_DATA_STREAMS_USB3][3];
+    bool simulated;
+    RHD2000SimulationSettings simulationSettings;
+
+    ScopedPointer<RHD2000UsbPipeline> usbPipeline;
 
     unsigned int blockSize;
 
@@ -185,12 +197,19 @@ private:
     bool uploadBitfile(String pathToBitfile);
     void initializeBoard();
 
+    /** Enables the headstages of a simulated board, in place of scanPorts().*/
+    void startSimulation();
+
     void updateRegisters();
 
     int deviceId(Rhd2000DataBlock* dataBlock, int stream, int& register59Value);
 
     bool updateBuffer();
 
+    /** Applies DAC, TTL and LED settings that changed during acquisition.
+        Called by the USB reader thread between reads.*/
+    void updateDacOutputs();
+
     double cableLengthPortA, cableLengthPortB, cableLengthPortC, cableLengthPortD;
 
     int audioOutputL, audioOutputR;
@@ -212,6 +231,31 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RHD2000Thread);
 };
 
+/**
+
+  Feeds the RHD2000UsbPipeline from the evaluation board. Settings that
+  change during acquisition are written to the board between reads, so that
+  the board is only accessed from the pipeline's reader thread.
+
+  @see RHD2000Thread, RHD2000UsbPipeline
+
+*/
+
+class RHDBoardSource : public RHD2000BlockSource
+{
+public:
+    RHDBoardSource(RHD2000Thread* board);
+
+    bool readBlock(unsigned char* buffer, int numBytes);
+    unsigned int numWordsInFifo();
+    bool needsFifoPolling();
+
+private:
+    RHD2000Thread* board;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RHDBoardSource);
+};
+
 class RHDHeadstage
 {
 public:
@@ -0,0 +1,527 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RHD2000UsbPipeline.h"
+#include "rhythm-api/rhd2000datablock.h"
+#include "rhythm-api/rhd2000evalboard.h"
+
+#define METRICS_INTERVAL_SECONDS 10
+#define FIFO_POLL_INTERVAL 16 // blocks between FIFO level checks, if the source doesn't need polling
+
+RHD2000FileSource::RHD2000FileSource(const File& file, int bytesPerSample_, double sampleRate_)
+    : bytesPerSample(bytesPerSample_), sampleRate(sampleRate_), startTicks(0), bytesDelivered(0)
+{
+    input = file.createInputStream();
+
+    if (input == nullptr)
+        std::cout << "Could not open RHD2000 data file " << file.getFullPathName() << std::endl;
+}
+
+RHD2000FileSource::~RHD2000FileSource() {}
+
+bool RHD2000FileSource::isOpen()
+{
+    return input != nullptr;
+}
+
+bool RHD2000FileSource::readBlock(unsigned char* buffer, int numBytes)
+{
+    if (input == nullptr)
+        return false;
+
+    if (startTicks == 0)
+        startTicks = Time::getHighResolutionTicks();
+
+    int numRead = 0;
+
+    while (numRead < numBytes)
+    {
+        int n = input->read(buffer + numRead, numBytes - numRead);
+
+        if (n <= 0)
+        {
+            if (input->getPosition() == 0)
+                return false; // empty file
+
+            input->setPosition(0); // start over
+        }
+        else
+        {
+            numRead += n;
+        }
+    }
+
+    bytesDelivered += numBytes;
+
+    return true;
+}
+
+unsigned int RHD2000FileSource::numWordsInFifo()
+{
+    if (sampleRate <= 0)
+        return 0;
+
+    if (startTicks == 0)
+        startTicks = Time::getHighResolutionTicks();
+
+    double elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+
+    int64 bytesAvailable = (int64)(elapsed * sampleRate) * bytesPerSample - bytesDelivered;
+
+    return (unsigned int) jmax<int64>(0, bytesAvailable / 2);
+}
+
+bool RHD2000FileSource::needsFifoPolling()
+{
+    return sampleRate > 0;
+}
+
+/** Parses the amplifier and aux channels of a subset of the data streams. */
+class RHD2000UsbPipeline::ParserWorker : public Thread
+{
+public:
+    ParserWorker(RHD2000UsbPipeline* p, int first, int last)
+        : Thread("RHD2000 Parser"), pipeline(p), firstStream(first), lastStream(last)
+    {
+        setPriority(10);
+    }
+
+    void run()
+    {
+        while (!threadShouldExit())
+        {
+            if (!startParsing.wait(100) || threadShouldExit())
+                continue;
+
+            pipeline->parseStreams(pipeline->currentBuffer, firstStream, lastStream,
+                                   pipeline->currentNumSamples);
+
+            if (--(pipeline->workersPending) == 0)
+                pipeline->workersDone.signal();
+        }
+    }
+
+    WaitableEvent startParsing;
+
+private:
+    RHD2000UsbPipeline* pipeline;
+    int firstStream, lastStream;
+};
+
+RHD2000UsbPipeline::RHD2000UsbPipeline(RHD2000BlockSource* source_, const RHD2000StreamLayout& layout_,
+                                       int numParserThreads)
+    : Thread("RHD2000 USB Reader"), source(source_), layout(layout_),
+      freeFifo(RHD2000_PIPELINE_POOL_SIZE + 1), filledFifo(RHD2000_PIPELINE_POOL_SIZE + 1),
+      block(1, 1), currentBuffer(nullptr), currentNumSamples(0),
+      lastTransferTicks(0), lastBlocksRead(0), lastParseTicks(0), lastBlocksParsed(0), nextReport(0)
+{
+    setPriority(10);
+
+    numStreams = jmin(layout.chipId.size(), layout.numChannels.size());
+    samplesPerBlock = Rhd2000DataBlock::getSamplesPerDataBlock(layout.usb3);
+    blockSizeInWords = Rhd2000DataBlock::calculateDataBlockSizeInWords(numStreams, layout.usb3);
+    bytesPerFrame = 2 * blockSizeInWords / samplesPerBlock;
+
+    // output order: amplifier channels of all streams, aux channels of all streams, ADCs
+    amplifierOffset.malloc(jmax(1, numStreams));
+    auxOffset.malloc(jmax(1, numStreams));
+
+    numChannels = 0;
+
+    for (int stream = 0; stream < numStreams; stream++)
+    {
+        amplifierOffset[stream] = numChannels;
+        numChannels += layout.numChannels[stream];
+    }
+
+    for (int stream = 0; stream < numStreams; stream++)
+    {
+        if (layout.chipId[stream] != CHIP_ID_RHD2164_B)
+        {
+            auxOffset[stream] = numChannels;
+            numChannels += 3;
+        }
+        else
+        {
+            auxOffset[stream] = -1;
+        }
+    }
+
+    adcOffset = numChannels;
+
+    if (layout.acquireAdcChannels)
+        numChannels += 8;
+
+    auxSamples.calloc(3 * jmax(1, numStreams));
+    auxHeld.calloc(3 * jmax(1, numStreams));
+
+    pool.malloc(RHD2000_PIPELINE_POOL_SIZE * 2 * blockSizeInWords);
+
+    block.setSize(jmax(1, numChannels), samplesPerBlock);
+    blockTimestamps.malloc(samplesPerBlock);
+    blockEventCodes.malloc(samplesPerBlock);
+
+    // the first share of the streams is parsed by the caller of parseNextBlock()
+    numParserThreads = jlimit(1, jmax(1, numStreams), numParserThreads);
+
+    int streamsPerThread = (numStreams + numParserThreads - 1) / numParserThreads;
+
+    numCallerStreams = jmin(numStreams, streamsPerThread);
+
+    for (int first = streamsPerThread; first < numStreams; first += streamsPerThread)
+        workers.add(new ParserWorker(this, first, jmin(numStreams, first + streamsPerThread)));
+}
+
+RHD2000UsbPipeline::~RHD2000UsbPipeline()
+{
+    stop();
+}
+
+void RHD2000UsbPipeline::start()
+{
+    freeFifo.reset();
+    filledFifo.reset();
+
+    int start1, size1, start2, size2;
+    freeFifo.prepareToWrite(RHD2000_PIPELINE_POOL_SIZE, start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; i++)
+        freeIndices[start1 + i] = i;
+
+    freeFifo.finishedWrite(size1);
+
+    readerFailed.set(0);
+    nextReport = Time::getHighResolutionTicks()
+                 + Time::secondsToHighResolutionTicks(METRICS_INTERVAL_SECONDS);
+
+    for (int i = 0; i < workers.size(); i++)
+        workers[i]->startThread();
+
+    startThread();
+}
+
+void RHD2000UsbPipeline::stop()
+{
+    signalThreadShouldExit();
+
+    for (int i = 0; i < workers.size(); i++)
+        workers[i]->signalThreadShouldExit();
+
+    bufferReleased.signal();
+
+    // The reader may be inside a USB read, which only returns once the block
+    // has arrived or the transfer has timed out. It reads into the pool and
+    // through the source, so neither can be released before it returns.
+    if (!waitForThreadToExit(1000))
+    {
+        std::cout << "RHD2000 USB reader is still in a read, waiting for it to return." << std::endl;
+        waitForThreadToExit(-1);
+    }
+
+    for (int i = 0; i < workers.size(); i++)
+        workers[i]->stopThread(500);
+}
+
+int RHD2000UsbPipeline::getNumChannels()
+{
+    return numChannels;
+}
+
+int RHD2000UsbPipeline::getNumParserThreads()
+{
+    return workers.size() + 1;
+}
+
+void RHD2000UsbPipeline::run()
+{
+    int blocksSincePoll = 0;
+
+    while (!threadShouldExit())
+    {
+        if (freeFifo.getNumReady() == 0)
+        {
+            // the parser is behind; the data wait in the device FIFO in the meantime
+            readerStalls.set(readerStalls.get() + 1);
+            bufferReleased.wait(10);
+            continue;
+        }
+
+        if (source->needsFifoPolling())
+        {
+            unsigned int numWords = source->numWordsInFifo();
+            fifoWords.set((int) numWords);
+
+            if (numWords < blockSizeInWords)
+            {
+                // sleep until the rest of the block should have been acquired
+                // (at least 1 ms, so the parser isn't starved)
+                int ms = 1;
+
+                if (layout.sampleRate > 0)
+                    ms = jlimit(1, 50, (int)((blockSizeInWords - numWords) * 2000.0 / bytesPerFrame / layout.sampleRate));
+
+                wait(ms);
+                continue;
+            }
+        }
+        else if (++blocksSincePoll >= FIFO_POLL_INTERVAL)
+        {
+            fifoWords.set((int) source->numWordsInFifo());
+            blocksSincePoll = 0;
+        }
+
+        int start1, size1, start2, size2;
+        freeFifo.prepareToRead(1, start1, size1, start2, size2);
+        const int index = freeIndices[start1];
+        freeFifo.finishedRead(1);
+
+        unsigned char* buffer = pool + index * 2 * blockSizeInWords;
+
+        const int64 startTicks = Time::getHighResolutionTicks();
+
+        if (!source->readBlock(buffer, 2 * blockSizeInWords))
+        {
+            std::cout << "RHD2000 USB read failed." << std::endl;
+            readerFailed.set(1);
+            blockReady.signal();
+            return;
+        }
+
+        const int64 ticks = Time::getHighResolutionTicks() - startTicks;
+
+        transferTicks.set(transferTicks.get() + ticks);
+        if (ticks > maxTransferTicks.get())
+            maxTransferTicks.set(ticks);
+        blocksRead.set(blocksRead.get() + 1);
+
+        filledFifo.prepareToWrite(1, start1, size1, start2, size2);
+        filledIndices[start1] = index;
+        filledFifo.finishedWrite(1);
+
+        blockReady.signal();
+    }
+}
+
+bool RHD2000UsbPipeline::parseNextBlock(DataBuffer* dataBuffer, int timeoutMs)
+{
+    if (filledFifo.getNumReady() == 0)
+    {
+        blockReady.wait(timeoutMs);
+
+        if (filledFifo.getNumReady() == 0)
+            return readerFailed.get() == 0;
+    }
+
+    const int64 startTicks = Time::getHighResolutionTicks();
+
+    int start1, size1, start2, size2;
+    filledFifo.prepareToRead(1, start1, size1, start2, size2);
+    const int index = filledIndices[start1];
+    filledFifo.finishedRead(1);
+
+    const unsigned char* buffer = pool + index * 2 * blockSizeInWords;
+
+    int numSamples = parseFrames(buffer);
+
+    if (workers.size() > 0)
+    {
+        currentBuffer = buffer;
+        currentNumSamples = numSamples;
+        workersPending.set(workers.size());
+
+        for (int i = 0; i < workers.size(); i++)
+            workers[i]->startParsing.signal();
+    }
+
+    parseStreams(buffer, 0, numCallerStreams, numSamples);
+
+    while (workersPending.get() > 0)
+        workersDone.wait(100);
+
+    // the raw data have been copied, so the reader can reuse the buffer
+    freeFifo.prepareToWrite(1, start1, size1, start2, size2);
+    freeIndices[start1] = index;
+    freeFifo.finishedWrite(1);
+    bufferReleased.signal();
+
+    int numAdded = dataBuffer->addBlockToBuffer(block, blockTimestamps, blockEventCodes, numSamples);
+
+    const int64 endTicks = Time::getHighResolutionTicks();
+    const int64 ticks = endTicks - startTicks;
+
+    parseTicks.set(parseTicks.get() + ticks);
+    if (ticks > maxParseTicks.get())
+        maxParseTicks.set(ticks);
+    blocksParsed.set(blocksParsed.get() + 1);
+    samplesDropped.set(samplesDropped.get() + numSamples - numAdded);
+
+    if (endTicks >= nextReport)
+    {
+        logMetrics();
+        nextReport = endTicks + Time::secondsToHighResolutionTicks(METRICS_INTERVAL_SECONDS);
+    }
+
+    return true;
+}
+
+int RHD2000UsbPipeline::parseFrames(const unsigned char* buffer)
+{
+    const int auxStart = 12;
+    const int adcStart = auxStart + 72 * numStreams;
+    const int ttlStart = adcStart + 16;
+
+    for (int samp = 0; samp < samplesPerBlock; samp++)
+    {
+        const unsigned char* frame = buffer + samp * bytesPerFrame;
+
+        if (!Rhd2000DataBlock::checkUsbHeader(const_cast<unsigned char*>(frame), 0))
+        {
+            std::cerr << "Error in Rhd2000EvalBoard::readDataBlock: Incorrect header." << std::endl;
+            return samp;
+        }
+
+        blockTimestamps[samp] = Rhd2000DataBlock::convertUsbTimeStamp(const_cast<unsigned char*>(frame), 8);
+
+        if (layout.acquireAdcChannels)
+        {
+            for (int adcChan = 0; adcChan < 8; adcChan++)
+            {
+                // ADC waveform units = volts
+                block.setSample(adcOffset + adcChan, samp,
+                                0.00015258789 * float(*(uint16*)(frame + adcStart + 2*adcChan)) - 5 - 0.4096); // account for +/-5V input range and DC offset
+            }
+        }
+
+        blockEventCodes[samp] = *(uint16*)(frame + ttlStart);
+    }
+
+    return samplesPerBlock;
+}
+
+void RHD2000UsbPipeline::parseStreams(const unsigned char* buffer, int firstStream, int lastStream, int numSamples)
+{
+    const int auxStart = 12 + 2 * numStreams; // second aux command slot
+    const int amplifierStart = 12 + 6 * numStreams;
+    const int stride = 2 * numStreams;
+
+    for (int stream = firstStream; stream < lastStream; stream++)
+    {
+        int firstWord = amplifierStart + 2 * stream;
+
+        if ((layout.chipId[stream] == CHIP_ID_RHD2132) && (layout.numChannels[stream] == 16)) //RHD2132 16ch. headstage
+            firstWord += RHD2132_16CH_OFFSET * stride;
+
+        for (int chan = 0; chan < layout.numChannels[stream]; chan++)
+        {
+            float* dest = block.getWritePointer(amplifierOffset[stream] + chan);
+            const unsigned char* src = buffer + firstWord + chan * stride;
+
+            for (int samp = 0; samp < numSamples; samp++)
+            {
+                dest[samp] = float(*(uint16*)(src + samp * bytesPerFrame) - 32768)*0.195f;
+            }
+        }
+
+        if (auxOffset[stream] < 0)
+            continue;
+
+        float* samples = auxSamples + 3 * stream;
+        float* held = auxHeld + 3 * stream;
+
+        float* dest[3] = { block.getWritePointer(auxOffset[stream]),
+                           block.getWritePointer(auxOffset[stream] + 1),
+                           block.getWritePointer(auxOffset[stream] + 2)
+                         };
+
+        for (int samp = 0; samp < numSamples; samp++)
+        {
+            // aux results for one input arrive every 4th sample
+            int auxNum = (samp+3) % 4;
+
+            if (auxNum < 3)
+            {
+                samples[auxNum] = float(*(uint16*)(buffer + samp * bytesPerFrame + auxStart + 2*stream) - 32768)*0.0000374;
+            }
+            else
+            {
+                held[0] = samples[0];
+                held[1] = samples[1];
+                held[2] = samples[2];
+            }
+
+            dest[0][samp] = held[0];
+            dest[1][samp] = held[1];
+            dest[2][samp] = held[2];
+        }
+    }
+}
+
+void RHD2000UsbPipeline::getMetrics(RHD2000PipelineMetrics& m)
+{
+    const double msPerTick = 1000.0 / (double) Time::getHighResolutionTicksPerSecond();
+
+    m.blocksRead = blocksRead.get();
+    m.blocksParsed = blocksParsed.get();
+
+    m.meanTransferMs = m.blocksRead > 0 ? transferTicks.get() * msPerTick / m.blocksRead : 0;
+    m.maxTransferMs = maxTransferTicks.get() * msPerTick;
+    m.meanParseMs = m.blocksParsed > 0 ? parseTicks.get() * msPerTick / m.blocksParsed : 0;
+    m.maxParseMs = maxParseTicks.get() * msPerTick;
+
+    m.blockDurationMs = layout.sampleRate > 0 ? 1000.0 * samplesPerBlock / layout.sampleRate : 0;
+
+    m.fifoWords = (unsigned int) fifoWords.get();
+    m.fifoFill = (float) m.fifoWords / (float) Rhd2000EvalBoard::fifoCapacityInWords();
+
+    m.buffersQueued = filledFifo.getNumReady();
+    m.poolSize = RHD2000_PIPELINE_POOL_SIZE;
+
+    m.readerStalls = readerStalls.get();
+    m.samplesDropped = samplesDropped.get();
+}
+
+void RHD2000UsbPipeline::logMetrics()
+{
+    RHD2000PipelineMetrics m;
+    getMetrics(m);
+
+    const double msPerTick = 1000.0 / (double) Time::getHighResolutionTicksPerSecond();
+
+    const int64 nRead = m.blocksRead - lastBlocksRead;
+    const int64 nParsed = m.blocksParsed - lastBlocksParsed;
+
+    const double transferMs = nRead > 0 ? (transferTicks.get() - lastTransferTicks) * msPerTick / nRead : 0;
+    const double parseMs = nParsed > 0 ? (parseTicks.get() - lastParseTicks) * msPerTick / nParsed : 0;
+
+    std::cout << "RHD2000 pipeline: transfer " << String(transferMs, 3) << " ms (max " << String(m.maxTransferMs, 2)
+              << "), parse " << String(parseMs, 3) << " ms (max " << String(m.maxParseMs, 2)
+              << ") per " << String(m.blockDurationMs, 2) << " ms block; FIFO " << (int) m.fifoWords
+              << " words (" << String(100.0f * m.fifoFill, 3) << "%); " << m.buffersQueued << "/" << m.poolSize
+              << " buffers queued; " << m.readerStalls << " stalls; " << m.samplesDropped << " samples dropped"
+              << std::endl;
+
+    lastTransferTicks = transferTicks.get();
+    lastParseTicks = parseTicks.get();
+    lastBlocksRead = m.blocksRead;
+    lastBlocksParsed = m.blocksParsed;
+}
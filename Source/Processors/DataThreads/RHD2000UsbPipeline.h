@@ -0,0 +1,267 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __RHD2000USBPIPELINE_H_5B7E2A91__
+#define __RHD2000USBPIPELINE_H_5B7E2A91__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+#include "DataBuffer.h"
+
+#define CHIP_ID_RHD2132  1
+#define CHIP_ID_RHD2216  2
+#define CHIP_ID_RHD2164  4
+#define CHIP_ID_RHD2164_B  1000
+#define RHD2132_16CH_OFFSET 8
+
+#define RHD2000_PIPELINE_POOL_SIZE 8
+#define RHD2000_STREAMS_PER_PARSER_THREAD 4
+
+/**
+
+  Source of raw Rhythm USB data for the RHD2000UsbPipeline.
+
+  @see RHD2000UsbPipeline, RHD2000FileSource
+
+*/
+
+class RHD2000BlockSource
+{
+public:
+    virtual ~RHD2000BlockSource() {}
+
+    /** Reads numBytes of raw USB data into buffer. Returns false if
+        acquisition can't continue. May block, but must return eventually
+        (e.g. when the transfer times out): the pipeline waits for it
+        before it is deleted.*/
+    virtual bool readBlock(unsigned char* buffer, int numBytes) = 0;
+
+    /** Returns the number of 16-bit words waiting in the device FIFO.*/
+    virtual unsigned int numWordsInFifo() = 0;
+
+    /** Returns true if readBlock() must only be called once numWordsInFifo()
+        reports a complete block (USB2 boards), false if readBlock() waits
+        for the data by itself (USB3 boards).*/
+    virtual bool needsFifoPolling() = 0;
+};
+
+/**
+
+  Stand-in for the Opal Kelly device that replays raw Rhythm USB data
+  (frames of magic number, timestamp, aux, amplifier, ADC and TTL words)
+  from a file, starting over at the end of the file.
+
+  If a sample rate is given, the data are released in real time and the
+  FIFO level grows when the reader falls behind, as it would on a board;
+  otherwise blocks are delivered as fast as they are requested.
+
+  @see RHD2000UsbPipeline
+
+*/
+
+class RHD2000FileSource : public RHD2000BlockSource
+{
+public:
+    RHD2000FileSource(const File& file, int bytesPerSample, double sampleRate = 0);
+    ~RHD2000FileSource();
+
+    /** Returns false if the file could not be opened.*/
+    bool isOpen();
+
+    bool readBlock(unsigned char* buffer, int numBytes);
+    unsigned int numWordsInFifo();
+    bool needsFifoPolling();
+
+private:
+    ScopedPointer<FileInputStream> input;
+
+    int bytesPerSample;
+    double sampleRate;
+
+    int64 startTicks;
+    int64 bytesDelivered;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RHD2000FileSource);
+};
+
+/** Describes the contents of a USB frame, i.e. which data streams are
+    enabled and how their channels end up in the DataBuffer. */
+struct RHD2000StreamLayout
+{
+    bool usb3;
+    bool acquireAdcChannels;
+    double sampleRate;
+
+    /** Chip ID (CHIP_ID_xxx) of each enabled data stream */
+    Array<int> chipId;
+
+    /** Number of amplifier channels read from each data stream */
+    Array<int> numChannels;
+};
+
+/** Live statistics of an RHD2000UsbPipeline. Times are per USB block. */
+struct RHD2000PipelineMetrics
+{
+    double meanTransferMs;
+    double maxTransferMs;
+    double meanParseMs;
+    double maxParseMs;
+
+    /** Amount of signal contained in one block */
+    double blockDurationMs;
+
+    /** Last value of numWordsInFifo(), and as a fraction of the FIFO size */
+    unsigned int fifoWords;
+    float fifoFill;
+
+    /** Blocks that have been read but not parsed yet */
+    int buffersQueued;
+    int poolSize;
+
+    int64 blocksRead;
+    int64 blocksParsed;
+
+    /** Number of times the reader had to wait for a free buffer */
+    int64 readerStalls;
+
+    /** Samples that did not fit into the DataBuffer */
+    int64 samplesDropped;
+};
+
+/**
+
+  Two-stage acquisition pipeline for the RHD2000 evaluation board.
+
+  The pipeline's own thread only moves data over USB: it takes an empty
+  buffer from a pool, reads one block from the RHD2000BlockSource into it
+  and hands it to the parser. parseNextBlock() (called by the DataThread)
+  converts the queued blocks into DataBuffer samples, and gives the buffers
+  back to the reader. While one block is being parsed, the next one is
+  already being transferred.
+
+  With more than a few data streams, the amplifier and aux channels of a
+  block can be split by data stream across several parser threads.
+
+  @see RHD2000Thread, RHD2000BlockSource
+
+*/
+
+class RHD2000UsbPipeline : public Thread
+{
+public:
+    RHD2000UsbPipeline(RHD2000BlockSource* source, const RHD2000StreamLayout& layout,
+                       int numParserThreads = 1);
+    ~RHD2000UsbPipeline();
+
+    /** Starts the reader and parser threads.*/
+    void start();
+
+    /** Stops all threads, waiting for a USB read in progress to return.
+        Blocks that have been read but not parsed are discarded.*/
+    void stop();
+
+    /** Waits up to timeoutMs for a block from the reader and adds its
+        samples to the DataBuffer. Returns false if the reader has stopped
+        because of an error.*/
+    bool parseNextBlock(DataBuffer* dataBuffer, int timeoutMs);
+
+    /** Returns the number of DataBuffer channels the layout produces.*/
+    int getNumChannels();
+
+    /** Returns the number of parser threads (including the caller of parseNextBlock()).*/
+    int getNumParserThreads();
+
+    /** Fills in the means and maxima since start().*/
+    void getMetrics(RHD2000PipelineMetrics& metrics);
+
+    /** Prints the metrics since the previous call.*/
+    void logMetrics();
+
+    /** Reader thread.*/
+    void run();
+
+private:
+
+    class ParserWorker;
+
+    /** Checks the headers and reads timestamps, ADCs and TTL inputs.
+        Returns the number of valid samples in the block.*/
+    int parseFrames(const unsigned char* buffer);
+
+    /** Reads amplifier and aux channels of data streams [firstStream, lastStream).*/
+    void parseStreams(const unsigned char* buffer, int firstStream, int lastStream, int numSamples);
+
+    ScopedPointer<RHD2000BlockSource> source;
+    RHD2000StreamLayout layout;
+
+    int numStreams;
+    int numChannels;
+    int samplesPerBlock;
+    int bytesPerFrame;
+    unsigned int blockSizeInWords;
+
+    /** Offsets of each stream's amplifier and aux channels in the output
+        (aux offset is -1 for the second stream of an RHD2164) */
+    HeapBlock<int> amplifierOffset;
+    HeapBlock<int> auxOffset;
+    int adcOffset;
+
+    /** Aux inputs are sampled every 4th sample, so the last values are held */
+    HeapBlock<float> auxSamples;
+    HeapBlock<float> auxHeld;
+
+    HeapBlock<unsigned char> pool;
+
+    /** Indices of empty and filled pool buffers (an AbstractFifo holds one
+        item less than its size) */
+    AbstractFifo freeFifo, filledFifo;
+    int freeIndices[RHD2000_PIPELINE_POOL_SIZE + 1];
+    int filledIndices[RHD2000_PIPELINE_POOL_SIZE + 1];
+
+    WaitableEvent blockReady, bufferReleased;
+
+    AudioSampleBuffer block;
+    HeapBlock<int64> blockTimestamps;
+    HeapBlock<uint64> blockEventCodes;
+
+    OwnedArray<ParserWorker> workers;
+    int numCallerStreams;
+    WaitableEvent workersDone;
+    Atomic<int> workersPending;
+    const unsigned char* currentBuffer;
+    int currentNumSamples;
+
+    Atomic<int> readerFailed;
+    Atomic<int> fifoWords;
+
+    Atomic<int64> transferTicks, maxTransferTicks, blocksRead, readerStalls;
+    Atomic<int64> parseTicks, maxParseTicks, blocksParsed, samplesDropped;
+
+    /** Totals at the previous logMetrics() call */
+    int64 lastTransferTicks, lastBlocksRead, lastParseTicks, lastBlocksParsed;
+    int64 nextReport;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RHD2000UsbPipeline);
+};
+
+#endif  // __RHD2000USBPIPELINE_H_5B7E2A91__
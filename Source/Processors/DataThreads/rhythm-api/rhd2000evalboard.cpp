@@ -1449,6 +1449,19 @@ bool Rhd2000EvalBoard::readDataBlock(Rhd2000DataBlock *dataBlock, int nSamples)
 }
 
 bool Rhd2000EvalBoard::readRawDataBlock(unsigned char** bufferPtr, int nSamples)
+{
+	if (!readRawDataBlockInto(usbBuffer, nSamples))
+	{
+		*bufferPtr = nullptr;
+		return false;
+	}
+	*bufferPtr = usbBuffer;
+	return true;
+}
+
+// Same as readRawDataBlock, but reads into a buffer supplied by the caller (which must hold
+// at least 2 * calculateDataBlockSizeInWords() bytes), so that several blocks can be in flight.
+bool Rhd2000EvalBoard::readRawDataBlockInto(unsigned char* buffer, int nSamples)
 {
 	unsigned int numBytesToRead;
 	long res;
@@ -1458,26 +1471,24 @@ bool Rhd2000EvalBoard::readRawDataBlock(unsigned char** bufferPtr, int nSamples)
 	if (numBytesToRead > USB_BUFFER_SIZE) {
 		cerr << "Error in Rhd2000EvalBoard::readDataBlock: USB buffer size exceeded.  " <<
 			"Increase value of USB_BUFFER_SIZE." << endl;
-		*bufferPtr = nullptr;
 		return false;
 	}
 
 	if (usb3)
 	{
 		//std::cout << "usb3 read : " << numBytesToRead << " in " << USB3_BLOCK_SIZE << " blocks" << std::endl;
-		res = dev->ReadFromBlockPipeOut(PipeOutData, USB3_BLOCK_SIZE, numBytesToRead, usbBuffer);
+		res = dev->ReadFromBlockPipeOut(PipeOutData, USB3_BLOCK_SIZE, numBytesToRead, buffer);
 
 	}
 	else
 	{
 		//std::cout << "usb2 read: " << numBytesToRead << std::endl;
-		res = dev->ReadFromPipeOut(PipeOutData, numBytesToRead, usbBuffer);
+		res = dev->ReadFromPipeOut(PipeOutData, numBytesToRead, buffer);
 	}
 	if (res == ok_Timeout)
 	{
 		cerr << "CRITICAL: Timeout on pipe read. Check block and buffer sizes." << endl;
 	}
-	*bufferPtr = usbBuffer;
 	return true;
 }
 
@@ -169,6 +169,7 @@ public:
 	bool isUSB3();
 	void printFIFOmetrics();
 	bool readRawDataBlock(unsigned char** bufferPtr, int nSamples = -1);
+	bool readRawDataBlockInto(unsigned char* buffer, int nSamples = -1);
 
 private:
     okCFrontPanel *dev;
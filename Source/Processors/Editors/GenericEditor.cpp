@@ -70,6 +70,8 @@ void GenericEditor::constructorInitialize(GenericProcessor* owner, bool useDefau
 
     nodeId = owner->getNodeId();
 
+    parameterButtonUpdater = new ParameterButtonUpdater(this);
+
     //MemoryInputStream mis(BinaryData::silkscreenserialized, BinaryData::silkscreenserializedSize, false);
     //Typeface::Ptr typeface = new CustomTypeface(mis);
     titleFont = Font("Small Text", 10, Font::plain);
@@ -1037,6 +1039,12 @@ SaveButton::SaveButton() : ImageButton("Save")
 
 void GenericEditor::updateParameterButtons(int parameterIndex)
 {
+    if (!MessageManager::getInstance()->isThisTheMessageThread())
+    {
+        // called by a queued parameter change on the processing thread
+        parameterButtonUpdater->triggerAsyncUpdate();
+        return;
+    }
 
     if (parameterEditors.size() == 0)
     {
@@ -325,6 +325,22 @@ private:
     /** Stores the editor's background gradient. */
     ColourGradient backgroundGradient;
 
+    /** Repeats updateParameterButtons() on the message thread when it is
+        called while a queued parameter change is being applied. */
+    class ParameterButtonUpdater : public AsyncUpdater
+    {
+    public:
+        ParameterButtonUpdater(GenericEditor* e) : editor(e) { }
+        void handleAsyncUpdate()
+        {
+            editor->updateParameterButtons(-1);
+        }
+    private:
+        GenericEditor* editor;
+    };
+
+    ScopedPointer<ParameterButtonUpdater> parameterButtonUpdater;
+
     bool isSelected;
     bool isEnabled;
     bool isCollapsed;
@@ -28,12 +28,15 @@
 
 
 EventDetector::EventDetector()
-    : GenericProcessor("Event Detector"), threshold(200.0), bufferZone(5.0f), state(false)
+    : GenericProcessor("Event Detector"), threshold(200.0), bufferZone(5.0f),
+      numBlocks(0), numEdges(0), processingTicks(0)
 
 {
 
     parameters.add(Parameter("thresh", 0.0, 500.0, 200.0, 0));
 
+    thresholds.add(threshold); // the first channel is watched by default
+
 }
 
 EventDetector::~EventDetector()
@@ -41,17 +44,73 @@ EventDetector::~EventDetector()
 
 }
 
+void EventDetector::updateSettings()
+{
+    while (thresholds.size() < getNumInputs())
+        thresholds.add(0.0f);
+
+    // edges beyond the first 1024 of a block are counted as dropped
+    detector.setNumChannels(getNumInputs(), 1024);
+
+    for (int c = 0; c < getNumInputs(); c++)
+        setThreshold(c, thresholds[c]);
+}
+
+void EventDetector::setThreshold(int channel, float newThreshold)
+{
+    detector.setLevels(channel, newThreshold, newThreshold - bufferZone, true);
+    detector.setEnabled(channel, newThreshold > 0.0f);
+}
+
+bool EventDetector::enable()
+{
+    if (SystemStats::getEnvironmentVariable("OPEN_EPHYS_EVENT_DETECTOR_BENCHMARK", String::empty).isNotEmpty())
+    {
+        ThresholdDetector::runBenchmark(jmax(getNumInputs(), 1), 1024);
+    }
+
+    detector.reset();
+
+    numBlocks = 0;
+    numEdges = 0;
+    processingTicks = 0;
 
+    return true;
+}
+
+bool EventDetector::disable()
+{
+    if (numBlocks > 0)
+    {
+        std::cout << "Event Detector: " << numEdges << " edges in " << numBlocks << " blocks, "
+                  << Time::highResolutionTicksToSeconds(processingTicks) * 1.0e9
+                  / (double(numBlocks) * jmax(getNumInputs(), 1))
+                  << " ns per channel per block";
+
+        if (detector.getNumDroppedEdges() > 0)
+            std::cout << ", " << detector.getNumDroppedEdges() << " edges dropped";
+
+        std::cout << std::endl;
+    }
+
+    return true;
+}
 
 void EventDetector::setParameter(int parameterIndex, float newValue)
 {
     editor->updateParameterButtons(parameterIndex);
 
     Parameter& p =  parameters.getReference(parameterIndex);
-    p.setValue(newValue, 0);
+    p.setValue(newValue, currentChannel);
 
     threshold = newValue;
 
+    if (currentChannel >= 0 && currentChannel < thresholds.size())
+    {
+        thresholds.set(currentChannel, newValue);
+        setThreshold(currentChannel, newValue);
+    }
+
     //std::cout << float(p[0]) << std::endl;
 
 }
@@ -62,27 +121,23 @@ void EventDetector::process(AudioSampleBuffer& buffer,
 
     //std::cout << *buffer.getReadPointer(0, 0) << std::endl;
 
+    if (getNumInputs() == 0)
+        return;
 
-    for (int i = 0; i < getNumSamples(channels[0]->sourceNodeId); i++)
-    {
-
-        if ((*buffer.getReadPointer(0, i) < -threshold) && !state)
-        {
+    const int64 start = Time::getHighResolutionTicks();
 
-            // generate midi event
-            //std::cout << "Value = " << *buffer.getSampleData(0, i) << std::endl;
-            addEvent(events, TTL, i);
-
-            state = true;
-
-        }
-        else if ((*buffer.getReadPointer(0, i) > -threshold + bufferZone)  && state)
-        {
-            state = false;
-        }
+    const int nEdges = detector.process(buffer, jmin(getNumSamples(0), buffer.getNumSamples()));
 
+    for (int i = 0; i < nEdges; i++)
+    {
+        const ThresholdDetector::Edge& edge = detector.getEdge(i);
 
+        // generate midi event
+        addEvent(events, TTL, edge.sample, edge.rising ? 1 : 0, edge.eventChannel);
     }
 
+    processingTicks += Time::getHighResolutionTicks() - start;
+    numEdges += nEdges;
+    numBlocks++;
 
 }
@@ -26,12 +26,22 @@
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
 #include "../GenericProcessor/GenericProcessor.h"
+#include "ThresholdDetector.h"
 
 /**
 
   Searches for threshold crossings and sends out TTL events.
 
-  @see GenericProcessor
+  Each input channel with a threshold above zero is watched by a
+  ThresholdDetector: its TTL line (the channel's index) goes high when the
+  signal falls below -threshold, and low again once it has come back up by
+  bufferZone. Only the first channel has a threshold by default; thresholds
+  are set for the channels selected in the editor.
+
+  Setting the OPEN_EPHYS_EVENT_DETECTOR_BENCHMARK environment variable runs
+  ThresholdDetector::runBenchmark() when acquisition starts.
+
+  @see GenericProcessor, ThresholdDetector
 
 */
 
@@ -46,11 +56,27 @@ public:
     void process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages);
     void setParameter(int parameterIndex, float newValue);
 
+    void updateSettings();
+
+    bool enable();
+    bool disable();
+
 private:
 
+    /** Applies a threshold (0 for none) to one channel of the detector. */
+    void setThreshold(int channel, float threshold);
+
     float threshold;
     float bufferZone;
-    bool state;
+
+    /** Threshold of each input channel, kept across updates */
+    Array<float> thresholds;
+
+    ThresholdDetector detector;
+
+    int64 numBlocks;
+    int64 numEdges;
+    int64 processingTicks;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EventDetector);
 
@@ -0,0 +1,239 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ThresholdDetector.h"
+
+ThresholdDetector::ThresholdDetector()
+    : numChannels(0), maxEdges(0), numEdges(0), numDropped(0)
+{
+}
+
+ThresholdDetector::~ThresholdDetector()
+{
+}
+
+void ThresholdDetector::setNumChannels(int numChannels_, int maxEdges_)
+{
+    numChannels = numChannels_;
+    maxEdges = maxEdges_;
+
+    onLevels.calloc(numChannels);
+    offLevels.calloc(numChannels);
+    signs.malloc(numChannels);
+    states.calloc(numChannels);
+    enabled.calloc(numChannels);
+    eventChannels.calloc(numChannels);
+    edges.malloc(maxEdges);
+
+    for (int c = 0; c < numChannels; c++)
+    {
+        signs[c] = 1.0f;
+        eventChannels[c] = (uint8) jmin(c, 255);
+    }
+
+    numEdges = 0;
+    numDropped = 0;
+}
+
+void ThresholdDetector::setLevels(int channel, float onLevel, float offLevel, bool negative)
+{
+    if (channel < 0 || channel >= numChannels)
+        return;
+
+    onLevels[channel] = onLevel;
+    offLevels[channel] = jmin(onLevel, offLevel);
+    signs[channel] = negative ? -1.0f : 1.0f;
+}
+
+void ThresholdDetector::setEnabled(int channel, bool shouldBeEnabled)
+{
+    if (channel < 0 || channel >= numChannels)
+        return;
+
+    enabled[channel] = shouldBeEnabled ? 1 : 0;
+
+    if (! shouldBeEnabled)
+        states[channel] = 0;
+}
+
+void ThresholdDetector::setEventChannel(int channel, int eventChannel)
+{
+    if (channel >= 0 && channel < numChannels)
+        eventChannels[channel] = (uint8) jlimit(0, 255, eventChannel);
+}
+
+void ThresholdDetector::reset()
+{
+    zeromem(states, sizeof(uint8) * numChannels);
+}
+
+int ThresholdDetector::process(const AudioSampleBuffer& buffer, int numSamples)
+{
+    numEdges = 0;
+
+    const int n = jmin(numChannels, buffer.getNumChannels());
+
+    if (numSamples <= 0)
+        return 0;
+
+    for (int c = 0; c < n; c++)
+    {
+        if (! enabled[c])
+            continue;
+
+        const float* samples = buffer.getReadPointer(c);
+
+        // a high channel can only go low if its minimum falls below offLevel,
+        // and a low channel can only go high if its maximum exceeds onLevel
+        const Range<float> range = FloatVectorOperations::findMinAndMax(samples, numSamples);
+
+        const float lowest = signs[c] > 0 ? range.getStart() : -range.getEnd();
+        const float highest = signs[c] > 0 ? range.getEnd() : -range.getStart();
+
+        if (states[c] ? lowest >= offLevels[c] : highest <= onLevels[c])
+            continue;
+
+        scanChannel(c, samples, numSamples);
+    }
+
+    return numEdges;
+}
+
+void ThresholdDetector::scanChannel(int channel, const float* samples, int numSamples)
+{
+    const float sign = signs[channel];
+    const float onLevel = onLevels[channel];
+    const float offLevel = offLevels[channel];
+
+    bool high = states[channel] != 0;
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        const float value = sign * samples[i];
+
+        if (high ? value < offLevel : value > onLevel)
+        {
+            high = ! high;
+
+            if (numEdges < maxEdges)
+            {
+                Edge& edge = edges[numEdges++];
+                edge.sample = i;
+                edge.channel = channel;
+                edge.eventChannel = eventChannels[channel];
+                edge.rising = high;
+            }
+            else
+            {
+                numDropped++;
+            }
+        }
+    }
+
+    states[channel] = high ? 1 : 0;
+}
+
+void ThresholdDetector::runBenchmark(int numChannels, int blockSize)
+{
+    const int numBlocks = 200;
+
+    AudioSampleBuffer quiet(numChannels, blockSize);
+    AudioSampleBuffer busy(numChannels, blockSize);
+    Random random(1);
+
+    for (int c = 0; c < numChannels; c++)
+    {
+        for (int i = 0; i < blockSize; i++)
+        {
+            const float noise = random.nextFloat() * 20.0f - 10.0f;
+
+            quiet.setSample(c, i, noise);
+            busy.setSample(c, i, noise + (((i + 37 * c) / 100) % 2 ? 300.0f : -300.0f));
+        }
+    }
+
+    ThresholdDetector detector;
+    detector.setNumChannels(numChannels, numChannels * blockSize);
+
+    for (int c = 0; c < numChannels; c++)
+    {
+        detector.setLevels(c, 200.0f, 195.0f, false);
+        detector.setEnabled(c, true);
+    }
+
+    std::cout << "Threshold detector benchmark: " << numChannels << " channels, "
+              << blockSize << " samples per block" << std::endl;
+
+    for (int signal = 0; signal < 2; signal++)
+    {
+        const AudioSampleBuffer& buffer = signal == 0 ? quiet : busy;
+
+        detector.reset();
+
+        int64 start = Time::getHighResolutionTicks();
+        int numEdges = 0;
+
+        for (int b = 0; b < numBlocks; b++)
+            numEdges += detector.process(buffer, blockSize);
+
+        const double detectorTime = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+        // the same hysteresis, branching on every sample of every channel
+        HeapBlock<uint8> states;
+        states.calloc(numChannels);
+        int numLoopEdges = 0;
+
+        start = Time::getHighResolutionTicks();
+
+        for (int b = 0; b < numBlocks; b++)
+        {
+            for (int c = 0; c < numChannels; c++)
+            {
+                const float* samples = buffer.getReadPointer(c);
+
+                for (int i = 0; i < blockSize; i++)
+                {
+                    if (samples[i] > 200.0f && ! states[c])
+                    {
+                        states[c] = 1;
+                        numLoopEdges++;
+                    }
+                    else if (samples[i] < 195.0f && states[c])
+                    {
+                        states[c] = 0;
+                        numLoopEdges++;
+                    }
+                }
+            }
+        }
+
+        const double loopTime = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+        const double scale = 1.0e9 / (double(numBlocks) * numChannels);
+
+        std::cout << (signal == 0 ? "  quiet: " : "  busy:  ")
+                  << detectorTime * scale << " ns per channel per block ("
+                  << numEdges / numBlocks << " edges per block), per-sample loop "
+                  << loopTime * scale << " ns (" << numLoopEdges / numBlocks << " edges)" << std::endl;
+    }
+}
@@ -0,0 +1,124 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __THRESHOLDDETECTOR_H_2C8D51F7__
+#define __THRESHOLDDETECTOR_H_2C8D51F7__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Finds threshold crossings, with hysteresis, on many channels at once.
+
+  A channel goes high when its signal rises above onLevel and low again when
+  it falls below offLevel (for negative channels, the signal is inverted
+  first). The state, levels and polarity of every channel are kept in flat
+  arrays.
+
+  Most blocks of most channels contain no crossing. For each channel, one
+  vectorized min/max pass over the block (FloatVectorOperations) checks
+  whether the signal reaches the level that would change its state; only
+  then are its samples scanned one by one. Each edge is reported with its
+  sample index within the block.
+
+  @see EventDetector
+
+*/
+
+class ThresholdDetector
+{
+public:
+    ThresholdDetector();
+    ~ThresholdDetector();
+
+    /** Allocates the state of numChannels channels, all disabled and low,
+        and room for maxEdges edges per block. */
+    void setNumChannels(int numChannels, int maxEdges);
+
+    int getNumChannels() const
+    {
+        return numChannels;
+    }
+
+    /** offLevel should not be above onLevel. If negative is true, the channel
+        goes high when the signal falls below -onLevel. */
+    void setLevels(int channel, float onLevel, float offLevel, bool negative);
+
+    void setEnabled(int channel, bool enabled);
+
+    /** The TTL channel of this channel's events */
+    void setEventChannel(int channel, int eventChannel);
+
+    /** Sets every channel low. */
+    void reset();
+
+    struct Edge
+    {
+        int sample;
+        int channel;
+        uint8 eventChannel;
+        bool rising;
+    };
+
+    /** Finds the edges in the first numSamples samples of every enabled
+        channel and returns how many there are. */
+    int process(const AudioSampleBuffer& buffer, int numSamples);
+
+    const Edge& getEdge(int index) const
+    {
+        return edges[index];
+    }
+
+    /** Edges found after the first maxEdges of a block */
+    int64 getNumDroppedEdges() const
+    {
+        return numDropped;
+    }
+
+    /** Times process() against a per-sample loop over every channel, on
+        quiet and busy signals, and prints the cost per channel per block. */
+    static void runBenchmark(int numChannels, int blockSize);
+
+private:
+
+    /** Goes through one channel sample by sample. */
+    void scanChannel(int channel, const float* samples, int numSamples);
+
+    int numChannels;
+
+    HeapBlock<float> onLevels;
+    HeapBlock<float> offLevels;
+    HeapBlock<float> signs;
+    HeapBlock<uint8> states;
+    HeapBlock<uint8> enabled;
+    HeapBlock<uint8> eventChannels;
+
+    HeapBlock<Edge> edges;
+    int maxEdges;
+    int numEdges;
+    int64 numDropped;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ThresholdDetector);
+};
+
+#endif  // __THRESHOLDDETECTOR_H_2C8D51F7__
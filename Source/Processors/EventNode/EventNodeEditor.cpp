@@ -72,7 +72,7 @@ void EventNodeEditor::buttonEvent(Button* button)
     String value = button->getName();
     //float val;
 
-    getAudioProcessor()->setParameter(0,value.getFloatValue());
+    getProcessor()->queueParameterChange(0,value.getFloatValue());
 
     // if (value.getLastCharacter() == juce_wchar('k')) {
     // 	val = value.dropLastCharacters(1).getFloatValue() * 1000.0f;
@@ -32,6 +32,8 @@ FileReader::FileReader()
 {
 
     timestamp = 0;
+    playbackStartTicks = 0;
+    samplesPlayed = 0;
 
     enabledState(false);
 
@@ -101,6 +103,14 @@ void FileReader::enabledState(bool t)
 
 }
 
+bool FileReader::enable()
+{
+    playbackStartTicks = 0;
+    samplesPlayed = 0;
+
+    return GenericProcessor::enable();
+}
+
 
 bool FileReader::setFile(String fullpath)
 {
@@ -180,9 +190,15 @@ void FileReader::process(AudioSampleBuffer& buffer, MidiBuffer& events)
 
     setTimestamp(events, timestamp);
 
-    int samplesNeeded = (int) float(buffer.getNumSamples()) * (getDefaultSampleRate()/44100.0f);
-    // FIXME: needs to account for the fact that the ratio might not be an exact
-    //        integer value
+    if (playbackStartTicks == 0)
+        playbackStartTicks = Time::getHighResolutionTicks();
+
+    const double elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - playbackStartTicks);
+    const int64 samplesDue = (int64)(elapsed * getDefaultSampleRate()) - samplesPlayed;
+
+    // anything that doesn't fit is read in the next block
+    int samplesNeeded = (int) jlimit<int64>(0, jmin(BUFFER_SIZE, buffer.getNumSamples()), samplesDue);
+    samplesPlayed += samplesNeeded;
 
     int samplesRead = 0;
 
@@ -75,6 +75,8 @@ public:
 
     void enabledState(bool t);
 
+    bool enable();
+
     float getDefaultSampleRate();
     int getNumHeadstageOutputs();
     int getNumEventChannels();
@@ -87,6 +89,11 @@ private:
 
     int64 timestamp;
 
+    /** Playback is paced by the time since acquisition started, so that it
+        runs at the recording's rate whatever clock drives the graph */
+    int64 playbackStartTicks;
+    int64 samplesPlayed;
+
     float currentSampleRate;
     int currentNumChannels;
     int64 currentNumSamples;
@@ -121,7 +121,7 @@ bool FileReaderEditor::setPlaybackStartTime(unsigned int ms)
 {
     if (ms > timeLimits->getTimeMilliseconds(1))
         return false;
-    fileReader->setParameter(1,ms);
+    fileReader->queueParameterChange(1,ms);
     return true;
 }
 
@@ -129,7 +129,7 @@ bool FileReaderEditor::setPlaybackStopTime(unsigned int ms)
 {
     if ((ms > recTotalTime) || (ms < timeLimits->getTimeMilliseconds(0)))
         return false;
-    fileReader->setParameter(2,ms);
+    fileReader->queueParameterChange(2,ms);
     return true;
 }
 
@@ -149,7 +149,7 @@ void FileReaderEditor::setCurrentTime(unsigned int ms)
 
 void FileReaderEditor::comboBoxChanged(ComboBox* combo)
 {
-    fileReader->setParameter(0,combo->getSelectedId()-1);
+    fileReader->queueParameterChange(0,combo->getSelectedId()-1);
 	CoreServices::updateSignalChain(this);
 }
 
@@ -139,7 +139,7 @@ void FilterEditor::labelTextChanged(Label* label)
             if (requestedValue > minVal)
             {
                 fn->setCurrentChannel(chans[n]);
-                fn->setParameter(1, requestedValue);
+                fn->queueParameterChange(1, requestedValue);
             }
 
             lastHighCutString = label->getText();
@@ -152,7 +152,7 @@ void FilterEditor::labelTextChanged(Label* label)
             if (requestedValue < maxVal)
             {
                 fn->setCurrentChannel(chans[n]);
-                fn->setParameter(0, requestedValue);
+                fn->queueParameterChange(0, requestedValue);
             }
 
             lastLowCutString = label->getText();
@@ -192,7 +192,7 @@ void FilterEditor::buttonEvent(Button* button)
             float newValue = button->getToggleState() ? 1.0 : 0.0;
 
             fn->setCurrentChannel(chans[n]);
-            fn->setParameter(2, newValue);
+            fn->queueParameterChange(2, newValue);
         }
     }
 }
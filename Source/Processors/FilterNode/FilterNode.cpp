@@ -286,9 +286,9 @@ void FilterNode::setApplyOnADC(bool state)
             setCurrentChannel(n);
 
             if (state)
-                setParameter(2,1.0);
+                queueParameterChange(2,1.0);
             else
-                setParameter(2,0.0);
+                queueParameterChange(2,0.0);
         }
     }
 }
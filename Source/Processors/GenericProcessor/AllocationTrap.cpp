@@ -0,0 +1,555 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "AllocationTrap.h"
+
+#include <new>
+#include <errno.h>
+#include <stdlib.h>
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <execinfo.h>
+ #include <cxxabi.h>
+#endif
+
+// Replacing the C library's functions is only done in builds made for the
+// check (the RealtimeCheck configuration), never in Debug or Release.
+#ifndef OPEN_EPHYS_REALTIME_CHECK_BUILD
+ #define OPEN_EPHYS_REALTIME_CHECK_BUILD 0
+#endif
+
+#define ALLOCATION_TRAP_INTERPOSE_LIBC (OPEN_EPHYS_REALTIME_CHECK_BUILD && JUCE_LINUX)
+#define ALLOCATION_TRAP_REPLACE_NEW (OPEN_EPHYS_REALTIME_CHECK_BUILD || JUCE_DEBUG)
+
+#if ALLOCATION_TRAP_INTERPOSE_LIBC
+
+ #ifndef __GLIBC__
+  #error "The real-time check build interposes the C library's allocator, which needs glibc"
+ #endif
+
+ #include <dlfcn.h>
+ #include <malloc.h>
+ #include <pthread.h>
+
+// the C library's own allocator, which the interposed functions call
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t numElements, size_t size);
+    void* __libc_realloc(void* p, size_t size);
+    void* __libc_memalign(size_t alignment, size_t size);
+    void* __libc_valloc(size_t size);
+    void __libc_free(void* p);
+}
+#endif
+
+namespace
+{
+    const int maxSites = 256;
+    const int maxFrames = 6;
+    const int maxNameLength = 32;
+
+    /** Operations of one kind, made by one processor from one place */
+    struct Site
+    {
+        const char* processorName;
+        char name[maxNameLength];
+        int nodeId;
+        int operation;
+        void* frames[maxFrames];
+        int numFrames;
+        int64 count;
+    };
+
+    Site sites[maxSites];
+    int numSites = 0;
+    int64 numUnlisted = 0;
+    int64 totals[AllocationTrap::NUM_OPERATIONS];
+    int64 numBlocks = 0;
+
+    const char* const operationNames[AllocationTrap::NUM_OPERATIONS] =
+    {
+        "operator new", "operator delete", "malloc", "free", "lock"
+    };
+
+    // written by the processing thread between enterBlock() and exitBlock() only
+    volatile bool trapEnabled = false;
+    volatile bool stopInDebugger = false;
+    volatile bool insideBlock = false;
+    volatile bool hasStopped = false;
+    Thread::ThreadID blockThread = 0;
+    const char* blockName = nullptr;
+    int blockNodeId = 0;
+    int* blockCounter = nullptr;
+
+    File& getReportFile()
+    {
+        static File reportFile;
+        return reportFile;
+    }
+
+    inline bool isTrapped()
+    {
+        return insideBlock && Thread::getCurrentThreadId() == blockThread;
+    }
+
+    inline void* rawMalloc(size_t size)
+    {
+#if ALLOCATION_TRAP_INTERPOSE_LIBC
+        return __libc_malloc(size);
+#else
+        return malloc(size);
+#endif
+    }
+
+    inline void rawFree(void* p)
+    {
+#if ALLOCATION_TRAP_INTERPOSE_LIBC
+        __libc_free(p);
+#else
+        free(p);
+#endif
+    }
+
+#if ALLOCATION_TRAP_INTERPOSE_LIBC
+    typedef int (*LockFunction)(pthread_mutex_t*);
+
+    /** The C library's pthread_mutex_lock */
+    LockFunction findMutexLock()
+    {
+        static LockFunction lock = (LockFunction) dlsym(RTLD_NEXT, "pthread_mutex_lock");
+        return lock;
+    }
+
+    // looked up while the program starts, so no lock call has to do it
+    LockFunction realMutexLock = findMutexLock();
+#endif
+
+    int captureStack(void** frames, int numFrames)
+    {
+#if JUCE_LINUX || JUCE_MAC
+        return backtrace(frames, numFrames);
+#else
+        return 0;
+#endif
+    }
+
+    /** The function name of a frame, without its arguments */
+    String describeFrame(void* frame)
+    {
+#if JUCE_LINUX || JUCE_MAC
+        char** symbols = backtrace_symbols(&frame, 1);
+
+        if (symbols == nullptr)
+            return String::toHexString((pointer_sized_int) frame);
+
+        const String symbol(symbols[0]);
+        free(symbols);
+
+        // Linux: "binary(mangled+0x1f) [0x...]", Mac: "3 binary 0x... mangled + 31"
+        String mangled = symbol.fromFirstOccurrenceOf("(", false, false).upToFirstOccurrenceOf("+", false, false);
+
+        if (mangled.isEmpty())
+            mangled = symbol.upToLastOccurrenceOf(" + ", false, false).fromLastOccurrenceOf(" ", false, false);
+
+        int status = -1;
+        char* demangled = abi::__cxa_demangle(mangled.toRawUTF8(), nullptr, nullptr, &status);
+
+        if (status == 0 && demangled != nullptr)
+        {
+            const String name = String(demangled).upToFirstOccurrenceOf("(", false, false);
+            free(demangled);
+            return name;
+        }
+
+        return mangled.isNotEmpty() ? mangled : symbol;
+#else
+        return String::toHexString((pointer_sized_int) frame);
+#endif
+    }
+}
+
+bool AllocationTrap::isAvailable()
+{
+#if ALLOCATION_TRAP_REPLACE_NEW || ALLOCATION_TRAP_INTERPOSE_LIBC
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AllocationTrap::configure(const String& settings)
+{
+    StringArray tokens;
+    tokens.addTokens(settings, " ;", "\"");
+    tokens.removeEmptyStrings();
+
+    for (int i = 0; i < tokens.size(); i++)
+    {
+        const String token = tokens[i].trim().unquoted();
+
+        if (token.startsWithIgnoreCase("file="))
+            getReportFile() = File::getCurrentWorkingDirectory().getChildFile(token.fromFirstOccurrenceOf("=", false, false));
+        else if (token.equalsIgnoreCase("stop"))
+            stopInDebugger = true;
+        else if (! token.equalsIgnoreCase("on"))
+            std::cout << "Real-time check: unknown setting " << token << std::endl;
+    }
+
+    if (! isAvailable())
+    {
+        std::cout << "Real-time check: not available in this build (use the RealtimeCheck configuration)." << std::endl;
+        return;
+    }
+
+    // the first stack walk loads the unwinder, which must not happen during a block
+    void* frames[maxFrames];
+    captureStack(frames, maxFrames);
+
+    trapEnabled = true;
+
+    std::cout << "Real-time check: catching allocations and locks on the processing thread." << std::endl;
+}
+
+bool AllocationTrap::isEnabled()
+{
+    return trapEnabled;
+}
+
+void AllocationTrap::start()
+{
+    numSites = 0;
+    numUnlisted = 0;
+    numBlocks = 0;
+    hasStopped = false;
+
+    for (int i = 0; i < NUM_OPERATIONS; i++)
+        totals[i] = 0;
+}
+
+bool AllocationTrap::stop()
+{
+    if (! trapEnabled)
+        return true;
+
+    int64 total = 0;
+
+    for (int i = 0; i < NUM_OPERATIONS; i++)
+        total += totals[i];
+
+    String report;
+    report << "Real-time check: " << numBlocks << " processor blocks" << newLine;
+
+    // the call sites of each processor, in the order they were first seen
+    HeapBlock<bool> listed;
+    listed.calloc(jmax(1, numSites));
+
+    for (int i = 0; i < numSites; i++)
+    {
+        if (listed[i])
+            continue;
+
+        report << "  " << sites[i].name << " (" << sites[i].nodeId << ")" << newLine;
+
+        for (int j = i; j < numSites; j++)
+        {
+            if (sites[j].processorName != sites[i].processorName)
+                continue;
+
+            listed[j] = true;
+
+            report << "    " << sites[j].count << " x " << operationNames[sites[j].operation];
+
+            for (int k = 0; k < sites[j].numFrames; k++)
+                report << (k == 0 ? " at " : " <- ") << describeFrame(sites[j].frames[k]);
+
+            report << newLine;
+        }
+    }
+
+    if (numUnlisted > 0)
+        report << "  " << numUnlisted << " more from call sites that did not fit in the table" << newLine;
+
+    if (total == 0)
+    {
+        report << "Real-time check: PASS" << newLine;
+    }
+    else
+    {
+        report << "Real-time check: FAIL (";
+
+        for (int i = 0; i < NUM_OPERATIONS; i++)
+        {
+            if (totals[i] > 0)
+                report << totals[i] << " " << operationNames[i] << ", ";
+        }
+
+        report << String(double(total) / jmax((int64) 1, numBlocks), 3) << " per block)" << newLine;
+    }
+
+    std::cout << report;
+
+    if (getReportFile() != File::nonexistent)
+    {
+        if (getReportFile().replaceWithText(report))
+            std::cout << "Real-time check written to " << getReportFile().getFullPathName() << std::endl;
+        else
+            std::cout << "Could not write " << getReportFile().getFullPathName() << std::endl;
+    }
+
+    return total == 0;
+}
+
+void AllocationTrap::enterBlock(const char* processorName, int nodeId, int* counter)
+{
+    if (! trapEnabled)
+        return;
+
+    blockThread = Thread::getCurrentThreadId();
+    blockName = processorName;
+    blockNodeId = nodeId;
+    blockCounter = counter;
+    numBlocks++;
+    insideBlock = true;
+}
+
+void AllocationTrap::exitBlock()
+{
+    insideBlock = false;
+}
+
+void AllocationTrap::operationMade(Operation operation)
+{
+    // walking the stack and asserting may allocate, so leave the block first
+    insideBlock = false;
+
+    if (operation != LOCK && blockCounter != nullptr)
+        ++*blockCounter;
+
+    totals[operation]++;
+
+    // skip this function and the interposed one
+    void* frames[maxFrames + 2];
+    int numCaptured = 0;
+
+#if JUCE_LINUX || JUCE_MAC
+    numCaptured = backtrace(frames, maxFrames + 2);
+#endif
+
+    const int numFrames = jmax(0, numCaptured - 2);
+    void** callSite = frames + (numCaptured - numFrames);
+
+    int i = 0;
+
+    while (i < numSites)
+    {
+        const Site& site = sites[i];
+
+        if (site.processorName == blockName && site.operation == operation && site.numFrames == numFrames
+            && memcmp(site.frames, callSite, sizeof(void*) * numFrames) == 0)
+            break;
+
+        i++;
+    }
+
+    if (i < numSites)
+    {
+        sites[i].count++;
+    }
+    else if (numSites < maxSites)
+    {
+        Site& site = sites[numSites++];
+        site.processorName = blockName;
+        strncpy(site.name, blockName != nullptr ? blockName : "?", maxNameLength - 1);
+        site.name[maxNameLength - 1] = 0;
+        site.nodeId = blockNodeId;
+        site.operation = operation;
+        site.numFrames = jmin(numFrames, maxFrames);
+        memcpy(site.frames, callSite, sizeof(void*) * site.numFrames);
+        site.count = 1;
+    }
+    else
+    {
+        numUnlisted++;
+    }
+
+    if (stopInDebugger && ! hasStopped)
+    {
+        hasStopped = true;
+        jassertfalse; // a processor allocated memory or took a lock on the processing thread
+    }
+
+    insideBlock = true;
+}
+
+#if ALLOCATION_TRAP_REPLACE_NEW
+
+void* operator new (size_t size)
+{
+    if (isTrapped())
+        AllocationTrap::operationMade(AllocationTrap::OPERATOR_NEW);
+
+    void* p = rawMalloc(size > 0 ? size : 1);
+
+    if (p == nullptr)
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void* operator new[] (size_t size)
+{
+    return operator new (size);
+}
+
+void* operator new (size_t size, const std::nothrow_t&) throw()
+{
+    if (isTrapped())
+        AllocationTrap::operationMade(AllocationTrap::OPERATOR_NEW);
+
+    return rawMalloc(size > 0 ? size : 1);
+}
+
+void* operator new[] (size_t size, const std::nothrow_t& nothrow) throw()
+{
+    return operator new (size, nothrow);
+}
+
+void operator delete (void* p) throw()
+{
+    if (p != nullptr && isTrapped())
+        AllocationTrap::operationMade(AllocationTrap::OPERATOR_DELETE);
+
+    rawFree(p);
+}
+
+void operator delete[] (void* p) throw()
+{
+    operator delete (p);
+}
+
+void operator delete (void* p, const std::nothrow_t&) throw()
+{
+    operator delete (p);
+}
+
+void operator delete[] (void* p, const std::nothrow_t&) throw()
+{
+    operator delete (p);
+}
+
+#endif
+
+#if ALLOCATION_TRAP_INTERPOSE_LIBC
+
+// Defined in the executable, these take the place of the C library's
+// functions for the whole process, including JUCE and other libraries.
+
+extern "C" void* malloc(size_t size) throw()
+{
+    if (isTrapped())
+        AllocationTrap::operationMade(AllocationTrap::MALLOC);
+
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t numElements, size_t size) throw()
+{
+    if (isTrapped())
+        AllocationTrap::operationMade(AllocationTrap::MALLOC);
+
+    return __libc_calloc(numElements, size);
+}
+
+extern "C" void* realloc(void* p, size_t size) throw()
+{
+    if (isTrapped())
+        AllocationTrap::operationMade(AllocationTrap::MALLOC);
+
+    return __libc_realloc(p, size);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size) throw()
+{
+    if (isTrapped())
+        AllocationTrap::operationMade(AllocationTrap::MALLOC);
+
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size) throw()
+{
+    if (isTrapped())
+        AllocationTrap::operationMade(AllocationTrap::MALLOC);
+
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** result, size_t alignment, size_t size) throw()
+{
+    if (isTrapped())
+        AllocationTrap::operationMade(AllocationTrap::MALLOC);
+
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+
+    void* p = __libc_memalign(alignment, size);
+
+    if (p == nullptr)
+        return ENOMEM;
+
+    *result = p;
+    return 0;
+}
+
+extern "C" void* valloc(size_t size) throw()
+{
+    if (isTrapped())
+        AllocationTrap::operationMade(AllocationTrap::MALLOC);
+
+    return __libc_valloc(size);
+}
+
+extern "C" void free(void* p) throw()
+{
+    if (p != nullptr && isTrapped())
+        AllocationTrap::operationMade(AllocationTrap::FREE);
+
+    __libc_free(p);
+}
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex) throw()
+{
+    if (isTrapped())
+        AllocationTrap::operationMade(AllocationTrap::LOCK);
+
+    // only null if another library locks while the program is still starting
+    LockFunction lock = realMutexLock;
+
+    if (lock == nullptr)
+        lock = findMutexLock();
+
+    return lock(mutex);
+}
+
+#endif
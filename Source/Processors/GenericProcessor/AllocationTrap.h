@@ -0,0 +1,115 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __ALLOCATIONTRAP_H_91D3F0B6__
+#define __ALLOCATIONTRAP_H_91D3F0B6__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Catches heap allocations and locks on the processing thread.
+
+  While GenericProcessor::processBlock() runs, the trap intercepts:
+
+  - operator new and operator delete (Debug and RealtimeCheck builds,
+    which replace them);
+  - malloc, calloc, realloc, memalign, posix_memalign, aligned_alloc, valloc
+    and free (RealtimeCheck builds on Linux, by interposing glibc);
+  - pthread_mutex_lock, which is what CriticalSection::enter() and
+    ScopedLock come down to (RealtimeCheck builds on Linux). tryEnter() is
+    not counted, as it never blocks.
+
+  The C library is only interposed when OPEN_EPHYS_REALTIME_CHECK_BUILD is
+  defined to 1, which the RealtimeCheck configuration of the Linux Makefile
+  does (make CONFIG=RealtimeCheck). Debug and Release builds keep the C
+  library's own functions, and need no glibc-specific symbols.
+
+  Each operation is attributed to the processor whose block is running and
+  to its call site (the first frames of the stack). The counts are kept in
+  a fixed table, so the trap itself never allocates on the processing
+  thread. When acquisition stops, a report lists every call site, and
+  ends with PASS if no processor allocated or locked, or FAIL otherwise,
+  so a headless run can be gated on it. Function names are only shown if
+  the executable exports its symbols (e.g. linked with -rdynamic);
+  otherwise the addresses are.
+
+  The trap is enabled by the OPEN_EPHYS_REALTIME_CHECK environment
+  variable, a list of space-separated tokens:
+
+  - on: count and report;
+  - stop: also stop in the debugger (jassertfalse) at the first operation
+    of each acquisition, with the offending call on the stack;
+  - file=PATH: also write the report to PATH.
+
+  OPEN_EPHYS_TRAP_ALLOCATIONS (set to anything but 0) is the same as
+  "stop". Other operations (e.g. locks on Windows and Mac) go unnoticed.
+
+  @see GenericProcessor, BlockArena
+
+*/
+
+class AllocationTrap
+{
+public:
+
+    /** True if this build can intercept anything */
+    static bool isAvailable();
+
+    /** Enables the trap with the settings described above. */
+    static void configure(const String& settings);
+
+    static bool isEnabled();
+
+    /** Clears the counts at the start of acquisition. */
+    static void start();
+
+    /** Prints (and writes) the report at the end of acquisition. Returns false
+        if any operation was caught. */
+    static bool stop();
+
+    /** Called by processBlock() on entry: operations on this thread are
+        attributed to this processor until exitBlock(). The name must outlive
+        the block, and heap operations are also counted in counter. */
+    static void enterBlock(const char* processorName, int nodeId, int* counter);
+
+    static void exitBlock();
+
+    enum Operation
+    {
+        OPERATOR_NEW = 0,
+        OPERATOR_DELETE,
+        MALLOC,
+        FREE,
+        LOCK,
+        NUM_OPERATIONS
+    };
+
+    /** Called by the interposed functions. */
+    static void operationMade(Operation operation);
+
+private:
+    AllocationTrap();
+};
+
+#endif  // __ALLOCATIONTRAP_H_91D3F0B6__
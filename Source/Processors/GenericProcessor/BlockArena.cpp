@@ -0,0 +1,73 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "BlockArena.h"
+
+BlockArena::BlockArena()
+    : start(nullptr), size(0), used(0), highWaterMark(0), numOverflows(0)
+{
+}
+
+BlockArena::~BlockArena()
+{
+}
+
+void BlockArena::reserve(size_t numBytes)
+{
+    numBytes = getPaddedSize(numBytes);
+
+    if (numBytes <= size)
+        return;
+
+    memory.malloc(numBytes + alignment);
+
+    // align the start, so that every piece is aligned too
+    start = memory.getData() + (alignment - (int)((pointer_sized_int) memory.getData() & (alignment - 1))) % alignment;
+    size = numBytes;
+    used = 0;
+}
+
+void* BlockArena::allocate(size_t numBytes)
+{
+    const size_t paddedSize = getPaddedSize(numBytes);
+
+    if (used + paddedSize > size)
+    {
+        numOverflows++;
+        return nullptr;
+    }
+
+    void* piece = start + used;
+    used += paddedSize;
+
+    if (used > highWaterMark)
+        highWaterMark = used;
+
+    return piece;
+}
+
+void BlockArena::clearStatistics()
+{
+    highWaterMark = 0;
+    numOverflows = 0;
+}
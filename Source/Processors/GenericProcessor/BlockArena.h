@@ -0,0 +1,107 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __BLOCKARENA_H_4E27A9C1__
+#define __BLOCKARENA_H_4E27A9C1__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Scratch memory for the temporary buffers of one processing block.
+
+  The arena is sized before acquisition starts (from updateSettings() or
+  enable()), then process() takes pieces of it with allocate(), and the
+  whole arena is released at once by reset() before the next block. Taking
+  a piece only moves an offset, so the processing thread never goes to the
+  heap for temporary storage.
+
+  Every piece is aligned to 64 bytes. If process() asks for more than was
+  reserved, allocate() returns nullptr and counts an overflow, rather than
+  allocating.
+
+  @see GenericProcessor::getScratch
+
+*/
+
+class BlockArena
+{
+public:
+    BlockArena();
+    ~BlockArena();
+
+    /** Makes sure the arena holds at least numBytes, counting the padding
+        added by getPaddedSize(). Not to be called from the processing thread. */
+    void reserve(size_t numBytes);
+
+    /** Returns numBytes of uninitialised memory that stay valid until the next
+        reset(), or nullptr if the arena is full. */
+    void* allocate(size_t numBytes);
+
+    /** Makes the whole arena available again. */
+    void reset()
+    {
+        used = 0;
+    }
+
+    size_t getSize() const
+    {
+        return size;
+    }
+
+    /** The most memory used in one block */
+    size_t getHighWaterMark() const
+    {
+        return highWaterMark;
+    }
+
+    /** Calls to allocate() that returned nullptr */
+    int getNumOverflows() const
+    {
+        return numOverflows;
+    }
+
+    void clearStatistics();
+
+    /** The room one piece of numBytes takes in the arena. */
+    static size_t getPaddedSize(size_t numBytes)
+    {
+        return (numBytes + alignment - 1) & ~(size_t)(alignment - 1);
+    }
+
+    static const int alignment = 64;
+
+private:
+
+    HeapBlock<char> memory;
+    char* start;
+    size_t size;
+    size_t used;
+
+    size_t highWaterMark;
+    int numOverflows;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BlockArena);
+};
+
+#endif  // __BLOCKARENA_H_4E27A9C1__
@@ -0,0 +1,59 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "BlockMetadata.h"
+
+BlockMetadata::BlockMetadata()
+    : slotTableSize(0), numStreams(0)
+{
+}
+
+BlockMetadata::~BlockMetadata()
+{
+}
+
+void BlockMetadata::setStreams(const Array<int>& nodeIds)
+{
+    int largestId = -1;
+
+    for (int i = 0; i < nodeIds.size(); i++)
+        largestId = jmax(largestId, nodeIds[i]);
+
+    slotTableSize = largestId + 1;
+    slots.malloc(jmax(1, slotTableSize));
+
+    for (int id = 0; id < slotTableSize; id++)
+        slots[id] = -1;
+
+    numStreams = 0;
+
+    for (int i = 0; i < nodeIds.size(); i++)
+    {
+        if (nodeIds[i] >= 0 && slots[nodeIds[i]] < 0)
+            slots[nodeIds[i]] = numStreams++;
+    }
+
+    numSamples.calloc(jmax(1, numStreams));
+    timestamps.calloc(jmax(1, numStreams));
+}
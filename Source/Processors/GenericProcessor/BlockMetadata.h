@@ -0,0 +1,114 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __BLOCKMETADATA_H_7C31E5A2__
+#define __BLOCKMETADATA_H_7C31E5A2__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Sample count and timestamp of the current block of each data stream.
+
+  A stream is identified by the node ID of the processor that produces it
+  (a channel's sourceNodeId). When the signal chain is built, the
+  ProcessorGraph gives every stream a slot in two dense arrays, and a table
+  from node ID to slot, so that reading or writing a stream's entry during
+  acquisition is a bounds check and two loads, whatever the node IDs are.
+
+  The graph owns one of these and hands it to each of its processors (see
+  GenericProcessor::setBlockMetadata()). Processors run one after another,
+  so the source of a stream writes its entry before any downstream
+  processor reads it.
+
+  Events still identify their source with one byte (see
+  GenericProcessor::addEvent()), so looking up the stream of an event is
+  only exact for node IDs below 256.
+
+  @see GenericProcessor, ProcessorGraph
+
+*/
+
+class BlockMetadata
+{
+public:
+    BlockMetadata();
+    ~BlockMetadata();
+
+    /** Gives each stream a slot, and clears the counts and timestamps. Only
+        called while no blocks are being processed. */
+    void setStreams(const Array<int>& nodeIds);
+
+    int getNumStreams() const
+    {
+        return numStreams;
+    }
+
+    /** Returns the slot of a stream, or -1 if it has none. */
+    int getSlot(int nodeId) const
+    {
+        return (nodeId >= 0 && nodeId < slotTableSize) ? slots[nodeId] : -1;
+    }
+
+    int getNumSamples(int nodeId) const
+    {
+        const int slot = getSlot(nodeId);
+        return slot >= 0 ? numSamples[slot] : 0;
+    }
+
+    int64 getTimestamp(int nodeId) const
+    {
+        const int slot = getSlot(nodeId);
+        return slot >= 0 ? timestamps[slot] : 0;
+    }
+
+    void setNumSamples(int nodeId, int count)
+    {
+        const int slot = getSlot(nodeId);
+
+        if (slot >= 0)
+            numSamples[slot] = count;
+    }
+
+    void setTimestamp(int nodeId, int64 timestamp)
+    {
+        const int slot = getSlot(nodeId);
+
+        if (slot >= 0)
+            timestamps[slot] = timestamp;
+    }
+
+private:
+
+    HeapBlock<int> slots;
+    int slotTableSize;
+
+    HeapBlock<int> numSamples;
+    HeapBlock<int64> timestamps;
+    int numStreams;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BlockMetadata);
+};
+
+#endif  // __BLOCKMETADATA_H_7C31E5A2__
@@ -0,0 +1,124 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ChannelBlock.h"
+
+ChannelBlock::ChannelBlock()
+    : data(nullptr), numChannels(0), numSamples(0), stride(0), buffer(1, 1)
+{
+}
+
+ChannelBlock::~ChannelBlock()
+{
+}
+
+void ChannelBlock::setSize(int numChannels_, int numSamples_)
+{
+    numChannels = jmax(1, numChannels_);
+    numSamples = jmax(1, numSamples_);
+
+    // a whole number of 64-byte lines per channel
+    const int samplesPerLine = alignment / (int) sizeof(float);
+    stride = (numSamples + samplesPerLine - 1) / samplesPerLine * samplesPerLine;
+
+    memory.malloc((size_t) numChannels * stride * sizeof(float) + alignment);
+
+    const int offset = (int)((pointer_sized_int) memory.getData() & (alignment - 1));
+    data = (float*)(memory.getData() + (alignment - offset) % alignment);
+
+    channelPointers.malloc(numChannels);
+
+    for (int c = 0; c < numChannels; c++)
+        channelPointers[c] = getChannel(c);
+
+    buffer.setDataToReferTo(channelPointers, numChannels, numSamples);
+
+    clear();
+}
+
+void ChannelBlock::clear()
+{
+    if (data != nullptr)
+        FloatVectorOperations::clear(data, numChannels * stride);
+}
+
+ChannelBlock::PlanarView ChannelBlock::getView() const
+{
+    PlanarView view;
+    view.data = data;
+    view.stride = stride;
+    view.numChannels = numChannels;
+    view.numSamples = numSamples;
+    return view;
+}
+
+bool ChannelBlock::getPlanarView(AudioSampleBuffer& buffer, int numChannels_, int numSamples_, PlanarView& view)
+{
+    if (numChannels_ <= 0 || numChannels_ > buffer.getNumChannels())
+        return false;
+
+    float* const* channels = buffer.getArrayOfWritePointers();
+
+    const pointer_sized_int spacing = numChannels_ > 1 ? (channels[1] - channels[0]) : numSamples_;
+
+    if (spacing < numSamples_)
+        return false;
+
+    for (int c = 2; c < numChannels_; c++)
+    {
+        if (channels[c] - channels[c - 1] != spacing)
+            return false;
+    }
+
+    view.data = channels[0];
+    view.stride = (int) spacing;
+    view.numChannels = numChannels_;
+    view.numSamples = numSamples_;
+    return true;
+}
+
+void ChannelBlock::interleave(const PlanarView& view, int firstChannel, int numChannels_,
+                              int startSample, int numSamples_, float* dest)
+{
+    for (int c = 0; c < numChannels_; c++)
+    {
+        const float* source = view.getChannel(firstChannel + c) + startSample;
+        float* d = dest + c;
+
+        for (int i = 0; i < numSamples_; i++)
+            d[i * numChannels_] = source[i];
+    }
+}
+
+void ChannelBlock::deinterleave(const float* source, const PlanarView& view, int firstChannel,
+                                int numChannels_, int startSample, int numSamples_)
+{
+    for (int c = 0; c < numChannels_; c++)
+    {
+        float* dest = view.getChannel(firstChannel + c) + startSample;
+        const float* s = source + c;
+
+        for (int i = 0; i < numSamples_; i++)
+            dest[i] = s[i * numChannels_];
+    }
+}
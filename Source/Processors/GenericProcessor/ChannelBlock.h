@@ -0,0 +1,138 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __CHANNELBLOCK_H_A3F6C218__
+#define __CHANNELBLOCK_H_A3F6C218__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Channels of one block of samples, stored in a single planar slab.
+
+  Every channel starts on a 64-byte boundary, and channel c starts
+  c * getStride() samples after the first, so cross-channel kernels can
+  walk any number of channels from one base pointer, with aligned loads
+  and an access pattern the prefetcher can follow. AudioSampleBuffer, by
+  contrast, only promises one pointer per channel.
+
+  getBuffer() returns an AudioSampleBuffer that refers to the same memory,
+  so processors that only know about AudioSampleBuffer work unchanged. The
+  BufferRouter keeps the whole signal chain in one ChannelBlock, and each
+  processor's channels are consecutive in it, so a processor can ask
+  getPlanarView() whether the buffer it is given is laid out this way and
+  use the planar kernel if it is.
+
+  For kernels that combine the channels of each sample (e.g. the channels
+  of a tetrode), interleave() copies a tile of channels into
+  channel-interleaved order, and deinterleave() copies it back.
+
+  @see BufferRouter, CAR
+
+*/
+
+class ChannelBlock
+{
+public:
+    ChannelBlock();
+    ~ChannelBlock();
+
+    /** Allocates and clears numChannels channels of numSamples samples. */
+    void setSize(int numChannels, int numSamples);
+
+    void clear();
+
+    int getNumChannels() const
+    {
+        return numChannels;
+    }
+
+    int getNumSamples() const
+    {
+        return numSamples;
+    }
+
+    /** Samples from the start of one channel to the start of the next */
+    int getStride() const
+    {
+        return stride;
+    }
+
+    float* getChannel(int channel) const
+    {
+        return data + (size_t) channel * stride;
+    }
+
+    /** An AudioSampleBuffer referring to the channels of this block */
+    AudioSampleBuffer& getBuffer()
+    {
+        return buffer;
+    }
+
+    /** Channels at a fixed stride from one base pointer */
+    struct PlanarView
+    {
+        float* data;
+        int stride;
+        int numChannels;
+        int numSamples;
+
+        float* getChannel(int channel) const
+        {
+            return data + (size_t) channel * stride;
+        }
+    };
+
+    PlanarView getView() const;
+
+    /** Returns true, and fills view, if the first numChannels channels of
+        buffer are spaced at a fixed stride in one slab (always the case for
+        one channel). */
+    static bool getPlanarView(AudioSampleBuffer& buffer, int numChannels, int numSamples, PlanarView& view);
+
+    /** Copies numSamples samples of numChannels channels, from firstChannel
+        and startSample, to dest[sample * numChannels + channel]. */
+    static void interleave(const PlanarView& view, int firstChannel, int numChannels,
+                           int startSample, int numSamples, float* dest);
+
+    /** The reverse of interleave(). */
+    static void deinterleave(const float* source, const PlanarView& view, int firstChannel,
+                             int numChannels, int startSample, int numSamples);
+
+    static const int alignment = 64;
+
+private:
+
+    HeapBlock<char> memory;
+    float* data;
+    int numChannels;
+    int numSamples;
+    int stride;
+
+    HeapBlock<float*> channelPointers;
+    AudioSampleBuffer buffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelBlock);
+};
+
+#endif  // __CHANNELBLOCK_H_A3F6C218__
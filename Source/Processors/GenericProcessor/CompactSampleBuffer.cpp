@@ -0,0 +1,292 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "CompactSampleBuffer.h"
+
+CompactSampleBuffer::CompactSampleBuffer(Format format_)
+    : format(format_), data(nullptr), numChannels(0), numSamples(0), stride(0)
+{
+}
+
+CompactSampleBuffer::~CompactSampleBuffer()
+{
+}
+
+CompactSampleBuffer::Format CompactSampleBuffer::getDefaultFormat()
+{
+    const String setting = SystemStats::getEnvironmentVariable("OPEN_EPHYS_COMPACT_SAMPLES", String::empty).trim();
+
+    if (setting.equalsIgnoreCase("int16"))
+        return INT16;
+    else if (setting.equalsIgnoreCase("fp16") || setting.equalsIgnoreCase("float16"))
+        return FLOAT16;
+    else
+        return FLOAT32;
+}
+
+String CompactSampleBuffer::getFormatName(Format format)
+{
+    switch (format)
+    {
+        case INT16:     return "int16";
+        case FLOAT16:   return "fp16";
+        default:        return "float32";
+    }
+}
+
+void CompactSampleBuffer::setFormat(Format newFormat)
+{
+    if (newFormat != format)
+    {
+        format = newFormat;
+
+        if (numChannels > 0)
+            setSize(numChannels, numSamples);
+    }
+}
+
+void CompactSampleBuffer::setSize(int numChannels_, int numSamples_)
+{
+    const int newChannels = jmax(1, numChannels_);
+
+    steps.realloc(newChannels);
+    offsets.realloc(newChannels);
+
+    for (int c = numChannels; c < newChannels; c++)
+    {
+        steps[c] = 1.0f;
+        offsets[c] = 0.0f;
+    }
+
+    numChannels = newChannels;
+    numSamples = jmax(1, numSamples_);
+
+    // a whole number of 64-byte lines per channel
+    const int samplesPerLine = alignment / getBytesPerSample();
+    stride = (numSamples + samplesPerLine - 1) / samplesPerLine * samplesPerLine;
+
+    memory.malloc((size_t) numChannels * stride * getBytesPerSample() + alignment);
+
+    const int offset = (int)((pointer_sized_int) memory.getData() & (alignment - 1));
+    data = memory.getData() + (alignment - offset) % alignment;
+
+    clear();
+}
+
+void CompactSampleBuffer::setStep(int channel, float step, float offset)
+{
+    if (channel >= 0 && channel < numChannels)
+    {
+        steps[channel] = step > 0.0f ? step : 1.0f;
+
+        if (offset != offsets[channel])
+        {
+            // what was cleared must still read as zero
+            offsets[channel] = offset;
+            clear(channel, 0, numSamples);
+        }
+    }
+}
+
+void CompactSampleBuffer::clear()
+{
+    if (data == nullptr)
+        return;
+
+    for (int c = 0; c < numChannels; c++)
+        clear(c, 0, numSamples);
+}
+
+void CompactSampleBuffer::clear(int channel, int startSample, int num)
+{
+    // zero is all-zero bits in every format, except in INT16 with an offset
+    if (format == INT16 && offsets[channel] != 0.0f)
+        fill(channel, startSample, 0.0f, num);
+    else
+        zeromem(getChannelData(channel) + (size_t) startSample * getBytesPerSample(),
+                (size_t) num * getBytesPerSample());
+}
+
+void CompactSampleBuffer::write(int channel, int startSample, const float* source, int num)
+{
+    char* const dest = getChannelData(channel) + (size_t) startSample * getBytesPerSample();
+
+    switch (format)
+    {
+        case INT16:
+            convertToInt16(source, (int16*) dest, num, steps[channel], offsets[channel]);
+            break;
+
+        case FLOAT16:
+        {
+            uint16* const half = (uint16*) dest;
+
+            for (int i = 0; i < num; i++)
+                half[i] = floatToHalf(source[i]);
+
+            break;
+        }
+
+        default:
+            FloatVectorOperations::copy((float*) dest, source, num);
+            break;
+    }
+}
+
+void CompactSampleBuffer::fill(int channel, int startSample, float value, int num)
+{
+    char* const dest = getChannelData(channel) + (size_t) startSample * getBytesPerSample();
+
+    if (format == FLOAT32)
+    {
+        FloatVectorOperations::fill((float*) dest, value, num);
+    }
+    else
+    {
+        uint16 converted;
+
+        if (format == INT16)
+            convertToInt16(&value, (int16*) &converted, 1, steps[channel], offsets[channel]);
+        else
+            converted = floatToHalf(value);
+
+        uint16* const samples = (uint16*) dest;
+
+        for (int i = 0; i < num; i++)
+            samples[i] = converted;
+    }
+}
+
+void CompactSampleBuffer::read(int channel, int startSample, float* dest, int num) const
+{
+    const char* const source = getChannelData(channel) + (size_t) startSample * getBytesPerSample();
+
+    switch (format)
+    {
+        case INT16:
+            convertFromInt16((const int16*) source, dest, num, steps[channel], offsets[channel]);
+            break;
+
+        case FLOAT16:
+        {
+            const uint16* const half = (const uint16*) source;
+
+            for (int i = 0; i < num; i++)
+                dest[i] = halfToFloat(half[i]);
+
+            break;
+        }
+
+        default:
+            FloatVectorOperations::copy(dest, (const float*) source, num);
+            break;
+    }
+}
+
+const float* CompactSampleBuffer::getFloatPointer(int channel, int startSample) const
+{
+    if (format != FLOAT32)
+        return nullptr;
+
+    return (const float*) getChannelData(channel) + startSample;
+}
+
+void CompactSampleBuffer::convertToInt16(const float* source, int16* dest, int num, float step,
+                                         float offset)
+{
+    const float inverseStep = 1.0f / step;
+    const float bias = 32768.5f - offset * inverseStep;
+
+    // biased so that truncation rounds, then clamped with min and max,
+    // so the loop has no branches and the compiler can vectorize it
+    for (int i = 0; i < num; i++)
+    {
+        const float x = jmin(jmax(source[i] * inverseStep + bias, 0.0f), 65535.0f);
+        dest[i] = (int16)((int) x - 32768);
+    }
+}
+
+void CompactSampleBuffer::convertFromInt16(const int16* source, float* dest, int num, float step,
+                                           float offset)
+{
+    for (int i = 0; i < num; i++)
+        dest[i] = source[i] * step + offset;
+}
+
+uint16 CompactSampleBuffer::floatToHalf(float value)
+{
+    uint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint32 sign = (bits >> 16) & 0x8000;
+    bits &= 0x7fffffff;
+
+    // 65536 and above, infinity and NaN
+    if (bits >= 0x47800000)
+        return (uint16)(sign | (bits > 0x7f800000 ? 0x7e00 : 0x7c00));
+
+    // below the smallest normal half: adding 0.5 leaves the subnormal
+    // mantissa, correctly rounded, in the low bits
+    if (bits < 0x38800000)
+    {
+        float x;
+        memcpy(&x, &bits, sizeof(x));
+        x += 0.5f;
+        memcpy(&bits, &x, sizeof(bits));
+        return (uint16)(sign | (bits - 0x3f000000));
+    }
+
+    // rebias the exponent and round the mantissa to nearest even
+    bits += 0xc8000fff + ((bits >> 13) & 1);
+    return (uint16)(sign | (bits >> 13));
+}
+
+float CompactSampleBuffer::halfToFloat(uint16 value)
+{
+    uint32 bits = (uint32)(value & 0x7fff) << 13;
+    const uint32 exponent = bits & 0x0f800000;
+
+    bits += 0x38000000; // rebias the exponent
+
+    if (exponent == 0x0f800000)
+    {
+        bits += 0x38000000; // infinity and NaN
+    }
+    else if (exponent == 0)
+    {
+        // subnormal: renormalize through a float subtraction
+        bits += 0x00800000;
+
+        float x;
+        memcpy(&x, &bits, sizeof(x));
+        x -= 6.103515625e-05f; // 2^-14
+        memcpy(&bits, &x, sizeof(bits));
+    }
+
+    bits |= (uint32)(value & 0x8000) << 16;
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
@@ -0,0 +1,184 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __COMPACTSAMPLEBUFFER_H_5E2A91C7__
+#define __COMPACTSAMPLEBUFFER_H_5E2A91C7__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Channels of samples stored in 16 bits instead of 32, for buffers that hold
+  a lot of data but do little arithmetic on it (the DataBuffer FIFO, display
+  and trial histories).
+
+  In INT16 format, each channel stores its samples as multiples of a step
+  (normally the channel's bitVolts) from an offset (the channel's
+  offsetVolts), rounded and saturated. A channel that came from a 16-bit
+  converter, with its step and offset set to the converter's scale and the
+  value of its mid-scale code, keeps every code it can produce; otherwise
+  samples are rounded to the nearest step. In FLOAT16 format, samples are
+  stored as IEEE half floats, with 11 significant bits and no scale. FLOAT32
+  stores the samples unchanged, as before.
+
+  Samples go in and come out as floats: write() and read() convert whole runs
+  at once, and getSample() converts one. Conversion happens only where a
+  kernel reads or writes the data, so the buffer itself moves half as many
+  bytes through the caches. Every channel starts on a 64-byte boundary.
+
+  The format is chosen when the buffer is created; by default it comes from
+  the OPEN_EPHYS_COMPACT_SAMPLES environment variable ("int16" or "fp16",
+  anything else meaning FLOAT32).
+
+  @see DataBuffer, LfpDisplayNode
+
+*/
+
+class CompactSampleBuffer
+{
+public:
+    enum Format
+    {
+        FLOAT32 = 0,
+        INT16,
+        FLOAT16
+    };
+
+    explicit CompactSampleBuffer(Format format = getDefaultFormat());
+    ~CompactSampleBuffer();
+
+    /** The format selected by OPEN_EPHYS_COMPACT_SAMPLES */
+    static Format getDefaultFormat();
+
+    static String getFormatName(Format format);
+
+    /** Changes the format, and clears the samples. */
+    void setFormat(Format newFormat);
+
+    Format getFormat() const
+    {
+        return format;
+    }
+
+    /** Allocates and clears numChannels channels of numSamples samples. The
+        steps of existing channels are kept; new channels get a step of 1 and
+        an offset of 0. */
+    void setSize(int numChannels, int numSamples);
+
+    int getNumChannels() const
+    {
+        return numChannels;
+    }
+
+    int getNumSamples() const
+    {
+        return numSamples;
+    }
+
+    int getBytesPerSample() const
+    {
+        return format == FLOAT32 ? 4 : 2;
+    }
+
+    /** The value of one INT16 step (e.g. bitVolts) for this channel, and the
+        value stored as 0 (e.g. offsetVolts). Ignored by the other formats. */
+    void setStep(int channel, float step, float offset = 0.0f);
+
+    float getStep(int channel) const
+    {
+        return steps[channel];
+    }
+
+    float getOffset(int channel) const
+    {
+        return offsets[channel];
+    }
+
+    void clear();
+    void clear(int channel, int startSample, int numSamples);
+
+    /** Converts numSamples floats into the channel, from startSample. */
+    void write(int channel, int startSample, const float* source, int numSamples);
+
+    /** Sets numSamples samples of the channel to value. */
+    void fill(int channel, int startSample, float value, int numSamples);
+
+    /** Converts numSamples samples of the channel, from startSample, to floats. */
+    void read(int channel, int startSample, float* dest, int numSamples) const;
+
+    void setSample(int channel, int index, float value)
+    {
+        write(channel, index, &value, 1);
+    }
+
+    float getSample(int channel, int index) const
+    {
+        const char* const p = getChannelData(channel) + (size_t) index * getBytesPerSample();
+
+        switch (format)
+        {
+            case INT16:     return *(const int16*) p * steps[channel] + offsets[channel];
+            case FLOAT16:   return halfToFloat(*(const uint16*) p);
+            default:        return *(const float*) p;
+        }
+    }
+
+    /** The samples themselves, in FLOAT32 format only (nullptr otherwise) */
+    const float* getFloatPointer(int channel, int startSample) const;
+
+    /** Rounds (source - offset) / step to int16, saturating. */
+    static void convertToInt16(const float* source, int16* dest, int numSamples, float step,
+                               float offset = 0.0f);
+
+    static void convertFromInt16(const int16* source, float* dest, int numSamples, float step,
+                                 float offset = 0.0f);
+
+    /** IEEE half float conversions (round to nearest even) */
+    static uint16 floatToHalf(float value);
+    static float halfToFloat(uint16 value);
+
+    static const int alignment = 64;
+
+private:
+
+    char* getChannelData(int channel) const
+    {
+        return data + (size_t) channel * stride * getBytesPerSample();
+    }
+
+    Format format;
+
+    HeapBlock<char> memory;
+    char* data;
+    int numChannels;
+    int numSamples;
+    int stride;
+
+    HeapBlock<float> steps;
+    HeapBlock<float> offsets;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CompactSampleBuffer);
+};
+
+#endif  // __COMPACTSAMPLEBUFFER_H_5E2A91C7__
@@ -24,14 +24,17 @@
 #include "GenericProcessor.h"
 #include "../../UI/UIComponent.h"
 #include "../../AccessClass.h"
+#include "../ProcessorGraph/LatencyMonitor.h"
+#include "AllocationTrap.h"
 
 #include <exception>
 
 GenericProcessor::GenericProcessor(const String& name_) :
     sourceNode(0), destNode(0), isEnabled(true), wasConnected(false),
     nextAvailableChannel(0), saveOrder(-1), loadOrder(-1), currentChannel(-1),
-    editor(0), parametersAsXml(nullptr), sendSampleCount(true), name(name_),
-    paramsWereLoaded(false), needsToSendTimestampMessage(false), timestampSet(false)
+    editor(0), parametersAsXml(nullptr), sendSampleCount(true), blockMetadata(&noStreams),
+    name(name_), paramsWereLoaded(false), needsToSendTimestampMessage(false), timestampSet(false),
+    selectedChannel(-1), numTrappedAllocations(0)
 {
     settings.numInputs = settings.numOutputs = settings.sampleRate = 0;
 
@@ -97,6 +100,123 @@ void GenericProcessor::setParameter(int parameterIndex, float newValue)
 
 }
 
+void GenericProcessor::queueParameterChange(int parameterIndex, float newValue, int target)
+{
+    ParameterChange change;
+    change.parameterIndex = parameterIndex;
+    change.newValue = newValue;
+    change.channel = selectedChannel;
+    change.target = target;
+
+    queueParameterChange(change);
+}
+
+void GenericProcessor::queueParameterChange(const ParameterChange& change)
+{
+    if (queueParameterChanges.get() == 0)
+    {
+        applyParameterChange(change);
+        return;
+    }
+
+    // if processing has stalled and the queue is full, the change is
+    // dropped (and counted) rather than blocking the message thread
+    parameterChanges.push(change);
+}
+
+void GenericProcessor::setQueueParameterChanges(bool shouldQueue)
+{
+    queueParameterChanges.set(shouldQueue ? 1 : 0);
+
+    if (shouldQueue)
+    {
+        scratch.clearStatistics();
+        numTrappedAllocations = 0;
+    }
+    else
+    {
+        // processing has stopped, so anything left over can be applied here,
+        // and currentChannel goes back to the editor
+        applyQueuedParameterChanges();
+        currentChannel = selectedChannel;
+
+        if (parameterChanges.getNumDropped() > 0)
+        {
+            std::cout << getName() << " dropped " << parameterChanges.getNumDropped()
+                      << " parameter changes (queue full)." << std::endl;
+            parameterChanges.clearNumDropped();
+        }
+
+        if (scratch.getNumOverflows() > 0)
+        {
+            std::cout << getName() << " ran out of scratch space " << scratch.getNumOverflows()
+                      << " times (" << scratch.getSize() << " bytes reserved)." << std::endl;
+        }
+
+        if (numTrappedAllocations > 0)
+        {
+            std::cout << getName() << " (" << nodeId << ") used the heap " << numTrappedAllocations
+                      << " times on the processing thread." << std::endl;
+        }
+    }
+}
+
+void GenericProcessor::reserveScratch(int numChannels, int numSamples)
+{
+    const size_t channelSize = BlockArena::getPaddedSize(sizeof(float) * jmax(0, numSamples));
+
+    scratch.reserve(BlockArena::getPaddedSize(sizeof(float*) * jmax(0, numChannels))
+                    + channelSize * jmax(0, numChannels));
+}
+
+float* GenericProcessor::getScratch(int numSamples)
+{
+    return (float*) scratch.allocate(sizeof(float) * jmax(0, numSamples));
+}
+
+float** GenericProcessor::getScratchChannels(int numChannels, int numSamples)
+{
+    float** pointers = (float**) scratch.allocate(sizeof(float*) * jmax(0, numChannels));
+
+    if (pointers == nullptr)
+        return nullptr;
+
+    for (int i = 0; i < numChannels; i++)
+    {
+        pointers[i] = getScratch(numSamples);
+
+        if (pointers[i] == nullptr)
+            return nullptr;
+    }
+
+    return pointers;
+}
+
+int GenericProcessor::getNumTrappedAllocations() const
+{
+    return numTrappedAllocations;
+}
+
+void GenericProcessor::setBlockMetadata(BlockMetadata* metadata)
+{
+    blockMetadata = (metadata != nullptr) ? metadata : &noStreams;
+}
+
+void GenericProcessor::applyParameterChange(const ParameterChange& change)
+{
+    currentChannel = change.channel;
+    setParameter(change.parameterIndex, change.newValue);
+}
+
+void GenericProcessor::applyQueuedParameterChanges()
+{
+    // only the changes already waiting, so a busy editor cannot hold up the block
+    ParameterChange change;
+
+    for (int n = parameterChanges.getNumReady(); n > 0 && parameterChanges.pop(change); n--)
+        applyParameterChange(change);
+}
+
 const String GenericProcessor::getParameterName(int parameterIndex)
 {
     Parameter& p=parameters.getReference(parameterIndex);
@@ -368,6 +488,7 @@ void GenericProcessor::update()
             ch->setProcessor(this);
             ch->sampleRate = getDefaultSampleRate();
             ch->bitVolts = getBitVolts(ch);
+            ch->offsetVolts = getOffsetVolts(ch);
             ch->sourceNodeId = nodeId;
             ch->nodeIndex = nidx;
             ch->mappedIndex = nidx;
@@ -392,6 +513,7 @@ void GenericProcessor::update()
             ch->setProcessor(this);
             ch->sampleRate = getDefaultSampleRate();
             ch->bitVolts = getBitVolts(ch);
+            ch->offsetVolts = getOffsetVolts(ch);
             ch->sourceNodeId = nodeId;
             ch->nodeIndex = nidx;
             ch->mappedIndex = nidx;
@@ -416,6 +538,7 @@ void GenericProcessor::update()
             ch->setProcessor(this);
             ch->sampleRate = getDefaultSampleRate();
             ch->bitVolts = getBitVolts(ch);
+            ch->offsetVolts = getOffsetVolts(ch);
             ch->sourceNodeId = nodeId;
             ch->nodeIndex = nidx;
             ch->mappedIndex = nidx;
@@ -522,27 +645,10 @@ void GenericProcessor::disableEditor()
 /** Used to get the number of samples in a given buffer, for a given channel. */
 int GenericProcessor::getNumSamples(int channelNum)
 {
-    int sourceNodeId, nSamples;
-
     if (channelNum >= 0 && channelNum < channels.size())
-        sourceNodeId = channels[channelNum]->sourceNodeId;
+        return blockMetadata->getNumSamples(channels[channelNum]->sourceNodeId);
     else
         return 0;
-
-    // std::cout << "Requesting samples for channel " << channelNum << " with source node " << sourceNodeId << std::endl;
-
-    try
-    {
-        nSamples = numSamples.at(sourceNodeId);
-    }
-    catch (std::exception& e)
-    {
-        return 0;
-    }
-
-    //std::cout << nSamples << " were found." << std::endl;
-
-    return nSamples;
 }
 
 
@@ -550,51 +656,23 @@ int GenericProcessor::getNumSamples(int channelNum)
 void GenericProcessor::setNumSamples(MidiBuffer& events, int sampleIndex)
 {
 
-    // This amounts to adding a "buffer size" flag at a particular sample number,
-    // and a new flag is added each time "setNumSamples" is called.
-    // Thus, if the number of samples changes somewhere in the processing pipeline,
-    // the old sample number will remain. This is a problem if the number of
-    // samples gets smaller.
-    // If we allow the sample rate to change (e.g., with a resampling node),
-    // this code will have to be updated. The easiest approach will be for each
-    // processor to ignore any buffer size events that don't come from its
-    // immediate source.
+    // Sample counts are kept per stream (i.e., per source node ID), so a
+    // processor that changes the sample rate (e.g., the ResamplingNode) sets the
+    // sourceNodeId of its output channels to its own node ID and sends its own
+    // count; the count of the original stream is left untouched for any other
+    // branch of the signal chain.
     //
 
-    uint8 data[4];
-
-    int16 si = (int16) sampleIndex;
-
-    data[0] = BUFFER_SIZE;  // most-significant byte
-    data[1] = nodeId;       // least-significant byte
-    memcpy(data+2, &si, 2);
-
-    events.addEvent(data,       // spike data
-                    4,          // total bytes
-                    0); // sample index
+    blockMetadata->setNumSamples(nodeId, sampleIndex);
 }
 
 /** Used to get the timestamp for a given buffer, for a given source node. */
 int64 GenericProcessor::getTimestamp(int channelNum)
 {
-    int sourceNodeId;
-    int64 ts;
-
     if (channelNum >= 0 && channelNum < channels.size())
-        sourceNodeId = channels[channelNum]->sourceNodeId;
+        return blockMetadata->getTimestamp(channels[channelNum]->sourceNodeId);
     else
         return 0;
-
-    try
-    {
-        ts = timestamps.at(sourceNodeId);
-    }
-    catch (std::exception& e)
-    {
-        return 0;
-    }
-
-    return ts;
 }
 
 /** Used to set the timestamp for a given buffer, for a given channel. */
@@ -618,8 +696,9 @@ void GenericProcessor::setTimestamp(MidiBuffer& events, int64 timestamp)
              true    // isTimestampEvent
             );
 
-    //since the processor generating the timestamp won't get the event, add it to the map
-    timestamps[nodeId] = timestamp;
+    // the event is still sent for processors that handle TIMESTAMP events,
+    // but the timestamp itself is read from the block metadata
+    blockMetadata->setTimestamp(nodeId, timestamp);
 
     if (needsToSendTimestampMessage)
     {
@@ -643,24 +722,15 @@ void GenericProcessor::setTimestamp(MidiBuffer& events, int64 timestamp)
 int GenericProcessor::processEventBuffer(MidiBuffer& events)
 {
     //
-    // This loops through all events in the buffer, and uses the BUFFER_SIZE
-    // events to determine the number of samples in the current buffer. If
-    // there are multiple such events, the one with the highest number of
-    // samples will be used.
-    // This approach is not ideal, as it will become a problem if we allow
-    // the sample rate to change at different points in the signal chain.
+    // Sample counts and timestamps are read directly from the numSamples and
+    // timestamps tables (see getNumSamples() and getTimestamp()), so all
+    // that's left to do here is to make sure that saved events aren't
+    // saved again by a downstream RecordNode.
     //
 
-    int numRead = 0;
-
-    //int numRead = 0;
-
     if (events.getNumEvents() > 0)
     {
 
-        // int m = events.getNumEvents();
-        //std::cout << getName() << " received " << m << " events." << std::endl;
-
         MidiBuffer::Iterator i(events);
 
         const uint8* dataptr;
@@ -671,55 +741,19 @@ int GenericProcessor::processEventBuffer(MidiBuffer& events)
         while (i.getNextEvent(dataptr, dataSize, samplePosition))
         {
 
-            if (*dataptr == BUFFER_SIZE)
+            if (isWritableEvent(*dataptr) &&    // a TTL event
+                getNodeId() < 900 && // not handled by a specialized processor (e.g. AudioNode))
+                *(dataptr+4) > 0)    // that's flagged for saving
             {
-
-                int16 nr;
-                memcpy(&nr, dataptr+2, 2);
-
-                numRead = nr;
-
-                uint8 sourceNodeId;
-                memcpy(&sourceNodeId, dataptr + 1, 1);
-
-                numSamples[sourceNodeId] = numRead;
-
-                //if (nodeId < 900)
-                //    std::cout << nodeId << " got " << numRead << " samples for " << (int) sourceNodeId << std::endl;
-
-
-            }
-            else if (*dataptr == TIMESTAMP)
-            {
-                int64 ts;
-                memcpy(&ts, dataptr+6, 8);
-
-                uint8 sourceNodeId;
-                memcpy(&sourceNodeId, dataptr + 1, 1);
-
-                timestamps[sourceNodeId] = ts;
-
-                //if (nodeId < 900)
-                //    std::cout << nodeId << " got " << ts << " timestamp for " << (int) sourceNodeId << std::endl;
-
-            }
-            else
-            {
-
-                if (isWritableEvent(*dataptr) &&    // a TTL event
-                    getNodeId() < 900 && // not handled by a specialized processor (e.g. AudioNode))
-                    *(dataptr+4) > 0)    // that's flagged for saving
-                {
-                    // changing the const cast is dangerous, but probably necessary:
-                    uint8* ptr = const_cast<uint8*>(dataptr);
-                    *(ptr + 4) = 0; // set fifth byte of raw data to 0, so the event
-                    // won't be saved twice
-                }
+                // changing the const cast is dangerous, but probably necessary:
+                uint8* ptr = const_cast<uint8*>(dataptr);
+                *(ptr + 4) = 0; // set fifth byte of raw data to 0, so the event
+                // won't be saved twice
             }
         }
     }
 
-    return numRead;
+    return 0;
 }
 
 
@@ -738,11 +772,17 @@ int GenericProcessor::checkForEvents(MidiBuffer& midiMessages)
         int samplePosition = 0;
         i.setNextSamplePosition(samplePosition);
 
+        // outputs report when TTL events reach them
+        LatencyMonitor* latencyMonitor = isSink() ? LatencyMonitor::getActive() : nullptr;
+
         while (i.getNextEvent(message, samplePosition))
         {
 
             const uint8* dataptr = message.getRawData();
 
+            if (latencyMonitor != nullptr && *dataptr == TTL)
+                latencyMonitor->eventReachedOutput(nodeId, dataptr, message.getRawDataSize(), samplePosition);
+
             handleEvent(*dataptr, message, samplePosition);
 
         }
@@ -803,6 +843,12 @@ void GenericProcessor::addEvent(MidiBuffer& eventBuffer,
 void GenericProcessor::processBlock(AudioSampleBuffer& buffer, MidiBuffer& eventBuffer)
 {
 
+    AllocationTrap::enterBlock(name.toRawUTF8(), nodeId, &numTrappedAllocations);
+
+    scratch.reset(); // temporary buffers of the previous block are released
+
+    applyQueuedParameterChanges(); // block boundary: safe to modify process() state
+
     processEventBuffer(eventBuffer); // extract buffer sizes and timestamps,
     // set flag on all TTL events to zero
 
@@ -810,6 +856,8 @@ void GenericProcessor::processBlock(AudioSampleBuffer& buffer, MidiBuffer& event
 
     process(buffer, eventBuffer);
 
+    AllocationTrap::exitBlock();
+
 }
 
 
@@ -1009,6 +1057,8 @@ void GenericProcessor::loadCustomChannelParametersFromXml(XmlElement* channelInf
 
 const String GenericProcessor::unusedNameString("xxx-UNUSED-OPEN-EPHYS-xxx");
 
+BlockMetadata GenericProcessor::noStreams;
+
 const String GenericProcessor::getName() const
 {
     return name;
@@ -1117,6 +1167,24 @@ float GenericProcessor::getSampleRate()
     return settings.sampleRate;
 }
 
+float GenericProcessor::getChannelSampleRate(int channelNum)
+{
+    if (channelNum >= 0 && channelNum < channels.size() && channels[channelNum]->sampleRate > 0)
+        return channels[channelNum]->sampleRate;
+    else
+        return getSampleRate();
+}
+
+float GenericProcessor::getMaxChannelSampleRate()
+{
+    float maxRate = 0;
+
+    for (int i = 0; i < channels.size(); i++)
+        maxRate = jmax(maxRate, channels[i]->sampleRate);
+
+    return (maxRate > 0) ? maxRate : getSampleRate();
+}
+
 float GenericProcessor::getDefaultSampleRate()
 {
     return 44100.0;
@@ -1162,9 +1230,19 @@ float GenericProcessor::getBitVolts(Channel* chan)
     return 1.0;
 }
 
+float GenericProcessor::getOffsetVolts(Channel* chan)
+{
+    return 0.0;
+}
+
 void GenericProcessor::setCurrentChannel(int chan)
 {
-    currentChannel = chan;
+    selectedChannel = chan;
+
+    // during acquisition, currentChannel belongs to the processing thread,
+    // and queued changes carry the selected channel with them
+    if (queueParameterChanges.get() == 0)
+        currentChannel = chan;
 }
 
 int GenericProcessor::getNodeId()
@@ -1290,4 +1368,4 @@ void GenericProcessor::updateSettings() {}
 String GenericProcessor::interProcessorCommunication(String command)
 {
     return String("OK");
-};
\ No newline at end of file
+};
\ No newline at end of file
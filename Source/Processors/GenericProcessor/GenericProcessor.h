@@ -36,6 +36,9 @@ enum ChannelType {HEADSTAGE_CHANNEL = 0, AUX_CHANNEL = 1, ADC_CHANNEL = 2, EVENT
 #include "../Parameter/Parameter.h"
 #include "../Channel/Channel.h"
 #include "../../CoreServices.h"
+#include "BlockArena.h"
+#include "ParameterChangeQueue.h"
+#include "BlockMetadata.h"
 
 #include <time.h>
 #include <stdio.h>
@@ -93,9 +96,33 @@ public:
 
     /** Allows parameters to change while acquisition is active. If the user wants
     to change ANY variables that are used within the process() method, this must
-    be done through setParameter(). Otherwise the application will crash. */
+    be done through setParameter(). Otherwise the application will crash.
+    Editors should use queueParameterChange(), which calls this function from
+    the processing thread while acquisition is active. */
     virtual void setParameter(int parameterIndex, float newValue);
 
+    /** Thread-safe way for editors to change parameters. While acquisition is
+    active, the change is pushed onto a lock-free queue and applied by
+    processBlock() before the next call to process(), so process() never sees a
+    half-updated state. Otherwise the change is applied immediately. */
+    void queueParameterChange(int parameterIndex, float newValue, int target = -1);
+
+    /** Queues a fully specified parameter change (see above). */
+    void queueParameterChange(const ParameterChange& change);
+
+    /** Called by the ProcessorGraph when acquisition starts and stops. Any
+    changes still waiting in the queue are applied when queueing is turned off. */
+    void setQueueParameterChanges(bool shouldQueue);
+
+    /** Called by the ProcessorGraph when the signal chain is built, before
+    acquisition starts. The graph owns the metadata. */
+    void setBlockMetadata(BlockMetadata* metadata);
+
+    /** Applies a single queued parameter change. The default implementation
+    selects the captured channel and calls setParameter(); processors that make
+    use of the target field should override it. */
+    virtual void applyParameterChange(const ParameterChange& change);
+
     /** Creates a GenericEditor.*/
     virtual AudioProcessorEditor* createEditor();
 
@@ -203,9 +230,17 @@ public:
     /** Pointer to a processor's immediate destination.*/
     GenericProcessor* destNode;
 
-    /** Returns the sample rate for a processor (assumes the same rate for all channels).*/
+    /** Returns the sample rate for a processor (the rate of the stream it inherited its settings from).*/
     virtual float getSampleRate();
 
+    /** Returns the sample rate of a continuous channel. Channels that come from different
+    streams (e.g. a full-rate branch and a decimated branch joined by a Merger) can have
+    different rates, and therefore a different number of samples in each buffer. */
+    float getChannelSampleRate(int channelNum);
+
+    /** Returns the highest sample rate of all continuous channels. */
+    float getMaxChannelSampleRate();
+
     /** Returns the default sample rate, in case a processor has no source (or is itself a source).*/
     virtual float getDefaultSampleRate();
 
@@ -233,6 +268,9 @@ public:
     /** Returns the bit volts for a given channel **/
     virtual float getBitVolts(Channel* chan);
 
+    /** Returns the voltage of an ADC value of 0 for a given channel (see Channel::offsetVolts) **/
+    virtual float getOffsetVolts(Channel* chan);
+
 
     /** Returns the next available channel (and increments the channel if the input is set to 'true'. */
     virtual int getNextChannel(bool t);
@@ -240,7 +278,7 @@ public:
     /** Resets all inter-processor connections prior to the start of data acquisition.*/
     virtual void resetConnections();
 
-    /** Sets the current channel (for purposes of updating parameter).*/
+    /** Selects the channel that the editor's next parameter changes apply to.*/
     virtual void setCurrentChannel(int chan);
 
     /** Returns the unique integer ID for a processor. */
@@ -382,7 +420,9 @@ public:
     /** Variable used to orchestrate loading the ProcessorGraph. */
     int loadOrder;
 
-    /** The channel that will be updated the next time a parameter is changed. */
+    /** The channel that setParameter() applies to. During acquisition, only the
+    processing thread changes it (to the channel of each queued change);
+    otherwise it follows setCurrentChannel(). */
     int currentChannel;
 
     /** Returns a pointer to the processor's editor. */
@@ -486,8 +526,28 @@ public:
     /** Used to set the timestamp for a given buffer, for a given source node. */
     void setTimestamp(MidiBuffer&, int64 timestamp);
 
-    std::map<uint8, int> numSamples;
-    std::map<uint8, int64> timestamps;
+    /** Sample count and timestamp of the current buffer of each stream,
+    looked up by source node ID. Never null: until the ProcessorGraph sets
+    it, it has no streams. */
+    BlockMetadata* blockMetadata;
+
+    /** Makes sure process() can take numChannels channels of numSamples samples
+    from the scratch arena in each block. Call it from updateSettings() or
+    enable(), with the most process() will need. */
+    void reserveScratch(int numChannels, int numSamples);
+
+    /** Returns space for numSamples samples that is valid until the end of
+    the current block, or nullptr if less was reserved. Only for use within
+    process(). */
+    float* getScratch(int numSamples);
+
+    /** Returns numChannels channels of numSamples samples from the scratch
+    arena (as for getScratch()). */
+    float** getScratchChannels(int numChannels, int numSamples);
+
+    /** Heap allocations made by process() during this acquisition, when the
+    AllocationTrap is enabled. */
+    int getNumTrappedAllocations() const;
 
 private:
 
@@ -502,7 +562,7 @@ private:
     Array<bool> recordStatus;
     Array<bool> monitorStatus;
 
-    /** Extracts sample counts and timestamps from the MidiBuffer. */
+    /** Clears the "saved" flag of incoming events. */
     int processEventBuffer(MidiBuffer&);
 
     /** For getInputChannelName() and getOutputChannelName() */
@@ -513,6 +573,26 @@ private:
 
     bool timestampSet;
 
+    /** The channel last selected by the editor. Only the message thread
+    touches it; queued changes capture it when they are requested. */
+    int selectedChannel;
+
+    /** Applies all parameter changes that are waiting in the queue. */
+    void applyQueuedParameterChanges();
+
+    /** Changes requested by the message thread, applied by processBlock() */
+    ParameterChangeQueue parameterChanges;
+
+    Atomic<int> queueParameterChanges;
+
+    /** Temporary buffers of process(), released after each block */
+    BlockArena scratch;
+
+    int numTrappedAllocations;
+
+    /** Used by processors that are not (yet) in a graph */
+    static BlockMetadata noStreams;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GenericProcessor);
 
 };
@@ -0,0 +1,66 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "ParameterChangeQueue.h"
+
+ParameterChangeQueue::ParameterChangeQueue(int capacity)
+    : fifo(capacity)
+{
+    changes.malloc(fifo.getTotalSize());
+}
+
+ParameterChangeQueue::~ParameterChangeQueue()
+{
+}
+
+bool ParameterChangeQueue::push(const ParameterChange& change)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+    {
+        ++numDropped;
+        return false;
+    }
+
+    changes[size1 > 0 ? start1 : start2] = change;
+    fifo.finishedWrite(1);
+
+    return true;
+}
+
+bool ParameterChangeQueue::pop(ParameterChange& change)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+        return false;
+
+    change = changes[size1 > 0 ? start1 : start2];
+    fifo.finishedRead(1);
+
+    return true;
+}
@@ -0,0 +1,98 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __PARAMETERCHANGEQUEUE_H_93C1E6A0__
+#define __PARAMETERCHANGEQUEUE_H_93C1E6A0__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+  A parameter change requested by the message thread. The channel (and an
+  optional processor-specific target, such as an electrode index) are captured
+  when the change is requested, so later selection changes in the editor
+  cannot redirect it.
+*/
+struct ParameterChange
+{
+    int parameterIndex;
+    float newValue;
+    int channel;
+    int target;
+};
+
+/**
+
+  Single-producer (message thread), single-consumer (processing thread) queue
+  of parameter changes.
+
+  The changes are copied into a fixed array through an AbstractFifo, so
+  neither side allocates or locks. If the processing thread has stalled and
+  the queue is full, push() drops the change and counts it rather than
+  blocking the message thread.
+
+  @see GenericProcessor::queueParameterChange
+
+*/
+
+class ParameterChangeQueue
+{
+public:
+    ParameterChangeQueue(int capacity = 256);
+    ~ParameterChangeQueue();
+
+    /** Adds a change to the queue. Returns false if it was full. Message
+        thread only. */
+    bool push(const ParameterChange& change);
+
+    /** Takes the oldest change off the queue. Returns false if it was empty.
+        Processing thread only (or the message thread once processing has
+        stopped). */
+    bool pop(ParameterChange& change);
+
+    int getNumReady() const
+    {
+        return fifo.getNumReady();
+    }
+
+    /** Changes dropped because the queue was full */
+    int getNumDropped() const
+    {
+        return numDropped.get();
+    }
+
+    void clearNumDropped()
+    {
+        numDropped.set(0);
+    }
+
+private:
+
+    AbstractFifo fifo;
+    HeapBlock<ParameterChange> changes;
+    Atomic<int> numDropped;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParameterChangeQueue);
+};
+
+#endif  // __PARAMETERCHANGEQUEUE_H_93C1E6A0__
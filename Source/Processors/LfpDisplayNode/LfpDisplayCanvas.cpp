@@ -27,7 +27,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 LfpDisplayCanvas::LfpDisplayCanvas(LfpDisplayNode* processor_) :
      timebase(1.0f), displayGain(1.0f),   timeOffset(0.0f),
-    processor(processor_), selectedChannelType(HEADSTAGE_CHANNEL)
+    processor(processor_), selectedChannelType(HEADSTAGE_CHANNEL),
+    scrollbackOffset(0), showingScrollback(false),
+    currentFrameTime(0.0), totalFrameTime(0.0), maxFrameTime(0.0), numFrames(0)
 {
 
     nChans = processor->getNumInputs();
@@ -241,6 +243,16 @@ LfpDisplayCanvas::LfpDisplayCanvas(LfpDisplayNode* processor_) :
     pauseButton->setToggleState(false, sendNotification);
     addAndMakeVisible(pauseButton);
 
+    //button for drawing all traces with OpenGL instead of one component per channel
+    openGLButton = new UtilityButton("OpenGL", Font("Small Text", 13, Font::plain));
+    openGLButton->setRadius(5.0f);
+    openGLButton->setEnabledState(true);
+    openGLButton->setCorners(true, true, true, true);
+    openGLButton->addListener(this);
+    openGLButton->setClickingTogglesState(true);
+    openGLButton->setToggleState(false, dontSendNotification);
+    addAndMakeVisible(openGLButton);
+
 
     lfpDisplay->setNumChannels(nChans);
     lfpDisplay->setRange(voltageRanges[HEADSTAGE_CHANNEL][selectedVoltageRange[HEADSTAGE_CHANNEL]-1].getFloatValue()*rangeGain[HEADSTAGE_CHANNEL]
@@ -268,6 +280,7 @@ LfpDisplayCanvas::LfpDisplayCanvas(LfpDisplayNode* processor_) :
 
 LfpDisplayCanvas::~LfpDisplayCanvas()
 {
+    openGLRenderer = nullptr;
 
     deleteAndZero(screenBuffer);
     deleteAndZero(screenBufferMin);
@@ -288,6 +301,9 @@ void LfpDisplayCanvas::resized()
 
     lfpDisplay->setBounds(0,0,getWidth()-scrollBarThickness, lfpDisplay->getChannelHeight()*nChans);
 
+    if (openGLRenderer != nullptr)
+        openGLRenderer->setBounds(leftmargin,30,getWidth()-scrollBarThickness-leftmargin,getHeight()-90);
+
     rangeSelection->setBounds(5,getHeight()-30,100,25);
     timebaseSelection->setBounds(175,getHeight()-30,100,25);
     spreadSelection->setBounds(345,getHeight()-30,100,25);
@@ -296,6 +312,7 @@ void LfpDisplayCanvas::resized()
     invertInputButton->setBounds(750,getHeight()-50,100,22);
     drawMethodButton->setBounds(750,getHeight()-25,100,22);
     pauseButton->setBounds(880,getHeight()-50,50,44);
+    openGLButton->setBounds(935,getHeight()-50,60,44);
 
     for (int i = 0; i < 8; i++)
     {
@@ -324,6 +341,12 @@ void LfpDisplayCanvas::beginAnimation()
         screenBufferIndex.set(i,0);
     }
 
+    {
+        const ScopedLock sl(frameTimeLock);
+        currentFrameTime = totalFrameTime = maxFrameTime = 0.0;
+        numFrames = 0;
+    }
+
     startCallbacks();
 }
 
@@ -332,6 +355,8 @@ void LfpDisplayCanvas::endAnimation()
     std::cout << "Ending animation." << std::endl;
 
     stopCallbacks();
+
+    printFrameTimes();
 }
 
 void LfpDisplayCanvas::update()
@@ -370,6 +395,7 @@ void LfpDisplayCanvas::update()
         refreshScreenBuffer();
 
         lfpDisplay->setNumChannels(nChans); // add an extra channel for events
+        lfpDisplay->setTracesVisible(openGLRenderer == nullptr);
 
         // update channel names
         for (int i = 0; i < processor->getNumInputs(); i++)
@@ -415,6 +441,21 @@ void LfpDisplayCanvas::buttonClicked(Button* b)
     if (b == pauseButton)
     {
         lfpDisplay->isPaused = b->getToggleState();
+
+        if (! lfpDisplay->isPaused && showingScrollback)
+        {
+            // go back to the live view
+            showingScrollback = false;
+            scrollbackOffset = 0;
+            refreshScreenBuffer();
+            fullredraw = true;
+        }
+
+        return;
+    }
+    if (b == openGLButton)
+    {
+        setOpenGLEnabled(b->getToggleState());
         return;
     }
 
@@ -661,6 +702,65 @@ void LfpDisplayCanvas::refreshScreenBuffer()
 
 }
 
+void LfpDisplayCanvas::showScrollback()
+{
+    ScrollbackBuffer* scrollback = processor->getScrollback();
+
+    if (scrollback == nullptr || ! scrollback->isOpen())
+        return;
+
+    const Range<double> available = scrollback->getAvailableTime();
+
+    if (available.isEmpty())
+        return;
+
+    scrollbackOffset = jlimit(0.0, jmax(0.0, available.getLength() - timebase), scrollbackOffset);
+
+    const double end = available.getEnd() - scrollbackOffset;
+    const int width = jmin(MAX_N_SAMP, lfpDisplay->getWidth() - leftmargin);
+    const int n = jmin(nChans + 1, scrollback->getNumChannels(), MAX_N_CHAN);
+
+    if (width <= 0)
+        return;
+
+    refreshScreenBuffer();
+
+    // the min and max of each pixel come straight from the scrollback's summaries
+    scrollback->readMinMax(0, n, Range<double>(end - timebase, end), width,
+                           screenBufferMin->getArrayOfWritePointers(),
+                           screenBufferMax->getArrayOfWritePointers());
+
+    for (int channel = 0; channel < n; channel++)
+    {
+        const float* mins = screenBufferMin->getReadPointer(channel);
+        const float* maxs = screenBufferMax->getReadPointer(channel);
+        float* samples = screenBuffer->getWritePointer(channel);
+        float* means = screenBufferMean->getWritePointer(channel);
+
+        for (int i = 0; i < width; i++)
+        {
+            means[i] = 0.5f * (mins[i] + maxs[i]);
+            samples[i] = channel == nChans ? maxs[i] : means[i]; // any TTL that was high
+        }
+    }
+
+    for (int channel = 0; channel <= nChans; channel++)
+    {
+        screenBufferIndex.set(channel, width);
+        lastScreenBufferIndex.set(channel, 0);
+    }
+
+    std::cout << "LFP Viewer: showing " << end - timebase << " s to " << end << " s of the scrollback" << std::endl;
+
+    showingScrollback = true;
+    fullredraw = true;
+
+    if (openGLRenderer != nullptr && openGLRenderer->isAvailable())
+        openGLRenderer->refresh();
+    else
+        lfpDisplay->refresh();
+}
+
 void LfpDisplayCanvas::updateScreenBuffer()
 {
 
@@ -736,18 +836,14 @@ void LfpDisplayCanvas::updateScreenBuffer()
                      dbi %= displayBufferSize; // just to be sure
 
                     // interpolate between two samples with invAlpha and alpha
-                    screenBuffer->addFrom(channel, // destChannel
-                                          sbi, // destStartSample
-                                          displayBuffer->getReadPointer(channel, dbi), // source
-                                          1, // numSamples
-                                          invAlpha*gain); // gain
+                    screenBuffer->addSample(channel, // destChannel
+                                            sbi, // destSample
+                                            displayBuffer->getSample(channel, dbi) * invAlpha*gain);
 
 
-                    screenBuffer->addFrom(channel, // destChannel
-                                          sbi, // destStartSample
-                                          displayBuffer->getReadPointer(channel, nextPos), // source
-                                          1, // numSamples
-                                          alpha*gain); // gain
+                    screenBuffer->addSample(channel, // destChannel
+                                            sbi, // destSample
+                                            displayBuffer->getSample(channel, nextPos) * alpha*gain);
 
                     // same thing again, but this time add the min,mean, and max of all samples in current pixel
                     float sample_min   =  1000000;
@@ -832,6 +928,26 @@ const float LfpDisplayCanvas::getYCoordMax(int chan, int samp)
     return *screenBufferMax->getReadPointer(chan, samp);
 }
 
+const float* LfpDisplayCanvas::getYCoords(int chan)
+{
+    return screenBuffer->getReadPointer(chan);
+}
+
+const float* LfpDisplayCanvas::getYCoordsMin(int chan)
+{
+    return screenBufferMin->getReadPointer(chan);
+}
+
+const float* LfpDisplayCanvas::getYCoordsMax(int chan)
+{
+    return screenBufferMax->getReadPointer(chan);
+}
+
+int LfpDisplayCanvas::getScreenBufferSize()
+{
+    return MAX_N_SAMP;
+}
+
 
 bool LfpDisplayCanvas::getInputInvertedState()
 {
@@ -891,11 +1007,98 @@ void LfpDisplayCanvas::paint(Graphics& g)
 
 }
 
+void LfpDisplayCanvas::setOpenGLEnabled(bool enabled)
+{
+    if (enabled == isOpenGLEnabled())
+        return;
+
+    printFrameTimes(); // report the renderer we're switching away from
+
+    if (enabled)
+    {
+        openGLRenderer = new LfpOpenGLRenderer(this, lfpDisplay, viewport);
+        addAndMakeVisible(openGLRenderer);
+    }
+    else
+    {
+        openGLRenderer = nullptr;
+    }
+
+    openGLButton->setToggleState(enabled, dontSendNotification);
+    lfpDisplay->setTracesVisible(!enabled);
+
+    {
+        const ScopedLock sl(frameTimeLock);
+        currentFrameTime = totalFrameTime = maxFrameTime = 0.0;
+        numFrames = 0;
+    }
+
+    fullredraw = true;
+    resized();
+}
+
+bool LfpDisplayCanvas::isOpenGLEnabled()
+{
+    return openGLRenderer != nullptr;
+}
+
+void LfpDisplayCanvas::addFrameTime(double ms)
+{
+    const ScopedLock sl(frameTimeLock);
+    currentFrameTime += ms;
+}
+
+void LfpDisplayCanvas::finishFrame()
+{
+    const ScopedLock sl(frameTimeLock);
+
+    if (currentFrameTime > 0.0)
+    {
+        totalFrameTime += currentFrameTime;
+        maxFrameTime = jmax(maxFrameTime, currentFrameTime);
+        numFrames++;
+    }
+
+    currentFrameTime = 0.0;
+}
+
+void LfpDisplayCanvas::printFrameTimes()
+{
+    finishFrame();
+
+    const ScopedLock sl(frameTimeLock);
+
+    if (numFrames > 0)
+    {
+        std::cout << "LfpDisplayCanvas: " << nChans << " channels, "
+                  << (isOpenGLEnabled() ? "OpenGL" : "component") << " renderer, "
+                  << "mean frame time " << totalFrameTime / numFrames << " ms, "
+                  << "max " << maxFrameTime << " ms over " << numFrames << " frames." << std::endl;
+    }
+}
+
 void LfpDisplayCanvas::refresh()
 {
+    finishFrame(); // includes the paint calls triggered by the previous refresh
+
+    int64 start = Time::getHighResolutionTicks();
 
     updateScreenBuffer();
 
+    addFrameTime(Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1000.0);
+
+    if (openGLRenderer != nullptr)
+    {
+        if (openGLRenderer->isAvailable())
+        {
+            openGLRenderer->refresh();
+            return;
+        }
+
+        std::cout << "OpenGL is not available, switching back to the component renderer." << std::endl;
+        setOpenGLEnabled(false);
+    }
+
     lfpDisplay->refresh(); // redraws only the new part of the screen buffer
 
     //getPeer()->performAnyPendingRepaintsNow();
@@ -910,6 +1113,19 @@ bool LfpDisplayCanvas::keyPressed(const KeyPress& key)
         return true;
     }
 
+    // while paused, the arrow keys step back and forth through the scrollback
+    if (lfpDisplay->isPaused && processor->getScrollback() != nullptr
+        && (key.getKeyCode() == key.leftKey || key.getKeyCode() == key.rightKey))
+    {
+        if (key.getKeyCode() == key.leftKey)
+            scrollbackOffset += timebase;
+        else
+            scrollbackOffset = jmax(0.0, scrollbackOffset - timebase);
+
+        showScrollback();
+        return true;
+    }
+
     return false;
 }
 
@@ -935,6 +1151,7 @@ void LfpDisplayCanvas::saveVisualizerParameters(XmlElement* xml)
     xmlNode->setAttribute("colorGrouping",colorGroupingSelection->getSelectedId());
     xmlNode->setAttribute("isInverted",invertInputButton->getToggleState());
     xmlNode->setAttribute("drawMethod",drawMethodButton->getToggleState());
+    xmlNode->setAttribute("openGL",isOpenGLEnabled());
 
     int eventButtonState = 0;
 
@@ -1000,6 +1217,8 @@ void LfpDisplayCanvas::loadVisualizerParameters(XmlElement* xml)
 
             drawMethodButton->setToggleState(xmlNode->getBoolAttribute("drawMethod", true), sendNotification);
 
+            setOpenGLEnabled(xmlNode->getBoolAttribute("openGL", false));
+
             viewport->setViewPosition(xmlNode->getIntAttribute("ScrollX"),
                                       xmlNode->getIntAttribute("ScrollY"));
 
@@ -1589,6 +1808,14 @@ bool LfpDisplay::setEventDisplayState(int ch, bool state)
 }
 
 
+void LfpDisplay::setTracesVisible(bool state)
+{
+    for (int i = 0; i < channels.size(); i++)
+    {
+        channels[i]->setVisible(state);
+    }
+}
+
 bool LfpDisplay::getEventDisplayState(int ch)
 {
     return eventDisplayEnabled[ch];
@@ -1674,6 +1901,8 @@ void LfpChannelDisplay::setEnabledState(bool state)
 void LfpChannelDisplay::paint(Graphics& g)
 {
 
+    int64 start = Time::getHighResolutionTicks();
+
     //g.fillAll(Colours::grey);
 
     g.setColour(Colours::yellow);   // draw most recent drawn sample position
@@ -1854,6 +2083,7 @@ void LfpChannelDisplay::paint(Graphics& g)
 
     // g.drawText(String(chan+1), 10, center-channelHeight/2, 200, channelHeight, Justification::left, false);
 
+    canvas->addFrameTime(Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1000.0);
 
 }
 
@@ -1964,6 +2194,21 @@ void LfpChannelDisplay::setDrawMethod(bool isDrawMethod)
 }
 
 
+bool LfpChannelDisplay::getDrawMethod()
+{
+    return drawMethod;
+}
+
+Colour LfpChannelDisplay::getColour()
+{
+    return lineColour;
+}
+
+float LfpChannelDisplay::getYOffset(float value)
+{
+    return value/range*channelHeightFloat;
+}
+
 void LfpChannelDisplay::setName(String name_)
 {
     name = name_;
@@ -26,6 +26,7 @@
 #include "../../../JuceLibraryCode/JuceHeader.h"
 #include "LfpDisplayNode.h"
 #include "../Visualization/Visualizer.h"
+#include "LfpOpenGLRenderer.h"
 #define CHANNEL_TYPES 3
 
 class LfpDisplayNode;
@@ -86,6 +87,22 @@ public:
     const float getYCoordMean(int chan, int samp);
     const float getYCoordMax(int chan, int samp);
 
+    /** Returns a channel's row of the screen buffers (one value per pixel). */
+    const float* getYCoords(int chan);
+    const float* getYCoordsMin(int chan);
+    const float* getYCoordsMax(int chan);
+
+    /** Returns the number of pixels held by each channel of the screen buffers. */
+    int getScreenBufferSize();
+
+    /** Switches between the per-channel component renderer and the OpenGL renderer. */
+    void setOpenGLEnabled(bool);
+    bool isOpenGLEnabled();
+
+    /** Adds the time (in ms) spent on part of the current frame, so that the
+        frame times of the two renderers can be compared. Thread safe. */
+    void addFrameTime(double ms);
+
     Array<int> screenBufferIndex;
     Array<int> lastScreenBufferIndex;
 
@@ -128,7 +145,7 @@ private:
     //float waves[MAX_N_CHAN][MAX_N_SAMP*2]; // we need an x and y point for each sample
 
     LfpDisplayNode* processor;
-    AudioSampleBuffer* displayBuffer; // sample wise data buffer for display
+    CompactSampleBuffer* displayBuffer; // sample wise data buffer for display
     AudioSampleBuffer* screenBuffer; // subsampled buffer- one int per pixel
 
     //'define 3 buffers for min mean and max for better plotting of spikes
@@ -150,8 +167,11 @@ private:
     ScopedPointer<UtilityButton> invertInputButton;
     ScopedPointer<UtilityButton> drawMethodButton;
     ScopedPointer<UtilityButton> pauseButton;
+    ScopedPointer<UtilityButton> openGLButton;
     OwnedArray<UtilityButton> typeButtons;
 
+    ScopedPointer<LfpOpenGLRenderer> openGLRenderer;
+
     StringArray voltageRanges[CHANNEL_TYPES];
     StringArray timebases;
     StringArray spreads; // option for vertical spacing between channels
@@ -176,11 +196,31 @@ private:
     void refreshScreenBuffer();
     void updateScreenBuffer();
 
+    /** While paused, fills the screen buffers from the processor's scrollback,
+        with the timebase that ends scrollbackOffset seconds before its most
+        recent sample. */
+    void showScrollback();
+
+    double scrollbackOffset;
+    bool showingScrollback;
+
     Array<int> displayBufferIndex;
     int displayBufferSize;
 
     int scrollBarThickness;
 
+    /** Closes the current frame's time measurement. */
+    void finishFrame();
+
+    /** Prints the mean and maximum frame times of the active renderer. */
+    void printFrameTimes();
+
+    CriticalSection frameTimeLock;
+    double currentFrameTime;
+    double totalFrameTime;
+    double maxFrameTime;
+    int numFrames;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpDisplayCanvas);
 
 };
@@ -244,6 +284,9 @@ public:
     bool setEventDisplayState(int ch, bool state);
     bool getEventDisplayState(int ch);
 
+    /** Shows or hides the per-channel trace components (hidden while OpenGL draws the traces). */
+    void setTracesVisible(bool);
+
     int getColorGrouping();
     void setColorGrouping(int i);
 
@@ -310,6 +353,12 @@ public:
     void setCanBeInverted(bool);
 
     void setDrawMethod(bool);
+    bool getDrawMethod();
+
+    Colour getColour();
+
+    /** Returns the vertical offset (in pixels, relative to the channel's center) of a sample value. */
+    float getYOffset(float value);
 
     PopupMenu getOptions();
     void changeParameter(const int id);
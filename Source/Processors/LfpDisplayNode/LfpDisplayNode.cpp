@@ -26,19 +26,13 @@
 #include <stdio.h>
 
 LfpDisplayNode::LfpDisplayNode()
-    : GenericProcessor("LFP Viewer"),
+    : GenericProcessor("LFP Viewer"), scrollbackEventGaps(0),
       displayGain(1), bufferLength(5.0f),
       abstractFifo(100)
 {
     //std::cout << " LFPDisplayNodeConstructor" << std::endl;
-    displayBuffer = new AudioSampleBuffer(8, 100);
-
-    arrayOfOnes = new float[5000];
-
-    for (int n = 0; n < 5000; n++)
-    {
-        arrayOfOnes[n] = 1;
-    }
+    displayBuffer = new CompactSampleBuffer();
+    displayBuffer->setSize(8, 100);
 
 }
 
@@ -93,7 +87,8 @@ void LfpDisplayNode::updateSettings()
 
 bool LfpDisplayNode::resizeBuffer()
 {
-    int nSamples = (int) getSampleRate()*bufferLength;
+    // channels from a decimated branch need less space than full-rate ones
+    int nSamples = (int) getMaxChannelSampleRate()*bufferLength;
     int nInputs = getNumInputs();
 
     std::cout << "Resizing buffer. Samples: " << nSamples << ", Inputs: " << nInputs << std::endl;
@@ -102,6 +97,11 @@ bool LfpDisplayNode::resizeBuffer()
     {
         abstractFifo.setTotalSize(nSamples);
         displayBuffer->setSize(nInputs + numEventChannels, nSamples); // add extra channels for TTLs
+
+        for (int i = 0; i < nInputs + numEventChannels; i++)
+            displayBuffer->setStep(i, i < nInputs ? channels[i]->bitVolts : 1.0f,
+                                   i < nInputs ? channels[i]->offsetVolts : 0.0f);
+
         return true;
     }
     else
@@ -116,6 +116,8 @@ bool LfpDisplayNode::enable()
 
     if (resizeBuffer())
     {
+        openScrollback();
+
         LfpDisplayEditor* editor = (LfpDisplayEditor*) getEditor();
         editor->enable();
         return true;
@@ -127,8 +129,56 @@ bool LfpDisplayNode::enable()
 
 }
 
+void LfpDisplayNode::openScrollback()
+{
+    double seconds;
+    File directory;
+
+    if (! ScrollbackBuffer::getSettings(seconds, directory))
+    {
+        scrollback = nullptr;
+        return;
+    }
+
+    const int nInputs = getNumInputs();
+    const float sampleRate = getMaxChannelSampleRate();
+
+    // the scrollback advances every channel by the same number of samples
+    for (int i = 0; i < nInputs; i++)
+    {
+        if (channels[i]->sampleRate != sampleRate)
+        {
+            std::cout << "Scrollback is off: the inputs of the LFP Viewer have different sample rates." << std::endl;
+            scrollback = nullptr;
+            return;
+        }
+    }
+
+    if (scrollback == nullptr)
+        scrollback = new ScrollbackBuffer();
+
+    if (! scrollback->open(directory, nInputs + numEventChannels, sampleRate, seconds))
+        return;
+
+    for (int i = 0; i < nInputs + numEventChannels; i++)
+        scrollback->setStep(i, i < nInputs ? channels[i]->bitVolts : 1.0f,
+                            i < nInputs ? channels[i]->offsetVolts : 0.0f);
+
+    reserveScratch(1, ScrollbackBuffer::chunkSamples); // event samples read back from the displayBuffer
+    scrollbackEventGaps = 0;
+}
+
 bool LfpDisplayNode::disable()
 {
+    if (scrollback != nullptr)
+    {
+        scrollback->finishAppending();
+
+        if (scrollbackEventGaps > 0)
+            std::cout << "Scrollback: the TTL states of " << scrollbackEventGaps
+                      << " blocks were stored as 0 (no scratch space)." << std::endl;
+    }
+
     LfpDisplayEditor* editor = (LfpDisplayEditor*) getEditor();
     editor->disable();
     return true;
@@ -162,7 +212,7 @@ void LfpDisplayNode::handleEvent(int eventType, MidiMessage& event, int sampleNu
 
         int eventSourceNodeId = *(dataptr+5);
 
-        int nSamples = numSamples.at(eventSourceNodeId);
+        int nSamples = blockMetadata->getNumSamples(eventSourceNodeId);
 
         int samplesToFill = nSamples - eventTime;
 
@@ -190,11 +240,10 @@ void LfpDisplayNode::handleEvent(int eventType, MidiMessage& event, int sampleNu
 
             //std::cout << bufferIndex << " " << samplesToFill << " " << ttlState[eventSourceNode] << std::endl;
 
-            displayBuffer->copyFrom(channelForEventSource[eventSourceNodeId],  // destChannel
-                                    bufferIndex,		// destStartSample
-                                    arrayOfOnes, 		// source
-                                    samplesToFill, 		// numSamples
-                                    float(ttlState[eventSourceNodeId]));   // gain
+            displayBuffer->fill(channelForEventSource[eventSourceNodeId],  // destChannel
+                                bufferIndex,		// destStartSample
+                                float(ttlState[eventSourceNodeId]),   // value
+                                samplesToFill);		// numSamples
         }
         else
         {
@@ -206,19 +255,17 @@ void LfpDisplayNode::handleEvent(int eventType, MidiMessage& event, int sampleNu
 
             //std::cout << bufferIndex << " " << block1Size << " " << ttlState << std::endl;
 
-            displayBuffer->copyFrom(channelForEventSource[eventSourceNodeId],  // destChannel
-                                    bufferIndex,		// destStartSample
-                                    arrayOfOnes, 		// source
-                                    block1Size, 		// numSamples
-                                    float(ttlState[eventSourceNodeId]));   // gain
+            displayBuffer->fill(channelForEventSource[eventSourceNodeId],  // destChannel
+                                bufferIndex,		// destStartSample
+                                float(ttlState[eventSourceNodeId]),   // value
+                                block1Size);		// numSamples
 
             //std::cout << 0 << " " << block2Size << " " << ttlState << std::endl;
 
-            displayBuffer->copyFrom(channelForEventSource[eventSourceNodeId],  // destChannel
-                                    0,		                        // destStartSample
-                                    arrayOfOnes, 		// source
-                                    block2Size, 		// numSamples
-                                    float(ttlState[eventSourceNodeId]));   // gain
+            displayBuffer->fill(channelForEventSource[eventSourceNodeId],  // destChannel
+                                0,		// destStartSample
+                                float(ttlState[eventSourceNodeId]),   // value
+                                block2Size);		// numSamples
 
 
         }
@@ -249,7 +296,7 @@ void LfpDisplayNode::initializeEventChannels()
 
         int samplesLeft = displayBuffer->getNumSamples() - index;
 
-        int nSamples = numSamples.at(eventSourceNodes[i]);
+        int nSamples = blockMetadata->getNumSamples(eventSourceNodes[i]);
 
 
 
@@ -258,11 +305,10 @@ void LfpDisplayNode::initializeEventChannels()
 
             //	std::cout << getNumInputs()+1 << " " << displayBufferIndex << " " << totalSamples << " " << ttlState << std::endl;
             //
-            displayBuffer->copyFrom(chan,  // destChannel
-                                    index,		// destStartSample
-                                    arrayOfOnes, 		// source
-                                    nSamples, 		// numSamples
-                                    float(ttlState[eventSourceNodes[i]]));   // gain
+            displayBuffer->fill(chan,  // destChannel
+                                index,		// destStartSample
+                                float(ttlState[eventSourceNodes[i]]),   // value
+                                nSamples);		// numSamples
 
             displayBufferIndex.set(chan, index + nSamples);
         }
@@ -274,18 +320,16 @@ void LfpDisplayNode::initializeEventChannels()
             // std::cout << "OVERFLOW." << std::endl;
             // std::cout << bufferIndex << " " << block1Size << " " << ttlState << std::endl;
 
-            displayBuffer->copyFrom(chan,    // destChannel
-                                    index,		// destStartSample
-                                    arrayOfOnes, 		// source
-                                    samplesLeft, 		// numSamples
-                                    float(ttlState[eventSourceNodes[i]]));   // gain
+            displayBuffer->fill(chan,  // destChannel
+                                index,		// destStartSample
+                                float(ttlState[eventSourceNodes[i]]),   // value
+                                samplesLeft);		// numSamples
             // std::cout << 0 << " " << block2Size << " " << ttlState << std::endl;
 
-            displayBuffer->copyFrom(chan,  // destChannel
-                                    0,		// destStartSample
-                                    arrayOfOnes, 		// source
-                                    extraSamples, 		// numSamples
-                                    float(ttlState[eventSourceNodes[i]]));   // gain
+            displayBuffer->fill(chan,  // destChannel
+                                0,		// destStartSample
+                                float(ttlState[eventSourceNodes[i]]),   // value
+                                extraSamples);		// numSamples
 
             displayBufferIndex.set(chan, extraSamples);
         }
@@ -311,12 +355,10 @@ void LfpDisplayNode::process(AudioSampleBuffer& buffer, MidiBuffer& events)
         if (nSamples < samplesLeft)
         {
 
-            displayBuffer->copyFrom(chan,  			// destChannel
-                                    displayBufferIndex[chan], // destStartSample
-                                    buffer, 			// source
-                                    chan, 				// source channel
-                                    0,					// source start sample
-                                    nSamples); 			// numSamples
+            displayBuffer->write(chan,  			// destChannel
+                                 displayBufferIndex[chan], // destStartSample
+                                 buffer.getReadPointer(chan, 0), // source
+                                 nSamples); 			// numSamples
         
             displayBufferIndex.set(chan, displayBufferIndex[chan] + nSamples);
         }
@@ -325,23 +367,61 @@ void LfpDisplayNode::process(AudioSampleBuffer& buffer, MidiBuffer& events)
 
             int extraSamples = nSamples - samplesLeft;
 
-            displayBuffer->copyFrom(chan,  				// destChannel
-                                    displayBufferIndex[chan], // destStartSample
-                                        buffer, 			// source
-                                        chan, 				// source channel
-                                        0,					// source start sample
-                                        samplesLeft); 		// numSamples
+            displayBuffer->write(chan,  				// destChannel
+                                 displayBufferIndex[chan], // destStartSample
+                                 buffer.getReadPointer(chan, 0), // source
+                                 samplesLeft); 		// numSamples
 
-                displayBuffer->copyFrom(chan,
-                                        0,
-                                        buffer,
-                                        chan,
-                                        samplesLeft,
-                                        extraSamples);
+            displayBuffer->write(chan,
+                                 0,
+                                 buffer.getReadPointer(chan, samplesLeft),
+                                 extraSamples);
 
             displayBufferIndex.set(chan, extraSamples);
         }
     }
 
+    if (scrollback != nullptr && scrollback->isOpen() && getNumInputs() > 0)
+        appendToScrollback(buffer, getNumSamples(0));
+
+}
+
+void LfpDisplayNode::appendToScrollback(AudioSampleBuffer& buffer, int nSamples)
+{
+    const int nInputs = jmin(getNumInputs(), buffer.getNumChannels());
+    const int size = displayBuffer->getNumSamples();
+
+    float* eventSamples = getScratch(ScrollbackBuffer::chunkSamples);
+
+    if (eventSamples == nullptr && numEventChannels > 0)
+        scrollbackEventGaps++;
+
+    for (int done = 0; done < nSamples; done += ScrollbackBuffer::chunkSamples)
+    {
+        const int n = jmin(ScrollbackBuffer::chunkSamples, nSamples - done);
+
+        for (int chan = 0; chan < nInputs; chan++)
+            scrollback->write(chan, buffer.getReadPointer(chan, done), n);
+
+        // the TTL states of this block are already in the displayBuffer
+        for (int i = 0; eventSamples == nullptr && i < numEventChannels; i++)
+            scrollback->writeZeros(getNumInputs() + i, n);
+
+        for (int i = 0; eventSamples != nullptr && i < numEventChannels; i++)
+        {
+            const int chan = getNumInputs() + i;
+            const int start = ((displayBufferIndex[chan] - nSamples + done) % size + size) % size;
+            const int n1 = jmin(n, size - start);
+
+            displayBuffer->read(chan, start, eventSamples, n1);
+
+            if (n > n1)
+                displayBuffer->read(chan, 0, eventSamples + n1, n - n1);
+
+            scrollback->write(chan, eventSamples, n);
+        }
+
+        scrollback->advance(n);
+    }
 }
 
@@ -25,6 +25,8 @@
 #define __LFPDISPLAYNODE_H_D969A379__
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../GenericProcessor/CompactSampleBuffer.h"
+#include "../Visualization/ScrollbackBuffer.h"
 #include "LfpDisplayEditor.h"
 #include "../Editors/VisualizerEditor.h"
 #include "../GenericProcessor/GenericProcessor.h"
@@ -36,6 +38,13 @@ class DataViewport;
   Holds data in a displayBuffer to be used by the LfpDisplayCanvas
   for rendering continuous data streams.
 
+  The displayBuffer may hold its samples in 16 bits (see CompactSampleBuffer),
+  in steps of each channel's bitVolts; event channels hold the TTL state of
+  their source as a whole number.
+
+  If OPEN_EPHYS_SCROLLBACK is set, every channel is also appended to a
+  ScrollbackBuffer, which keeps a much longer history on disk.
+
   @see GenericProcessor, LfpDisplayEditor, LfpDisplayCanvas
 
 */
@@ -66,7 +75,7 @@ public:
 
     void handleEvent(int, MidiMessage&, int);
 
-    AudioSampleBuffer* getDisplayBufferAddress()
+    CompactSampleBuffer* getDisplayBufferAddress()
     {
         return displayBuffer;
     }
@@ -80,11 +89,18 @@ public:
 		return &displayMutex;
 	}
 
+    /** The long history of every channel, or nullptr if it is not kept */
+    ScrollbackBuffer* getScrollback()
+    {
+        return scrollback;
+    }
+
 private:
 
     void initializeEventChannels();
 
-    ScopedPointer<AudioSampleBuffer> displayBuffer;
+    ScopedPointer<CompactSampleBuffer> displayBuffer;
+    ScopedPointer<ScrollbackBuffer> scrollback;
 
     Array<int> displayBufferIndex;
     Array<int> eventSourceNodes;
@@ -92,6 +108,10 @@ private:
 
     int numEventChannels;
 
+    /** Blocks whose TTL states could not be stored in the scrollback (no
+        scratch space), and were stored as 0 */
+    int scrollbackEventGaps;
+
     float displayGain; //
     float bufferLength; // s
 
@@ -99,11 +119,16 @@ private:
 
     int64 bufferTimestamp;
     std::map<int, int> ttlState;
-    float* arrayOfOnes;
     int totalSamples;
 
     bool resizeBuffer();
 
+    /** Opens the scrollback file, if OPEN_EPHYS_SCROLLBACK is set. */
+    void openScrollback();
+
+    /** Appends the samples of this block, events included, to the scrollback. */
+    void appendToScrollback(AudioSampleBuffer& buffer, int nSamples);
+
 	CriticalSection displayMutex;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpDisplayNode);
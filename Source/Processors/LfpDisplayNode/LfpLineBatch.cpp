@@ -0,0 +1,156 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "LfpLineBatch.h"
+
+LfpLineBatch::LfpLineBatch() : numFloats(0), capacity(0)
+{
+    reserve(65536 / (2 * floatsPerVertex));
+}
+
+void LfpLineBatch::clear()
+{
+    numFloats = 0;
+}
+
+void LfpLineBatch::reserve(int numLines)
+{
+    const int needed = numFloats + numLines * 2 * floatsPerVertex;
+
+    if (needed > capacity)
+    {
+        capacity = jmax(needed, 2 * capacity);
+        values.realloc(capacity);
+    }
+}
+
+void LfpLineBatch::getColour(uint32 argb, float* rgba)
+{
+    rgba[0] = ((argb >> 16) & 0xff) / 255.0f;
+    rgba[1] = ((argb >> 8) & 0xff) / 255.0f;
+    rgba[2] = (argb & 0xff) / 255.0f;
+    rgba[3] = (argb >> 24) / 255.0f;
+}
+
+void LfpLineBatch::writeLine(float* v, float x1, float y1, float x2, float y2, const float* rgba)
+{
+    v[0] = x1;
+    v[1] = y1;
+    v[2] = rgba[0];
+    v[3] = rgba[1];
+    v[4] = rgba[2];
+    v[5] = rgba[3];
+
+    v[6] = x2;
+    v[7] = y2;
+    v[8] = rgba[0];
+    v[9] = rgba[1];
+    v[10] = rgba[2];
+    v[11] = rgba[3];
+}
+
+void LfpLineBatch::addLine(float x1, float y1, float x2, float y2, uint32 argb)
+{
+    float rgba[4];
+    getColour(argb, rgba);
+
+    reserve(1);
+
+    writeLine(values + numFloats, x1, y1, x2, y2, rgba);
+    numFloats += 2 * floatsPerVertex;
+}
+
+void LfpLineBatch::addTrace(const float* samples, int numSamples, float center, float scale, uint32 argb)
+{
+    if (numSamples < 2)
+        return;
+
+    float rgba[4];
+    getColour(argb, rgba);
+
+    reserve(numSamples - 1);
+
+    float* v = values + numFloats;
+
+    for (int i = 0; i < numSamples - 1; i++, v += 2 * floatsPerVertex)
+        writeLine(v, i, center + samples[i] * scale, i + 1, center + samples[i+1] * scale, rgba);
+
+    numFloats += (numSamples - 1) * 2 * floatsPerVertex;
+}
+
+void LfpLineBatch::addRange(const float* mins, const float* maxs, int numSamples, float center, float scale, uint32 argb)
+{
+    if (numSamples < 1)
+        return;
+
+    float rgba[4];
+    getColour(argb, rgba);
+
+    reserve(numSamples);
+
+    float* v = values + numFloats;
+
+    for (int i = 0; i < numSamples; i++, v += 2 * floatsPerVertex)
+    {
+        const float a = maxs[i] * scale;
+        const float b = mins[i] * scale;
+
+        writeLine(v, i + 0.5f, center + jmin(a, b),
+                  i + 0.5f, center + jmax(a, b) + 1.0f,
+                  rgba);
+    }
+
+    numFloats += numSamples * 2 * floatsPerVertex;
+}
+
+void LfpLineBatch::swapWith(LfpLineBatch& other)
+{
+    values.swapWith(other.values);
+    std::swap(numFloats, other.numFloats);
+    std::swap(capacity, other.capacity);
+}
+
+String LfpLineBatch::getVertexShader(const String& lowp)
+{
+    return "attribute vec2 position;\n"
+           "attribute vec4 colour;\n"
+           "uniform vec2 screenSize;\n"
+           "varying " + lowp + " vec4 fragColour;\n"
+           "void main()\n"
+           "{\n"
+           "    fragColour = colour;\n"
+           "    gl_Position = vec4(2.0 * position.x / screenSize.x - 1.0,\n"
+           "                       1.0 - 2.0 * position.y / screenSize.y,\n"
+           "                       0.0, 1.0);\n"
+           "}\n";
+}
+
+String LfpLineBatch::getFragmentShader(const String& lowp)
+{
+    return "varying " + lowp + " vec4 fragColour;\n"
+           "void main()\n"
+           "{\n"
+           "    gl_FragColor = fragColour;\n"
+           "}\n";
+}
@@ -0,0 +1,104 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __LFPLINEBATCH_H_2C9E51A7__
+#define __LFPLINEBATCH_H_2C9E51A7__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  The vertices of one frame of the LfpOpenGLRenderer: pairs of line
+  vertices, each as interleaved x, y, r, g, b, a floats, in pixels from the
+  top left corner.
+
+  Only uses juce_core, so that the frames can be built (and drawn with
+  the same shaders) outside the GUI, e.g. by Tests/LfpRenderBenchmark.cpp.
+
+  @see LfpOpenGLRenderer
+
+*/
+
+class LfpLineBatch
+{
+public:
+    LfpLineBatch();
+
+    void clear();
+
+    /** Makes room for numLines more lines, so that adding them doesn't
+        allocate. Called once per frame with the expected number of lines. */
+    void reserve(int numLines);
+
+    /** Adds a line in a colour given as 0xAARRGGBB (e.g. Colour::getARGB()). */
+    void addLine(float x1, float y1, float x2, float y2, uint32 argb);
+
+    /** Adds a trace joining consecutive samples, one pixel apart, drawn at
+        center + value * scale. */
+    void addTrace(const float* values, int numSamples, float center, float scale, uint32 argb);
+
+    /** Adds one vertical line per pixel, from min to max (at least one pixel
+        high), drawn at center + value * scale. */
+    void addRange(const float* mins, const float* maxs, int numSamples, float center, float scale, uint32 argb);
+
+    void swapWith(LfpLineBatch& other);
+
+    const float* getData() const
+    {
+        return values;
+    }
+
+    int getNumFloats() const
+    {
+        return numFloats;
+    }
+
+    int getNumVertices() const
+    {
+        return numFloats / floatsPerVertex;
+    }
+
+    static const int floatsPerVertex = 6;
+
+    /** GLSL 1.10 shaders that draw the vertices (attributes "position" and
+        "colour") on a screen of the size given by the "screenSize" uniform.
+        lowp is the precision qualifier of the colour (JUCE_LOWP, which is
+        empty on desktop OpenGL). */
+    static String getVertexShader(const String& lowp);
+    static String getFragmentShader(const String& lowp);
+
+private:
+    /** Writes the two vertices of a line at v. */
+    static void writeLine(float* v, float x1, float y1, float x2, float y2, const float* rgba);
+
+    static void getColour(uint32 argb, float* rgba);
+
+    HeapBlock<float> values;
+    int numFloats;
+    int capacity;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpLineBatch);
+};
+
+#endif  // __LFPLINEBATCH_H_2C9E51A7__
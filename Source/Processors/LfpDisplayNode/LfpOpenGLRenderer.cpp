@@ -0,0 +1,225 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "LfpOpenGLRenderer.h"
+#include "LfpDisplayCanvas.h"
+
+LfpOpenGLRenderer::LfpOpenGLRenderer(LfpDisplayCanvas* c, LfpDisplay* d, Viewport* v) :
+    canvas(c), display(d), viewport(v), vertexBuffer(0)
+{
+    // mouse events go to the LfpDisplay underneath, so channel selection still works
+    setInterceptsMouseClicks(false, false);
+
+    openGLContext.setRenderer(this);
+    openGLContext.setComponentPaintingEnabled(false);
+    openGLContext.attachTo(*this);
+}
+
+LfpOpenGLRenderer::~LfpOpenGLRenderer()
+{
+    openGLContext.detach();
+}
+
+bool LfpOpenGLRenderer::isAvailable()
+{
+    return shadersFailed.get() == 0;
+}
+
+void LfpOpenGLRenderer::newOpenGLContextCreated()
+{
+    shader = new OpenGLShaderProgram(openGLContext);
+
+    if (shader->addVertexShader(LfpLineBatch::getVertexShader(JUCE_LOWP ""))
+        && shader->addFragmentShader(LfpLineBatch::getFragmentShader(JUCE_LOWP ""))
+        && shader->link())
+    {
+        positionAttribute = new OpenGLShaderProgram::Attribute(*shader, "position");
+        colourAttribute = new OpenGLShaderProgram::Attribute(*shader, "colour");
+        screenSizeUniform = new OpenGLShaderProgram::Uniform(*shader, "screenSize");
+
+        openGLContext.extensions.glGenBuffers(1, &vertexBuffer);
+    }
+    else
+    {
+        std::cout << "LFP OpenGL renderer could not compile shaders: "
+                  << shader->getLastError() << std::endl;
+        shader = nullptr;
+        shadersFailed.set(1);
+    }
+}
+
+void LfpOpenGLRenderer::openGLContextClosing()
+{
+    positionAttribute = nullptr;
+    colourAttribute = nullptr;
+    screenSizeUniform = nullptr;
+    shader = nullptr;
+
+    if (vertexBuffer != 0)
+    {
+        openGLContext.extensions.glDeleteBuffers(1, &vertexBuffer);
+        vertexBuffer = 0;
+    }
+}
+
+void LfpOpenGLRenderer::refresh()
+{
+    int64 start = Time::getHighResolutionTicks();
+
+    const int w = jmin(getWidth(), canvas->getScreenBufferSize() - 1);
+    const int h = getHeight();
+    const int nChans = canvas->getNumChannels();
+    const int top = viewport->getViewPositionY();
+
+    batch.clear();
+    batch.reserve(nChans * (w + 3) + 32); // traces, baselines, grid and cursor
+
+    // timing grid (same layout as LfpDisplayCanvas::paint)
+    const uint32 gridColour = Colour(25,25,60).getARGB();
+
+    for (int i = 0; i < 10; i++)
+    {
+        float x = (float)(getWidth()/10*i) + 0.5f;
+
+        batch.addLine(x, 0, x, h, gridColour);
+
+        if (i == 5 || i == 0)
+        {
+            batch.addLine(x-1, 0, x-1, h, gridColour);
+            batch.addLine(x+1, 0, x+1, h, gridColour);
+        }
+    }
+
+    // event markers span the whole display, rather than being repeated for every channel
+    for (int i = 0; i < w; i++)
+    {
+        int rawEventState = canvas->getYCoord(nChans, i);
+
+        if (rawEventState == 0)
+            continue;
+
+        for (int ev_ch = 0; ev_ch < 8; ev_ch++)
+        {
+            if (display->getEventDisplayState(ev_ch) && (rawEventState & (1 << ev_ch)))
+            {
+                batch.addLine(i + 0.5f, 0, i + 0.5f, h, display->channelColours[ev_ch*2].withAlpha(0.35f).getARGB());
+            }
+        }
+    }
+
+    // traces for all channels that are at least partially visible
+    for (int chan = 0; chan < nChans; chan++)
+    {
+        LfpChannelDisplay* cd = display->channels[chan];
+
+        if (cd->getY() - top > h || cd->getBottom() - top < 0 || !cd->getEnabledState())
+            continue;
+
+        const float center = (float)(cd->getY() + cd->getHeight()/2 - top);
+        const int channelHeight = cd->getChannelHeight();
+        const float scale = cd->getYOffset(1.0f);
+        const uint32 lineColour = cd->getColour().getARGB();
+
+        batch.addLine(0, center, w, center, Colour(40,40,40).getARGB());
+
+        if (cd->getSelected())
+        {
+            batch.addLine(0, center - channelHeight/2, w, center - channelHeight/2, Colours::lightgrey.getARGB());
+            batch.addLine(0, center + channelHeight/2, w, center + channelHeight/2, Colours::lightgrey.getARGB());
+        }
+
+        if (cd->getDrawMethod())
+            batch.addTrace(canvas->getYCoords(chan), w, center, scale, lineColour);
+        else
+            batch.addRange(canvas->getYCoordsMin(chan), canvas->getYCoordsMax(chan), w, center, scale, lineColour);
+    }
+
+    // most recent sample position
+    float cursor = (float)(canvas->screenBufferIndex[0] + 1) + 0.5f;
+    batch.addLine(cursor, 0, cursor, h, Colours::yellow.getARGB());
+
+    {
+        const ScopedLock sl(vertexLock);
+        renderBatch.swapWith(batch);
+    }
+
+    openGLContext.triggerRepaint();
+
+    canvas->addFrameTime(Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1000.0);
+}
+
+void LfpOpenGLRenderer::renderOpenGL()
+{
+    if (shader == nullptr)
+        return;
+
+    int64 start = Time::getHighResolutionTicks();
+
+    const float scale = (float) openGLContext.getRenderingScale();
+    glViewport(0, 0, roundToInt(scale * getWidth()), roundToInt(scale * getHeight()));
+
+    OpenGLHelpers::clear(Colour(0,18,43));
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    shader->use();
+    screenSizeUniform->set((GLfloat) getWidth(), (GLfloat) getHeight());
+
+    OpenGLExtensionFunctions& gl = openGLContext.extensions;
+
+    gl.glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+
+    int numVertices;
+
+    {
+        const ScopedLock sl(vertexLock);
+
+        numVertices = renderBatch.getNumVertices();
+
+        gl.glBufferData(GL_ARRAY_BUFFER,
+                        renderBatch.getNumFloats() * sizeof(GLfloat),
+                        renderBatch.getData(),
+                        GL_STREAM_DRAW);
+    }
+
+    const GLsizei stride = LfpLineBatch::floatsPerVertex * sizeof(GLfloat);
+
+    gl.glVertexAttribPointer(positionAttribute->attributeID, 2, GL_FLOAT, GL_FALSE, stride, 0);
+    gl.glEnableVertexAttribArray(positionAttribute->attributeID);
+
+    gl.glVertexAttribPointer(colourAttribute->attributeID, 4, GL_FLOAT, GL_FALSE, stride,
+                             (GLvoid*)(2 * sizeof(GLfloat)));
+    gl.glEnableVertexAttribArray(colourAttribute->attributeID);
+
+    // the whole frame is a single batch of line segments
+    glDrawArrays(GL_LINES, 0, numVertices);
+
+    gl.glDisableVertexAttribArray(positionAttribute->attributeID);
+    gl.glDisableVertexAttribArray(colourAttribute->attributeID);
+    gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glFinish(); // so that the frame time includes the actual rasterization
+
+    canvas->addFrameTime(Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1000.0);
+}
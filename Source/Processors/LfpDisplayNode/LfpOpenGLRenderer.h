@@ -0,0 +1,104 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __LFPOPENGLRENDERER_H_6A1C03F2__
+#define __LFPOPENGLRENDERER_H_6A1C03F2__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+#include "LfpLineBatch.h"
+
+class LfpDisplayCanvas;
+class LfpDisplay;
+
+/**
+
+  Draws the traces of an LfpDisplay with OpenGL instead of JUCE Graphics.
+
+  Rather than painting one component per channel, the screen buffers of all
+  visible channels are converted into a single array of line vertices (an
+  LfpLineBatch) on the message thread. The OpenGL thread then uploads that array into one vertex
+  buffer and draws the whole frame (grid, event markers, traces and cursor)
+  with a single glDrawArrays() call.
+
+  Only OpenGL 2.0 / GLSL 1.10 features are used, so the renderer also works
+  with software Mesa (llvmpipe, e.g. LIBGL_ALWAYS_SOFTWARE=1 under Xvfb). If
+  the shaders cannot be compiled, isAvailable() returns false and the canvas
+  falls back to the regular per-channel components.
+
+  Tests/LfpRenderBenchmark.cpp draws the same batches with the same shaders
+  offscreen, to measure frame times without a display.
+
+  @see LfpDisplayCanvas, LfpDisplay
+
+*/
+
+class LfpOpenGLRenderer : public Component,
+    public OpenGLRenderer
+{
+public:
+    LfpOpenGLRenderer(LfpDisplayCanvas*, LfpDisplay*, Viewport*);
+    ~LfpOpenGLRenderer();
+
+    /** Rebuilds the vertex array from the canvas's screen buffers and
+        schedules a new OpenGL frame. Must be called on the message thread. */
+    void refresh();
+
+    /** Returns false if the OpenGL shaders could not be compiled. */
+    bool isAvailable();
+
+    /** Called on the OpenGL thread when the context has been created. */
+    void newOpenGLContextCreated();
+
+    /** Called on the OpenGL thread to draw the most recent vertex array. */
+    void renderOpenGL();
+
+    /** Called on the OpenGL thread before the context is destroyed. */
+    void openGLContextClosing();
+
+private:
+
+    LfpDisplayCanvas* canvas;
+    LfpDisplay* display;
+    Viewport* viewport;
+
+    OpenGLContext openGLContext;
+    ScopedPointer<OpenGLShaderProgram> shader;
+    ScopedPointer<OpenGLShaderProgram::Attribute> positionAttribute;
+    ScopedPointer<OpenGLShaderProgram::Attribute> colourAttribute;
+    ScopedPointer<OpenGLShaderProgram::Uniform> screenSizeUniform;
+
+    GLuint vertexBuffer;
+
+    /** The frame being built, and the one being drawn */
+    LfpLineBatch batch;
+    LfpLineBatch renderBatch;
+    CriticalSection vertexLock;
+
+    Atomic<int> shadersFailed;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpOpenGLRenderer);
+
+};
+
+#endif  // __LFPOPENGLRENDERER_H_6A1C03F2__
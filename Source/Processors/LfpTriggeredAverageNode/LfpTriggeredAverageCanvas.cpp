@@ -26,21 +26,18 @@
 #include <math.h>
 
 LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* processor_) :
-    screenBufferIndex(0), timebase(1.0f), displayGain(1.0f),   timeOffset(0.0f),
+    timebase(1.0f), displayGain(1.0f),   timeOffset(0.0f),
     processor(processor_),
-    displayBufferIndex(0)
+    meanBuffer(1, TriggeredAverage::maxBins), errorBuffer(1, TriggeredAverage::maxBins),
+    numBins(0), numTriggers(0), lastVersion(-1)
 {
 
     nChans = processor->getNumInputs();
     sampleRate = processor->getSampleRate();
     std::cout << "Setting num inputs on LfpTriggeredAverageCanvas to " << nChans << std::endl;
 
-    displayBuffer = processor->getDisplayBufferAddress();
-    displayBufferSize = displayBuffer->getNumSamples();
-    std::cout << "Setting displayBufferSize on LfpTriggeredAverageCanvas to " << displayBufferSize << std::endl;
-
-    screenBuffer = new AudioSampleBuffer(MAX_N_CHAN, MAX_N_SAMP);
-    screenBuffer->clear();
+    meanBuffer.setSize(jmax(nChans, 1), TriggeredAverage::maxBins);
+    errorBuffer.setSize(jmax(nChans, 1), TriggeredAverage::maxBins);
 
     viewport = new Viewport();
     display = new LfpTriggeredAverageDisplay(this, viewport);
@@ -103,6 +100,11 @@ LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* pr
     spreadSelection->addListener(this);
     addAndMakeVisible(spreadSelection);
 
+    clearButton = new UtilityButton("CLEAR", Font("Small Text", 13, Font::plain));
+    clearButton->setRadius(3.0f);
+    clearButton->addListener(this);
+    addAndMakeVisible(clearButton);
+
 
     display->setNumChannels(nChans);
     display->setRange(1000.0f);
@@ -117,7 +119,7 @@ LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* pr
         addAndMakeVisible(eventOptions);
         eventOptions->setBounds(500+(floor(i/2)*20), getHeight()-20-(i%2)*20, 40, 20);
 
-        display->setEventDisplayState(i,true);
+        display->setEventDisplayState(i, i == 0); // trigger on the first channel by default
 
     }
 
@@ -127,7 +129,6 @@ LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* pr
 LfpTriggeredAverageCanvas::~LfpTriggeredAverageCanvas()
 {
 
-    deleteAndZero(screenBuffer);
 }
 
 void LfpTriggeredAverageCanvas::resized()
@@ -141,6 +142,7 @@ void LfpTriggeredAverageCanvas::resized()
     rangeSelection->setBounds(5,getHeight()-30,100,25);
     timebaseSelection->setBounds(175,getHeight()-30,100,25);
     spreadSelection->setBounds(345,getHeight()-30,100,25);
+    clearButton->setBounds(600,getHeight()-35,60,20);
 
     for (int i = 0; i < 8; i++)
     {
@@ -158,9 +160,7 @@ void LfpTriggeredAverageCanvas::beginAnimation()
 {
     std::cout << "Beginning animation." << std::endl;
 
-    displayBufferSize = displayBuffer->getNumSamples();
-
-    screenBufferIndex = 0;
+    lastVersion = -1;
 
     startCallbacks();
 }
@@ -179,7 +179,10 @@ void LfpTriggeredAverageCanvas::update()
 
     std::cout << "Setting num inputs on LfpTriggeredAverageCanvas to " << nChans << std::endl;
 
-    refreshScreenBuffer();
+    meanBuffer.setSize(nChans, TriggeredAverage::maxBins);
+    errorBuffer.setSize(nChans, TriggeredAverage::maxBins);
+    numBins = 0;
+    lastVersion = -1;
 
     display->setNumChannels(nChans);
 
@@ -205,6 +208,9 @@ void LfpTriggeredAverageCanvas::comboBoxChanged(ComboBox* cb)
     if (cb == timebaseSelection)
     {
         timebase = timebases[cb->getSelectedId()-1].getFloatValue();
+
+        // a new window clears the averages
+        processor->queueParameterChange(LfpTriggeredAverageNode::WINDOW_LENGTH, timebase);
     }
     else if (cb == rangeSelection)
     {
@@ -248,129 +254,40 @@ void LfpTriggeredAverageCanvas::setParameter(int param, float val)
     // repaint();
 }
 
-void LfpTriggeredAverageCanvas::refreshState()
-{
-    // called when the component's tab becomes visible again
-    displayBufferIndex = processor->getDisplayBufferIndex();
-    screenBufferIndex = 0;
-
-}
-
-void LfpTriggeredAverageCanvas::refreshScreenBuffer()
+void LfpTriggeredAverageCanvas::buttonClicked(Button* button)
 {
-
-    screenBufferIndex = 0;
-
-    screenBuffer->clear();
-
-    // int w = display->getWidth();
-    // //std::cout << "Refreshing buffer size to " << w << "pixels." << std::endl;
-
-    // for (int i = 0; i < w; i++)
-    // {
-    //  float x = float(i);
-
-    //  for (int n = 0; n < nChans; n++)
-    //  {
-    //      waves[n][i*2] = x;
-    //      waves[n][i*2+1] = 0.5f; // line in center of display
-    //  }
-    // }
-
+    if (button == clearButton)
+        processor->queueParameterChange(LfpTriggeredAverageNode::CLEAR_AVERAGE, 1.0f);
 }
 
-void LfpTriggeredAverageCanvas::updateScreenBuffer()
+void LfpTriggeredAverageCanvas::updateTriggerChannels()
 {
+    int triggerChannels = 0;
 
-
-    // copy new samples from the displayBuffer into the screenBuffer (waves)
-    int maxSamples = display->getWidth() - leftmargin;
-
-    if (screenBufferIndex >= maxSamples) // wrap around if we reached right edge before
-        screenBufferIndex = 0;
-
-    lastScreenBufferIndex = screenBufferIndex;
-
-    int index = processor->getDisplayBufferIndex();
-
-    int nSamples =  index - displayBufferIndex; // N new samples to be addeddisplayBufferIndex
-
-    if (nSamples < 0) // buffer has reset to 0
-    {
-        nSamples = (displayBufferSize - displayBufferIndex) + index;
-    }
-
-    float ratio = sampleRate * timebase / float(getWidth() - leftmargin - scrollBarThickness);
-
-    // this number is crucial: converting from samples to values (in px) for the screen buffer
-    int valuesNeeded = (int) float(nSamples) / ratio;
-
-
-    if (screenBufferIndex + valuesNeeded > maxSamples)  // crop number of samples to fit cavas width
+    for (int i = 0; i < 8; i++)
     {
-        valuesNeeded = maxSamples - screenBufferIndex;
+        if (display->getEventDisplayState(i))
+            triggerChannels |= (1 << i);
     }
 
-    float subSampleOffset = 0.0;
-
-    displayBufferIndex = displayBufferIndex % displayBufferSize; // make sure we're not overshooting
-    int nextPos = (displayBufferIndex + 1) % displayBufferSize; //  position next to displayBufferIndex in display buffer to copy from
-
-    if (valuesNeeded > 0 && valuesNeeded < 1000)
-    {
-
-        for (int i = 0; i < valuesNeeded; i++) // also fill one extra sample for line drawing interpolation to match across draws
-        {
-            float gain = 1.0;
-            float alpha = (float) subSampleOffset;
-            float invAlpha = 1.0f - alpha;
-
-            screenBuffer->clear(screenBufferIndex, 1);
-
-            for (int channel = 0; channel <= nChans; channel++) // pull one extra channel for event display
-            {
-
-                screenBuffer->addFrom(channel, // destChannel
-                                      screenBufferIndex, // destStartSample
-                                      displayBuffer->getWritePointer(channel, displayBufferIndex), // source
-                                      1, // numSamples
-                                      invAlpha*gain); // gain
-
-                screenBuffer->addFrom(channel, // destChannel
-                                      screenBufferIndex, // destStartSample
-                                      displayBuffer->getWritePointer(channel, nextPos), // source
-                                      1, // numSamples
-                                      alpha*gain); // gain
-
-
-            }
-
-            subSampleOffset += ratio;
-
-            while (subSampleOffset >= 1.0)
-            {
-                if (++displayBufferIndex > displayBufferSize)
-                    displayBufferIndex = 0;
-
-                nextPos = (displayBufferIndex + 1) % displayBufferSize;
-                subSampleOffset -= 1.0;
-            }
-
-            screenBufferIndex++;
+    processor->queueParameterChange(LfpTriggeredAverageNode::TRIGGER_CHANNELS, float(triggerChannels));
+}
 
-        }
+void LfpTriggeredAverageCanvas::refreshState()
+{
+    // called when the component's tab becomes visible again
+    lastVersion = -1;
 
+}
 
-    }
-    else
-    {
-        //std::cout << "Skip." << std::endl;
-    }
+int LfpTriggeredAverageCanvas::getPlotWidth()
+{
+    return getWidth() - scrollBarThickness - leftmargin;
 }
 
-float LfpTriggeredAverageCanvas::getXCoord(int chan, int samp)
+int LfpTriggeredAverageCanvas::getNumBins()
 {
-    return samp;
+    return numBins;
 }
 
 int LfpTriggeredAverageCanvas::getNumChannels()
@@ -378,9 +295,14 @@ int LfpTriggeredAverageCanvas::getNumChannels()
     return nChans;
 }
 
-float LfpTriggeredAverageCanvas::getYCoord(int chan, int samp)
+float LfpTriggeredAverageCanvas::getMean(int chan, int bin)
+{
+    return meanBuffer.getSample(chan, bin);
+}
+
+float LfpTriggeredAverageCanvas::getStandardError(int chan, int bin)
 {
-    return *screenBuffer->getReadPointer(chan, samp);
+    return errorBuffer.getSample(chan, bin);
 }
 
 void LfpTriggeredAverageCanvas::paint(Graphics& g)
@@ -422,7 +344,9 @@ void LfpTriggeredAverageCanvas::paint(Graphics& g)
     g.drawText("Timebase (s)",175,getHeight()-55,300,20,Justification::left, false);
     g.drawText("Spread (px)",345,getHeight()-55,300,20,Justification::left, false);
 
-    g.drawText("Event display",500,getHeight()-55,300,20,Justification::left, false);
+    g.drawText("Trigger on",500,getHeight()-55,300,20,Justification::left, false);
+
+    g.drawText(String(numTriggers) + " triggers",600,getHeight()-55,300,20,Justification::left, false);
 
 
 
@@ -430,11 +354,19 @@ void LfpTriggeredAverageCanvas::paint(Graphics& g)
 
 void LfpTriggeredAverageCanvas::refresh()
 {
-    updateScreenBuffer();
+    // the averages only change when a window is complete
+    const int version = processor->getAverage().getVersion();
 
-    display->refresh(); // redraws only the new part of the screen buffer
+    if (version != lastVersion)
+    {
+        lastVersion = version;
+        numTriggers = processor->getAverage().copyAverages(meanBuffer, errorBuffer, numBins);
 
-    //getPeer()->performAnyPendingRepaintsNow();
+        fullredraw = true;
+        display->refresh();
+
+        repaint(600, getHeight()-55, 300, 20); // trigger count
+    }
 
 }
 
@@ -478,7 +410,7 @@ void LfpTriggeredAverageCanvas::loadVisualizerParameters(XmlElement* xml)
             viewport->setViewPosition(xmlNode->getIntAttribute("ScrollX"),
                                       xmlNode->getIntAttribute("ScrollY"));
 
-            int eventButtonState = xmlNode->getIntAttribute("eventButtonState");
+            int eventButtonState = xmlNode->getIntAttribute("EventButtonState", 1);
 
             for (int i = 0; i < 8; i++)
             {
@@ -486,6 +418,8 @@ void LfpTriggeredAverageCanvas::loadVisualizerParameters(XmlElement* xml)
 
                 LfpTriggeredAverageEventInterfaces[i]->checkEnabledState();
             }
+
+            updateTriggerChannels();
         }
     }
 
@@ -514,7 +448,7 @@ void LfpTriggeredAverageTimescale::paint(Graphics& g)
 
     g.setColour(Colour(100,100,100));
 
-    g.drawText("ms:",5,0,100,getHeight(),Justification::left, false);
+    g.drawText("ms:",5,0,100,getHeight(),Justification::left, false); // relative to the trigger
 
     for (int i = 1; i < 10; i++)
     {
@@ -536,7 +470,7 @@ void LfpTriggeredAverageTimescale::setTimebase(float t)
 
     for (float i = 1.0f; i < 10.0; i++)
     {
-        String labelString = String(timebase/10.0f*1000.0f*i);
+        String labelString = String(timebase*1000.0f*(i/10.0f - 0.5f));
 
         labels.add(labelString.substring(0,4));
     }
@@ -695,16 +629,10 @@ void LfpTriggeredAverageDisplay::refresh()
         {
             if (canvas->fullredraw)
             {
-                channels[i]->fullredraw = true;
                 channels[i]->repaint();
                 channelInfo[i]->repaint();
 
             }
-            else
-            {
-                channels[i]->repaint(canvas->lastScreenBufferIndex-2, 0, (canvas->screenBufferIndex-canvas->lastScreenBufferIndex)+3, getChildComponent(i)->getHeight());  //repaint only the updated portion
-                // we redraw from -2 to +1 relative to the real redraw window, the -2 makes sure that the lines join nicely, and the +1 draws the vertical update line
-            }
             //std::cout << i << std::endl;
         }
 
@@ -878,17 +806,6 @@ LfpTriggeredAverageChannelDisplay::~LfpTriggeredAverageChannelDisplay()
 void LfpTriggeredAverageChannelDisplay::paint(Graphics& g)
 {
 
-    //g.fillAll(Colours::grey);
-
-    g.setColour(Colours::yellow);   // draw most recent drawn sample position
-    g.drawLine(canvas->screenBufferIndex+1, 0, canvas->screenBufferIndex+1, getHeight());
-
-
-
-
-    //g.setColour(Colours::red); // draw oldest drawn sample position
-    //g.drawLine(canvas->lastScreenBufferIndex, 0, canvas->lastScreenBufferIndex, getHeight()-channelOverlap);
-
     int center = getHeight()/2;
 
     if (isSelected)
@@ -909,102 +826,39 @@ void LfpTriggeredAverageChannelDisplay::paint(Graphics& g)
     g.setColour(Colour(40,40,40));
     g.drawLine(0, getHeight()/2, getWidth(), getHeight()/2);
 
-    int stepSize = 1;
-    int from = 0; // for vertical line drawing in the LFP data
-    int to = 0;
+    int numBins = canvas->getNumBins();
+
+    if (numBins < 2)
+        return;
 
-    //for (int i = 0; i < getWidth()-stepSize; i += stepSize) // redraw entire display
-    int ifrom = canvas->lastScreenBufferIndex - 3; // need to start drawing a bit before the actual redraw windowfor the interpolated line to join correctly
+    // the bins span the plot, with the trigger in the middle
+    float xScale = float(canvas->getPlotWidth()) / float(numBins - 1);
+    float yScale = channelHeightFloat / range;
 
-    if (ifrom < 0)
-        ifrom = 0;
+    Path mean;
+    Path error;
 
-    int ito = canvas->screenBufferIndex - 1;
+    mean.startNewSubPath(0, canvas->getMean(chan, 0)*yScale + center);
+    error.startNewSubPath(0, (canvas->getMean(chan, 0) + canvas->getStandardError(chan, 0))*yScale + center);
 
-    if (fullredraw)
+    for (int i = 1; i < numBins; i++)
     {
-        ifrom = 0; //canvas->leftmargin;
-        ito = getWidth()-stepSize;
-        fullredraw = false;
+        mean.lineTo(i*xScale, canvas->getMean(chan, i)*yScale + center);
+        error.lineTo(i*xScale, (canvas->getMean(chan, i) + canvas->getStandardError(chan, i))*yScale + center);
     }
 
-    for (int i = ifrom; i < ito ; i += stepSize) // redraw only changed portion
+    for (int i = numBins-1; i >= 0; i--)
     {
-
-        // draw event markers
-        int rawEventState = canvas->getYCoord(canvas->getNumChannels(), i);// get last channel+1 in buffer (represents events)
-        for (int ev_ch = 0; ev_ch < 8 ; ev_ch++) // for all event channels
-        {
-            if (display->getEventDisplayState(ev_ch))  // check if plotting for this channel is enabled
-            {
-                if (rawEventState & (1 << ev_ch))    // events are  representet by a bit code, so we have to extract the individual bits with a mask
-                {
-                    g.setColour(display->channelColours[ev_ch*2]); // get color from lfp color scheme
-                    g.setOpacity(0.35f);
-                    g.drawLine(i, center-channelHeight/2 , i, center+channelHeight/2);
-                }
-            }
-        }
-
-        //std::cout << "e " << canvas->getYCoord(canvas->getNumChannels()-1, i) << std::endl;
-
-        g.setColour(lineColour);
-        g.setOpacity(1);
-
-        // drawLine makes for ok anti-aliased plots, but is pretty slow
-        g.drawLine(i,
-                   (canvas->getYCoord(chan, i)/range*channelHeightFloat)+getHeight()/2,
-                   i+stepSize,
-                   (canvas->getYCoord(chan, i+stepSize)/range*channelHeightFloat)+getHeight()/2);
-
-        if (false) // switched back to line drawing now that we only draw partial updates
-        {
-
-            // // pixel wise line plot has no anti-aliasing, but runs much faster
-            double a = (canvas->getYCoord(chan, i)/range*channelHeightFloat)+getHeight()/2;
-            double b = (canvas->getYCoord(chan, i+stepSize)/range*channelHeightFloat)+getHeight()/2;
-
-            if (a<b)
-            {
-                from = (a);
-                to = (b);
-            }
-            else
-            {
-                from = (b);
-                to = (a);
-            }
-
-            if ((to-from) < 40)  // if there is too much vertical range in one pixel, don't draw the full line for speed reasons
-            {
-                for (int j = from; j <= to; j += 1)
-                {
-                    g.setPixel(i,j);
-                }
-            }
-            else if ((to-from) < 100)
-            {
-                for (int j = from; j <= to; j += 2)
-                {
-                    g.setPixel(i,j);
-                }
-            }
-            else
-            {
-                g.setPixel(i,to);
-                g.setPixel(i,from);
-            }
-
-        }
-
+        error.lineTo(i*xScale, (canvas->getMean(chan, i) - canvas->getStandardError(chan, i))*yScale + center);
     }
 
-    // g.setColour(lineColour.withAlpha(0.7f)); // alpha on seems to decrease draw speed
-    // g.setFont(channelFont);
-    //  g.setFont(channelHeightFloat*0.6);
+    error.closeSubPath();
 
-    // g.drawText(String(chan+1), 10, center-channelHeight/2, 200, channelHeight, Justification::left, false);
+    g.setColour(lineColour.withAlpha(0.3f)); // standard error
+    g.fillPath(error);
 
+    g.setColour(lineColour);
+    g.strokePath(mean, PathStrokeType(1.0f));
 
 }
 
@@ -1143,6 +997,8 @@ void LfpTriggeredAverageEventInterface::buttonClicked(Button* button)
         display->setEventDisplayState(channelNumber, true);
     }
 
+    canvas->updateTriggerChannels();
+
     repaint();
 
 }
@@ -37,14 +37,20 @@ class LfpTriggeredAverageEventInterface;
 
 /**
 
-  Displays multiple channels of continuous data.
+  Displays the mean and standard error of every channel around the triggers.
+
+  The averages are computed by the LfpTriggeredAverageNode as the data
+  arrives; the canvas copies them only when a new window is complete. The
+  timebase is the window length, centred on the trigger, and the event
+  buttons select the trigger channels.
 
   @see LfpTriggeredAverageNode, LfpTriggeredAverageDisplayEditor
 
 */
 
 class LfpTriggeredAverageCanvas : public Visualizer,
-    public ComboBox::Listener
+    public ComboBox::Listener,
+    public Button::Listener
 
 {
 public:
@@ -71,14 +77,20 @@ public:
 
     int getNumChannels();
 
-    float getXCoord(int chan, int samp);
-    float getYCoord(int chan, int samp);
+    /** Width of the plots, which span the whole window */
+    int getPlotWidth();
 
-    int screenBufferIndex;
-    int lastScreenBufferIndex;
+    int getNumBins();
+    float getMean(int chan, int bin);
+    float getStandardError(int chan, int bin);
 
     void comboBoxChanged(ComboBox* cb);
 
+    void buttonClicked(Button* button);
+
+    /** Sends the enabled event channels to the processor as trigger channels. */
+    void updateTriggerChannels();
+
     void saveVisualizerParameters(XmlElement* xml);
 
     void loadVisualizerParameters(XmlElement* xml);
@@ -96,14 +108,14 @@ private:
     float timeOffset;
     //int spread ; // vertical spacing between channels
 
-    static const int MAX_N_CHAN = 256;  // maximum number of channels
-    static const int MAX_N_SAMP = 5000; // maximum display size in pixels
-    //float waves[MAX_N_CHAN][MAX_N_SAMP*2]; // we need an x and y point for each sample
-
     LfpTriggeredAverageNode* processor;
-    AudioSampleBuffer* displayBuffer;
-    AudioSampleBuffer* screenBuffer;
-    MidiBuffer* eventBuffer;
+
+    /** Copies of the processor's averages, one sample per bin */
+    AudioSampleBuffer meanBuffer;
+    AudioSampleBuffer errorBuffer;
+    int numBins;
+    int numTriggers;
+    int lastVersion;
 
     ScopedPointer<LfpTriggeredAverageTimescale> timescale;
     ScopedPointer<LfpTriggeredAverageDisplay> display;
@@ -113,18 +125,14 @@ private:
     ScopedPointer<ComboBox> rangeSelection;
     ScopedPointer<ComboBox> spreadSelection;
 
+    ScopedPointer<UtilityButton> clearButton;
+
     StringArray voltageRanges;
     StringArray timebases;
     StringArray spreads; // option for vertical spacing between channels
 
     OwnedArray<LfpTriggeredAverageEventInterface> LfpTriggeredAverageEventInterfaces;
 
-    void refreshScreenBuffer();
-    void updateScreenBuffer();
-
-    int displayBufferIndex;
-    int displayBufferSize;
-
     int scrollBarThickness;
 
     int nChans;
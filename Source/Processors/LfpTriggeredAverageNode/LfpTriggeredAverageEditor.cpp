@@ -29,7 +29,7 @@ LfpTriggeredAverageEditor::LfpTriggeredAverageEditor(GenericProcessor* parentNod
 
 {
 
-    tabText = "LFP";
+    tabText = "Trig. Avg.";
     desiredWidth = 180;
 
 }
@@ -43,7 +43,7 @@ Visualizer* LfpTriggeredAverageEditor::createNewCanvas()
 {
 
     LfpTriggeredAverageNode* processor = (LfpTriggeredAverageNode*) getProcessor();
-    return 0; //new LfpTriggeredAverageCanvas(processor);
+    return new LfpTriggeredAverageCanvas(processor);
 
 }
 
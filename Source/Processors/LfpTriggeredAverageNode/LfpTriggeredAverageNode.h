@@ -28,14 +28,20 @@
 #include "LfpTriggeredAverageEditor.h"
 #include "../Editors/VisualizerEditor.h"
 #include "../GenericProcessor/GenericProcessor.h"
+#include "TriggeredAverage.h"
 
 class DataViewport;
 
 /**
 
-  Displays the average of a continuous signal, triggered on a certain event channel.
+  Displays the average of continuous signals around TTL events.
 
-  @see GenericProcessor, LfpTriggeredAverageEditor, LfpDisplayCanvas
+  Every rising edge on one of the trigger channels adds a window, centred
+  on the event, to the running averages of all channels (see
+  TriggeredAverage). The canvas only draws the resulting mean and standard
+  error.
+
+  @see GenericProcessor, LfpTriggeredAverageEditor, LfpTriggeredAverageCanvas
 
 */
 
@@ -63,40 +69,27 @@ public:
     bool enable();
     bool disable();
 
-    void handleEvent(int, MidiMessage&);
+    void handleEvent(int eventType, MidiMessage& event, int samplePosition);
 
-    AudioSampleBuffer* getDisplayBufferAddress()
+    enum TriggeredAverageParameters
     {
-        return displayBuffer;
-    }
-    int getDisplayBufferIndex()
+        WINDOW_LENGTH,      // s, centred on the trigger
+        TRIGGER_CHANNELS,   // bit mask of the TTL channels
+        CLEAR_AVERAGE
+    };
+
+    /** The running averages, read by the canvas */
+    TriggeredAverage& getAverage()
     {
-        return displayBufferIndex;
+        return average;
     }
 
 private:
 
-    void initializeEventChannel();
-
-    ScopedPointer<AudioSampleBuffer> displayBuffer;
-    ScopedPointer<MidiBuffer> eventBuffer;
-
-    int displayBufferIndex;
-    int displayBufferIndexEvents;
-
-    float displayGain; //
-    float bufferLength; // s
-
-    AbstractFifo abstractFifo;
-
-    int64 bufferTimestamp;
-    int ttlState;
-    float* arrayOfOnes;
-    int totalSamples;
-
-    //Time timer;
+    TriggeredAverage average;
 
-    bool resizeBuffer();
+    float windowLength; // s
+    int triggerChannels;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpTriggeredAverageNode);
 
@@ -0,0 +1,261 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "TriggeredAverage.h"
+
+TriggeredAverage::TriggeredAverage()
+    : numChannels(0), windowSamples(maxBins), binSize(1), numBins(maxBins),
+      preBins(maxBins / 2), numTriggers(0), historyRows(2 * maxBins), binFill(0),
+      nextBin(0), samplesSinceReset(0), numPending(0), numDropped(0),
+      needsPublish(false), publishedBins(0), publishedTriggers(0)
+{
+    counts.calloc(maxBins);
+    pendingStart.malloc(maxPendingWindows);
+}
+
+TriggeredAverage::~TriggeredAverage()
+{
+}
+
+void TriggeredAverage::setNumChannels(int numChannels_)
+{
+    const ScopedLock lock(publishLock);
+
+    numChannels = numChannels_;
+
+    // the history holds a whole window plus the bins completed in one step
+    // of addSamples(), so every row is still there when it is accumulated
+    sum.calloc(maxBins * numChannels);
+    sumOfSquares.calloc(maxBins * numChannels);
+    history.calloc(historyRows * numChannels);
+    partialBin.calloc(numChannels);
+
+    publishedMean.calloc(maxBins * numChannels);
+    publishedError.calloc(maxBins * numChannels);
+    publishedBins = 0;
+    publishedTriggers = 0;
+
+    reset();
+}
+
+void TriggeredAverage::setWindow(int windowSamples_)
+{
+    windowSamples = jmax(2, windowSamples_);
+
+    binSize = (windowSamples + maxBins - 1) / maxBins;
+    numBins = jmax(2, windowSamples / binSize);
+    preBins = numBins / 2;
+
+    reset();
+}
+
+void TriggeredAverage::reset()
+{
+    if (numChannels > 0)
+    {
+        zeromem(sum, sizeof(double) * numBins * numChannels);
+        zeromem(sumOfSquares, sizeof(double) * numBins * numChannels);
+        zeromem(partialBin, sizeof(double) * numChannels);
+    }
+
+    zeromem(counts, sizeof(int) * maxBins);
+
+    numTriggers = 0;
+    numPending = 0;
+    numDropped = 0;
+    binFill = 0;
+    nextBin = 0;
+    samplesSinceReset = 0;
+
+    needsPublish = true;
+}
+
+void TriggeredAverage::addTrigger(int sampleIndex)
+{
+    if (numChannels == 0)
+        return;
+
+    if (numPending == maxPendingWindows)
+    {
+        numDropped++;
+        return;
+    }
+
+    const int64 start = (samplesSinceReset + sampleIndex) / binSize - preBins;
+
+    // the bins before the trigger that are complete are still in the history
+    const int64 firstStored = jmax(start, nextBin - historyRows, (int64) 0);
+    const int64 end = jmin(nextBin, start + numBins);
+
+    for (int64 bin = firstStored; bin < end; bin++)
+        accumulate((int) (bin - start), history + (bin % historyRows) * numChannels);
+
+    pendingStart[numPending++] = start;
+}
+
+void TriggeredAverage::addSamples(const AudioSampleBuffer& buffer, int numSamples)
+{
+    const int nChannels = jmin(numChannels, buffer.getNumChannels());
+
+    int start = 0;
+
+    while (start < numSamples)
+    {
+        // at most maxBins bins are completed before they are added to the windows
+        const int n = jmin(numSamples - start, maxBins * binSize - binFill);
+        const int numCompleted = (binFill + n) / binSize;
+
+        for (int c = 0; c < nChannels; c++)
+        {
+            const float* x = buffer.getReadPointer(c, start);
+            double partial = partialBin[c];
+            int fill = binFill;
+            int64 bin = nextBin;
+
+            for (int i = 0; i < n; i++)
+            {
+                partial += x[i];
+
+                if (++fill == binSize)
+                {
+                    history[(bin % historyRows) * numChannels + c] = (float)(partial / binSize);
+                    partial = 0.0;
+                    fill = 0;
+                    bin++;
+                }
+            }
+
+            partialBin[c] = partial;
+        }
+
+        for (int k = 0; k < numCompleted; k++)
+            addRow(nextBin + k);
+
+        nextBin += numCompleted;
+        binFill = (binFill + n) % binSize;
+        start += n;
+    }
+
+    samplesSinceReset += numSamples;
+
+    if (needsPublish)
+        publish();
+}
+
+void TriggeredAverage::addRow(int64 bin)
+{
+    const float* row = history + (bin % historyRows) * numChannels;
+
+    for (int w = 0; w < numPending;)
+    {
+        const int k = (int)(bin - pendingStart[w]);
+
+        if (k >= 0)
+            accumulate(k, row);
+
+        if (k >= numBins - 1)
+        {
+            pendingStart[w] = pendingStart[--numPending];
+            numTriggers++;
+            needsPublish = true;
+        }
+        else
+        {
+            w++;
+        }
+    }
+}
+
+void TriggeredAverage::accumulate(int k, const float* row)
+{
+    double* s = sum + k * numChannels;
+    double* s2 = sumOfSquares + k * numChannels;
+
+    // contiguous across channels, so the compiler can vectorize it
+    for (int c = 0; c < numChannels; c++)
+    {
+        const double v = row[c];
+        s[c] += v;
+        s2[c] += v * v;
+    }
+
+    counts[k]++;
+}
+
+void TriggeredAverage::publish()
+{
+    const ScopedTryLock lock(publishLock);
+
+    if (! lock.isLocked())
+        return; // the display is copying; try again after the next block
+
+    for (int k = 0; k < numBins; k++)
+    {
+        const int n = counts[k];
+        const double* s = sum + k * numChannels;
+        const double* s2 = sumOfSquares + k * numChannels;
+
+        for (int c = 0; c < numChannels; c++)
+        {
+            float mean = 0.0f;
+            float squaredError = 0.0f;
+
+            if (n > 0)
+                mean = (float)(s[c] / n);
+
+            if (n > 1)
+                squaredError = (float) jmax(0.0, (s2[c] - s[c] * s[c] / n) / ((n - 1) * (double) n));
+
+            publishedMean[c * maxBins + k] = mean;
+            publishedError[c * maxBins + k] = squaredError; // square root taken by copyAverages()
+        }
+    }
+
+    publishedBins = numBins;
+    publishedTriggers = numTriggers;
+    needsPublish = false;
+
+    ++version;
+}
+
+int TriggeredAverage::copyAverages(AudioSampleBuffer& mean, AudioSampleBuffer& standardError, int& numBins_)
+{
+    const ScopedLock lock(publishLock);
+
+    numBins_ = jmin(publishedBins, mean.getNumSamples(), standardError.getNumSamples());
+
+    const int nChannels = jmin(numChannels, mean.getNumChannels(), standardError.getNumChannels());
+
+    for (int c = 0; c < nChannels; c++)
+    {
+        mean.copyFrom(c, 0, publishedMean + c * maxBins, numBins_);
+
+        const float* squaredError = publishedError + c * maxBins;
+        float* error = standardError.getWritePointer(c);
+
+        for (int k = 0; k < numBins_; k++)
+            error[k] = sqrtf(squaredError[k]);
+    }
+
+    return publishedTriggers;
+}
@@ -0,0 +1,141 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __TRIGGEREDAVERAGE_H_6B1E94D2__
+#define __TRIGGEREDAVERAGE_H_6B1E94D2__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Running average of every channel around a set of triggers, updated as the
+  data arrives.
+
+  The window is centred on the trigger and divided into at most maxBins
+  bins (one sample each for short windows). Samples are averaged into bins
+  as they arrive, and the last bins of every channel are kept, so the part
+  of a window before its trigger is already there when the trigger comes.
+  Each completed bin is then added to the running sum and sum of squares of
+  every window that contains it, for all channels at once.
+
+  Each trigger therefore costs one pass over its window, whatever the number
+  of triggers or redraws. When a window is complete, the mean and standard
+  error of every bin are published for the display, which only copies them.
+
+  All methods but setNumChannels() and copyAverages() are called from the
+  processing thread.
+
+  @see LfpTriggeredAverageNode
+
+*/
+
+class TriggeredAverage
+{
+public:
+    TriggeredAverage();
+    ~TriggeredAverage();
+
+    /** Allocates the sums and history. Not to be called during acquisition. */
+    void setNumChannels(int numChannels);
+
+    /** Sets the window length and clears the averages. */
+    void setWindow(int windowSamples);
+
+    /** Clears the averages. */
+    void reset();
+
+    /** Adds a trigger at this sample of the next block passed to addSamples(). */
+    void addTrigger(int sampleIndex);
+
+    /** Bins the first numSamples samples of each channel and adds them to the
+        pending windows. */
+    void addSamples(const AudioSampleBuffer& buffer, int numSamples);
+
+    /** Incremented whenever new averages are published */
+    int getVersion() const
+    {
+        return version.get();
+    }
+
+    /** Triggers ignored since the last reset because maxPendingWindows
+        windows were already being filled */
+    int getNumDroppedTriggers() const
+    {
+        return numDropped;
+    }
+
+    /** Copies the latest mean and standard error of each channel (one sample
+        per bin) and returns the number of triggers they include. */
+    int copyAverages(AudioSampleBuffer& mean, AudioSampleBuffer& standardError, int& numBins);
+
+    static const int maxBins = 1024;
+    static const int maxPendingWindows = 256;
+
+private:
+
+    /** Adds one row of the history (a bin of every channel) to bin k of the sums. */
+    void accumulate(int k, const float* row);
+
+    /** Adds a completed bin to every pending window that contains it. */
+    void addRow(int64 bin);
+
+    /** Computes the mean and standard error, unless the display is copying them. */
+    void publish();
+
+    int numChannels;
+    int windowSamples;
+    int binSize;
+    int numBins;
+    int preBins;
+
+    /** Sums per bin and channel, bin-major */
+    HeapBlock<double> sum;
+    HeapBlock<double> sumOfSquares;
+    HeapBlock<int> counts;
+    int numTriggers;
+
+    /** The last historyRows bins of every channel */
+    HeapBlock<float> history;
+    int historyRows;
+    HeapBlock<double> partialBin;
+    int binFill;
+    int64 nextBin;
+    int64 samplesSinceReset;
+
+    /** First bin of each window still being filled */
+    HeapBlock<int64> pendingStart;
+    int numPending;
+    int numDropped;
+
+    bool needsPublish;
+    CriticalSection publishLock;
+    HeapBlock<float> publishedMean;
+    HeapBlock<float> publishedError;
+    int publishedBins;
+    int publishedTriggers;
+    Atomic<int> version;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TriggeredAverage);
+};
+
+#endif  // __TRIGGEREDAVERAGE_H_6B1E94D2__
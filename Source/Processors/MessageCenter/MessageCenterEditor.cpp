@@ -55,7 +55,7 @@ MessageCenterEditor::~MessageCenterEditor()
 
 void MessageCenterEditor::buttonClicked(Button* button)
 {
-    messageCenter->setParameter(1,1);
+    messageCenter->queueParameterChange(1,1);
 
 }
 
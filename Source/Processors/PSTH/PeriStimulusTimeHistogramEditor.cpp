@@ -420,6 +420,7 @@ PeriStimulusTimeHistogramCanvas::PeriStimulusTimeHistogramCanvas(PeriStimulusTim
 {
     screenWidth = screenHeight = 0;
     conditionWidth = 200;
+    displayedVersion = -1;
 
     inFocusedMode = false;
     showLFP = true;
@@ -829,8 +830,17 @@ void PeriStimulusTimeHistogramCanvas::paint(Graphics& g)
 
 void PeriStimulusTimeHistogramCanvas::refresh()
 {
-    repaint();
-    psthDisplay->refresh();
+    // the analysis thread bumps the version whenever the statistics change;
+    // there is nothing new to draw otherwise
+    const int version = (processor->trialCircularBuffer != nullptr) ?
+                        processor->trialCircularBuffer->getStatisticsVersion() : -1;
+
+    if (updateNeeded || version != displayedVersion || psthDisplay->hasPendingPlotEvents())
+    {
+        displayedVersion = version;
+        repaint();
+        psthDisplay->refresh();
+    }
 }
 
 /***********************************************/
@@ -860,6 +870,17 @@ void PeriStimulusTimeHistogramDisplay::refresh()
 
 }
 
+bool PeriStimulusTimeHistogramDisplay::hasPendingPlotEvents()
+{
+    for (int k = 0; k < psthPlots.size(); k++)
+    {
+        if (psthPlots[k]->hasPendingEvents())
+            return true;
+    }
+
+    return false;
+}
+
 void PeriStimulusTimeHistogramDisplay::paint(Graphics& g)
 {
     g.setColour(Colours::white);
@@ -1337,6 +1358,11 @@ void GenericPlot::buildSmoothKernel(float gaussianStandardDeviationMS_)
     }
 }
 
+bool GenericPlot::hasPendingEvents()
+{
+    return mlp->eventsAvail();
+}
+
 void GenericPlot::handleEventFromMatlabLikePlot(String event)
 {
     std::vector<String> command = StringTS(event).splitString(' ');
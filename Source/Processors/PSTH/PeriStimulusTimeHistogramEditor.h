@@ -74,6 +74,9 @@ public:
     void refresh();
     void focusOnPlot(int plotIndex);
 
+    /** True if a plot has button or range events waiting to be handled in its paint().*/
+    bool hasPendingPlotEvents();
+
     PeriStimulusTimeHistogramNode* processor;
     Viewport* viewport;
     PeriStimulusTimeHistogramCanvas* canvas;
@@ -167,6 +170,9 @@ public:
 private:
     int conditionWidth;
 
+    /** Statistics version of the TrialCircularBuffer at the last repaint */
+    int displayedVersion;
+
     bool showLFP, showSpikes, smoothPlots, autoRescale,compactView, matchRange, inFocusedMode,rasterMode;
     PeriStimulusTimeHistogramNode* processor;
     ScopedPointer<Viewport> viewport, conditionsViewport;
@@ -246,6 +252,7 @@ public:
     void setYRange(double ymin,double ymax);
 
     void handleEventFromMatlabLikePlot(String event);
+    bool hasPendingEvents();
     void resetAxes();
 private:
     void paintSpikeRaster(Graphics& g);
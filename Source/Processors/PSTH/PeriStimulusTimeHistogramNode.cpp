@@ -33,8 +33,31 @@
 
 
 
+PSTHAnalysisThread::PSTHAnalysisThread(PeriStimulusTimeHistogramNode* node_)
+    : Thread("PSTH Analysis"), node(node_)
+{
+}
+
+PSTHAnalysisThread::~PSTHAnalysisThread()
+{
+    stopThread(1000);
+}
+
+void PSTHAnalysisThread::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(50); // woken up by every block
+
+        node->analyzePendingData();
+    }
+}
+
+/***********************************************/
+
 PeriStimulusTimeHistogramNode::PeriStimulusTimeHistogramNode()
-    : GenericProcessor("PSTH"), displayBufferSize(5),  redrawRequested(false)
+    : GenericProcessor("PSTH"), pendingFifo(PSTH_MAX_PENDING_ITEMS), pendingSampleFifo(2),
+      pendingSamples(1, 2), analysisBuffer(1, 2), displayBufferSize(5),  redrawRequested(false)
 {
     trialCircularBuffer  = nullptr;
     isRecording = false;
@@ -42,6 +65,8 @@ PeriStimulusTimeHistogramNode::PeriStimulusTimeHistogramNode()
     saveNetworkEventsWhenNotRecording = false;
     spikeSavingMode = 2;
     syncCounter = 0;
+
+    pendingItems.malloc(PSTH_MAX_PENDING_ITEMS);
 }
 
 
@@ -79,7 +104,7 @@ void PeriStimulusTimeHistogramNode::loadCustomParametersFromXml()
 
 PeriStimulusTimeHistogramNode::~PeriStimulusTimeHistogramNode()
 {
-
+    analysisThread = nullptr;
 }
 
 AudioProcessorEditor* PeriStimulusTimeHistogramNode::createEditor()
@@ -107,6 +132,11 @@ void PeriStimulusTimeHistogramNode::allocateTrialCircularBuffer()
     params.buildTrialsPSTH = true;
     params.reconstructTTL = false;
     params.approximate = true;
+    for (int k=0; k<getNumInputs(); k++)
+    {
+        params.bitVolts.push_back(channels[k]->bitVolts);
+        params.offsetVolts.push_back(channels[k]->offsetVolts);
+    }
 
     trialCircularBuffer = new TrialCircularBuffer(params);
 }
@@ -146,6 +176,17 @@ bool PeriStimulusTimeHistogramNode::enable()
     PeriStimulusTimeHistogramEditor* editor = (PeriStimulusTimeHistogramEditor*) getEditor();
     editor->enable();
 
+    if (trialCircularBuffer == nullptr && getSampleRate() > 0 && getNumInputs() > 0)
+    {
+        allocateTrialCircularBuffer();
+        syncInternalDataStructuresWithSpikeSorter();
+    }
+
+    allocatePendingBuffers();
+
+    analysisThread = new PSTHAnalysisThread(this);
+    analysisThread->startThread();
+
     CoreServices::RecordNode::registerSpikeSource(this);
     for (int i = 0; i < electrodeChannels.size(); i++)
     {
@@ -167,6 +208,17 @@ bool PeriStimulusTimeHistogramNode::disable()
     PeriStimulusTimeHistogramEditor* editor = (PeriStimulusTimeHistogramEditor*) getEditor();
     editor->disable();
 
+    if (analysisThread != nullptr)
+    {
+        analysisThread->stopThread(1000);
+        analysisThread = nullptr;
+
+        analyzePendingData(); // whatever arrived after the last pass
+
+        if (droppedItems.get() > 0)
+            std::cout << "PSTH: " << droppedItems.get() << " blocks or events were not analyzed (queue full)." << std::endl;
+    }
+
     return true;
 }
 
@@ -180,19 +232,46 @@ void PeriStimulusTimeHistogramNode::toggleConditionVisibility(int cond)
 
 void PeriStimulusTimeHistogramNode::process(AudioSampleBuffer& buffer, MidiBuffer& events)
 {
-    //printf("Entering PeriStimulusTimeHistogramNode::process\n");
-    // Update internal statistics
+    // queue the events and the data for the analysis thread
     checkForEvents(events);
 
+    const int nSamples = getNumSamples(0);
 
-    if (trialCircularBuffer == nullptr && getSampleRate() > 0 && getNumInputs() > 0)
-    {
-        allocateTrialCircularBuffer();
-        syncInternalDataStructuresWithSpikeSorter();
-    }
-    else if (trialCircularBuffer != nullptr)
+    if (analysisThread != nullptr && nSamples > 0)
     {
-        trialCircularBuffer->process(buffer,getNumSamples(0),hardware_timestamp,software_timestamp);
+        PendingItem* item = startPendingItem();
+
+        if (item != nullptr)
+        {
+            int start1, size1, start2, size2;
+            pendingSampleFifo.prepareToWrite(nSamples, start1, size1, start2, size2);
+
+            if (size1 + size2 < nSamples)
+            {
+                ++droppedItems;
+            }
+            else
+            {
+                const int numChannels = jmin(buffer.getNumChannels(), pendingSamples.getNumChannels());
+
+                for (int ch = 0; ch < numChannels; ch++)
+                {
+                    pendingSamples.copyFrom(ch, start1, buffer, ch, 0, size1);
+                    if (size2 > 0)
+                        pendingSamples.copyFrom(ch, start2, buffer, ch, size1, size2);
+                }
+
+                pendingSampleFifo.finishedWrite(nSamples);
+
+                item->type = PENDING_BLOCK;
+                item->numSamples = nSamples;
+                item->hardwareTimestamp = hardware_timestamp;
+                item->softwareTimestamp = software_timestamp;
+                finishPendingItem();
+            }
+        }
+
+        analysisThread->notify();
     }
 
 
@@ -206,6 +285,92 @@ void PeriStimulusTimeHistogramNode::process(AudioSampleBuffer& buffer, MidiBuffe
 
 
 
+void PeriStimulusTimeHistogramNode::allocatePendingBuffers()
+{
+    // half a second of data
+    const int numChannels = jmax(1, getNumInputs());
+    const int numSamples = jmax(4096, (int)(getSampleRate() / 2));
+
+    pendingSamples.setSize(numChannels, numSamples);
+    analysisBuffer.setSize(numChannels, numSamples);
+    pendingSampleFifo.setTotalSize(numSamples);
+
+    pendingSampleFifo.reset();
+    pendingFifo.reset();
+    droppedItems.set(0);
+}
+
+PeriStimulusTimeHistogramNode::PendingItem* PeriStimulusTimeHistogramNode::startPendingItem()
+{
+    int start1, size1, start2, size2;
+    pendingFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+    {
+        ++droppedItems;
+        return nullptr;
+    }
+
+    return pendingItems + start1;
+}
+
+void PeriStimulusTimeHistogramNode::finishPendingItem()
+{
+    pendingFifo.finishedWrite(1);
+}
+
+void PeriStimulusTimeHistogramNode::analyzePendingData()
+{
+    const ScopedLock sl(analysisLock);
+
+    while (pendingFifo.getNumReady() > 0)
+    {
+        int start1, size1, start2, size2;
+        pendingFifo.prepareToRead(1, start1, size1, start2, size2);
+
+        const PendingItem& item = pendingItems[start1];
+
+        if (item.type == PENDING_BLOCK)
+        {
+            // the samples always have to be consumed, even if there is nothing to update
+            int sampleStart1, sampleSize1, sampleStart2, sampleSize2;
+            pendingSampleFifo.prepareToRead(item.numSamples, sampleStart1, sampleSize1, sampleStart2, sampleSize2);
+
+            for (int ch = 0; ch < analysisBuffer.getNumChannels(); ch++)
+            {
+                analysisBuffer.copyFrom(ch, 0, pendingSamples, ch, sampleStart1, sampleSize1);
+                if (sampleSize2 > 0)
+                    analysisBuffer.copyFrom(ch, sampleSize1, pendingSamples, ch, sampleStart2, sampleSize2);
+            }
+
+            pendingSampleFifo.finishedRead(sampleSize1 + sampleSize2);
+
+            if (trialCircularBuffer != nullptr)
+                trialCircularBuffer->process(analysisBuffer, item.numSamples, item.hardwareTimestamp, item.softwareTimestamp);
+        }
+        else if (trialCircularBuffer != nullptr)
+        {
+            if (item.type == PENDING_SPIKE)
+            {
+                trialCircularBuffer->addSpikeToSpikeBuffer(item.channel, item.sortedId,
+                                                           item.softwareTimestamp, item.hardwareTimestamp);
+            }
+            else if (item.type == PENDING_TTL)
+            {
+                trialCircularBuffer->addTTLevent(item.channel, item.softwareTimestamp, item.hardwareTimestamp,
+                                                 item.rise, true);
+            }
+            else if (item.type == PENDING_MESSAGE)
+            {
+                StringTS s((unsigned char*) item.message, item.messageLength, item.softwareTimestamp);
+                handleNetworkMessage(s);
+            }
+        }
+
+        pendingFifo.finishedRead(1);
+    }
+}
+
 void PeriStimulusTimeHistogramNode::syncInternalDataStructuresWithSpikeSorter()
 {
     Array<Electrode*> electrodes;
@@ -228,6 +393,8 @@ void PeriStimulusTimeHistogramNode::syncInternalDataStructuresWithSpikeSorter()
 
 void PeriStimulusTimeHistogramNode::modifyTimeRange(double preSec_, double postSec_)
 {
+    const ScopedLock sl(analysisLock);
+
     ProcessorGraph* g = AccessClass::getProcessorGraph();
     Array<GenericProcessor*> p = g->getListOfProcessors();
     for (int k=0; k<p.size(); k++)
@@ -278,11 +445,19 @@ void PeriStimulusTimeHistogramNode::handleEvent(int eventType, MidiMessage& even
 
     if ((eventType == MESSAGE) && (eventId > 0)) //to differentiate network events from simple messages
     {
-        //tictoc.Tic(10);
+        // same layout as StringTS(MidiMessage&), without allocating
+        const uint8* dataptr = event.getRawData();
+        const int len = event.getRawDataSize() - 6 - 8;
+        PendingItem* item = (len >= 0) ? startPendingItem() : nullptr;
 
-        StringTS s(event);
-        handleNetworkMessage(s);
-        //tictoc.Toc(10);
+        if (item != nullptr)
+        {
+            item->type = PENDING_MESSAGE;
+            item->messageLength = jmin(len, PSTH_MAX_MESSAGE_LENGTH);
+            memcpy(item->message, dataptr + 6, item->messageLength);
+            memcpy(&item->softwareTimestamp, dataptr + 6 + len, 8);
+            finishPendingItem();
+        }
     }
     /*
     if (eventType == EYE_POSITION)
@@ -330,13 +505,23 @@ void PeriStimulusTimeHistogramNode::handleEvent(int eventType, MidiMessage& even
         int ttl_source = dataptr[1];
         bool ttl_raise = dataptr[2] > 0;
         int channel = dataptr[3]; // channel number
-        int64 ttl_timestamp_hardware = timestamps[ttl_source] + samplePosition; // hardware time
+        int64 ttl_timestamp_hardware = blockMetadata->getTimestamp(ttl_source) + samplePosition; // hardware time
         int64 ttl_timestamp_software = timer.getHighResolutionTicks(); // get software time
         //int64  ttl_timestamp_software,ttl_timestamp_hardware;
         //memcpy(&ttl_timestamp_software, dataptr+4, 8);
         //memcpy(&ttl_timestamp_hardware, dataptr+12, 8);
 
-        trialCircularBuffer->addTTLevent(channel, ttl_timestamp_software, ttl_timestamp_hardware, ttl_raise, true);
+        PendingItem* item = startPendingItem();
+
+        if (item != nullptr)
+        {
+            item->type = PENDING_TTL;
+            item->channel = channel;
+            item->rise = ttl_raise;
+            item->hardwareTimestamp = ttl_timestamp_hardware;
+            item->softwareTimestamp = ttl_timestamp_software;
+            finishPendingItem();
+        }
 
     }
 
@@ -351,9 +536,16 @@ void PeriStimulusTimeHistogramNode::handleEvent(int eventType, MidiMessage& even
             SpikeObject newSpike;
             unpackSpike(&newSpike, dataptr, bufferSize);
 
-            if (newSpike.sortedId > 0)   // drop unsorted spikes
+            PendingItem* item = (newSpike.sortedId > 0) ? startPendingItem() : nullptr; // drop unsorted spikes
+
+            if (item != nullptr)
             {
-                trialCircularBuffer->addSpikeToSpikeBuffer(newSpike);
+                item->type = PENDING_SPIKE;
+                item->channel = newSpike.electrodeID;
+                item->sortedId = newSpike.sortedId;
+                item->hardwareTimestamp = newSpike.timestamp;
+                item->softwareTimestamp = newSpike.timestamp_software;
+                finishPendingItem();
             }
 
             if (isRecording)
@@ -35,9 +35,41 @@
 #include <queue>
 #include <vector>
 
+#define PSTH_MAX_PENDING_ITEMS 4096
+#define PSTH_MAX_MESSAGE_LENGTH 256
+
 class DataViewport;
 class SpikePlot;
 class TrialCircularBuffer;
+class PeriStimulusTimeHistogramNode;
+
+/**
+
+  Updates the PSTH statistics away from the audio thread.
+
+  PeriStimulusTimeHistogramNode::process() and handleEvent() only copy
+  continuous data, spikes, TTLs and network messages into preallocated
+  lock-free rings. This thread drains them in order into the
+  TrialCircularBuffer, which does the trial detection, alignment and
+  averaging. The editor redraws when the statistics version changes.
+
+  @see PeriStimulusTimeHistogramNode, TrialCircularBuffer
+
+*/
+
+class PSTHAnalysisThread : public Thread
+{
+public:
+    PSTHAnalysisThread(PeriStimulusTimeHistogramNode* node);
+    ~PSTHAnalysisThread();
+
+    void run();
+
+private:
+    PeriStimulusTimeHistogramNode* node;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PSTHAnalysisThread);
+};
 
 class PeriStimulusTimeHistogramNode :  public GenericProcessor
 {
@@ -88,8 +120,53 @@ public:
     void setHardwareTriggerAlignmentChannel(int chan);
 
     void handleNetworkMessage(StringTS s);
+
+    /** Passes everything queued by the audio thread to the TrialCircularBuffer.
+        Called by the PSTHAnalysisThread. */
+    void analyzePendingData();
+
 private:
 
+    /** A block of continuous data or an event, in the order the audio thread saw them */
+    struct PendingItem
+    {
+        int type;
+        int numSamples;
+        int channel;
+        int sortedId;
+        bool rise;
+        int64 hardwareTimestamp;
+        int64 softwareTimestamp;
+        int messageLength;
+        uint8 message[PSTH_MAX_MESSAGE_LENGTH];
+    };
+
+    enum PendingItemType
+    {
+        PENDING_BLOCK = 0,
+        PENDING_SPIKE,
+        PENDING_TTL,
+        PENDING_MESSAGE
+    };
+
+    void allocatePendingBuffers();
+
+    /** Returns a free slot, or nullptr if the ring is full. Audio thread only. */
+    PendingItem* startPendingItem();
+    void finishPendingItem();
+
+    AbstractFifo pendingFifo;
+    HeapBlock<PendingItem> pendingItems;
+
+    AbstractFifo pendingSampleFifo;
+    AudioSampleBuffer pendingSamples;
+    AudioSampleBuffer analysisBuffer;
+
+    Atomic<int> droppedItems;
+
+    CriticalSection analysisLock;
+    ScopedPointer<PSTHAnalysisThread> analysisThread;
+
     bool isRecording;
     int displayBufferSize;
     bool redrawRequested;
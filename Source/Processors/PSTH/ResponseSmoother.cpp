@@ -0,0 +1,155 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ResponseSmoother.h"
+
+ResponseSmoother::ResponseSmoother() : signalSpectrumSize(0), kernelSpectrumSize(0)
+{
+}
+
+ResponseSmoother::~ResponseSmoother()
+{
+}
+
+void ResponseSmoother::smooth(const std::vector<float>& y, const std::vector<float>& kernel,
+                              int xmin, int xmax, std::vector<float>& result)
+{
+    result.resize(jmax(0, xmax - xmin + 1));
+
+    if (result.size() == 0)
+        return;
+
+    if (kernel.size() > FFT_KERNEL_THRESHOLD && y.size() > 0)
+        smoothFFT(y, kernel, xmin, xmax, &result[0]);
+    else
+        smoothDirect(y, kernel, xmin, xmax, &result[0]);
+}
+
+void ResponseSmoother::smoothDirect(const std::vector<float>& y, const std::vector<float>& kernel,
+                                    int xmin, int xmax, float* result)
+{
+    const int numXbins = y.size();
+    const int numOutputs = xmax - xmin + 1;
+
+    FloatVectorOperations::clear(result, numOutputs);
+
+    if (kernel.size() == 0)
+    {
+        const int start = jmax(xmin, 0);
+        const int end = jmin(xmax, numXbins - 1);
+
+        if (end >= start)
+            FloatVectorOperations::copy(result + start - xmin, &y[start], end - start + 1);
+
+        return;
+    }
+
+    const int zeroIndex = (kernel.size() - 1) / 2;
+
+    // result[k] += kernel[j] * y[k + j] for all valid k, one tap at a time
+    for (int j = -zeroIndex; j < (int) kernel.size() - zeroIndex; j++)
+    {
+        const int start = jmax(xmin, -j);
+        const int end = jmin(xmax, numXbins - 1 - j);
+
+        if (end >= start)
+            FloatVectorOperations::addWithMultiply(result + start - xmin, &y[start + j],
+                                                   kernel[j + zeroIndex], end - start + 1);
+    }
+}
+
+void ResponseSmoother::smoothFFT(const std::vector<float>& y, const std::vector<float>& kernel,
+                                 int xmin, int xmax, float* result)
+{
+    const int numXbins = y.size();
+    const int numKernelBins = kernel.size();
+    const int zeroIndex = (numKernelBins - 1) / 2;
+    const int numOutputs = xmax - xmin + 1;
+
+    // only the part of y that reaches the output range
+    const int first = jmax(0, xmin - zeroIndex);
+    const int last = jmin(numXbins - 1, xmax + numKernelBins - 1 - zeroIndex);
+
+    FloatVectorOperations::clear(result, numOutputs);
+
+    if (last < first)
+        return;
+
+    const int numSegmentBins = last - first + 1;
+
+    int n = 1;
+    while (n < numSegmentBins + numKernelBins - 1)
+        n <<= 1;
+
+    if (fft == nullptr || fft->getSize() != n)
+        fft = new FastFourierTransform(n);
+
+    if (n != kernelSpectrumSize || kernel != lastKernel)
+    {
+        // spectrum of the reversed kernel, so that the convolution gives the correlation
+        kernelSpectrum.calloc(2 * n);
+
+        for (int k = 0; k < numKernelBins; k++)
+            kernelSpectrum[2 * k] = kernel[numKernelBins - 1 - k];
+
+        fft->perform(kernelSpectrum);
+
+        kernelSpectrumSize = n;
+        lastKernel = kernel;
+    }
+
+    if (n > signalSpectrumSize)
+    {
+        signalSpectrum.malloc(2 * n);
+        signalSpectrumSize = n;
+    }
+
+    zeromem(signalSpectrum, 2 * n * sizeof(float));
+
+    for (int k = 0; k < numSegmentBins; k++)
+        signalSpectrum[2 * k] = y[first + k];
+
+    fft->perform(signalSpectrum);
+
+    for (int k = 0; k < n; k++)
+    {
+        const float re = signalSpectrum[2 * k] * kernelSpectrum[2 * k] - signalSpectrum[2 * k + 1] * kernelSpectrum[2 * k + 1];
+        const float im = signalSpectrum[2 * k] * kernelSpectrum[2 * k + 1] + signalSpectrum[2 * k + 1] * kernelSpectrum[2 * k];
+        signalSpectrum[2 * k] = re;
+        signalSpectrum[2 * k + 1] = im;
+    }
+
+    fft->performInverse(signalSpectrum);
+
+    // output bin x is at (x - first) + (numKernelBins - 1 - zeroIndex) in the full convolution
+    const float scale = 1.0f / n;
+    const int offset = numKernelBins - 1 - zeroIndex - first;
+
+    for (int x = xmin; x <= xmax; x++)
+    {
+        const int index = x + offset;
+
+        if (index >= 0 && index < numSegmentBins + numKernelBins - 1)
+            result[x - xmin] = signalSpectrum[2 * index] * scale;
+    }
+}
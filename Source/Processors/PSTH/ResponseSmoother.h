@@ -0,0 +1,80 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __RESPONSESMOOTHER_H__
+#define __RESPONSESMOOTHER_H__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include <vector>
+
+#include "../Visualization/FastFourierTransform.h"
+
+/**
+
+  Convolves average trial responses with a (Gaussian) smoothing kernel.
+
+  Narrow kernels are applied in the time domain, one kernel tap at a time
+  over the whole output range, so that the inner loop is a vectorized
+  multiply-add. Kernels wider than FFT_KERNEL_THRESHOLD taps are applied
+  by FFT convolution instead, which costs O(N log N) whatever the width;
+  the spectrum of the last kernel is kept between calls.
+
+  Not thread safe: each user keeps its own instance.
+
+  @see TrialCircularBuffer
+
+*/
+
+class ResponseSmoother
+{
+public:
+    ResponseSmoother();
+    ~ResponseSmoother();
+
+    /** Fills result with bins [xmin, xmax] of y convolved with the centred kernel.
+        Samples outside y count as zeros. An empty kernel copies the range.*/
+    void smooth(const std::vector<float>& y, const std::vector<float>& kernel,
+                int xmin, int xmax, std::vector<float>& result);
+
+    enum { FFT_KERNEL_THRESHOLD = 64 };
+
+private:
+
+    void smoothDirect(const std::vector<float>& y, const std::vector<float>& kernel,
+                      int xmin, int xmax, float* result);
+    void smoothFFT(const std::vector<float>& y, const std::vector<float>& kernel,
+                   int xmin, int xmax, float* result);
+
+    ScopedPointer<FastFourierTransform> fft;
+
+    HeapBlock<float> signalSpectrum;
+    int signalSpectrumSize;
+
+    HeapBlock<float> kernelSpectrum;
+    int kernelSpectrumSize;
+    std::vector<float> lastKernel;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ResponseSmoother);
+};
+
+#endif  // __RESPONSESMOOTHER_H__
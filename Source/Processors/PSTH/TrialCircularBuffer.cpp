@@ -292,7 +292,7 @@ void PSTH::getRange(float& xMin, float& xMax, float& yMin, float& yMax)
     yMin = ymin;
 }
 
-void PSTH::updatePSTH(std::vector<float> alignedLFP,std::vector<bool> valid)
+void PSTH::updatePSTH(const std::vector<float>& alignedLFP, const std::vector<bool>& valid)
 {
 
     numTrials++;
@@ -493,7 +493,7 @@ ChannelPSTHs::ChannelPSTHs(int ID, TrialCircularBufferParams params_) : channelI
     numTrials = 0;
 }
 
-void ChannelPSTHs::updateConditionsWithLFP(std::vector<int> conditionsNeedUpdating, std::vector<float> alignedLFP, std::vector<bool> valid, Trial* trial)
+void ChannelPSTHs::updateConditionsWithLFP(const std::vector<int>& conditionsNeedUpdating, const std::vector<float>& alignedLFP, const std::vector<bool>& valid, Trial* trial)
 {
     numTrials++;
     if (conditionsNeedUpdating.size() == 0)
@@ -773,7 +773,7 @@ void ElectrodePSTH::UpdateChannelConditionWithLFP(int ch, std::vector<int>* cond
 }
 
 
-void ElectrodePSTH::updateChannelsConditionsWithLFP(std::vector<int> conditionsNeedUpdate, Trial* trial, SmartContinuousCircularBuffer* lfpBuffer)
+void ElectrodePSTH::updateChannelsConditionsWithLFP(const std::vector<int>& conditionsNeedUpdate, Trial* trial, SmartContinuousCircularBuffer* lfpBuffer)
 {
     // compute trial aligned lfp for all channels
 
@@ -981,7 +981,7 @@ bool SmartContinuousCircularBuffer::getAlignedData(std::vector<int> channels, Tr
 
             for (int ch=0; ch<channels.size(); ch++)
             {
-                float value = Buf[channels[ch]][actual_index];
+                float value = Buf.getSample(channels[ch], actual_index);
                 output[ch][index] =  value;
             }
         }
@@ -1018,7 +1018,7 @@ bool SmartContinuousCircularBuffer::getAlignedData(std::vector<int> channels, Tr
 
             for (int ch=0; ch<channels.size(); ch++)
             {
-                output[ch][i] =  Buf[channels[ch]][index1] * (1-frac) +  Buf[channels[ch]][index2] * (frac);
+                output[ch][i] =  Buf.getSample(channels[ch], index1) * (1-frac) +  Buf.getSample(channels[ch], index2) * (frac);
             }
 
         }
@@ -1180,7 +1180,7 @@ bool SmartContinuousCircularBuffer::getAlignedDataInterp(std::vector<int> channe
         valid[i] = true;
         for (int ch=0; ch<channels.size(); ch++)
         {
-            output[ch][i] =  Buf[channels[ch]][index] * (1-fracA) +  Buf[channels[ch]][index_next] * (fracA);
+            output[ch][i] =  Buf.getSample(channels[ch], index) * (1-fracA) +  Buf.getSample(channels[ch], index_next) * (fracA);
         }
         // now advance pointers if needed
         if (i < numTimeBins-1)
@@ -1261,17 +1261,36 @@ SmartSpikeCircularBuffer::SmartSpikeCircularBuffer(float maxTrialTimeSeconds, in
     }
 
     trialID.resize(maxTrialsInMemory);
-    pointers.resize(maxTrialsInMemory);
 
     for (int k = 0; k < maxTrialsInMemory; k++)
     {
-        trialID[k] = pointers[k] = 0;
+        trialID[k] = 0;
     }
 
     jassert(trialID.size() > 0);
 
 }
 
+int SmartSpikeCircularBuffer::getSpikeIndex(int k) const
+{
+    int index = bufferIndex - numSpikesStored + k;
+
+    if (index < 0)
+        index += bufferSize;
+
+    return index;
+}
+
+int SmartSpikeCircularBuffer::getTrialIndex(int k) const
+{
+    int index = trialIndex - numTrialsStored + k;
+
+    if (index < 0)
+        index += maxTrialsInMemory;
+
+    return index;
+}
+
 void SmartSpikeCircularBuffer::addSpikeToBuffer(int64 spikeTimeSoftware,int64 spikeTimeHardware)
 {
     jassert(bufferSize > 0);
@@ -1285,6 +1304,19 @@ void SmartSpikeCircularBuffer::addSpikeToBuffer(int64 spikeTimeSoftware,int64 sp
 
     if (numSpikesStored > bufferSize)
         numSpikesStored = bufferSize;
+
+    // spikes almost always arrive in order; if not, move this one back to its place
+    for (int k = numSpikesStored - 1; k > 0; k--)
+    {
+        const int current = getSpikeIndex(k);
+        const int previous = getSpikeIndex(k - 1);
+
+        if (spikeTimesSoftware[previous] <= spikeTimesSoftware[current])
+            break;
+
+        std::swap(spikeTimesSoftware[previous], spikeTimesSoftware[current]);
+        std::swap(spikeTimesHardware[previous], spikeTimesHardware[current]);
+    }
 }
 
 
@@ -1293,7 +1325,6 @@ void SmartSpikeCircularBuffer::addTrialStartToBuffer(Trial* t)
     jassert(trialIndex >= 0);
 
     trialID[trialIndex] = t->trialID;
-    pointers[trialIndex] = bufferIndex; // current index in the spike buffer
 
     trialIndex = (trialIndex + 1) % maxTrialsInMemory;
 
@@ -1303,29 +1334,46 @@ void SmartSpikeCircularBuffer::addTrialStartToBuffer(Trial* t)
         numTrialsStored = maxTrialsInMemory;
 }
 
-int SmartSpikeCircularBuffer::queryTrialStart(int ID)
+bool SmartSpikeCircularBuffer::containsTrial(int ID)
 {
-    for (int k = 0; k < numTrialsStored; k++)
-    {
-        int whereToLook = trialIndex - 1 - k;
+    // trial IDs are handed out in increasing order
+    int first = 0;
+    int last = numTrialsStored;
 
-        if (whereToLook < 0)
-            whereToLook += maxTrialsInMemory;
+    while (first < last)
+    {
+        const int middle = (first + last) / 2;
 
-        if (trialID[whereToLook] == ID)
-            return pointers[whereToLook];
+        if (trialID[getTrialIndex(middle)] < ID)
+            first = middle + 1;
+        else
+            last = middle;
     }
 
-    // trial not found?!!?!?
-    return -1;
+    return first < numTrialsStored && trialID[getTrialIndex(first)] == ID;
 }
 
+int SmartSpikeCircularBuffer::findFirstSpikeAtOrAfter(int64 ts) const
+{
+    int first = 0;
+    int last = numSpikesStored;
 
+    while (first < last)
+    {
+        const int middle = (first + last) / 2;
+
+        if (spikeTimesSoftware[getSpikeIndex(middle)] < ts)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    return first;
+}
 
 std::vector<int64> SmartSpikeCircularBuffer::getAlignedSpikes(Trial* trial, float preSecs, float postSecs)
 {
-    // we need to update the average firing rate with the spikes that were stored in the spike buffer.
-    // first, query spike buffer where does the trial start....
+    // return all spikes within Start_TS-BeforeSec .. End_TS+AfterSec, aligned to AlignTS
     jassert(spikeTimesSoftware.size() > 0);
     std::vector<int64> alignedSpikes;
     Time t;
@@ -1335,68 +1383,29 @@ std::vector<int64> SmartSpikeCircularBuffer::getAlignedSpikes(Trial* trial, floa
 
     int64 samplesToTicks = 1.0/float(sampleRateHz) * ticksPerSec;
 
-    int saved_ptr = queryTrialStart(trial->trialID);
-    if (saved_ptr < 0)
+    if (!containsTrial(trial->trialID))
         return alignedSpikes; // trial is not in memory??!?
 
+    const int64 windowEnd = trial->endTS + numTicksPostTrial;
 
-    // return all spikes within a given interval aligned to AlignTS
-    // Use ptr as a search reference in the buffer
-    // The interval is defined as Start_TS-BeforeSec .. End_TS+AfterSec
-
-    //std::cout << "Stored spikes: " << numSpikesStored << std::endl;
-
-    // Search Backward
-    int currPtr = saved_ptr;
-    int  N = 0;
-    while (N < numSpikesStored)
+    for (int k = findFirstSpikeAtOrAfter(trial->startTS - numTicksPreTrial); k < numSpikesStored; k++)
     {
-        if (spikeTimesSoftware[currPtr] < trial->startTS-numTicksPreTrial || spikeTimesSoftware[currPtr] > trial->endTS+numTicksPostTrial)
-        {
-            //std::cout << "Current spikeTimeSoftware = " << spikeTimesSoftware[currPtr] << ", trial start time = " << trial->startTS-numTicksPreTrial
-            //          << ", and trial end time = " << trial->endTS+numTicksPostTrial << std::endl;
+        const int index = getSpikeIndex(k);
+
+        if (spikeTimesSoftware[index] > windowEnd)
             break;
-        }
 
-        // Add spike..
         if (trial->hardwareAlignment)
             // convert from samples to ticks...
-            alignedSpikes.push_back((spikeTimesHardware[currPtr]-trial->alignTS_hardware)*samplesToTicks);
+            alignedSpikes.push_back((spikeTimesHardware[index] - trial->alignTS_hardware) * samplesToTicks);
         else
-            alignedSpikes.push_back(spikeTimesSoftware[currPtr]-trial->alignTS);
-
-        currPtr--;
-        N++;
-        if (currPtr < 0)
-            currPtr = bufferSize-1;
-    }
-    // Now Search Forward
-    currPtr = saved_ptr + 1;
-
-    while (N < numSpikesStored)
-    {
-        if (currPtr >= bufferSize)
-            currPtr = 0;
-
-        if (spikeTimesSoftware[currPtr] > trial->endTS + numTicksPostTrial || currPtr == bufferIndex)
-            break;
-        // Add spike..
-        if (spikeTimesSoftware[currPtr] - trial->startTS >= -numTicksPreTrial)
-        {
-
-            if (trial->hardwareAlignment)
-                alignedSpikes.push_back((spikeTimesHardware[currPtr] - trial->alignTS_hardware) * samplesToTicks);
-            else
-                alignedSpikes.push_back(spikeTimesSoftware[currPtr] - trial->alignTS);
-
-            N++;
-        }
-        currPtr++;
-
+            alignedSpikes.push_back(spikeTimesSoftware[index] - trial->alignTS);
     }
 
+    // hardware timestamps can be slightly out of order with respect to software ones
+    if (trial->hardwareAlignment)
+        std::sort(alignedSpikes.begin(), alignedSpikes.end());
 
-    std::sort(alignedSpikes.begin(),alignedSpikes.begin()+alignedSpikes.size());
     return alignedSpikes;
 }
 
@@ -1421,6 +1430,7 @@ TrialCircularBuffer::TrialCircularBuffer()
     lastSimulatedTrialTS = 0;
     lastTrialID = 0;
     uniqueIntervalID = 0;
+    cacheVersion = -1;
     useThreads = true;
 }
 
@@ -1436,12 +1446,18 @@ TrialCircularBuffer::TrialCircularBuffer(TrialCircularBufferParams params_) : pa
     lastTrialID = 0;
     hardwareTriggerAlignmentChannel = -1;
     uniqueIntervalID = 0;
+    cacheVersion = -1;
     // sampling them should be at least 600 Hz (Nyquist!)
     // We typically sample everything at 30000, so a sub-sampling by a factor of 50 should be good
-    int subSample = params.sampleRate/ params.desiredSamplingRateHz;
+    // (a decimated stream may already be below the desired rate)
+    int subSample = jmax(1, int(params.sampleRate/ params.desiredSamplingRateHz));
     float numSeconds = 2*(params.maxTrialTimeSeconds+params.preSec+params.postSec);
     lfpBuffer = new SmartContinuousCircularBuffer(params.numChannels, params.sampleRate, subSample, numSeconds);
     ttlBuffer = new SmartContinuousCircularBuffer(params.numTTLchannels, params.sampleRate, subSample, numSeconds);
+    for (int k=0; k<params.bitVolts.size() && k<params.numChannels; k++)
+    {
+        lfpBuffer->Buf.setStep(k, params.bitVolts[k], k < params.offsetVolts.size() ? params.offsetVolts[k] : 0.0f);
+    }
     lastTTLts.resize(params.numTTLchannels);
     ttlChannelStatus.resize(params.numTTLchannels);
     for (int k=0; k<params.numTTLchannels; k++)
@@ -1603,6 +1619,7 @@ void TrialCircularBuffer::addDefaultTTLConditions(Array<bool> visibility)
 void TrialCircularBuffer::clearAll()
 {
     const ScopedLock myScopedLock(psthMutex);
+    ++statisticsVersion;
     //lockPSTH();
     for (int i = 0; i < electrodesPSTH.size(); i++)
     {
@@ -1627,6 +1644,7 @@ void TrialCircularBuffer::clearDesign()
     //lockConditions();
     //const ScopedLock myScopedLock (conditionMutex);
     const ScopedLock myScopedLock(psthMutex);
+    ++statisticsVersion;
     // keep ttl visibility status
     Array<bool> ttlVisible;
     if (conditions.size() > 0)
@@ -1823,6 +1841,7 @@ void TrialCircularBuffer::addNewElectrode(Electrode* electrode)
 {
     //lockPSTH();
     const ScopedLock myScopedLock(psthMutex);
+    ++statisticsVersion;
 
     ElectrodePSTH e(electrode->electrodeID,electrode->name);
     int numChannels = electrode->numChannels;
@@ -1863,6 +1882,7 @@ void  TrialCircularBuffer::addNewUnit(int electrodeID, int unitID, uint8 r,uint8
     // build a new PSTH for all defined conditions
     //lockPSTH();
     const ScopedLock myScopedLock(psthMutex);
+    ++statisticsVersion;
 
     UnitPSTHs unitPSTHs(unitID, params,r,g,b);
     for (int k = 0; k < conditions.size(); k++)
@@ -1885,6 +1905,7 @@ void  TrialCircularBuffer::removeUnit(int electrodeID, int unitID)
 {
     //lockPSTH();
     const ScopedLock myScopedLock(psthMutex);
+    ++statisticsVersion;
 
     for (int e =0; e<electrodesPSTH.size(); e++)
     {
@@ -1906,6 +1927,7 @@ void  TrialCircularBuffer::removeUnit(int electrodeID, int unitID)
 void  TrialCircularBuffer::removeAllUnits(int electrodeID)
 {
     const ScopedLock myScopedLock(psthMutex);
+    ++statisticsVersion;
 
     for (int e =0; e<electrodesPSTH.size(); e++)
     {
@@ -1920,6 +1942,7 @@ void  TrialCircularBuffer::removeAllUnits(int electrodeID)
 void TrialCircularBuffer::removeElectrode(int electrodeID)
 {
     const ScopedLock myScopedLock(psthMutex);
+    ++statisticsVersion;
 
     //	lockPSTH();
     for (int e =0; e<electrodesPSTH.size(); e++)
@@ -2099,19 +2122,24 @@ bool TrialCircularBuffer::parseMessage(StringTS msg)
 }
 
 void TrialCircularBuffer::addSpikeToSpikeBuffer(SpikeObject newSpike)
+{
+    addSpikeToSpikeBuffer(newSpike.electrodeID, newSpike.sortedId, newSpike.timestamp_software, newSpike.timestamp);
+}
+
+void TrialCircularBuffer::addSpikeToSpikeBuffer(int electrodeID, int sortedId, int64 timestampSoftware, int64 timestampHardware)
 {
     //lockPSTH();
     const ScopedLock myScopedLock(psthMutex);
 
     for (int e = 0; e < electrodesPSTH.size(); e++)
     {
-        if (electrodesPSTH[e].electrodeID == newSpike.electrodeID)
+        if (electrodesPSTH[e].electrodeID == electrodeID)
         {
             for (int u = 0; u < electrodesPSTH[e].unitsPSTHs.size(); u++)
             {
-                if (electrodesPSTH[e].unitsPSTHs[u].unitID == newSpike.sortedId)
+                if (electrodesPSTH[e].unitsPSTHs[u].unitID == sortedId)
                 {
-                    electrodesPSTH[e].unitsPSTHs[u].addSpikeToBuffer(newSpike.timestamp_software, newSpike.timestamp);
+                    electrodesPSTH[e].unitsPSTHs[u].addSpikeToBuffer(timestampSoftware, timestampHardware);
                     //unlockPSTH();
                     return;
                 }
@@ -2132,95 +2160,89 @@ bool TrialCircularBuffer::contains(std::vector<int> v, int x)
     return false;
 }
 
-void TrialCircularBuffer::updateLFPwithTrial(int electrodeIndex, std::vector<int>* conditionsNeedUpdate, Trial* trial)
+void TrialCircularBuffer::updateLFPwithTrials(int electrodeIndex)
 {
-    electrodesPSTH[electrodeIndex].updateChannelsConditionsWithLFP(*conditionsNeedUpdate,trial, lfpBuffer);
+    for (int t = 0; t < batchTrials.size(); t++)
+        electrodesPSTH[electrodeIndex].updateChannelsConditionsWithLFP(batchConditions[t], &batchTrials[t], lfpBuffer);
 }
 
-void TrialCircularBuffer::updateSpikeswithTrial(int electrodeIndex, int unitIndex, std::vector<int>* conditionsNeedUpdate, Trial* trial)
+void TrialCircularBuffer::updateSpikeswithTrials(int electrodeIndex, int unitIndex)
 {
-    electrodesPSTH[electrodeIndex].unitsPSTHs[unitIndex].updateConditionsWithSpikes(*conditionsNeedUpdate,trial);
+    for (int t = 0; t < batchTrials.size(); t++)
+        electrodesPSTH[electrodeIndex].unitsPSTHs[unitIndex].updateConditionsWithSpikes(batchConditions[t], &batchTrials[t]);
 }
 
-void TrialCircularBuffer::updatePSTHwithTrial(Trial* trial)
+void TrialCircularBuffer::updatePSTHwithTrials(std::vector<Trial>& trials)
 {
-    //printf("Calling updatePSTHwithTrial::lock conditions started\n");
     const ScopedLock myScopedLock(psthMutex);
-    //const ScopedLock myScopedLock (conditionMutex);
-    //
-    //lockConditions();
-    //printf("Calling updatePSTHwithTrial::lock PSTH started\n");
-    //lockPSTH();
-    //printf("Finished updatePSTHwithTrial::lock PSTH started\n");
-    //	printf("Calling updatePSTHwithTrial::lock conditions finished \n");
 
-    // find out which conditions need to be updated
-    std::vector<int> conditionsNeedUpdating;
-    for (int c=0; c<conditions.size(); c++)
+    // find out which conditions need to be updated by each trial, and drop
+    // the trials that don't match any
+    batchTrials.clear();
+    batchConditions.clear();
+
+    for (int t = 0; t < trials.size(); t++)
     {
-        if (contains(conditions[c].trialTypes, trial->type) &&
-            ((conditions[c].trialOutcomes.size() == 0) ||
-             (conditions[c].trialOutcomes.size() > 0 && contains(conditions[c].trialOutcomes, trial->outcome))))
-            conditionsNeedUpdating.push_back(conditions[c].conditionID);
+        std::vector<int> conditionsNeedUpdating;
+        for (int c=0; c<conditions.size(); c++)
+        {
+            if (contains(conditions[c].trialTypes, trials[t].type) &&
+                ((conditions[c].trialOutcomes.size() == 0) ||
+                 (conditions[c].trialOutcomes.size() > 0 && contains(conditions[c].trialOutcomes, trials[t].outcome))))
+                conditionsNeedUpdating.push_back(conditions[c].conditionID);
+        }
+
+        if (conditionsNeedUpdating.size() > 0)
+        {
+            batchTrials.push_back(trials[t]);
+            batchConditions.push_back(conditionsNeedUpdating);
+        }
     }
 
-    if (conditionsNeedUpdating.size() == 0)
+    if (batchTrials.size() == 0)
     {
         // none of the conditions match. nothing to update.
-        //unlockPSTH();
-        //unlockConditions();
-        //std::cout << "No updates needed." << std::endl;
-
         return;
     }
 
-
-
     if (!useThreads)
     {
-        //std::cout << "Updating without threads..." << std::endl;
-        // these two parts can be fully distributed along several threads because they are completely independent.
-        //printf("Calling updatePSTHwithTrial::update without threads\n");
-
         tictoc.Tic(23);
         for (int i = 0; i < electrodesPSTH.size(); i++)
         {
-            electrodesPSTH[i].updateChannelsConditionsWithLFP(conditionsNeedUpdating,trial, lfpBuffer); // timer 6 -> 7,18
+            updateLFPwithTrials(i);
         }
         // update both spikes and LFP PSTHs
         for (int i = 0; i < electrodesPSTH.size(); i++)
         {
             for (int u = 0; u < electrodesPSTH[i].unitsPSTHs.size(); u++)
             {
-                electrodesPSTH[i].unitsPSTHs[u].updateConditionsWithSpikes(conditionsNeedUpdating,trial); // timer 14,15
+                updateSpikeswithTrials(i, u);
             }
         }
         tictoc.Toc(23);
-        //printf("Finished updatePSTHwithTrial::update without threads\n");
-
     }
     else
     {
-
-        //std::cout << "Updating with threads..." << std::endl;
+        // one job per electrode and per unit handles the whole batch
         tictoc.Tic(24);
         int cnt = 0;
         int numElectrodes = electrodesPSTH.size();
-        //printf("Calling updatePSTHwithTrial::update with threads\n");
+
+        if (threadpool == nullptr)
+            threadpool = new ThreadPool(SystemStats::getNumCpus());
 
         for (int i = 0; i < numElectrodes; i++)
         {
-            TrialCircularBufferThread* job = new TrialCircularBufferThread(this,&conditionsNeedUpdating,trial,cnt++,0,i,-1);
+            TrialCircularBufferThread* job = new TrialCircularBufferThread(this,cnt++,0,i,-1);
             threadpool->addJob(job, true);
             for (int u=0; u<electrodesPSTH[i].unitsPSTHs.size(); u++)
             {
-                TrialCircularBufferThread* job = new TrialCircularBufferThread(this,&conditionsNeedUpdating,trial,cnt++,1,i,u);
+                TrialCircularBufferThread* job = new TrialCircularBufferThread(this,cnt++,1,i,u);
                 threadpool->addJob(job, true);
             }
         }
 
-        //printf("Calling updatePSTHwithTrial::Waiting for jobs\n");
-
         while (threadpool->getNumJobs() > 0)
         {
 #if JUCE_WINDOWS
@@ -2230,12 +2252,14 @@ void TrialCircularBuffer::updatePSTHwithTrial(Trial* trial)
 #endif
         }
         tictoc.Toc(24);
-        //printf("Finished updatePSTHwithTrial::Waiting for jobs\n");
-
     }
 
-    //unlockPSTH();
-    //unlockConditions();
+    ++statisticsVersion;
+}
+
+int TrialCircularBuffer::getStatisticsVersion()
+{
+    return statisticsVersion.get();
 }
 
 void TrialCircularBuffer::reallocate(int numChannels)
@@ -2333,14 +2357,14 @@ void TrialCircularBuffer::addTTLevent(int channel,int64 ttl_timestamp_software,
 
 }
 
-std::vector<std::vector<bool>> TrialCircularBuffer::reconstructTTLchannels(int64 hardware_timestamp,int nSamples)
+void TrialCircularBuffer::reconstructTTLchannels(int64 hardware_timestamp,int nSamples)
 {
-    std::vector<std::vector<bool>> contdata;
+    std::vector<std::vector<bool> >& contdata = reconstructedTTLs;
     contdata.resize(params.numTTLchannels);
 
     for (int k=0; k<params.numTTLchannels; k++)
     {
-        contdata[k].resize(nSamples);
+        contdata[k].resize(nSamples); // keeps its capacity
     }
 
     int64 currTS = hardware_timestamp;
@@ -2368,7 +2392,6 @@ std::vector<std::vector<bool>> TrialCircularBuffer::reconstructTTLchannels(int64
         }
 
     }
-    return contdata;
 }
 
 
@@ -2654,6 +2677,7 @@ void TrialCircularBuffer::clearUnitStatistics(int electrodeID, int unitID)
                 if (electrodesPSTH[electrodeIndex].unitsPSTHs[entryindex].unitID == unitID)
                 {
                     electrodesPSTH[electrodeIndex].unitsPSTHs[entryindex].clearStatistics();
+                    ++statisticsVersion;
                     //unlockPSTH();
                     return;
 
@@ -2678,6 +2702,7 @@ void TrialCircularBuffer::clearChanneltatistics(int electrodeID, int channelID)
                 if (electrodesPSTH[electrodeIndex].channelsPSTHs[entryindex].channelID == channelID)
                 {
                     electrodesPSTH[electrodeIndex].channelsPSTHs[entryindex].clearStatistics();
+                    ++statisticsVersion;
                     //unlockPSTH();
                     return;
                 }
@@ -2728,26 +2753,38 @@ std::vector<float> TrialCircularBuffer::buildSmoothKernel(float guassianStandard
     return smoothKernel;
 }
 
-std::vector<float> TrialCircularBuffer::smooth(std::vector<float> y, std::vector<float> smoothKernel, int xmin, int xmax)
+std::vector<float> TrialCircularBuffer::smooth(const std::vector<float>& y, const std::vector<float>& smoothKernel, int xmin, int xmax)
 {
     std::vector<float> smoothy;
-    smoothy.resize(xmax-xmin+1);
+    smoother.smooth(y, smoothKernel, xmin, xmax, smoothy);
+    return  smoothy;
+}
 
-    int numKernelBins = smoothKernel.size();
-    int zeroIndex = (numKernelBins-1)/2;
-    int numXbins = y.size();
-    for (int k=xmin; k<=xmax; k++)
+bool TrialCircularBuffer::ResponseCacheKey::operator< (const ResponseCacheKey& other) const
+{
+    if (electrodeID != other.electrodeID) return electrodeID < other.electrodeID;
+    if (id != other.id) return id < other.id;
+    if (isChannel != other.isChannel) return isChannel < other.isChannel;
+    if (smoothMS != other.smoothMS) return smoothMS < other.smoothMS;
+    if (xmin != other.xmin) return xmin < other.xmin;
+    if (xmax != other.xmax) return xmax < other.xmax;
+    if (ymin != other.ymin) return ymin < other.ymin;
+    return ymax < other.ymax;
+}
+
+void TrialCircularBuffer::validateResponseCache()
+{
+    // any new trial (or cleared statistics) makes every cached response stale
+    const int version = statisticsVersion.get();
+
+    if (version != cacheVersion || responseCache.size() + imageCache.size() > MAX_CACHED_RESPONSES)
     {
-        float response = 0;
-        for (int j=-zeroIndex; j<zeroIndex; j++)
-        {
-            if (k+j >=0 && k+j < numXbins)
-                response+=y[k+j] * smoothKernel[j+zeroIndex];
-        }
-        smoothy[k-xmin] = response;
+        responseCache.clear();
+        imageCache.clear();
+        cacheVersion = version;
     }
-    return  smoothy;
 }
+
 // Builds average raster matrix.
 // each line corresponds to a trial type, and contains the average response for that trial type.
 // each column corresponds to a specific time point, returned by x_time
@@ -2756,198 +2793,139 @@ std::vector<float> TrialCircularBuffer::smooth(std::vector<float> y, std::vector
 std::vector<std::vector<float>> TrialCircularBuffer::getTrialsAverageUnitResponse(int electrodeID, int unitID,
                              std::vector<float>& x_time, int& numTrialTypes, std::vector<int>& numTrialRepeats, double smoothMS, float xmin, float xmax)
 {
-    // allocate a matrix with average trial responses (not conditions!)
-    std::vector<std::vector<float>> avgResponseMatrix;
-    avgResponseMatrix.clear();
-    x_time.clear();
-    numTrialRepeats.clear();
-    numTrialTypes = 0;
+    return getTrialsAverageResponse(electrodeID, unitID, false, x_time, numTrialTypes, numTrialRepeats, smoothMS, xmin, xmax);
+}
 
-    std::vector<float> smoothKernel;
-    if (smoothMS > 0)
-        smoothKernel = buildSmoothKernel(smoothMS, 1.0);
+std::vector<std::vector<float>> TrialCircularBuffer::getTrialsAverageChannelResponse(int electrodeID, int channelID,
+                             std::vector<float>& x_time, int& numTrialTypes, std::vector<int>& numTrialRepeats, double smoothMS, float xmin, float xmax)
+{
+    return getTrialsAverageResponse(electrodeID, channelID, true, x_time, numTrialTypes, numTrialRepeats, smoothMS, xmin, xmax);
+}
 
-    //lockPSTH();
-    //lockConditions();
-    const ScopedLock myScopedLock(psthMutex);
-    //const ScopedLock myScopedLock (conditionMutex);
+std::vector<std::vector<float>> TrialCircularBuffer::getTrialsAverageResponse(int electrodeID, int id, bool isChannel,
+                             std::vector<float>& x_time, int& numTrialTypes, std::vector<int>& numTrialRepeats, double smoothMS, float xmin, float xmax)
+{
+    const ScopedLock cacheScopedLock(cacheLock);
+    validateResponseCache();
 
-    //bool fisrtTime = true;
-    for (int electrodeIndex=0; electrodeIndex<electrodesPSTH.size(); electrodeIndex++)
+    ResponseCacheKey key;
+    key.electrodeID = electrodeID;
+    key.id = id;
+    key.isChannel = isChannel;
+    key.smoothMS = (float) smoothMS;
+    key.xmin = xmin;
+    key.xmax = xmax;
+    key.ymin = key.ymax = -1;
+
+    std::map<ResponseCacheKey, CachedResponse>::iterator cached = responseCache.find(key);
+
+    if (cached == responseCache.end())
     {
-        if (electrodesPSTH[electrodeIndex].electrodeID == electrodeID)
-        {
-            for (int entryindex = 0; entryindex < electrodesPSTH[electrodeIndex].unitsPSTHs.size(); entryindex++)
-            {
-                if (electrodesPSTH[electrodeIndex].unitsPSTHs[entryindex].unitID == unitID)
-                {
-                    // great. we found our unit.
-                    // now iterate over trial and build the matrix.
-                    numTrialTypes = electrodesPSTH[electrodeIndex].unitsPSTHs[entryindex].trialPSTHs.size();
-                    if (numTrialTypes == 0)
-                        return avgResponseMatrix;
+        CachedResponse response;
 
-                    int xminIndex = -1,xmaxIndex=-1;
-                    for (int t=0; t<electrodesPSTH[electrodeIndex].unitsPSTHs[entryindex].trialPSTHs[0].binTime.size(); t++)
-                    {
-                        if (electrodesPSTH[electrodeIndex].unitsPSTHs[entryindex].trialPSTHs[0].binTime[t] >= xmin && xminIndex == -1)
-                        {
-                            xminIndex = t;
-                        }
-                        if (electrodesPSTH[electrodeIndex].unitsPSTHs[entryindex].trialPSTHs[0].binTime[t] >= xmax && xmaxIndex == -1)
-                        {
-                            xmaxIndex = t;
-                        }
+        std::vector<float> smoothKernel;
+        if (smoothMS > 0)
+            smoothKernel = buildSmoothKernel(smoothMS, 1.0);
 
-                    }
-                    // constrain output to be between [xminIndex,xmaxIndex]
-                    if (xmaxIndex-xminIndex < 10)
-                        return avgResponseMatrix; // no point displaying an image with less than 10 pixels ?
+        const ScopedLock myScopedLock(psthMutex);
 
-                    numTrialRepeats.resize(numTrialTypes);
+        std::vector<PSTH>* trialPSTHs = nullptr;
 
-                    x_time.resize(xmaxIndex-xminIndex+1);
-                    for (int t=0; t<xmaxIndex-xminIndex+1; t++)
+        for (int electrodeIndex=0; electrodeIndex<electrodesPSTH.size() && trialPSTHs == nullptr; electrodeIndex++)
+        {
+            if (electrodesPSTH[electrodeIndex].electrodeID != electrodeID)
+                continue;
+
+            if (isChannel)
+            {
+                for (int entryindex = 0; entryindex < electrodesPSTH[electrodeIndex].channelsPSTHs.size(); entryindex++)
+                {
+                    if (electrodesPSTH[electrodeIndex].channelsPSTHs[entryindex].channelID == id)
                     {
-                        x_time[t] = electrodesPSTH[electrodeIndex].unitsPSTHs[entryindex].trialPSTHs[0].binTime[xminIndex+t];
+                        trialPSTHs = &electrodesPSTH[electrodeIndex].channelsPSTHs[entryindex].trialPSTHs;
+                        break;
                     }
-
-                    avgResponseMatrix.resize(numTrialTypes);
-                    int numTimePoints = x_time.size();
-                    for (int trialIter = 0; trialIter < numTrialTypes; trialIter++)
+                }
+            }
+            else
+            {
+                for (int entryindex = 0; entryindex < electrodesPSTH[electrodeIndex].unitsPSTHs.size(); entryindex++)
+                {
+                    if (electrodesPSTH[electrodeIndex].unitsPSTHs[entryindex].unitID == id)
                     {
-                        numTrialRepeats[trialIter] = electrodesPSTH[electrodeIndex].unitsPSTHs[entryindex].trialPSTHs[trialIter].numTrials;
-                        if (numTrialRepeats[trialIter] == 0)
-                        {
-                            avgResponseMatrix[trialIter].resize(numTimePoints);
-                            for (int q=0; q<numTimePoints; q++)
-                                avgResponseMatrix[trialIter][q] = 0;
-                        }
-                        else
-                        {
-
-                            if (smoothMS > 0)
-                                avgResponseMatrix[trialIter] = smooth(electrodesPSTH[electrodeIndex].unitsPSTHs[entryindex].trialPSTHs[trialIter].getAverageTrialResponse(), smoothKernel,xminIndex,xmaxIndex);
-                            else
-                                avgResponseMatrix[trialIter] = electrodesPSTH[electrodeIndex].unitsPSTHs[entryindex].trialPSTHs[trialIter].getAverageTrialResponse();
-                        }
-
+                        trialPSTHs = &electrodesPSTH[electrodeIndex].unitsPSTHs[entryindex].trialPSTHs;
+                        break;
                     }
-
-                    //unlockConditions();
-                    //unlockPSTH();
-                    return avgResponseMatrix;
-
                 }
             }
         }
-    }
-    //unlockConditions();
-    //unlockPSTH();
-    return avgResponseMatrix;
-}
 
+        response.numTrialTypes = 0;
 
+        if (trialPSTHs != nullptr)
+            buildAverageResponseMatrix(*trialPSTHs, smoothKernel, xmin, xmax, response);
 
+        cached = responseCache.insert(std::make_pair(key, response)).first;
+    }
 
-// Builds average raster matrix.
-// each line corresponds to a trial type, and contains the average response for that trial type.
-// each column corresponds to a specific time point, returned by x_time
-// the number of trial types is returned, as well as the number of repetitions of each individual trial type.
-// constrain output to be between xmin & xmax (approximately).
-std::vector<std::vector<float>> TrialCircularBuffer::getTrialsAverageChannelResponse(int electrodeID, int channelID,
-                             std::vector<float>& x_time, int& numTrialTypes, std::vector<int>& numTrialRepeats, double smoothMS, float xmin, float xmax)
-{
-    // allocate a matrix with average trial responses (not conditions!)
-    std::vector<std::vector<float>> avgResponseMatrix;
-    avgResponseMatrix.clear();
-    x_time.clear();
-    numTrialRepeats.clear();
-    numTrialTypes = 0;
+    x_time = cached->second.x_time;
+    numTrialTypes = cached->second.numTrialTypes;
+    numTrialRepeats = cached->second.numTrialRepeats;
 
-    std::vector<float> smoothKernel;
-    if (smoothMS > 0)
-        smoothKernel = buildSmoothKernel(smoothMS, 1.0);
+    return cached->second.avgResponseMatrix;
+}
 
-    const ScopedLock myScopedLock(psthMutex);
-    //const ScopedLock myScopedLock (conditionMutex);
+void TrialCircularBuffer::buildAverageResponseMatrix(std::vector<PSTH>& trialPSTHs, const std::vector<float>& smoothKernel,
+                                                     float xmin, float xmax, CachedResponse& response)
+{
+    // now iterate over trial and build the matrix.
+    response.numTrialTypes = trialPSTHs.size();
+    if (response.numTrialTypes == 0)
+        return;
 
-    //lockPSTH();
-    //lockConditions();
-    //bool fisrtTime = true;
-    for (int electrodeIndex=0; electrodeIndex<electrodesPSTH.size(); electrodeIndex++)
+    int xminIndex = -1,xmaxIndex=-1;
+    for (int t=0; t<trialPSTHs[0].binTime.size(); t++)
     {
-        if (electrodesPSTH[electrodeIndex].electrodeID == electrodeID)
+        if (trialPSTHs[0].binTime[t] >= xmin && xminIndex == -1)
         {
-            for (int entryindex = 0; entryindex < electrodesPSTH[electrodeIndex].channelsPSTHs.size(); entryindex++)
-            {
-                if (electrodesPSTH[electrodeIndex].channelsPSTHs[entryindex].channelID == channelID)
-                {
-                    // great. we found our unit.
-                    // now iterate over trial and build the matrix.
-                    numTrialTypes = electrodesPSTH[electrodeIndex].channelsPSTHs[entryindex].trialPSTHs.size();
-                    if (numTrialTypes == 0)
-                        return avgResponseMatrix;
-
-                    int xminIndex = -1,xmaxIndex=-1;
-                    for (int t=0; t<electrodesPSTH[electrodeIndex].channelsPSTHs[entryindex].trialPSTHs[0].binTime.size(); t++)
-                    {
-                        if (electrodesPSTH[electrodeIndex].channelsPSTHs[entryindex].trialPSTHs[0].binTime[t] >= xmin && xminIndex == -1)
-                        {
-                            xminIndex = t;
-                        }
-                        if (electrodesPSTH[electrodeIndex].channelsPSTHs[entryindex].trialPSTHs[0].binTime[t] >= xmax && xmaxIndex == -1)
-                        {
-                            xmaxIndex = t;
-                        }
-
-                    }
-                    // constrain output to be between [xminIndex,xmaxIndex]
-                    if (xmaxIndex-xminIndex < 10)
-                        return avgResponseMatrix; // no point displaying an image with less than 10 pixels ?
-
-                    numTrialRepeats.resize(numTrialTypes);
+            xminIndex = t;
+        }
+        if (trialPSTHs[0].binTime[t] >= xmax && xmaxIndex == -1)
+        {
+            xmaxIndex = t;
+        }
 
-                    x_time.resize(xmaxIndex-xminIndex+1);
-                    for (int t=0; t<xmaxIndex-xminIndex+1; t++)
-                    {
-                        x_time[t] = electrodesPSTH[electrodeIndex].channelsPSTHs[entryindex].trialPSTHs[0].binTime[xminIndex+t];
-                    }
+    }
+    // constrain output to be between [xminIndex,xmaxIndex]
+    if (xmaxIndex-xminIndex < 10)
+        return; // no point displaying an image with less than 10 pixels ?
 
-                    avgResponseMatrix.resize(numTrialTypes);
-                    int numTimePoints = x_time.size();
-                    for (int trialIter = 0; trialIter < numTrialTypes; trialIter++)
-                    {
-                        numTrialRepeats[trialIter] = electrodesPSTH[electrodeIndex].channelsPSTHs[entryindex].trialPSTHs[trialIter].numTrials;
-                        if (numTrialRepeats[trialIter] == 0)
-                        {
-                            avgResponseMatrix[trialIter].resize(numTimePoints);
-                            for (int q=0; q<numTimePoints; q++)
-                                avgResponseMatrix[trialIter][q] = 0;
-                        }
-                        else
-                        {
-
-                            if (smoothMS > 0)
-                                avgResponseMatrix[trialIter] = smooth(electrodesPSTH[electrodeIndex].channelsPSTHs[entryindex].trialPSTHs[trialIter].getAverageTrialResponse(), smoothKernel,xminIndex,xmaxIndex);
-                            else
-                                avgResponseMatrix[trialIter] = electrodesPSTH[electrodeIndex].channelsPSTHs[entryindex].trialPSTHs[trialIter].getAverageTrialResponse();
-                        }
+    response.numTrialRepeats.resize(response.numTrialTypes);
 
-                    }
-
-                    //unlockConditions();
-                    //unlockPSTH();
-                    return avgResponseMatrix;
+    response.x_time.resize(xmaxIndex-xminIndex+1);
+    for (int t=0; t<xmaxIndex-xminIndex+1; t++)
+    {
+        response.x_time[t] = trialPSTHs[0].binTime[xminIndex+t];
+    }
 
-                }
-            }
+    response.avgResponseMatrix.resize(response.numTrialTypes);
+    int numTimePoints = response.x_time.size();
+    for (int trialIter = 0; trialIter < response.numTrialTypes; trialIter++)
+    {
+        response.numTrialRepeats[trialIter] = trialPSTHs[trialIter].numTrials;
+        if (response.numTrialRepeats[trialIter] == 0)
+        {
+            response.avgResponseMatrix[trialIter].assign(numTimePoints, 0.0f);
+        }
+        else
+        {
+            // an empty kernel only crops the response to [xminIndex,xmaxIndex]
+            smoother.smooth(trialPSTHs[trialIter].getAverageTrialResponse(), smoothKernel, xminIndex, xmaxIndex,
+                            response.avgResponseMatrix[trialIter]);
         }
     }
-    //unlockConditions();
-    //unlockPSTH();
-    return avgResponseMatrix;
 }
+
 const uint8 jet_colors_64[64][3] =
 {
     {0,0,143},
@@ -3153,8 +3131,10 @@ int TrialCircularBuffer::getNumTrialsInUnit(int electrodeID, int unitID)
     return 0;
 }
 
-juce::Image TrialCircularBuffer::getTrialsAverageResponseAsJuceImage(int  ymin, int ymax,	std::vector<float> x_time,	int numTrialTypes,	std::vector<int> numTrialRepeats,	std::vector<std::vector<float>> trialResponseMatrix, float& maxValue)
+juce::Image TrialCircularBuffer::getTrialsAverageResponseAsJuceImage(int  ymin, int ymax,	const std::vector<float>& x_time,	int numTrialTypes,	const std::vector<int>& numTrialRepeats,	const std::vector<std::vector<float>>& trialResponseMatrix, float& maxValue)
 {
+    maxValue = 0;
+
     if (trialResponseMatrix.size() == 0)
     {
         int imageWidth = 200, imageHeight = 200;
@@ -3184,8 +3164,7 @@ juce::Image TrialCircularBuffer::getTrialsAverageResponseAsJuceImage(int  ymin,
     if (maxValue < 1e-5)
         return I;
 
-    uint8* ptr = bitmap.data;
-
+    const float scale = (maxValue > minValue) ? 63.0f / (maxValue-minValue) : 0.0f;
 
     for (int i=0; i<imageHeight; i++)
     {
@@ -3197,17 +3176,20 @@ juce::Image TrialCircularBuffer::getTrialsAverageResponseAsJuceImage(int  ymin,
         }
         else
         {
-            for (int j=0; j<imageWidth; j++)
+            const int rowWidth = jmin(imageWidth, (int) trialResponseMatrix[ymin+i].size());
+            const float* row = rowWidth > 0 ? &trialResponseMatrix[ymin+i][0] : nullptr;
+            uint8* pixel = bitmap.getLinePointer(i);
+
+            for (int j=0; j<rowWidth; j++, pixel += bitmap.pixelStride)
             {
-                float normalizedValue = (trialResponseMatrix[ymin+i][j]-minValue) / (maxValue-minValue);
-                if (normalizedValue > 1)
-                    normalizedValue = 1.0;
-                int jetIndex = (int)(normalizedValue*63) % 64;
+                int jetIndex = (int)((row[j]-minValue) * scale);
+                if (jetIndex > 63)
+                    jetIndex = 63;
                 // convert to a nice Jet RGB value.
                 // just take the closest value...
-                ptr[i * bitmap.lineStride + j * bitmap.pixelStride + 0] = jet_colors_64[jetIndex][2];
-                ptr[i * bitmap.lineStride + j * bitmap.pixelStride + 1] = jet_colors_64[jetIndex][1];
-                ptr[i * bitmap.lineStride + j * bitmap.pixelStride + 2] = jet_colors_64[jetIndex][0];
+                pixel[0] = jet_colors_64[jetIndex][2];
+                pixel[1] = jet_colors_64[jetIndex][1];
+                pixel[2] = jet_colors_64[jetIndex][0];
             }
         }
     }
@@ -3218,20 +3200,48 @@ juce::Image TrialCircularBuffer::getTrialsAverageResponseAsJuceImage(int  ymin,
 
 juce::Image TrialCircularBuffer::getTrialsAverageChannelResponseAsJuceImage(int electrodeID, int channelID, float guassianStandardDeviationMS, float xmin, float xmax, int ymin, int ymax, float& maxValue)
 {
-    std::vector<float> x_time;
-    int numTrialTypes;
-    std::vector<int> numTrialRepeats;
-    std::vector<std::vector<float>> trialResponseMatrix = getTrialsAverageChannelResponse(electrodeID, channelID, x_time, numTrialTypes, numTrialRepeats,guassianStandardDeviationMS,xmin, xmax);
-    return getTrialsAverageResponseAsJuceImage(ymin,ymax,x_time,	numTrialTypes,	numTrialRepeats,	trialResponseMatrix, maxValue);
+    return getTrialsAverageResponseAsJuceImage(electrodeID, channelID, true, guassianStandardDeviationMS, xmin, xmax, ymin, ymax, maxValue);
 }
 
 juce::Image TrialCircularBuffer::getTrialsAverageUnitResponseAsJuceImage(int electrodeID, int unitID, float guassianStandardDeviationMS, float xmin, float xmax, int ymin, int ymax, float& maxValue)
 {
-    std::vector<float> x_time;
-    int numTrialTypes;
-    std::vector<int> numTrialRepeats;
-    std::vector<std::vector<float>> trialResponseMatrix = getTrialsAverageUnitResponse(electrodeID, unitID, x_time, numTrialTypes, numTrialRepeats,guassianStandardDeviationMS,xmin, xmax);
-    return getTrialsAverageResponseAsJuceImage(ymin,ymax,x_time,	numTrialTypes,	numTrialRepeats,	trialResponseMatrix, maxValue);
+    return getTrialsAverageResponseAsJuceImage(electrodeID, unitID, false, guassianStandardDeviationMS, xmin, xmax, ymin, ymax, maxValue);
+}
+
+juce::Image TrialCircularBuffer::getTrialsAverageResponseAsJuceImage(int electrodeID, int id, bool isChannel, float guassianStandardDeviationMS,
+                                                                     float xmin, float xmax, int ymin, int ymax, float& maxValue)
+{
+    // images are only rebuilt when new trials arrived or the view changed
+    const ScopedLock cacheScopedLock(cacheLock);
+    validateResponseCache();
+
+    ResponseCacheKey key;
+    key.electrodeID = electrodeID;
+    key.id = id;
+    key.isChannel = isChannel;
+    key.smoothMS = guassianStandardDeviationMS;
+    key.xmin = xmin;
+    key.xmax = xmax;
+    key.ymin = ymin;
+    key.ymax = ymax;
+
+    std::map<ResponseCacheKey, CachedImage>::iterator cached = imageCache.find(key);
+
+    if (cached == imageCache.end())
+    {
+        std::vector<float> x_time;
+        int numTrialTypes;
+        std::vector<int> numTrialRepeats;
+        std::vector<std::vector<float>> trialResponseMatrix = getTrialsAverageResponse(electrodeID, id, isChannel, x_time, numTrialTypes, numTrialRepeats,guassianStandardDeviationMS,xmin, xmax);
+
+        CachedImage entry;
+        entry.image = getTrialsAverageResponseAsJuceImage(ymin,ymax,x_time,	numTrialTypes,	numTrialRepeats,	trialResponseMatrix, entry.maxValue);
+
+        cached = imageCache.insert(std::make_pair(key, entry)).first;
+    }
+
+    maxValue = cached->second.maxValue;
+    return cached->second.image;
 }
 
 
@@ -3257,7 +3267,7 @@ void TrialCircularBuffer::process(AudioSampleBuffer& buffer, int nSamples, int64
     // for oscilloscope purposes, it is easier to reconstruct TTL changes to "continuous" form.
     if (params.reconstructTTL)
     {
-        std::vector<std::vector<bool>> reconstructedTTLs = reconstructTTLchannels(hardware_timestamp,nSamples);
+        reconstructTTLchannels(hardware_timestamp,nSamples);
         ttlBuffer->update(reconstructedTTLs,hardware_timestamp,software_timestamp,nSamples);
     }
     tictoc.Toc(2);
@@ -3276,23 +3286,17 @@ void TrialCircularBuffer::process(AudioSampleBuffer& buffer, int nSamples, int64
 
     if (electrodesPSTH.size() > 0 && aliveTrials.size() > 0)
     {
-        //printf("Entering alive loop\n");
+        // trials are queued in the order they end; collect all those that have
+        // enough post-trial data and update the statistics with them at once
+        finishedTrials.clear();
 
-        //std::cout << "Hardware timestamp: " << hardware_timestamp << std::endl;
-        //std::cout << "Software timestamp: " << software_timestamp << std::endl;
-
-        for (int k = 0; k < aliveTrials.size(); k++)
+        while (aliveTrials.size() > 0)
         {
-            Trial topTrial = aliveTrials.front();
-            //int64 ticksElapsed = software_timestamp - topTrial.endTS;
-            //std::cout << "Ticks elapsed: " << ticksElapsed << std::endl;
-            //float timeElapsedSec = float(ticksElapsed)/ numTicksPerSecond;
-            //std::cout << "Time elapsed: " << timeElapsedSec << std::endl;
+            const Trial& topTrial = aliveTrials.front();
             bool trialEndedAndEnoughDataInBuffer;
 
             if (!topTrial.hardwareAlignment)
             {
-                //trialEndedAndEnoughDataInBuffer = timeElapsedSec > params.postSec + 0.1;
                 trialEndedAndEnoughDataInBuffer = software_timestamp > topTrial.alignTS + (params.postSec + 0.1)*numTicksPerSecond;
             }
             else
@@ -3301,30 +3305,20 @@ void TrialCircularBuffer::process(AudioSampleBuffer& buffer, int nSamples, int64
                 trialEndedAndEnoughDataInBuffer = hardware_timestamp+nSamples > topTrial.alignTS_hardware+ (params.postSec + 0.1)*params.sampleRate;
             }
 
-            if (trialEndedAndEnoughDataInBuffer)
-            {
-                aliveTrials.pop();
-                lastTrialID = topTrial.trialID;
-                //printf("Entering updatePSTHwithTrial\n");
-                tictoc.Tic(4);
-
-                //std::cout << "Updating PSTH" << std::endl;
-                updatePSTHwithTrial(&topTrial);
-
-                tictoc.Toc(4);
-                //printf("Exiting updatePSTHwithTrial\n");
-            }
-
-            //long endTime = t.getHighResolutionTicks();
-
-            //std::cout << "End time: " << endTime << std::endl;
-
-            //	if  ((endTime-startTime) > MaxPSTHprocessingTime*t.getHighResolutionTicksPerSecond())
-            //break;
+            if (!trialEndedAndEnoughDataInBuffer)
+                break;
 
+            lastTrialID = topTrial.trialID;
+            finishedTrials.push_back(topTrial);
+            aliveTrials.pop();
+        }
 
+        if (finishedTrials.size() > 0)
+        {
+            tictoc.Tic(4);
+            updatePSTHwithTrials(finishedTrials);
+            tictoc.Toc(4);
         }
-        //printf("Exiting alive loop\n");
     }
     tictoc.Toc(3);
 
@@ -3333,8 +3327,8 @@ void TrialCircularBuffer::process(AudioSampleBuffer& buffer, int nSamples, int64
 }
 
 
-TrialCircularBufferThread::TrialCircularBufferThread(TrialCircularBuffer* tcb_,  std::vector<int>* conditions, Trial* trial_, int jobID_, int jobType_, int electrodeID_, int subID_) : ThreadPoolJob("Job "+String(jobID)),
-    tcb(tcb_), trial(trial_), conditionsNeedUpdate(conditions), jobID(jobID_), jobType(jobType_), electrodeID(electrodeID_), subID(subID_)
+TrialCircularBufferThread::TrialCircularBufferThread(TrialCircularBuffer* tcb_, int jobID_, int jobType_, int electrodeID_, int subID_) : ThreadPoolJob("Job "+String(jobID_)),
+    tcb(tcb_), jobID(jobID_), jobType(jobType_), electrodeID(electrodeID_), subID(subID_)
 {
 
 }
@@ -3343,11 +3337,11 @@ juce::ThreadPoolJob::JobStatus TrialCircularBufferThread::runJob()
 {
     if (jobType == 0)
     {
-        tcb->updateLFPwithTrial(electrodeID,conditionsNeedUpdate,trial);
+        tcb->updateLFPwithTrials(electrodeID);
     }
     else if (jobType == 1)
     {
-        tcb->updateSpikeswithTrial(electrodeID,subID,conditionsNeedUpdate,trial);
+        tcb->updateSpikeswithTrials(electrodeID,subID);
     }
     return jobHasFinished;
 }
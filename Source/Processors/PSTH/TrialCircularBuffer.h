@@ -30,10 +30,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../Visualization/MatlabLikePlot.h"
 #include "../SpikeSorter/SpikeSorter.h"
 #include "../NetworkEvents/NetworkEvents.h"
+#include "ResponseSmoother.h"
 #include <algorithm>
 #include <queue>
 #include <vector>
 #include <list>
+#include <map>
 class Electrode;
 
 #define TTL_TRIAL_OFFSET 30000
@@ -65,6 +67,9 @@ public:
     bool buildTrialsPSTH;
     bool reconstructTTL;
     bool approximate;
+    // step and offset of each LFP channel, if its history is held as int16
+    std::vector<float> bitVolts;
+    std::vector<float> offsetVolts;
 };
 
 class Condition
@@ -102,22 +107,35 @@ public:
     bool hardwareAlignment;
 };
 
+/**
+  Spike times of one unit, and the IDs of the trials that started while
+  they were recorded.
+
+  Both rings are kept sorted (spikes by software timestamp, trials by ID),
+  so the spikes around a trial are found with a binary search followed by
+  a scan of just the spikes in the window, i.e. O(log n + k).
+*/
 class SmartSpikeCircularBuffer
 {
 public:
     SmartSpikeCircularBuffer(float maxTrialTimeSeconds, int maxTrialsInMemory, int _sampleRateHz);
-    // contains spike times, but also pointers for trial onsets so we don't need to search
-    // the entire array
     void addSpikeToBuffer(int64 spikeTimeSoftware,int64 spikeTimeHardware);
     std::vector<int64> getAlignedSpikes(Trial* trial, float preSecs, float postSecs);
     void addTrialStartToBuffer(Trial* t);
 
-    int queryTrialStart(int trialID);
+    /** Returns true if the start of the trial is still in memory. */
+    bool containsTrial(int trialID);
 private:
+    /** Position in the ring of the k-th oldest spike (or trial). */
+    int getSpikeIndex(int k) const;
+    int getTrialIndex(int k) const;
+
+    /** Returns the age rank (0 = oldest) of the first spike at or after ts. */
+    int findFirstSpikeAtOrAfter(int64 ts) const;
+
     std::vector<int64> spikeTimesSoftware;
     std::vector<int64> spikeTimesHardware;
     std::vector<int> trialID;
-    std::vector<int> pointers;
     int maxTrialsInMemory;
     int bufferSize;
     int bufferIndex;
@@ -162,7 +180,7 @@ public:
     double getDx();
     void clear();
     void updatePSTH(SmartSpikeCircularBuffer* spikeBuffer, Trial* trial);
-    void updatePSTH(std::vector<float> alignedLFP,std::vector<bool> valid);
+    void updatePSTH(const std::vector<float>& alignedLFP, const std::vector<bool>& valid);
 
     std::vector<float> getAverageTrialResponse();
     std::vector<float> getLastTrial();
@@ -222,7 +240,7 @@ class ChannelPSTHs
 {
 public:
     ChannelPSTHs(int channelID, TrialCircularBufferParams params);
-    void updateConditionsWithLFP(std::vector<int> conditionsNeedUpdating, std::vector<float> lfpData, std::vector<bool> valid, Trial* trial);
+    void updateConditionsWithLFP(const std::vector<int>& conditionsNeedUpdating, const std::vector<float>& lfpData, const std::vector<bool>& valid, Trial* trial);
     void clearStatistics();
     void getRange(float& xmin, float& xmax, float& ymin, float& ymax);
     bool isNewDataAvailable();
@@ -255,7 +273,7 @@ public:
     ElectrodePSTH();
     ElectrodePSTH(int ID, String name);
     ~ElectrodePSTH();
-    void updateChannelsConditionsWithLFP(std::vector<int> conditionsNeedUpdate, Trial* trial, SmartContinuousCircularBuffer* lfpBuffer);
+    void updateChannelsConditionsWithLFP(const std::vector<int>& conditionsNeedUpdate, Trial* trial, SmartContinuousCircularBuffer* lfpBuffer);
     void UpdateChannelConditionWithLFP(int ch, std::vector<int>* conditionsNeedUpdate, Trial* trial, std::vector<float>* alignedLFP,std::vector<bool>* valid);
     int electrodeID;
     String electrodeName;
@@ -295,13 +313,15 @@ public:
     TrialCircularBuffer();
     TrialCircularBuffer(TrialCircularBufferParams param_);
     ~TrialCircularBuffer();
-    void updatePSTHwithTrial(Trial* trial);
+    /** Adds a batch of finished trials to the statistics of the conditions they match. */
+    void updatePSTHwithTrials(std::vector<Trial>& trials);
     bool contains(std::vector<int> v, int x);
     void toggleConditionVisibility(int cond);
     void modifyConditionVisibility(int cond, bool newstate);
     void modifyConditionVisibilityusingConditionID(int condID, bool newstate);
     bool parseMessage(StringTS s);
     void addSpikeToSpikeBuffer(SpikeObject newSpike);
+    void addSpikeToSpikeBuffer(int electrodeID, int sortedId, int64 timestampSoftware, int64 timestampHardware);
     void process(AudioSampleBuffer& buffer,int nSamples,int64 hardware_timestamp,int64 software_timestamp);
     void simulateHardwareTrial(int64 ttl_timestamp_software,int64 ttl_timestamp_hardware, int trialType, float lengthSec);
     //void simulateTrial(int64 ttl_timestamp_software, int trialType, float lengthSec);
@@ -317,7 +337,8 @@ public:
     void simulateTTLtrial(int channel, int64 ttl_timestamp_software);
     void clearDesign();
     void clearAll();
-    std::vector<std::vector<bool>>  reconstructTTLchannels(int64 hardware_timestamp,int nSamples);
+    /** Fills reconstructedTTLs with the state of every TTL channel at each sample */
+    void reconstructTTLchannels(int64 hardware_timestamp,int nSamples);
     void channelChange(int electrodeID, int channelindex, int newchannel);
     void syncInternalDataStructuresWithSpikeSorter(Array<Electrode*> electrodes);
     void addNewElectrode(Electrode* electrode);
@@ -369,19 +390,60 @@ public:
     int getLastTrialID();
     int getNumberAliveTrials();
 
-    // thread job functions
-    void updateLFPwithTrial(int electrodeIndex, std::vector<int>* conditionsNeedUpdate, Trial* trial);
-    void updateSpikeswithTrial(int electrodeIndex, int unitIndex, std::vector<int>* conditionsNeedUpdate, Trial* trial);
+    // thread job functions (update one electrode or unit with the current batch)
+    void updateLFPwithTrials(int electrodeIndex);
+    void updateSpikeswithTrials(int electrodeIndex, int unitIndex);
+
+    /** Incremented whenever the statistics change, so that the display only
+        redraws when there is something new to show. */
+    int getStatisticsVersion();
 
     CriticalSection psthMutex;//conditionMutex
 private:
     bool useThreads;
     std::vector<int> dropOutcomes;
 
-    juce::Image getTrialsAverageResponseAsJuceImage(int  ymin, int ymax,	std::vector<float> x_time,	int numTrialTypes,
-                                                    std::vector<int> numTrialRepeats,	std::vector<std::vector<float>> trialResponseMatrix, float& maxValue);
-
-    std::vector<float> smooth(std::vector<float> y, std::vector<float> smoothKernel, int xmin, int xmax);
+    /** A smoothed response matrix or raster image; ymin and ymax are -1 for matrices */
+    struct ResponseCacheKey
+    {
+        int electrodeID, id;
+        bool isChannel;
+        float smoothMS, xmin, xmax;
+        int ymin, ymax;
+        bool operator< (const ResponseCacheKey& other) const;
+    };
+
+    struct CachedResponse
+    {
+        std::vector<float> x_time;
+        int numTrialTypes;
+        std::vector<int> numTrialRepeats;
+        std::vector<std::vector<float>> avgResponseMatrix;
+    };
+
+    struct CachedImage
+    {
+        juce::Image image;
+        float maxValue;
+    };
+
+    enum { MAX_CACHED_RESPONSES = 1024 };
+
+    /** Empties the caches if the statistics changed since they were filled. */
+    void validateResponseCache();
+
+    std::vector<std::vector<float>> getTrialsAverageResponse(int electrodeID, int id, bool isChannel,
+                                                             std::vector<float>& x_time, int& numTrialTypes,
+                                                             std::vector<int>& numTrialRepeats, double smoothMS, float xmin, float xmax);
+    void buildAverageResponseMatrix(std::vector<PSTH>& trialPSTHs, const std::vector<float>& smoothKernel,
+                                    float xmin, float xmax, CachedResponse& response);
+
+    juce::Image getTrialsAverageResponseAsJuceImage(int electrodeID, int id, bool isChannel, float guassianStandardDeviationMS,
+                                                    float xmin, float xmax, int ymin, int ymax, float& maxValue);
+    juce::Image getTrialsAverageResponseAsJuceImage(int  ymin, int ymax,	const std::vector<float>& x_time,	int numTrialTypes,
+                                                    const std::vector<int>& numTrialRepeats,	const std::vector<std::vector<float>>& trialResponseMatrix, float& maxValue);
+
+    std::vector<float> smooth(const std::vector<float>& y, const std::vector<float>& smoothKernel, int xmin, int xmax);
 
     bool firstTime;
     int lastTrialID;
@@ -397,23 +459,35 @@ private:
     std::vector<int64> lastTTLts;
     std::vector<bool> ttlChannelStatus;
     std::queue<Trial> aliveTrials;
+    std::vector<Trial> finishedTrials;
+    /** The trials being added by updatePSTHwithTrials(), and the conditions each one updates */
+    std::vector<Trial> batchTrials;
+    std::vector<std::vector<int> > batchConditions;
     std::vector<Condition> conditions;
     std::vector<ElectrodePSTH> electrodesPSTH;
     ScopedPointer<SmartContinuousCircularBuffer> lfpBuffer;
     ScopedPointer<SmartContinuousCircularBuffer> ttlBuffer;
     std::queue<ttlStatus> ttlQueue;
+    /** Kept between blocks, so it only allocates when a longer block arrives */
+    std::vector<std::vector<bool> > reconstructedTTLs;
     TrialCircularBufferParams params;
     ScopedPointer<ThreadPool> threadpool;
+    Atomic<int> statisticsVersion;
+
+    /** Smoothed responses and images of the current statistics version (UI thread) */
+    CriticalSection cacheLock;
+    ResponseSmoother smoother;
+    std::map<ResponseCacheKey, CachedResponse> responseCache;
+    std::map<ResponseCacheKey, CachedImage> imageCache;
+    int cacheVersion;
 };
 
 class TrialCircularBufferThread : public ThreadPoolJob
 {
 public:
-    TrialCircularBufferThread(TrialCircularBuffer* tcb_, std::vector<int>* conditions, Trial* trial_, int jobID_, int jobType_, int electrodeID_, int subID_);
+    TrialCircularBufferThread(TrialCircularBuffer* tcb_, int jobID_, int jobType_, int electrodeID_, int subID_);
     JobStatus runJob();
     TrialCircularBuffer* tcb;
-    Trial* trial;
-    std::vector<int>* conditionsNeedUpdate;
     int jobID;
     int jobType;
     int electrodeID;
@@ -215,8 +215,8 @@ void ParameterEditor::buttonClicked(Button* button)
             {
                 //std::cout << a[i] << " ";
                 processor->setCurrentChannel(a[i]);
-                processor->setParameter(button->getName().getIntValue(),
-                                        button->getButtonText().getFloatValue());
+                processor->queueParameterChange(button->getName().getIntValue(),
+                                                button->getButtonText().getFloatValue());
                 //processor->
             }
             //std::cout << std::endl;
@@ -243,8 +243,8 @@ void ParameterEditor::sliderValueChanged(Slider* slider)
             {
                 //std::cout << a[i] << " ";
                 processor->setCurrentChannel(a[i]);
-                processor->setParameter(slider->getName().getIntValue(),
-                                        slider->getValue());
+                processor->queueParameterChange(slider->getName().getIntValue(),
+                                                slider->getValue());
                 //processor->
             }
             //std::cout << std::endl;
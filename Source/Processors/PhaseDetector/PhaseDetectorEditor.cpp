@@ -317,7 +317,7 @@ void DetectorInterface::comboBoxChanged(ComboBox* c)
     }
 
 
-    processor->setParameter(parameterIndex, (float) c->getSelectedId() - 2);
+    processor->queueParameterChange(parameterIndex, (float) c->getSelectedId() - 2);
 
 }
 
@@ -330,7 +330,7 @@ void DetectorInterface::buttonClicked(Button* b)
 
     processor->setActiveModule(idNum);
 
-    processor->setParameter(1, (float) i+1);
+    processor->queueParameterChange(1, (float) i+1);
 
 }
 
@@ -391,7 +391,7 @@ void DetectorInterface::setPhase(int p)
 
     processor->setActiveModule(idNum);
 
-    processor->setParameter(1, (float) p+1);
+    processor->queueParameterChange(1, (float) p+1);
 
 }
 
@@ -399,21 +399,21 @@ void DetectorInterface::setInputChan(int chan)
 {
     inputSelector->setSelectedId(chan+2);
 
-    processor->setParameter(2, (float) chan);
+    processor->queueParameterChange(2, (float) chan);
 }
 
 void DetectorInterface::setOutputChan(int chan)
 {
     outputSelector->setSelectedId(chan+2);
 
-    processor->setParameter(3, (float) chan);
+    processor->queueParameterChange(3, (float) chan);
 }
 
 void DetectorInterface::setGateChan(int chan)
 {
     gateSelector->setSelectedId(chan+2);
 
-    processor->setParameter(4, (float) chan);
+    processor->queueParameterChange(4, (float) chan);
 }
 
 int DetectorInterface::getInputChan()
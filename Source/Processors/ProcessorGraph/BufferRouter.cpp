@@ -0,0 +1,542 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "BufferRouter.h"
+#include "../Channel/Channel.h"
+
+#define MIDI_BUFFER_BYTES 8192
+
+BufferRouter::BufferRouter()
+    : outputNode(-1), numConnections(0), numSlots(0), zeroSlot(0), blockSize(0),
+      buildTimeMs(0), numBlocks(0), bytesCopied(0), bytesCleared(0)
+{
+}
+
+BufferRouter::~BufferRouter()
+{
+}
+
+int BufferRouter::indexOf(AudioProcessor* processor)
+{
+    for (int i = 0; i < nodes.size(); i++)
+        if (nodes[i]->processor == processor)
+            return i;
+
+    return -1;
+}
+
+int BufferRouter::addNode(AudioProcessor* processor, bool isTap, int numOwnedChannels)
+{
+    int index = indexOf(processor);
+
+    if (index < 0)
+    {
+        Node* node = new Node();
+        node->processor = processor;
+        node->numChannels = 0;
+        node->predecessor = node->successor = -1;
+        node->firstSlot = node->snapshotSlot = -1;
+        node->midiBuffer = -1;
+        node->mergesEvents = true;
+        node->viewSamples = -1;
+
+        index = nodes.size();
+        nodes.add(node);
+    }
+
+    nodes[index]->isTap = isTap;
+    nodes[index]->numOwnedChannels = numOwnedChannels;
+
+    return index;
+}
+
+void BufferRouter::addProcessor(AudioProcessor* processor)
+{
+    addNode(processor, false, 0);
+}
+
+void BufferRouter::addTap(AudioProcessor* processor, int numOwnedChannels)
+{
+    addNode(processor, true, numOwnedChannels);
+}
+
+void BufferRouter::setOutput(AudioProcessor* processor)
+{
+    outputNode = indexOf(processor);
+}
+
+bool BufferRouter::addConnection(AudioProcessor* source, int sourceChannel,
+                                 AudioProcessor* dest, int destChannel,
+                                 Channel* channel)
+{
+    const int s = indexOf(source);
+    const int d = indexOf(dest);
+
+    if (s < 0 || d < 0 || s == d
+        || sourceChannel < 0 || sourceChannel >= source->getNumOutputChannels()
+        || destChannel < 0 || destChannel >= dest->getNumInputChannels())
+        return false;
+
+    Array<Route>& inputs = nodes[d]->inputs;
+
+    for (int i = 0; i < inputs.size(); i++)
+        if (inputs[i].destChannel == destChannel)
+            return false; // the graph would mix them; the signal chain never asks for that
+
+    Route route;
+    route.source = s;
+    route.sourceChannel = sourceChannel;
+    route.destChannel = destChannel;
+    route.channel = channel;
+
+    inputs.add(route);
+    numConnections++;
+
+    return true;
+}
+
+void BufferRouter::addEventConnection(AudioProcessor* source, AudioProcessor* dest)
+{
+    const int s = indexOf(source);
+    const int d = indexOf(dest);
+
+    if (s < 0 || d < 0 || s == d)
+        return;
+
+    if (!nodes[d]->eventSources.contains(s))
+    {
+        nodes[d]->eventSources.add(s);
+        numConnections++;
+    }
+}
+
+int BufferRouter::getNumConnections() const
+{
+    return numConnections;
+}
+
+void BufferRouter::build()
+{
+    const int64 startTicks = Time::getHighResolutionTicks();
+
+    for (int i = 0; i < nodes.size(); i++)
+    {
+        Node* node = nodes[i];
+
+        node->numChannels = jmax(1, node->processor->getNumInputChannels(),
+                                 node->processor->getNumOutputChannels(), node->numOwnedChannels);
+        node->audioDests.clearQuick();
+        node->eventDests.clearQuick();
+        node->tappedChannels.clearQuick();
+        node->tappedChannelInfo.clearQuick();
+        node->predecessor = node->successor = -1;
+    }
+
+    for (int d = 0; d < nodes.size(); d++)
+    {
+        Node* dest = nodes[d];
+
+        for (int i = 0; i < dest->inputs.size(); i++)
+        {
+            const Route& route = dest->inputs.getReference(i);
+            Node* source = nodes[route.source];
+
+            if (!dest->isTap)
+            {
+                source->audioDests.addIfNotAlreadyThere(d);
+            }
+            else if (!source->tappedChannels.contains(route.sourceChannel))
+            {
+                source->tappedChannels.add(route.sourceChannel);
+                source->tappedChannelInfo.add(route.channel);
+            }
+        }
+
+        for (int i = 0; i < dest->eventSources.size(); i++)
+            nodes[dest->eventSources[i]]->eventDests.addIfNotAlreadyThere(d);
+    }
+
+    // dependency order, keeping the order the processors were added in where possible
+    order.clearQuick();
+
+    Array<bool> done;
+    done.insertMultiple(0, false, nodes.size());
+
+    for (bool progress = true; progress;)
+    {
+        progress = false;
+
+        for (int d = 0; d < nodes.size(); d++)
+        {
+            Node* node = nodes[d];
+
+            if (done[d] || node->isTap)
+                continue;
+
+            bool ready = true;
+
+            for (int i = 0; i < node->inputs.size() && ready; i++)
+                ready = done[node->inputs[i].source];
+
+            for (int i = 0; i < node->eventSources.size() && ready; i++)
+                ready = done[node->eventSources[i]];
+
+            if (ready)
+            {
+                order.add(d);
+                done.set(d, true);
+                progress = true;
+                break;
+            }
+        }
+    }
+
+    for (int d = 0; d < nodes.size(); d++)
+    {
+        if (!done[d] && !nodes[d]->isTap)
+        {
+            std::cout << "Buffer routing: the connections form a loop; running the rest in order." << std::endl;
+            order.add(d);
+        }
+    }
+
+    for (int d = 0; d < nodes.size(); d++)
+        if (nodes[d]->isTap)
+            order.add(d);
+
+    // buffers and event buffers that can be reused in place
+    int numMidiBuffers = 0;
+
+    for (int n = 0; n < order.size(); n++)
+    {
+        const int d = order[n];
+        Node* node = nodes[d];
+
+        if (node->isTap)
+        {
+            node->midiBuffer = numMidiBuffers++;
+            node->mergesEvents = false;
+            continue;
+        }
+
+        if (node->inputs.size() > 0)
+        {
+            const int s = node->inputs[0].source;
+            bool inPlace = !nodes[s]->isTap && nodes[s]->audioDests.size() == 1 && nodes[s]->successor < 0;
+
+            for (int i = 0; i < node->inputs.size() && inPlace; i++)
+                inPlace = node->inputs[i].source == s && node->inputs[i].destChannel == node->inputs[i].sourceChannel;
+
+            if (inPlace)
+            {
+                node->predecessor = s;
+                nodes[s]->successor = d;
+            }
+        }
+
+        int eventPredecessor = -1;
+
+        if (node->eventSources.size() == 1)
+        {
+            Node* source = nodes[node->eventSources[0]];
+            int numProcessorDests = 0;
+
+            for (int i = 0; i < source->eventDests.size(); i++)
+                if (!nodes[source->eventDests[i]]->isTap)
+                    numProcessorDests++;
+
+            if (!source->isTap && numProcessorDests == 1)
+                eventPredecessor = node->eventSources[0];
+        }
+
+        node->mergesEvents = eventPredecessor < 0;
+        node->midiBuffer = node->mergesEvents ? numMidiBuffers++ : nodes[eventPredecessor]->midiBuffer;
+    }
+
+    // one range of slots per chain of in-place processors, then the saved tapped channels
+    numSlots = 0;
+
+    for (int n = 0; n < order.size(); n++)
+    {
+        Node* node = nodes[order[n]];
+
+        if (node->isTap || node->predecessor >= 0)
+            continue;
+
+        int numChannels = 0;
+
+        for (int d = order[n]; d >= 0; d = nodes[d]->successor)
+            numChannels = jmax(numChannels, nodes[d]->numChannels);
+
+        for (int d = order[n]; d >= 0; d = nodes[d]->successor)
+            nodes[d]->firstSlot = numSlots;
+
+        numSlots += numChannels;
+    }
+
+    for (int n = 0; n < order.size(); n++)
+    {
+        Node* node = nodes[order[n]];
+
+        node->snapshotSlot = -1;
+
+        if (node->isTap)
+        {
+            node->firstSlot = numSlots;
+            numSlots += node->numOwnedChannels;
+        }
+        else if (node->successor >= 0 && node->tappedChannels.size() > 0)
+        {
+            node->snapshotSlot = numSlots;
+            numSlots += node->numChannels;
+        }
+    }
+
+    zeroSlot = numSlots++;
+
+    midiBuffers.clear();
+
+    for (int i = 0; i < numMidiBuffers; i++)
+    {
+        MidiBuffer* midiBuffer = new MidiBuffer();
+        midiBuffer->ensureSize(MIDI_BUFFER_BYTES);
+        midiBuffers.add(midiBuffer);
+    }
+
+    buildTimeMs = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) * 1000.0;
+
+    // the pointers depend on the slots
+    if (blockSize > 0)
+        prepare(blockSize);
+}
+
+int BufferRouter::getTapSlot(int node, int channel)
+{
+    if (nodes[node]->snapshotSlot >= 0)
+        return nodes[node]->snapshotSlot + channel;
+
+    return nodes[node]->firstSlot + channel;
+}
+
+void BufferRouter::prepare(int blockSize_)
+{
+    blockSize = jmax(1, blockSize_);
+
+    slab.setSize(jmax(1, numSlots), blockSize);
+
+    for (int n = 0; n < order.size(); n++)
+    {
+        Node* node = nodes[order[n]];
+
+        node->channelPointers.malloc(node->numChannels);
+        node->copies.clearQuick();
+        node->clears.clearQuick();
+        node->viewSamples = -1;
+
+        Array<bool> connected;
+        connected.insertMultiple(0, false, node->numChannels);
+
+        if (node->isTap)
+        {
+            for (int c = 0; c < node->numChannels; c++)
+                node->channelPointers[c] = slab.getChannel(c < node->numOwnedChannels ? node->firstSlot + c : zeroSlot);
+
+            for (int i = 0; i < node->inputs.size(); i++)
+            {
+                const Route& route = node->inputs.getReference(i);
+
+                if (route.destChannel >= node->numOwnedChannels)
+                    node->channelPointers[route.destChannel] = slab.getChannel(getTapSlot(route.source, route.sourceChannel));
+            }
+
+            for (int c = 0; c < node->numOwnedChannels; c++)
+                node->clears.add(node->channelPointers[c]);
+
+            continue;
+        }
+
+        for (int c = 0; c < node->numChannels; c++)
+            node->channelPointers[c] = slab.getChannel(node->firstSlot + c);
+
+        if (node->predecessor >= 0)
+        {
+            // save what the taps need before this processor overwrites it
+            Node* predecessor = nodes[node->predecessor];
+
+            for (int i = 0; i < predecessor->tappedChannels.size(); i++)
+            {
+                const int c = predecessor->tappedChannels[i];
+
+                CopyOp op;
+                op.source = slab.getChannel(predecessor->firstSlot + c);
+                op.dest = slab.getChannel(predecessor->snapshotSlot + c);
+                op.channel = predecessor->tappedChannelInfo[i];
+                node->copies.add(op);
+            }
+
+            for (int i = 0; i < node->inputs.size(); i++)
+                connected.set(node->inputs[i].destChannel, true);
+        }
+        else
+        {
+            for (int i = 0; i < node->inputs.size(); i++)
+            {
+                const Route& route = node->inputs.getReference(i);
+
+                CopyOp op;
+                op.source = slab.getChannel(nodes[route.source]->firstSlot + route.sourceChannel);
+                op.dest = node->channelPointers[route.destChannel];
+                op.channel = nullptr;
+                node->copies.add(op);
+
+                connected.set(route.destChannel, true);
+            }
+        }
+
+        for (int c = 0; c < node->numChannels; c++)
+            if (!connected[c])
+                node->clears.add(node->channelPointers[c]);
+    }
+}
+
+void BufferRouter::process(AudioSampleBuffer& output, MidiBuffer& midiMessages)
+{
+    jassert(output.getNumSamples() <= blockSize);
+
+    const int numSamples = jmin(output.getNumSamples(), blockSize);
+
+    FloatVectorOperations::clear(slab.getChannel(zeroSlot), numSamples);
+
+    for (int n = 0; n < order.size(); n++)
+    {
+        Node* node = nodes[order[n]];
+
+        if (node->isTap)
+            midiBuffers[node->midiBuffer]->clear();
+    }
+
+    int64 copied = 0, cleared = 0;
+
+    for (int n = 0; n < order.size(); n++)
+    {
+        Node* node = nodes[order[n]];
+
+        for (int i = 0; i < node->copies.size(); i++)
+        {
+            const CopyOp& op = node->copies.getReference(i);
+
+            if (op.channel == nullptr || op.channel->getRecordState() || op.channel->isMonitored)
+            {
+                FloatVectorOperations::copy(op.dest, op.source, numSamples);
+                copied += numSamples;
+            }
+        }
+
+        for (int i = 0; i < node->clears.size(); i++)
+            FloatVectorOperations::clear(node->clears[i], numSamples);
+
+        cleared += node->clears.size() * numSamples;
+
+        MidiBuffer& events = *midiBuffers[node->midiBuffer];
+
+        if (node->mergesEvents)
+        {
+            events.clear();
+
+            for (int i = 0; i < node->eventSources.size(); i++)
+                events.addEvents(*midiBuffers[nodes[node->eventSources[i]]->midiBuffer], 0, -1, 0);
+        }
+
+        if (node->viewSamples != numSamples)
+        {
+            node->view.getArrayOfWritePointers();
+            node->view.setDataToReferTo(node->channelPointers, node->numChannels, numSamples);
+            node->viewSamples = numSamples;
+        }
+        else
+        {
+            node->view.getArrayOfWritePointers(); // the processor may have cleared it last time
+        }
+
+        node->processor->processBlock(node->view, events);
+
+        for (int i = 0; i < node->eventDests.size(); i++)
+        {
+            Node* dest = nodes[node->eventDests[i]];
+
+            if (dest->isTap)
+                midiBuffers[dest->midiBuffer]->addEvents(events, 0, -1, 0);
+        }
+    }
+
+    for (int c = 0; c < output.getNumChannels(); c++)
+    {
+        if (outputNode >= 0 && c < nodes[outputNode]->numChannels)
+            output.copyFrom(c, 0, nodes[outputNode]->channelPointers[c], numSamples);
+        else
+            output.clear(c, 0, output.getNumSamples());
+    }
+
+    midiMessages.clear();
+
+    numBlocks++;
+    bytesCopied += copied * sizeof(float);
+    bytesCleared += cleared * sizeof(float);
+}
+
+void BufferRouter::printPlan()
+{
+    int numInPlace = 0;
+    int numCopies = 0;
+    int numSaved = 0;
+
+    for (int i = 0; i < nodes.size(); i++)
+    {
+        if (nodes[i]->predecessor >= 0)
+        {
+            numInPlace++;
+            numSaved += nodes[nodes[i]->predecessor]->tappedChannels.size();
+        }
+        else if (!nodes[i]->isTap)
+        {
+            numCopies += nodes[i]->inputs.size();
+        }
+    }
+
+    std::cout << "Buffer routing: " << nodes.size() << " processors, " << numInPlace << " working in place, "
+              << numConnections << " connections, " << numSlots << " channel buffers; planned in "
+              << buildTimeMs << " ms." << std::endl;
+    std::cout << "Buffer routing: " << numCopies << " channels copied per block, and up to " << numSaved
+              << " saved for recording or monitoring." << std::endl;
+}
+
+void BufferRouter::printStatistics()
+{
+    if (numBlocks == 0)
+        return;
+
+    std::cout << "Buffer routing: " << numBlocks << " blocks, " << bytesCopied / numBlocks << " bytes copied and "
+              << bytesCleared / numBlocks << " bytes cleared per block on average." << std::endl;
+
+    numBlocks = bytesCopied = bytesCleared = 0;
+}
@@ -0,0 +1,177 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __BUFFERROUTER_H_5D07A3B9__
+#define __BUFFERROUTER_H_5D07A3B9__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../GenericProcessor/ChannelBlock.h"
+
+class Channel;
+
+/**
+
+  Runs the signal chain without the AudioProcessorGraph's per-channel
+  connections.
+
+  The ProcessorGraph describes the same connections as usual, but they
+  are stored here as lists, and build() works out a plan for the whole
+  block buffer:
+
+  - Processors are run in dependency order, each on a view of one shared
+    block of channel buffers (like the AudioProcessorGraph's rendering
+    buffers). The block is a ChannelBlock, and each processor's channels
+    are consecutive in it, so processors can use planar kernels on them.
+  - A processor whose only input is the whole output of the previous one,
+    with nothing else reading it, works in place on the same channels.
+    Otherwise its inputs are copied, as the graph would.
+  - The AudioNode and RecordNode are taps: they never modify their inputs,
+    so their views point straight at the channels of the processors they
+    read. When a tapped buffer is then reused in place, only the channels
+    that are recorded or monitored are saved before it is overwritten.
+
+  As with the graph, unconnected channels are cleared before each
+  processor runs, and event buffers are merged where chains meet.
+
+  @see ProcessorGraph
+
+*/
+
+class BufferRouter
+{
+public:
+    BufferRouter();
+    ~BufferRouter();
+
+    /** Adds a processor that may modify its buffer. */
+    void addProcessor(AudioProcessor* processor);
+
+    /** Adds a processor that only reads its inputs, apart from its first
+        numOwnedChannels channels (the AudioNode's output channels). Taps
+        run after all other processors. */
+    void addTap(AudioProcessor* processor, int numOwnedChannels);
+
+    /** Routes one continuous channel, with the same checks as
+        AudioProcessorGraph::addConnection(). For taps, the channel's
+        record and monitor settings tell whether it must be saved before
+        its buffer is reused. */
+    bool addConnection(AudioProcessor* source, int sourceChannel,
+                       AudioProcessor* dest, int destChannel,
+                       Channel* channel = nullptr);
+
+    /** Routes the events of source to dest. */
+    void addEventConnection(AudioProcessor* source, AudioProcessor* dest);
+
+    /** The first channels of this processor's buffer are copied to the
+        output of each block. */
+    void setOutput(AudioProcessor* processor);
+
+    /** Orders the processors and decides which buffers are shared. */
+    void build();
+
+    /** Allocates the buffers for blocks of up to blockSize samples. */
+    void prepare(int blockSize);
+
+    /** Runs every processor on one block. */
+    void process(AudioSampleBuffer& output, MidiBuffer& midiMessages);
+
+    int getNumConnections() const;
+
+    /** Prints the plan made by build(). */
+    void printPlan();
+
+    /** Prints the mean number of bytes copied and cleared per block. */
+    void printStatistics();
+
+private:
+
+    struct Route
+    {
+        int source;
+        int sourceChannel;
+        int destChannel;
+        Channel* channel;
+    };
+
+    struct CopyOp
+    {
+        const float* source;
+        float* dest;
+        Channel* channel; // only copied if recorded or monitored (null = always)
+    };
+
+    struct Node
+    {
+        AudioProcessor* processor;
+        bool isTap;
+        int numOwnedChannels;
+        int numChannels;
+
+        Array<Route> inputs;
+        Array<int> eventSources;
+        Array<int> audioDests;      // processors (not taps) reading this one's channels
+        Array<int> eventDests;      // processors and taps receiving this one's events
+
+        int predecessor;            // the node whose buffer this one reuses, or -1
+        int successor;              // the node that reuses this one's buffer, or -1
+        int firstSlot;
+        int snapshotSlot;           // where tapped channels are saved, or -1
+        Array<int> tappedChannels;
+        Array<Channel*> tappedChannelInfo;
+
+        int midiBuffer;
+        bool mergesEvents;
+
+        HeapBlock<float*> channelPointers;
+        Array<CopyOp> copies;
+        Array<float*> clears;
+        AudioSampleBuffer view;
+        int viewSamples;
+    };
+
+    int indexOf(AudioProcessor* processor);
+    int addNode(AudioProcessor* processor, bool isTap, int numOwnedChannels);
+
+    /** The slot a tap reads for one of a processor's channels */
+    int getTapSlot(int node, int channel);
+
+    OwnedArray<Node> nodes;
+    Array<int> order;
+    int outputNode;
+    int numConnections;
+
+    int numSlots;
+    int zeroSlot;
+    int blockSize;
+    ChannelBlock slab;
+    OwnedArray<MidiBuffer> midiBuffers;
+
+    double buildTimeMs;
+    int64 numBlocks;
+    int64 bytesCopied;
+    int64 bytesCleared;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BufferRouter);
+};
+
+#endif  // __BUFFERROUTER_H_5D07A3B9__
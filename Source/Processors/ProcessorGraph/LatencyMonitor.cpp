@@ -0,0 +1,369 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "LatencyMonitor.h"
+
+#include <algorithm>
+
+#define REPORT_INTERVAL_SECONDS 10
+
+LatencyMonitor* LatencyMonitor::active = nullptr;
+
+LatencyMonitor::LatencyMonitor(const String& settings)
+    : Thread("Latency Monitor"), budgetMs(0),
+      queue(LATENCY_MONITOR_QUEUE_SIZE), statsValid(false)
+{
+    StringArray tokens;
+    tokens.addTokens(settings, " ;", "\"");
+    tokens.removeEmptyStrings();
+
+    for (int i = 0; i < tokens.size(); i++)
+    {
+        const String token = tokens[i].trim().unquoted();
+
+        if (token.startsWithIgnoreCase("file="))
+            outputFile = File::getCurrentWorkingDirectory().getChildFile(token.fromFirstOccurrenceOf("=", false, false));
+        else if (token.startsWithIgnoreCase("budget="))
+            budgetMs = token.fromFirstOccurrenceOf("=", false, false).getDoubleValue();
+        else if (!token.equalsIgnoreCase("on"))
+            std::cout << "Unknown latency monitor setting: " << token << std::endl;
+    }
+
+    for (int i = 0; i < LATENCY_MONITOR_MAX_SOURCES; i++)
+    {
+        sources[i].sourceNodeId = -1;
+        sources[i].numSamples = 0;
+        sources[i].blockTicks = 0;
+        sources[i].arrivals.calloc(LATENCY_MONITOR_MAX_BLOCK);
+    }
+
+    records.malloc(LATENCY_MONITOR_QUEUE_SIZE);
+
+    intervalTotals.ensureStorageAllocated(LATENCY_MONITOR_QUEUE_SIZE);
+
+    active = this;
+
+    std::cout << "Latency monitoring enabled";
+    if (outputFile != File::nonexistent)
+        std::cout << ", writing to " << outputFile.getFullPathName();
+    if (budgetMs > 0)
+        std::cout << ", budget " << budgetMs << " ms";
+    std::cout << std::endl;
+}
+
+LatencyMonitor::~LatencyMonitor()
+{
+    stopThread(1000);
+
+    if (active == this)
+        active = nullptr;
+}
+
+LatencyMonitor* LatencyMonitor::getActive()
+{
+    return active;
+}
+
+void LatencyMonitor::start()
+{
+    stopThread(1000);
+
+    queue.reset();
+    dropped.set(0);
+    unmatched.set(0);
+
+    for (int i = 0; i < LATENCY_MONITOR_MAX_SOURCES; i++)
+    {
+        sources[i].sourceNodeId = -1;
+        sources[i].numSamples = 0;
+    }
+
+    intervalTotals.clearQuick();
+    runTotals.clearQuick();
+    intervalBufferMs = intervalProcessingMs = runBufferMs = runProcessingMs = 0;
+    intervalOverBudget = runOverBudget = 0;
+
+    {
+        const ScopedLock sl(statsLock);
+        statsValid = false;
+    }
+
+    if (outputFile != File::nonexistent)
+    {
+        outputFile.deleteFile();
+        output = outputFile.createOutputStream();
+
+        if (output != nullptr)
+            *output << "output_node,event_channel,event_id,buffer_ms,processing_ms,total_ms\n";
+        else
+            std::cout << "Could not open " << outputFile.getFullPathName() << std::endl;
+    }
+
+    startThread(3);
+}
+
+void LatencyMonitor::stop()
+{
+    stopThread(1000);
+
+    drainQueue();
+
+    if (output != nullptr)
+    {
+        output->flush();
+        output = nullptr;
+    }
+
+    LatencyStats stats;
+    computeStats(runTotals, runBufferMs, runProcessingMs, runOverBudget, stats);
+
+    printStats("Latency over the whole acquisition", stats);
+
+    if (budgetMs > 0 && stats.numEvents > 0)
+    {
+        if (stats.overBudget == 0 && stats.dropped == 0 && stats.unmatched == 0)
+            std::cout << "Latency budget of " << budgetMs << " ms: PASS" << std::endl;
+        else
+            std::cout << "Latency budget of " << budgetMs << " ms: FAIL (" << stats.overBudget
+                      << " events over budget, " << stats.dropped << " not recorded, "
+                      << stats.unmatched << " from unknown sources)" << std::endl;
+    }
+
+    const ScopedLock sl(statsLock);
+    lastStats = stats;
+    statsValid = stats.numEvents > 0 || stats.unmatched > 0;
+}
+
+void LatencyMonitor::setBlockArrivals(int sourceNodeId, const int64* arrivals1, int numSamples1,
+                                      const int64* arrivals2, int numSamples2)
+{
+    int slot = -1;
+
+    for (int i = 0; i < LATENCY_MONITOR_MAX_SOURCES; i++)
+    {
+        if (sources[i].sourceNodeId == sourceNodeId)
+        {
+            slot = i;
+            break;
+        }
+        else if (sources[i].sourceNodeId < 0 && slot < 0)
+        {
+            slot = i;
+        }
+    }
+
+    if (slot < 0)
+        return; // more sources than slots
+
+    SourceBlock& block = sources[slot];
+
+    numSamples1 = jmin(numSamples1, LATENCY_MONITOR_MAX_BLOCK);
+    numSamples2 = jmin(numSamples2, LATENCY_MONITOR_MAX_BLOCK - numSamples1);
+
+    if (numSamples1 > 0)
+        memcpy(block.arrivals, arrivals1, numSamples1 * sizeof(int64));
+    if (numSamples2 > 0)
+        memcpy(block.arrivals + numSamples1, arrivals2, numSamples2 * sizeof(int64));
+
+    block.sourceNodeId = sourceNodeId;
+    block.numSamples = numSamples1 + numSamples2;
+    block.blockTicks = Time::getHighResolutionTicks();
+}
+
+void LatencyMonitor::eventReachedOutput(int outputNodeId, const uint8* event, int eventSize, int sampleNum)
+{
+    const int64 now = Time::getHighResolutionTicks();
+
+    // the event is matched to the last block of the source it names
+    int slot = -1;
+
+    if (eventSize > 5)
+    {
+        for (int i = 0; i < LATENCY_MONITOR_MAX_SOURCES; i++)
+        {
+            if (sources[i].sourceNodeId >= 0 && (sources[i].sourceNodeId & 0xff) == event[5])
+            {
+                slot = i;
+                break;
+            }
+        }
+    }
+
+    if (slot < 0 || sources[slot].numSamples == 0)
+    {
+        unmatched.set(unmatched.get() + 1);
+        return;
+    }
+
+    const SourceBlock& block = sources[slot];
+
+    int start1, size1, start2, size2;
+    queue.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+    {
+        dropped.set(dropped.get() + 1);
+        return;
+    }
+
+    Record& r = records[start1];
+    r.arrivalTicks = block.arrivals[jlimit(0, block.numSamples - 1, sampleNum)];
+    r.blockTicks = block.blockTicks;
+    r.outputTicks = now;
+    r.outputNodeId = (int16) outputNodeId;
+    r.eventId = event[2];
+    r.eventChannel = event[3];
+
+    queue.finishedWrite(1);
+}
+
+void LatencyMonitor::drainQueue()
+{
+    const double msPerTick = 1000.0 / Time::getHighResolutionTicksPerSecond();
+
+    int start1, size1, start2, size2;
+    queue.prepareToRead(queue.getNumReady(), start1, size1, start2, size2);
+
+    for (int n = 0; n < size1 + size2; n++)
+    {
+        const Record& r = records[n < size1 ? start1 + n : start2 + n - size1];
+
+        const double bufferMs = (r.blockTicks - r.arrivalTicks) * msPerTick;
+        const double processingMs = (r.outputTicks - r.blockTicks) * msPerTick;
+        const double totalMs = (r.outputTicks - r.arrivalTicks) * msPerTick;
+
+        intervalTotals.add((float) totalMs);
+        runTotals.add((float) totalMs);
+        intervalBufferMs += bufferMs;
+        runBufferMs += bufferMs;
+        intervalProcessingMs += processingMs;
+        runProcessingMs += processingMs;
+
+        if (budgetMs > 0 && totalMs > budgetMs)
+        {
+            intervalOverBudget++;
+            runOverBudget++;
+        }
+
+        if (output != nullptr)
+        {
+            *output << r.outputNodeId << "," << (int) r.eventChannel << "," << (int) r.eventId << ","
+                    << String(bufferMs, 3) << "," << String(processingMs, 3) << "," << String(totalMs, 3) << "\n";
+        }
+    }
+
+    queue.finishedRead(size1 + size2);
+}
+
+void LatencyMonitor::computeStats(Array<float>& totals, double sumBufferMs, double sumProcessingMs,
+                                  int64 overBudget, LatencyStats& stats)
+{
+    const int n = totals.size();
+
+    stats.numEvents = n;
+    stats.overBudget = overBudget;
+    stats.dropped = dropped.get();
+    stats.unmatched = unmatched.get();
+    stats.meanMs = stats.medianMs = stats.p95Ms = stats.p99Ms = stats.maxMs = 0;
+    stats.meanBufferMs = stats.meanProcessingMs = 0;
+
+    if (n == 0)
+        return;
+
+    std::sort(totals.begin(), totals.end());
+
+    double sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += totals.getUnchecked(i);
+
+    stats.meanMs = sum / n;
+    stats.medianMs = totals.getUnchecked(n / 2);
+    stats.p95Ms = totals.getUnchecked(jmin(n - 1, (int)(0.95 * n)));
+    stats.p99Ms = totals.getUnchecked(jmin(n - 1, (int)(0.99 * n)));
+    stats.maxMs = totals.getUnchecked(n - 1);
+    stats.meanBufferMs = sumBufferMs / n;
+    stats.meanProcessingMs = sumProcessingMs / n;
+}
+
+void LatencyMonitor::printStats(const String& title, const LatencyStats& stats)
+{
+    std::cout << title << ": " << stats.numEvents << " events, mean " << stats.meanMs
+              << " ms (buffer " << stats.meanBufferMs << ", processing " << stats.meanProcessingMs
+              << "), median " << stats.medianMs << ", 95% " << stats.p95Ms << ", 99% " << stats.p99Ms
+              << ", max " << stats.maxMs << " ms";
+
+    if (budgetMs > 0)
+        std::cout << ", " << stats.overBudget << " over budget";
+    if (stats.dropped > 0)
+        std::cout << ", " << stats.dropped << " not recorded";
+    if (stats.unmatched > 0)
+        std::cout << ", " << stats.unmatched << " from unknown sources";
+
+    std::cout << std::endl;
+}
+
+bool LatencyMonitor::getStats(LatencyStats& stats)
+{
+    const ScopedLock sl(statsLock);
+
+    stats = lastStats;
+
+    return statsValid;
+}
+
+void LatencyMonitor::run()
+{
+    int64 nextReport = Time::getHighResolutionTicks()
+                       + Time::secondsToHighResolutionTicks(REPORT_INTERVAL_SECONDS);
+
+    while (!threadShouldExit())
+    {
+        wait(100);
+
+        drainQueue();
+
+        if (Time::getHighResolutionTicks() >= nextReport)
+        {
+            LatencyStats stats;
+            computeStats(intervalTotals, intervalBufferMs, intervalProcessingMs, intervalOverBudget, stats);
+
+            if (stats.numEvents > 0)
+            {
+                printStats("Latency", stats);
+
+                const ScopedLock sl(statsLock);
+                lastStats = stats;
+                statsValid = true;
+            }
+
+            if (output != nullptr)
+                output->flush();
+
+            intervalTotals.clearQuick();
+            intervalBufferMs = intervalProcessingMs = 0;
+            intervalOverBudget = 0;
+
+            nextReport += Time::secondsToHighResolutionTicks(REPORT_INTERVAL_SECONDS);
+        }
+    }
+}
@@ -0,0 +1,178 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __LATENCYMONITOR_H_8C31F5A2__
+#define __LATENCYMONITOR_H_8C31F5A2__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+#define LATENCY_MONITOR_MAX_SOURCES 4
+#define LATENCY_MONITOR_MAX_BLOCK 10000
+#define LATENCY_MONITOR_QUEUE_SIZE 4096
+
+/** Latency statistics of the TTL events that reached output processors, in ms. */
+struct LatencyStats
+{
+    int64 numEvents;
+
+    /** From the sample entering the DataBuffer to the event reaching an output */
+    double meanMs;
+    double medianMs;
+    double p95Ms;
+    double p99Ms;
+    double maxMs;
+
+    /** The part spent waiting in the DataBuffer, and in the signal chain */
+    double meanBufferMs;
+    double meanProcessingMs;
+
+    /** Events slower than the budget (if one is set), events that could
+        not be recorded because the queue was full, and events whose source
+        ID names no source that sent a block */
+    int64 overBudget;
+    int64 dropped;
+    int64 unmatched;
+};
+
+/**
+
+  Measures the closed-loop latency of the signal chain.
+
+  Every sample is tagged with the time it enters the DataBuffer of its
+  source. SourceNode passes these times to the monitor along with each
+  block, and when a TTL event reaches the handleEvent() of a sink (e.g.
+  PulsePalOutput, ArduinoOutput or FPGAOutput), the monitor records how
+  long ago the sample it belongs to arrived. The sample is looked up in the
+  last block of the source named by the event's source ID byte, so events
+  from several sources are told apart. This covers the wait in the
+  DataBuffer (which depends on the audio buffer size) and the processing
+  of the chain, but not the output device itself.
+
+  The audio thread only pushes records into a lock-free queue; the
+  monitor's thread computes the distributions, prints them every 10 s
+  and at the end of acquisition, and optionally writes every event to a
+  CSV file.
+
+  Monitoring is enabled by setting the OPEN_EPHYS_LATENCY_MONITOR
+  environment variable to a list of space-separated tokens:
+
+  - on: live report only;
+  - file=PATH: also write one line per event to PATH;
+  - budget=MS: count events slower than MS, and print PASS or FAIL when
+    acquisition stops.
+
+  For a loopback test without hardware, combine it with the simulated
+  Rhythm board (OPEN_EPHYS_RHD2000_SIMULATION), whose TTL inputs toggle
+  at fixed intervals, and any sink, e.g. the LFP Viewer.
+
+  @see ProcessorGraph, SourceNode, GenericProcessor::checkForEvents()
+
+*/
+
+class LatencyMonitor : public Thread
+{
+public:
+    LatencyMonitor(const String& settings);
+    ~LatencyMonitor();
+
+    /** Returns the monitor, or nullptr if latency monitoring is off.*/
+    static LatencyMonitor* getActive();
+
+    /** Resets the statistics and opens the output file.*/
+    void start();
+
+    /** Prints the statistics of the whole acquisition and closes the file.*/
+    void stop();
+
+    /** Called by a SourceNode for every block, with the arrival times of its
+        samples (two regions, as read from the DataBuffer). Audio thread only.*/
+    void setBlockArrivals(int sourceNodeId, const int64* arrivals1, int numSamples1,
+                          const int64* arrivals2, int numSamples2);
+
+    /** Records that a TTL event reached an output processor. The event is
+        given as GenericProcessor::addEvent() lays it out (type, node ID,
+        event ID, channel, saving flag, source node ID); its source node ID
+        only holds the low 8 bits of the ID. Audio thread only.*/
+    void eventReachedOutput(int outputNodeId, const uint8* event, int eventSize, int sampleNum);
+
+    /** Fills in the statistics of the last report interval, or of the whole
+        acquisition once it has stopped. Returns false if there are none yet.*/
+    bool getStats(LatencyStats& stats);
+
+    /** Drains the queue, writes the file and prints the reports.*/
+    void run();
+
+private:
+
+    struct Record
+    {
+        int64 arrivalTicks;
+        int64 blockTicks;
+        int64 outputTicks;
+        int16 outputNodeId;
+        uint8 eventId;
+        uint8 eventChannel;
+    };
+
+    struct SourceBlock
+    {
+        int sourceNodeId;
+        int numSamples;
+        int64 blockTicks;
+        HeapBlock<int64> arrivals;
+    };
+
+    /** Moves the queued records into the accumulators.*/
+    void drainQueue();
+
+    void computeStats(Array<float>& totals, double sumBufferMs, double sumProcessingMs,
+                      int64 overBudget, LatencyStats& stats);
+
+    void printStats(const String& title, const LatencyStats& stats);
+
+    static LatencyMonitor* active;
+
+    File outputFile;
+    ScopedPointer<FileOutputStream> output;
+    double budgetMs;
+
+    SourceBlock sources[LATENCY_MONITOR_MAX_SOURCES];
+
+    AbstractFifo queue;
+    HeapBlock<Record> records;
+    Atomic<int64> dropped;
+    Atomic<int64> unmatched;
+
+    /** Accumulators of the current report interval and of the whole acquisition */
+    Array<float> intervalTotals, runTotals;
+    double intervalBufferMs, intervalProcessingMs, runBufferMs, runProcessingMs;
+    int64 intervalOverBudget, runOverBudget;
+
+    CriticalSection statsLock;
+    LatencyStats lastStats;
+    bool statsValid;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LatencyMonitor);
+};
+
+#endif  // __LATENCYMONITOR_H_8C31F5A2__
@@ -28,6 +28,7 @@
 
 #include "../AudioNode/AudioNode.h"
 #include "../LfpDisplayNode/LfpDisplayNode.h"
+#include "../LfpTriggeredAverageNode/LfpTriggeredAverageNode.h"
 #include "../SpikeDisplayNode/SpikeDisplayNode.h"
 #include "../EventNode/EventNode.h"
 #include "../FilterNode/FilterNode.h"
@@ -54,6 +55,10 @@
 #include "../PSTH/PeriStimulusTimeHistogramNode.h"
 #include "../CAR/CAR.h"
 #include "../Rectifier/Rectifier.h"
+#include "../SpectralAnalyzer/SpectralAnalyzer.h"
+#include "LatencyMonitor.h"
+#include "BufferRouter.h"
+#include "../GenericProcessor/AllocationTrap.h"
 
     
 ProcessorGraph::ProcessorGraph() : currentNodeId(100)
@@ -66,6 +71,27 @@ ProcessorGraph::ProcessorGraph() : currentNodeId(100)
                          44100.0, // sampleRate
                          1024);    // blockSize
 
+    const String latencySettings = SystemStats::getEnvironmentVariable("OPEN_EPHYS_LATENCY_MONITOR", String::empty);
+
+    if (latencySettings.isNotEmpty())
+        latencyMonitor = new LatencyMonitor(latencySettings);
+
+    const String routingSettings = SystemStats::getEnvironmentVariable("OPEN_EPHYS_BUFFER_ROUTING", String::empty);
+
+    usesBufferRouting = routingSettings.isNotEmpty() && routingSettings != "0";
+
+    if (usesBufferRouting)
+        std::cout << "Using buffer routing instead of graph connections." << std::endl;
+
+    String checkSettings = SystemStats::getEnvironmentVariable("OPEN_EPHYS_REALTIME_CHECK", String::empty);
+    const String trapSettings = SystemStats::getEnvironmentVariable("OPEN_EPHYS_TRAP_ALLOCATIONS", String::empty);
+
+    if (trapSettings.isNotEmpty() && trapSettings != "0")
+        checkSettings << " stop";
+
+    if (checkSettings.isNotEmpty())
+        AllocationTrap::configure(checkSettings);
+
 }
 
 ProcessorGraph::~ProcessorGraph()
@@ -274,13 +300,34 @@ void ProcessorGraph::clearConnections()
 
     }
 
-    addConnection(MESSAGE_CENTER_ID, midiChannelIndex,
-                  RECORD_NODE_ID, midiChannelIndex);
+    routeChannel(MESSAGE_CENTER_ID, midiChannelIndex,
+                 RECORD_NODE_ID, midiChannelIndex);
 }
 
 
 void ProcessorGraph::updateConnections(Array<SignalChainTabButton*, CriticalSection> tabs)
 {
+    const int64 startTicks = Time::getHighResolutionTicks();
+
+    if (usesBufferRouting)
+    {
+        nextRouter = new BufferRouter();
+
+        for (int i = 0; i < getNumNodes(); i++)
+        {
+            Node* node = getNode(i);
+
+            if (node->nodeId == AUDIO_NODE_ID)
+                nextRouter->addTap(node->getProcessor(), 2); // the left and right outputs
+            else if (node->nodeId == RECORD_NODE_ID)
+                nextRouter->addTap(node->getProcessor(), 0);
+            else if (node->nodeId != OUTPUT_NODE_ID)
+                nextRouter->addProcessor(node->getProcessor());
+        }
+
+        nextRouter->setOutput(getAudioNode());
+    }
+
     clearConnections(); // clear processor graph
 
     std::cout << "Updating connections:" << std::endl;
@@ -402,8 +449,73 @@ void ProcessorGraph::updateConnections(Array<SignalChainTabButton*, CriticalSect
         } // end while source != 0
     } // end "tabs" for loop
 
+    if (nextRouter != nullptr)
+    {
+        nextRouter->build();
+        nextRouter->prepare(getBlockSize());
+        nextRouter->printPlan();
+
+        {
+            const ScopedLock sl(getCallbackLock());
+            router.swapWith(nextRouter);
+        }
+
+        nextRouter = nullptr;
+    }
+
+    std::cout << "Connections updated in "
+              << Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) * 1000.0 << " ms ("
+              << (router != nullptr ? router->getNumConnections() : getNumConnections()) << " connections)." << std::endl;
+
 } // end method
 
+void ProcessorGraph::routeChannel(uint32 sourceNodeId, int sourceChannel, uint32 destNodeId, int destChannel)
+{
+    if (nextRouter == nullptr)
+    {
+        addConnection(sourceNodeId, sourceChannel, destNodeId, destChannel);
+        return;
+    }
+
+    GenericProcessor* source = (GenericProcessor*) getNodeForId(sourceNodeId)->getProcessor();
+    AudioProcessor* dest = getNodeForId(destNodeId)->getProcessor();
+
+    if (sourceChannel == midiChannelIndex)
+    {
+        nextRouter->addEventConnection(source, dest);
+    }
+    else
+    {
+        // the audio and record nodes read the source's buffer in place
+        const bool isTap = (destNodeId == AUDIO_NODE_ID || destNodeId == RECORD_NODE_ID);
+
+        nextRouter->addConnection(source, sourceChannel, dest, destChannel,
+                                  isTap ? source->channels[sourceChannel] : nullptr);
+    }
+}
+
+void ProcessorGraph::prepareToPlay(double sampleRate, int estimatedSamplesPerBlock)
+{
+    const int64 startTicks = Time::getHighResolutionTicks();
+
+    AudioProcessorGraph::prepareToPlay(sampleRate, estimatedSamplesPerBlock);
+
+    if (router != nullptr)
+        router->prepare(estimatedSamplesPerBlock);
+
+    std::cout << "Processor graph prepared in "
+              << Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) * 1000.0
+              << " ms." << std::endl;
+}
+
+void ProcessorGraph::processBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+{
+    if (router != nullptr)
+        router->process(buffer, midiMessages);
+    else
+        AudioProcessorGraph::processBlock(buffer, midiMessages);
+}
+
 void ProcessorGraph::connectProcessors(GenericProcessor* source, GenericProcessor* dest)
 {
 
@@ -433,20 +545,20 @@ void ProcessorGraph::connectProcessors(GenericProcessor* source, GenericProcesso
         {
             //std::cout << chan << " ";
 
-            addConnection(source->getNodeId(),         // sourceNodeID
-                          chan,                        // sourceNodeChannelIndex
-                          dest->getNodeId(),           // destNodeID
-                          dest->getNextChannel(true)); // destNodeChannelIndex
+            routeChannel(source->getNodeId(),         // sourceNodeID
+                         chan,                        // sourceNodeChannelIndex
+                         dest->getNodeId(),           // destNodeID
+                         dest->getNextChannel(true)); // destNodeChannelIndex
         }
     }
 
     // 2. connect event channel
     if (connectEvents)
     {
-        addConnection(source->getNodeId(),    // sourceNodeID
-                      midiChannelIndex,       // sourceNodeChannelIndex
-                      dest->getNodeId(),      // destNodeID
-                      midiChannelIndex);      // destNodeChannelIndex
+        routeChannel(source->getNodeId(),    // sourceNodeID
+                     midiChannelIndex,       // sourceNodeChannelIndex
+                     dest->getNodeId(),      // destNodeID
+                     midiChannelIndex);      // destNodeChannelIndex
     }
 
 }
@@ -468,31 +580,31 @@ void ProcessorGraph::connectProcessorToAudioAndRecordNodes(GenericProcessor* sou
         // IT CAN CAUSE PROBLEMS IF THE SAMPLE RATE VARIES ACROSS PROCESSORS
         getAudioNode()->settings.sampleRate = source->getSampleRate();
 
-        addConnection(source->getNodeId(),                   // sourceNodeID
-                      chan,                                  // sourceNodeChannelIndex
-                      AUDIO_NODE_ID,                         // destNodeID
-                      getAudioNode()->getNextChannel(true)); // destNodeChannelIndex
+        routeChannel(source->getNodeId(),                   // sourceNodeID
+                     chan,                                  // sourceNodeChannelIndex
+                     AUDIO_NODE_ID,                         // destNodeID
+                     getAudioNode()->getNextChannel(true)); // destNodeChannelIndex
 
         getRecordNode()->addInputChannel(source, chan);
 
-        addConnection(source->getNodeId(),                    // sourceNodeID
-                      chan,                                   // sourceNodeChannelIndex
-                      RECORD_NODE_ID,                         // destNodeID
-                      getRecordNode()->getNextChannel(true)); // destNodeChannelIndex
+        routeChannel(source->getNodeId(),                    // sourceNodeID
+                     chan,                                   // sourceNodeChannelIndex
+                     RECORD_NODE_ID,                         // destNodeID
+                     getRecordNode()->getNextChannel(true)); // destNodeChannelIndex
 
     }
 
     // connect event channel
-    addConnection(source->getNodeId(),    // sourceNodeID
-                  midiChannelIndex,       // sourceNodeChannelIndex
-                  RECORD_NODE_ID,         // destNodeID
-                  midiChannelIndex);      // destNodeChannelIndex
+    routeChannel(source->getNodeId(),    // sourceNodeID
+                 midiChannelIndex,       // sourceNodeChannelIndex
+                 RECORD_NODE_ID,         // destNodeID
+                 midiChannelIndex);      // destNodeChannelIndex
 
     // connect event channel
-    addConnection(source->getNodeId(),    // sourceNodeID
-                  midiChannelIndex,       // sourceNodeChannelIndex
-                  AUDIO_NODE_ID,          // destNodeID
-                  midiChannelIndex);      // destNodeChannelIndex
+    routeChannel(source->getNodeId(),    // sourceNodeID
+                 midiChannelIndex,       // sourceNodeChannelIndex
+                 AUDIO_NODE_ID,          // destNodeID
+                 midiChannelIndex);      // destNodeChannelIndex
 
 
     getRecordNode()->addInputChannel(source, midiChannelIndex);
@@ -606,6 +718,16 @@ GenericProcessor* ProcessorGraph::createProcessorFromDescription(String& descrip
         {
             std::cout << "Creating a new common average reference node." << std::endl;
             processor = new CAR();
+        }
+        else if (subProcessorType.equalsIgnoreCase("Resampler"))
+        {
+            std::cout << "Creating a new resampler." << std::endl;
+            processor = new ResamplingNode();
+        }
+        else if (subProcessorType.equalsIgnoreCase("Spectral Analyzer"))
+        {
+            std::cout << "Creating a new spectral analyzer." << std::endl;
+            processor = new SpectralAnalyzer();
         }
 		CoreServices::sendStatusMessage("New filter node created.");
 
@@ -651,6 +773,12 @@ GenericProcessor* ProcessorGraph::createProcessorFromDescription(String& descrip
             processor = new LfpDisplayNode();
         }
 
+        else if (subProcessorType.equalsIgnoreCase("LFP Trig. Avg."))
+        {
+            std::cout << "Creating an LfpTriggeredAverageNode." << std::endl;
+            processor = new LfpTriggeredAverageNode();
+        }
+
         else if (subProcessorType.equalsIgnoreCase("Spike Viewer"))
         {
             std::cout << "Creating a SpikeDisplayNode." << std::endl;
@@ -748,6 +876,25 @@ bool ProcessorGraph::enableProcessors()
         return false;
     }
 
+    // any processor can be the source of a stream
+    Array<int> nodeIds;
+
+    for (int i = 0; i < getNumNodes(); i++)
+    {
+        if (getNode(i)->nodeId != OUTPUT_NODE_ID)
+            nodeIds.add(getNode(i)->nodeId);
+    }
+
+    blockMetadata.setStreams(nodeIds);
+
+    for (int i = 0; i < getNumNodes(); i++)
+    {
+        Node* node = getNode(i);
+
+        if (node->nodeId != OUTPUT_NODE_ID)
+            ((GenericProcessor*) node->getProcessor())->setBlockMetadata(&blockMetadata);
+    }
+
     for (int i = 0; i < getNumNodes(); i++)
     {
 
@@ -769,6 +916,11 @@ bool ProcessorGraph::enableProcessors()
         }
     }
 
+    if (latencyMonitor != nullptr)
+        latencyMonitor->start();
+
+    AllocationTrap::start();
+
     for (int i = 0; i < getNumNodes(); i++)
     {
 
@@ -779,6 +931,7 @@ bool ProcessorGraph::enableProcessors()
             GenericProcessor* p = (GenericProcessor*) node->getProcessor();
             p->enableEditor();
             p->enable();
+            p->setQueueParameterChanges(true);
         }
     }
 
@@ -806,6 +959,7 @@ bool ProcessorGraph::disableProcessors()
 			if (node->nodeId != MESSAGE_CENTER_ID)
 				p->disableEditor();
             allClear = p->disable();
+            p->setQueueParameterChanges(false);
 
             if (!allClear)
             {
@@ -817,6 +971,14 @@ bool ProcessorGraph::disableProcessors()
 
     AccessClass::getEditorViewport()->signalChainCanBeEdited(true);
 
+    if (latencyMonitor != nullptr)
+        latencyMonitor->stop();
+
+    if (router != nullptr)
+        router->printStatistics();
+
+    AllocationTrap::stop();
+
     //	sendActionMessage("Acquisition ended.");
 
     return true;
@@ -27,12 +27,15 @@
 #include "../../../JuceLibraryCode/JuceHeader.h"
 
 #include "../../AccessClass.h"
+#include "../GenericProcessor/BlockMetadata.h"
 
 class GenericProcessor;
 class RecordNode;
 class AudioNode;
 class MessageCenter;
 class SignalChainTabButton;
+class LatencyMonitor;
+class BufferRouter;
 
 /**
 
@@ -45,6 +48,10 @@ class SignalChainTabButton;
 
   The user is able to modify the ProcessGraph through the EditorViewport
 
+  If the OPEN_EPHYS_BUFFER_ROUTING environment variable is set (to anything
+  but 0), the processors are run by a BufferRouter instead of through the
+  AudioProcessorGraph's per-channel connections.
+
   @see EditorViewport, GenericProcessor, GenericEditor, RecordNode,
        AudioNode, Configuration, MessageCenter
 
@@ -87,9 +94,25 @@ public:
     void refreshColors();
 
     void createDefaultNodes();
+
+    void prepareToPlay(double sampleRate, int estimatedSamplesPerBlock);
+    void processBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages);
+
 private:
     int currentNodeId;
 
+    /** Only created if latency monitoring is enabled */
+    ScopedPointer<LatencyMonitor> latencyMonitor;
+
+    /** Sample counts and timestamps of the current block, handed to every
+        processor by enableProcessors() */
+    BlockMetadata blockMetadata;
+
+    /** Only used if buffer routing is enabled; nextRouter is built by updateConnections() */
+    bool usesBufferRouting;
+    ScopedPointer<BufferRouter> router;
+    ScopedPointer<BufferRouter> nextRouter;
+
     enum nodeIds
     {
         RECORD_NODE_ID = 900,
@@ -103,6 +126,9 @@ private:
     void connectProcessors(GenericProcessor* source, GenericProcessor* dest);
     void connectProcessorToAudioAndRecordNodes(GenericProcessor* source);
 
+    /** Adds a connection to the graph, or to the BufferRouter being built */
+    void routeChannel(uint32 sourceNodeId, int sourceChannel, uint32 destNodeId, int destChannel);
+
 };
 
 
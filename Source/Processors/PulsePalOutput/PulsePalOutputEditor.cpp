@@ -159,13 +159,13 @@ void ChannelTriggerInterface::comboBoxChanged(ComboBox* comboBoxThatHasChanged)
 
     if (comboBoxThatHasChanged == triggerSelector)
     {
-        processor->setParameter(0, channelNumber);
-        processor->setParameter(1, (float) comboBoxThatHasChanged->getSelectedId() - 2);
+        processor->queueParameterChange(0, channelNumber);
+        processor->queueParameterChange(1, (float) comboBoxThatHasChanged->getSelectedId() - 2);
     }
     else if (comboBoxThatHasChanged == gateSelector)
     {
-        processor->setParameter(0, channelNumber);
-        processor->setParameter(2, (float) comboBoxThatHasChanged->getSelectedId() - 2);
+        processor->queueParameterChange(0, channelNumber);
+        processor->queueParameterChange(2, (float) comboBoxThatHasChanged->getSelectedId() - 2);
     }
 
 
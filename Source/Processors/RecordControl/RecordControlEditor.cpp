@@ -115,17 +115,17 @@ void RecordControlEditor::comboBoxChanged(ComboBox* comboBox)
     if (comboBox == availableChans)
     {
         if (comboBox->getSelectedId() > 1)
-            getProcessor()->setParameter(0, (float)comboBox->getSelectedId() - 2);
+            getProcessor()->queueParameterChange(0, (float)comboBox->getSelectedId() - 2);
         else
-            getProcessor()->setParameter(0, -1);
+            getProcessor()->queueParameterChange(0, -1);
     }
     else if (comboBox == triggerMode)
     {
-        getProcessor()->setParameter(1, comboBox->getSelectedId());
+        getProcessor()->queueParameterChange(1, comboBox->getSelectedId());
     }
     else if (comboBox == triggerPol)
     {
-        getProcessor()->setParameter(2, comboBox->getSelectedId());
+        getProcessor()->queueParameterChange(2, comboBox->getSelectedId());
     }
 }
 
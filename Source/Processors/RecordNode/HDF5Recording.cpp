@@ -22,18 +22,17 @@
  */
 
 #include "HDF5Recording.h"
+#include "../GenericProcessor/CompactSampleBuffer.h"
 #define MAX_BUFFER_SIZE 10000
 
 HDF5Recording::HDF5Recording() : processorIndex(-1), hasAcquired(false)
 {
     //timestamp = 0;
-    scaledBuffer = new float[MAX_BUFFER_SIZE];
     intBuffer = new int16[MAX_BUFFER_SIZE];
 }
 
 HDF5Recording::~HDF5Recording()
 {
-    delete scaledBuffer;
     delete intBuffer;
 }
 
@@ -95,7 +94,7 @@ void HDF5Recording::openFiles(File rootFolder, int experimentNumber, int recordi
     infoArray[0]->name = String("Open Ephys Recording #") + String(recordingNumber);
 
     if (hasAcquired)
-        infoArray[0]->start_time = (*timestamps)[getChannel(0)->sourceNodeId]; //(*timestamps).begin()->first;
+        infoArray[0]->start_time = blockMetadata->getTimestamp(getChannel(0)->sourceNodeId); //(*timestamps).begin()->first;
     else
         infoArray[0]->start_time = 0;
 
@@ -112,7 +111,7 @@ void HDF5Recording::openFiles(File rootFolder, int experimentNumber, int recordi
             {
                 fileArray[index]->initFile(getChannel(i)->nodeId,basepath);
                 if (hasAcquired)
-                    infoArray[index]->start_time = (*timestamps)[getChannel(i)->sourceNodeId]; //the timestamps of the first channel
+                    infoArray[index]->start_time = blockMetadata->getTimestamp(getChannel(i)->sourceNodeId); //the timestamps of the first channel
                 else
                     infoArray[index]->start_time = 0;
             }
@@ -178,12 +177,10 @@ void HDF5Recording::writeData(AudioSampleBuffer& buffer)
         {
 
             int sourceNodeId = getChannel(i)->sourceNodeId;
-            int nSamples = (*numSamples)[sourceNodeId];
+            int nSamples = blockMetadata->getNumSamples(sourceNodeId);
 
-            double multFactor = 1/(float(0x7fff) * getChannel(i)->bitVolts);
             int index = processorMap[getChannel(i)->recordIndex];
-            FloatVectorOperations::copyWithMultiply(scaledBuffer,buffer.getReadPointer(i,0),multFactor,nSamples);
-            AudioDataConverters::convertFloatToInt16LE(scaledBuffer,intBuffer,nSamples);
+            CompactSampleBuffer::convertToInt16(buffer.getReadPointer(i,0),intBuffer,nSamples,getChannel(i)->bitVolts);
             fileArray[index]->writeRowData(intBuffer,nSamples);
         }
     }
@@ -195,9 +192,9 @@ void HDF5Recording::writeEvent(int eventType, MidiMessage& event, int samplePosi
 {
     const uint8* dataptr = event.getRawData();
     if (eventType == GenericProcessor::TTL)
-        eventFile->writeEvent(0,*(dataptr+2),*(dataptr+1),(void*)(dataptr+3),(*timestamps)[*(dataptr+1)]+samplePosition);
+        eventFile->writeEvent(0,*(dataptr+2),*(dataptr+1),(void*)(dataptr+3),blockMetadata->getTimestamp(*(dataptr+1))+samplePosition);
     else if (eventType == GenericProcessor::MESSAGE)
-        eventFile->writeEvent(1,*(dataptr+2),*(dataptr+1),(void*)(dataptr+6),(*timestamps)[*(dataptr+1)]+samplePosition);
+        eventFile->writeEvent(1,*(dataptr+2),*(dataptr+1),(void*)(dataptr+6),blockMetadata->getTimestamp(*(dataptr+1))+samplePosition);
 }
 
 void HDF5Recording::addSpikeElectrode(int index, SpikeRecordInfo* elec)
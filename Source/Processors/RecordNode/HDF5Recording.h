@@ -58,7 +58,6 @@ private:
     OwnedArray<HDF5RecordingInfo> infoArray;
     ScopedPointer<KWEFile> eventFile;
     ScopedPointer<KWXFile> spikesFile;
-    float* scaledBuffer;
     int16* intBuffer;
 
     bool hasAcquired;
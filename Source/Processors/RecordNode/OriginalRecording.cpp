@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "OriginalRecording.h"
+#include "../GenericProcessor/CompactSampleBuffer.h"
 #include "../../AccessClass.h"
 #include "../../Audio/AudioComponent.h"
 
@@ -30,7 +31,6 @@ OriginalRecording::OriginalRecording() : separateFiles(false),
     eventFile(nullptr), messageFile(nullptr), lastProcId(0)
 {
     continuousDataIntegerBuffer = new int16[10000];
-    continuousDataFloatBuffer = new float[10000];
 
     recordMarker = new char[10];
     for (int i = 0; i < 9; i++)
@@ -53,7 +53,6 @@ OriginalRecording::~OriginalRecording()
     {
         if (spikeFileArray[i] != nullptr) fclose(spikeFileArray[i]);
     }
-    delete continuousDataFloatBuffer;
     delete continuousDataIntegerBuffer;
     delete recordMarker;
 }
@@ -393,7 +392,7 @@ void OriginalRecording::writeMessage(MidiMessage& event, int samplePosition)
     uint64 samplePos = (uint64) samplePosition;
     uint8 sourceNodeId = event.getNoteNumber();
 
-    int64 eventTimestamp = (*timestamps)[sourceNodeId] + samplePos;
+    int64 eventTimestamp = blockMetadata->getTimestamp(sourceNodeId) + samplePos;
 
     int msgLength = event.getRawDataSize() - 6;
     const char* dataptr = (const char*)event.getRawData() + 6;
@@ -423,7 +422,7 @@ void OriginalRecording::writeTTLEvent(MidiMessage& event, int samplePosition)
 
     uint8 sourceNodeId = event.getNoteNumber();
 
-    int64 eventTimestamp = (*timestamps)[sourceNodeId] + samplePos; // add the sample position to the buffer timestamp
+    int64 eventTimestamp = blockMetadata->getTimestamp(sourceNodeId) + samplePos; // add the sample position to the buffer timestamp
 
     diskWriteLock.enter();
 
@@ -462,7 +461,7 @@ void OriginalRecording::writeData(AudioSampleBuffer& buffer)
 
             samplesSinceLastTimestamp.set(i,0);
 
-            int nSamples = (*numSamples)[sourceNodeId];
+            int nSamples = blockMetadata->getNumSamples(sourceNodeId);
 
             while (samplesWritten < nSamples) // there are still unwritten samples in this buffer
             {
@@ -511,14 +510,13 @@ void OriginalRecording::writeContinuousBuffer(const float* data, int nSamples, i
     if (fileArray[channel] == nullptr)
         return;
 
-    // scale the data back into the range of int16
-    float scaleFactor =  float(0x7fff) * getChannel(channel)->bitVolts;
+    // scale the data back into the range of int16, in one pass
+    CompactSampleBuffer::convertToInt16(data, continuousDataIntegerBuffer, nSamples, getChannel(channel)->bitVolts);
 
     for (int n = 0; n < nSamples; n++)
     {
-        *(continuousDataFloatBuffer+n) = *(data+n) / scaleFactor;
+        continuousDataIntegerBuffer[n] = (int16) ByteOrder::swapIfLittleEndian((uint16) continuousDataIntegerBuffer[n]);
     }
-    AudioDataConverters::convertFloatToInt16BE(continuousDataFloatBuffer, continuousDataIntegerBuffer, nSamples);
 
     if (blockIndex[channel] == 0)
     {
@@ -552,7 +550,7 @@ void OriginalRecording::writeTimestampAndSampleCount(FILE* file, int channel)
 
     int sourceNodeId = getChannel(channel)->sourceNodeId;
 
-    int64 ts = (*timestamps)[sourceNodeId] + samplesSinceLastTimestamp[channel];
+    int64 ts = blockMetadata->getTimestamp(sourceNodeId) + samplesSinceLastTimestamp[channel];
 
     fwrite(&ts,                       // ptr
            8,                               // size of each element
@@ -90,11 +90,6 @@ private:
     */
     int16* continuousDataIntegerBuffer;
 
-    /** Holds data that has been converted from float to int16 before
-        saving.
-    */
-    float* continuousDataFloatBuffer;
-
     /** Used to indicate the end of each record */
     char* recordMarker;
 
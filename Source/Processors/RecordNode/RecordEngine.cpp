@@ -31,7 +31,7 @@
 #include "OriginalRecording.h"
 
 RecordEngine::RecordEngine()
-    : manager(nullptr)
+    : blockMetadata(nullptr), manager(nullptr)
 {
 }
 
@@ -58,14 +58,9 @@ SpikeRecordInfo* RecordEngine::getSpikeElectrode(int index)
     return AccessClass::getProcessorGraph()->getRecordNode()->getSpikeElectrode(index);
 }
 
-void RecordEngine::updateTimestamps(std::map<uint8, int64>* ts)
+void RecordEngine::setBlockMetadata(const BlockMetadata* metadata)
 {
-    timestamps = ts;
-}
-
-void RecordEngine::updateNumSamples(std::map<uint8, int>* ns)
-{
-    numSamples = ns;
+    blockMetadata = metadata;
 }
 
 
@@ -128,12 +128,9 @@ public:
     */
     virtual void resetChannels();
 
-    /** Called every time a new timestamp event is received
+    /** Gives the engine the sample counts and timestamps of the current block
     */
-    void updateTimestamps(std::map<uint8, int64>* timestamps);
-
-    /** Called every time a new numSamples event is received */
-    void updateNumSamples(std::map<uint8, int>* numSamples);
+    void setBlockMetadata(const BlockMetadata* metadata);
 
     /** Called after all channels and spike groups have been registered,
     	just before acquisition starts
@@ -164,8 +161,8 @@ protected:
     */
     String generateDateString();
 
-    std::map<uint8, int>* numSamples;
-    std::map<uint8, int64>* timestamps;
+    /** Sample counts and timestamps of each stream, by source node ID */
+    const BlockMetadata* blockMetadata;
 
 private:
     RecordEngineManager* manager;
@@ -87,9 +87,9 @@ void RecordNode::setChannelStatus(Channel* ch, bool status)
     setChannel(ch);
 
     if (status)
-        setParameter(2, 1.0f);
+        queueParameterChange(2, 1.0f);
     else
-        setParameter(2, 0.0f);
+        queueParameterChange(2, 0.0f);
 
 }
 
@@ -434,8 +434,7 @@ void RecordNode::process(AudioSampleBuffer& buffer,
                          MidiBuffer& events)
 {
 	//update timstamp data even if we're not recording yet
-	EVERY_ENGINE->updateTimestamps(&timestamps);
-	EVERY_ENGINE->updateNumSamples(&numSamples);
+	EVERY_ENGINE->setBlockMetadata(blockMetadata);
 	
 	// FIRST: cycle through events -- extract the TTLs and the timestamps
     checkForEvents(events);
@@ -63,7 +63,7 @@ void Rectifier::process(AudioSampleBuffer& buffer,
     
     for (int ch = 0; ch < nChannels ; ch++)
     {
-        int nSamples = buffer.getNumSamples();
+        int nSamples = getNumSamples(ch);
         float* bufPtr = buffer.getWritePointer(ch);
         for (int n = 0; n < nSamples; n++)
         {
@@ -0,0 +1,312 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "PolyphaseResampler.h"
+
+#include <cmath>
+
+// number of zero crossings of the sinc on each side of the center tap
+#define RESAMPLER_HALF_WIDTH 8
+
+// largest value allowed for L or M
+#define RESAMPLER_MAX_FACTOR 1024
+
+PolyphaseResampler::PolyphaseResampler()
+    : upFactor(1), downFactor(1), tapsPerPhase(1), numChannels(0),
+      inputCapacity(0), numBuffered(0), inputIndex(0), phase(0), droppedSamples(0)
+{
+}
+
+PolyphaseResampler::~PolyphaseResampler()
+{
+}
+
+void PolyphaseResampler::getRationalApproximation(double ratio, int maxDenominator, int& p, int& q)
+{
+    // continued fraction expansion, stopping before either term gets too large
+    int64 p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+    double x = ratio;
+
+    for (int i = 0; i < 32; i++)
+    {
+        const int64 a = (int64) std::floor(x);
+        const int64 p2 = a * p1 + p0;
+        const int64 q2 = a * q1 + q0;
+
+        if (p2 > maxDenominator || q2 > maxDenominator)
+            break;
+
+        p0 = p1; q0 = q1;
+        p1 = p2; q1 = q2;
+
+        const double remainder = x - (double) a;
+
+        if (remainder < 1e-9 || std::abs((double) p1 / (double) q1 - ratio) < 1e-12 * ratio)
+            break;
+
+        x = 1.0 / remainder;
+    }
+
+    p = jmax(1, (int) p1);
+    q = jmax(1, (int) q1);
+}
+
+void PolyphaseResampler::setRates(double sourceSampleRate, double destSampleRate,
+                                  int numChannels_, int maxBlockSize)
+{
+    numChannels = jmax(1, numChannels_);
+
+    if (sourceSampleRate <= 0 || destSampleRate <= 0)
+        sourceSampleRate = destSampleRate = 1.0;
+
+    getRationalApproximation(destSampleRate / sourceSampleRate, RESAMPLER_MAX_FACTOR,
+                             upFactor, downFactor);
+
+    designFilter();
+
+    inputCapacity = tapsPerPhase + downFactor + 4 * jmax(1, maxBlockSize);
+    inputBuffer.allocate(inputCapacity * numChannels, true);
+    frame.allocate(numChannels, true);
+
+    std::cout << "Resampler: " << sourceSampleRate << " Hz -> " << destSampleRate << " Hz (x"
+              << upFactor << "/" << downFactor << ", " << tapsPerPhase << " taps per phase, "
+              << numChannels << " channels)" << std::endl;
+
+    reset();
+}
+
+void PolyphaseResampler::designFilter()
+{
+    if (upFactor == downFactor)
+    {
+        upFactor = downFactor = 1;
+        tapsPerPhase = 1;
+        coefficients.allocate(1, false);
+        coefficients[0] = 1.0f;
+        return;
+    }
+
+    const int factor = jmax(upFactor, downFactor);
+
+    // cutoff relative to the upsampled rate, slightly below the lower Nyquist frequency
+    const double cutoff = 0.45 / (double) factor;
+
+    tapsPerPhase = (2 * RESAMPLER_HALF_WIDTH * factor + upFactor - 1) / upFactor;
+
+    const int length = tapsPerPhase * upFactor;
+    const double center = (length - 1) / 2.0;
+
+    HeapBlock<double> prototype(length);
+    double sum = 0;
+
+    for (int n = 0; n < length; n++)
+    {
+        const double t = (double) n - center;
+        const double x = 2.0 * double_Pi * cutoff * t;
+        const double sinc = (t == 0) ? 1.0 : std::sin(x) / x;
+
+        // Blackman window
+        const double w = 0.42 - 0.5 * std::cos(2.0 * double_Pi * n / (length - 1))
+                         + 0.08 * std::cos(4.0 * double_Pi * n / (length - 1));
+
+        prototype[n] = 2.0 * cutoff * sinc * w;
+        sum += prototype[n];
+    }
+
+    // each phase sums to (approximately) one, so the passband gain is unity
+    const double scale = (double) upFactor / sum;
+
+    coefficients.allocate(length, false);
+
+    for (int p = 0; p < upFactor; p++)
+    {
+        for (int j = 0; j < tapsPerPhase; j++)
+        {
+            // stored oldest-first, so the newest input sample meets tap 0 of the prototype
+            coefficients[p * tapsPerPhase + j] =
+                (float)(prototype[(tapsPerPhase - 1 - j) * upFactor + p] * scale);
+        }
+    }
+}
+
+void PolyphaseResampler::reset()
+{
+    if (inputBuffer == nullptr)
+        return;
+
+    inputBuffer.clear(inputCapacity * numChannels);
+
+    // the filter history starts out as silence
+    numBuffered = tapsPerPhase - 1;
+    inputIndex = tapsPerPhase - 1;
+    phase = 0;
+    droppedSamples = 0;
+}
+
+int PolyphaseResampler::getMaxOutputSamples(int numInputSamples) const
+{
+    const int64 available = (int64) numBuffered - inputIndex + numInputSamples;
+
+    if (available <= 0)
+        return 0;
+
+    return (int)((available * upFactor) / downFactor) + 1;
+}
+
+int PolyphaseResampler::getNumPendingSamples() const
+{
+    return jmax(0, numBuffered - inputIndex);
+}
+
+int64 PolyphaseResampler::getNumDroppedSamples() const
+{
+    return droppedSamples;
+}
+
+int PolyphaseResampler::process(const float* const* input, int numInputSamples,
+                                float* const* output, int maxOutputSamples)
+{
+    appendInput(input, numInputSamples);
+    return convert(output, maxOutputSamples, false, 1.0f);
+}
+
+int PolyphaseResampler::processAdding(const float* const* input, int numInputSamples,
+                                      float* const* output, int maxOutputSamples, float gain)
+{
+    appendInput(input, numInputSamples);
+    return convert(output, maxOutputSamples, true, gain);
+}
+
+void PolyphaseResampler::appendInput(const float* const* input, int numInputSamples)
+{
+    if (inputBuffer == nullptr || numInputSamples <= 0)
+        return;
+
+    int offset = 0;
+
+    if (numBuffered + numInputSamples > inputCapacity)
+    {
+        // the output side is not keeping up; drop the oldest input
+        const int drop = jmin(numBuffered, numBuffered + numInputSamples - inputCapacity);
+
+        memmove(inputBuffer, inputBuffer + drop * numChannels,
+                (numBuffered - drop) * numChannels * sizeof(float));
+
+        numBuffered -= drop;
+        inputIndex = jmax(tapsPerPhase - 1, inputIndex - drop);
+        droppedSamples += drop;
+
+        if (numInputSamples > inputCapacity - numBuffered)
+        {
+            offset = numInputSamples - (inputCapacity - numBuffered);
+            numInputSamples -= offset;
+            droppedSamples += offset;
+        }
+    }
+
+    float* dest = inputBuffer + numBuffered * numChannels;
+
+    for (int c = 0; c < numChannels; c++)
+    {
+        const float* src = input[c] + offset;
+
+        for (int i = 0; i < numInputSamples; i++)
+            dest[i * numChannels + c] = src[i];
+    }
+
+    numBuffered += numInputSamples;
+}
+
+int PolyphaseResampler::convert(float* const* output, int maxOutputSamples, bool adding, float gain)
+{
+    if (inputBuffer == nullptr)
+        return 0;
+
+    const int nChans = numChannels;
+    const int nTaps = tapsPerPhase;
+    float* const acc = frame;
+
+    int n = 0;
+
+    while (n < maxOutputSamples && inputIndex < numBuffered)
+    {
+        const float* h = coefficients + phase * nTaps;
+        const float* x = inputBuffer + (inputIndex - nTaps + 1) * nChans;
+
+        if (nChans == 1)
+        {
+            float sum = 0;
+
+            for (int j = 0; j < nTaps; j++)
+                sum += h[j] * x[j];
+
+            acc[0] = sum;
+        }
+        else
+        {
+            for (int c = 0; c < nChans; c++)
+                acc[c] = 0;
+
+            // multiply-accumulate across all channels at once
+            for (int j = 0; j < nTaps; j++)
+            {
+                const float coeff = h[j];
+                const float* xj = x + j * nChans;
+
+                for (int c = 0; c < nChans; c++)
+                    acc[c] += coeff * xj[c];
+            }
+        }
+
+        if (adding)
+        {
+            for (int c = 0; c < nChans; c++)
+                output[c][n] += gain * acc[c];
+        }
+        else
+        {
+            for (int c = 0; c < nChans; c++)
+                output[c][n] = acc[c];
+        }
+
+        n++;
+
+        phase += downFactor;
+        inputIndex += phase / upFactor;
+        phase %= upFactor;
+    }
+
+    // discard input that is no longer needed, keeping the filter history
+    const int consumed = jmin(inputIndex - (nTaps - 1), numBuffered);
+
+    if (consumed > 0)
+    {
+        memmove(inputBuffer, inputBuffer + consumed * nChans,
+                (numBuffered - consumed) * nChans * sizeof(float));
+
+        numBuffered -= consumed;
+        inputIndex -= consumed;
+    }
+
+    return n;
+}
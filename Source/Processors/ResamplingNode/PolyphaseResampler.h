@@ -0,0 +1,132 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __POLYPHASERESAMPLER_H_3E0B94D7__
+#define __POLYPHASERESAMPLER_H_3E0B94D7__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Multi-channel rational-ratio resampler.
+
+  The conversion ratio is reduced to L/M (upsample by L, downsample by M),
+  and a windowed-sinc anti-aliasing filter is split into L phases of
+  getTapsPerPhase() coefficients each. Every output sample then costs one
+  short dot product per channel, and only the output samples that are
+  actually needed are computed, so e.g. 30 kHz -> 1 kHz decimation touches
+  each input sample once per output sample instead of filtering the full
+  rate signal.
+
+  Input is stored interleaved (sample-major), so the multiply-accumulate
+  runs across all channels with unit stride and can be vectorised by the
+  compiler. State is kept between calls, so blocks of any size can be fed
+  in; input that cannot be converted yet (because the output is full or the
+  filter needs more look-ahead) is kept for the next call.
+
+  All memory is allocated in setRates(); process() does not allocate.
+
+  @see ResamplingNode, AudioResamplingNode, AudioNode
+
+*/
+
+class PolyphaseResampler
+{
+public:
+    PolyphaseResampler();
+    ~PolyphaseResampler();
+
+    /** Designs the filter for a given conversion and allocates the
+        internal buffers. maxBlockSize is the largest number of input
+        samples that will be passed to process() at once. */
+    void setRates(double sourceSampleRate, double destSampleRate,
+                  int numChannels, int maxBlockSize);
+
+    /** Clears the filter history and any pending input. */
+    void reset();
+
+    /** Resamples numInputSamples from each input channel and writes at most
+        maxOutputSamples to each output channel (starting at index 0).
+        Returns the number of output samples written. */
+    int process(const float* const* input, int numInputSamples,
+                float* const* output, int maxOutputSamples);
+
+    /** Same as process(), but adds the result to the output, scaled by gain. */
+    int processAdding(const float* const* input, int numInputSamples,
+                      float* const* output, int maxOutputSamples, float gain);
+
+    /** Returns the largest number of output samples that numInputSamples
+        new input samples can produce. */
+    int getMaxOutputSamples(int numInputSamples) const;
+
+    /** Number of input samples that have been received but not yet used. */
+    int getNumPendingSamples() const;
+
+    /** Number of input samples that were discarded because the internal
+        buffer was full (i.e. the output side did not keep up). */
+    int64 getNumDroppedSamples() const;
+
+    int getUpsamplingFactor() const     { return upFactor; }
+    int getDownsamplingFactor() const   { return downFactor; }
+    int getTapsPerPhase() const         { return tapsPerPhase; }
+    int getNumChannels() const          { return numChannels; }
+
+    /** Returns true if the source and destination rates are the same. */
+    bool isPassThrough() const          { return upFactor == downFactor; }
+
+private:
+
+    /** Approximates ratio with p/q, where q <= maxDenominator. */
+    static void getRationalApproximation(double ratio, int maxDenominator, int& p, int& q);
+
+    void designFilter();
+
+    void appendInput(const float* const* input, int numInputSamples);
+    int convert(float* const* output, int maxOutputSamples, bool adding, float gain);
+
+    int upFactor;
+    int downFactor;
+    int tapsPerPhase;
+    int numChannels;
+
+    /** L phases of tapsPerPhase coefficients, each stored in time order. */
+    HeapBlock<float> coefficients;
+
+    /** Interleaved input: filter history followed by pending samples. */
+    HeapBlock<float> inputBuffer;
+    int inputCapacity;
+    int numBuffered;
+
+    /** Index (in inputBuffer) of the newest sample used by the next output. */
+    int inputIndex;
+    int phase;
+
+    HeapBlock<float> frame;
+
+    int64 droppedSamples;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PolyphaseResampler);
+
+};
+
+#endif  // __POLYPHASERESAMPLER_H_3E0B94D7__
@@ -28,21 +28,17 @@
 
 ResamplingNode::ResamplingNode()
     : GenericProcessor("Resampler"),
-      targetSampleRate(5000.0f), ratio(1.0)
+      targetSampleRate(1000.0f), sourceBufferSampleRate(30000.0f), inputSourceNodeId(-1),
+      outputTimestamp(0), needsTimestamp(true), acquisitionIsActive(false),
+      rateChangePending(false)
 {
 
-    filter = new Dsp::SmoothedFilterDesign
-    <Dsp::RBJ::Design::LowPass, 1> (1024);
-
     parameters.add(Parameter("Hz",500.0f, 10000.0f, targetSampleRate, 0, true));
 
-    tempBuffer = new AudioSampleBuffer(16, TEMP_BUFFER_WIDTH);
-
 }
 
 ResamplingNode::~ResamplingNode()
 {
-    filter = 0;
 }
 
 AudioProcessorEditor* ResamplingNode::createEditor()
@@ -63,33 +59,45 @@ void ResamplingNode::setParameter(int parameterIndex, float newValue)
         Parameter& p =  parameters.getReference(parameterIndex);
         p.setValue(newValue, 0);
 
+        if (newValue == targetSampleRate)
+            return;
+
         targetSampleRate = newValue;
 
-        settings.sampleRate = targetSampleRate;
+        // The new rate is applied by updateSettings(), which also rebuilds the
+        // filter bank and tells downstream processors. During acquisition this
+        // runs on the processing thread, so the change waits until disable().
+        if (acquisitionIsActive)
+            rateChangePending = true;
+        else
+            CoreServices::updateSignalChain(getEditor());
 
-        ratio = sourceBufferSampleRate / targetSampleRate;
+    }
 
-        for (int i = 0; i < channels.size(); i++)
-        {
-            channels[i]->sampleRate = targetSampleRate;
-        }
+}
 
-        updateFilter();
+bool ResamplingNode::enable()
+{
 
-        //std::cout << "Got parameter update." << std::endl;
-    }
+    resampler.reset();
+    needsTimestamp = true;
 
-    //std::cout << float(p[0]) << std::endl;
+    acquisitionIsActive = true;
+
+    return true;
 
 }
 
-bool ResamplingNode::enable()
+bool ResamplingNode::disable()
 {
 
+    acquisitionIsActive = false;
 
-    tempBuffer->clear();
-
-    updateFilter();
+    if (rateChangePending)
+    {
+        rateChangePending = false;
+        CoreServices::updateSignalChain(getEditor());
+    }
 
     return true;
 
@@ -101,135 +109,68 @@ void ResamplingNode::updateSettings()
     sourceBufferSampleRate = settings.sampleRate;
     settings.sampleRate = targetSampleRate;
 
-    if (getNumInputs() > 0)
-        tempBuffer->setSize(getNumInputs(), TEMP_BUFFER_WIDTH);
+    inputSourceNodeId = (channels.size() > 0) ? channels[0]->sourceNodeId : -1;
 
-    ratio = sourceBufferSampleRate / targetSampleRate;
+    // the resampled block is written to scratch space, then copied back
+    reserveScratch(getNumInputs(), TEMP_BUFFER_WIDTH);
 
     for (int i = 0; i < channels.size(); i++)
     {
         channels[i]->sampleRate = targetSampleRate;
+        channels[i]->sourceNodeId = nodeId; // the resampled channels are a new stream
     }
 
-    updateFilter();
+    updateResampler();
 
 }
 
 
-void ResamplingNode::updateFilter()
+void ResamplingNode::updateResampler()
 {
 
-    double cutoffFreq = (ratio > 1.0) ? 2 * targetSampleRate  // downsample
-                        : targetSampleRate / 2; // upsample
-
-    double sampleFreq = (ratio > 1.0) ? sourceBufferSampleRate // downsample
-                        : targetSampleRate;  // upsample
-
-    Dsp::Params params;
-    params[0] = sampleFreq; // sample rate
-    params[1] = cutoffFreq; // cutoff frequency
-    params[2] = 1.25; //Q //
-
-    filter->setParams(params);
+    resampler.setRates(sourceBufferSampleRate,
+                       targetSampleRate,
+                       jmax(1, getNumInputs()),
+                       TEMP_BUFFER_WIDTH);
 
 }
 
-// void ResamplingNode::releaseResources()
-// {
-// 	//fclose(file);
-// }
-
 void ResamplingNode::process(AudioSampleBuffer& buffer,
                              MidiBuffer& midiMessages)
 {
 
-    //std::cout << "Resampling node sample count: " << nSamples << std::endl; ///buffer.getNumSamples() << std::endl;
-
-    // save data at the beginning of each round of processing
-    //writeContinuousBuffer(buffer.getSampleData(0), nSamples, 0);
+    if (buffer.getNumChannels() < resampler.getNumChannels())
+        return;
 
-    int nSamples = 100; // SOME NUMBER
+    int nSamples = jmin(blockMetadata->getNumSamples(inputSourceNodeId), TEMP_BUFFER_WIDTH);
 
-    int nSamps = float(nSamples);
-    int valuesNeeded = int(nSamps / ratio);
-
-    if (ratio > 1.0001)
+    if (needsTimestamp)
     {
-        // pre-apply filter before downsampling
-        filter->process(nSamples, buffer.getArrayOfWritePointers());
-    }
-
-    // initialize variables
-    tempBuffer->clear();
-    int sourceBufferPos = 0;
-    int sourceBufferSize = buffer.getNumSamples();
-    float subSampleOffset = 0.0;
-    int nextPos = (sourceBufferPos + 1) % sourceBufferSize;
+        outputTimestamp = (int64)((double) blockMetadata->getTimestamp(inputSourceNodeId)
+                                  * targetSampleRate / sourceBufferSampleRate);
 
-    int tempBufferPos;
-
-    // code modified from "juce_ResamplingAudioSource.cpp":
-
-    for (tempBufferPos = 0; tempBufferPos < valuesNeeded; tempBufferPos++)
-    {
-        float gain = 1.0;
-        float alpha = (float) subSampleOffset;
-        float invAlpha = 1.0f - alpha;
-
-        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-        {
-
-            tempBuffer->addFrom(channel, 		// destChannel
-                                tempBufferPos,  // destSampleOffset
-                                buffer,			// source
-                                channel,		// sourceChannel
-                                sourceBufferPos,// sourceSampleOffset
-                                1,				// number of samples
-                                invAlpha*gain);      // gain to apply to source
-
-            tempBuffer->addFrom(channel, 		// destChannel
-                                tempBufferPos,   // destSampleOffset
-                                buffer,			// source
-                                channel,			// sourceChannel
-                                nextPos,		 	// sourceSampleOffset
-                                1,				// number of samples
-                                alpha*gain);     	 // gain to apply to source
-
-        }
-
-        subSampleOffset += ratio;
-
-        while (subSampleOffset >= 1.0)
-        {
-            if (++sourceBufferPos >= sourceBufferSize)
-                sourceBufferPos = 0;
-
-            nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-            subSampleOffset -= 1.0;
-        }
+        needsTimestamp = false;
     }
 
-    // std::cout << sourceBufferPos << " " << tempBufferPos << std::endl;
+    float** output = getScratchChannels(resampler.getNumChannels(), TEMP_BUFFER_WIDTH);
 
+    if (output == nullptr)
+        return;
 
-    if (ratio < 0.9999)
-    {
+    int valuesProduced = resampler.process(buffer.getArrayOfReadPointers(),
+                                           nSamples,
+                                           output,
+                                           jmin(buffer.getNumSamples(), TEMP_BUFFER_WIDTH));
 
-        filter->process(tempBufferPos, tempBuffer->getArrayOfWritePointers());
-        // apply the filter after upsampling
-        ///////filter->process (totalSamples, buffer.getArrayOfChannels());
-    }
-    else if (ratio <= 1.0001)
+    // copy the output back into the original buffer
+    for (int channel = 0; channel < resampler.getNumChannels(); channel++)
     {
-
-        // no resampling is being applied, no need to filter, BUT...
-        // keep the filter stoked with samples to avoid discontinuities
-
+        buffer.copyFrom(channel, 0, output[channel], valuesProduced);
     }
 
-    // copy the tempBuffer back into the original buffer
-    buffer = AudioSampleBuffer(tempBuffer->getArrayOfWritePointers(), 2, tempBufferPos);//buffer.getNumSamples());
+    setTimestamp(midiMessages, outputTimestamp);
+    setNumSamples(midiMessages, valuesProduced);
 
-    nSamples = valuesNeeded;
+    outputTimestamp += valuesProduced;
 
 }
@@ -26,8 +26,8 @@
 
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
-#include "../Dsp/Dsp.h"
 #include "../GenericProcessor/GenericProcessor.h"
+#include "PolyphaseResampler.h"
 
 #define TEMP_BUFFER_WIDTH 5000
 
@@ -35,9 +35,12 @@
 
   Changes the sample rate of continuous data.
 
-  Code is based on Juce's ResamplingAudioSource class.
+  Uses a polyphase FIR resampler, so blocks of any size can be converted
+  and the filter state carries over from one block to the next. The
+  resampled channels form a new data stream: their sourceNodeId is set to
+  this processor, which sends its own sample counts and timestamps.
 
-  @see GenericProcessor
+  @see GenericProcessor, PolyphaseResampler
 
 */
 
@@ -55,9 +58,10 @@ public:
 
     void updateSettings();
 
-    void updateFilter();
+    void updateResampler();
 
     bool enable();
+    bool disable();
 
     AudioProcessorEditor* createEditor();
     bool hasEditor() const
@@ -69,22 +73,22 @@ private:
 
     // sample rate, timebase, and ratio info:
     double targetSampleRate;
-    double sourceBufferSampleRate; //, destBufferSampleRate;
-    double ratio; //, lastRatio;
-    //double destBufferTimebaseSecs;
-    //int destBufferWidth;
-
-    // major objects:
-    Dsp::Filter* filter;
-    //ScopedPointer<AudioSampleBuffer> destBuffer;
-    ScopedPointer<AudioSampleBuffer> tempBuffer;
-
-    // is the destBuffer a temp buffer or not?
-    //bool destBufferIsTempBuffer;
-    //bool isTransmitting;
-
-    // indexing objects that persist between rounds:
-    //int destBufferPos;
+    double sourceBufferSampleRate;
+
+    /** Node ID of the stream being resampled (the channels' original source). */
+    int inputSourceNodeId;
+
+    PolyphaseResampler resampler;
+
+    /** Timestamp of the next output sample, in units of the target rate. */
+    int64 outputTimestamp;
+    bool needsTimestamp;
+
+    /** Set by enable() and cleared by disable(), while no blocks are processed. */
+    bool acquisitionIsActive;
+
+    /** targetSampleRate changed during acquisition and has not been applied yet. */
+    bool rateChangePending;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ResamplingNode);
 
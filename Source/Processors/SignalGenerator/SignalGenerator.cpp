@@ -36,6 +36,9 @@ SignalGenerator::SignalGenerator()
       nOut(5), defaultFrequency(10.0), defaultAmplitude(0.5f),
       previousPhase(1000), spikeDelay(0)
 {
+    startTicks = 0;
+    samplesGenerated = 0;
+
     parameters.add(Parameter("Amplitude", 0.0005f, 500.0f, .5f, 0, true));
     parameters.add(Parameter("Frequency", 0.01, 10000.0, 10, 1, true));
     parameters.add(Parameter("Phase", -double_Pi, double_Pi, 0, 2, true));
@@ -77,10 +80,6 @@ void SignalGenerator::updateSettings()
         currentPhase.add(0);
     }
 
-    sampleRateRatio = getSampleRate() / 44100.0;
-
-    std::cout << "Sample rate ratio: " << sampleRateRatio << std::endl;
-
 }
 
 void SignalGenerator::setParameter(int parameterIndex, float newValue)
@@ -125,6 +124,9 @@ bool SignalGenerator::enable()
 
     std::cout << "Signal generator received enable signal." << std::endl;
 
+    startTicks = 0;
+    samplesGenerated = 0;
+
     // for (int n = 0; n < waveformType.size(); n++)
     // {
     // 	updateWaveform(n);
@@ -187,7 +189,16 @@ void SignalGenerator::process(AudioSampleBuffer& buffer,
                               MidiBuffer& midiMessages)
 {
 
-    int nSamps = int((float) buffer.getNumSamples() * sampleRateRatio);
+    if (startTicks == 0)
+        startTicks = Time::getHighResolutionTicks();
+
+    const double elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+
+    int nSamps = (int) jlimit<int64>(0, buffer.getNumSamples(),
+                                     (int64)(elapsed * getSampleRate()) - samplesGenerated);
+    samplesGenerated += nSamps;
+
+    setNumSamples(midiMessages, nSamps);
 
     for (int i = 0; i < nSamps; ++i)
     {
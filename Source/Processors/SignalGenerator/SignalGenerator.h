@@ -90,7 +90,10 @@ private:
 
     float generateSpikeSample(double amp, double phase, double noise);
 
-    float sampleRateRatio;
+    /** Samples are generated at the sample rate since acquisition started,
+        whatever clock drives the graph */
+    int64 startTicks;
+    int64 samplesGenerated;
 
     //void updateWaveform(int chan);
 
@@ -136,7 +136,7 @@ void SignalGeneratorEditor::buttonEvent(Button* button)
             {
 
                 p->setCurrentChannel(chans[n]);
-                p->setParameter(3,(float) i);
+                p->queueParameterChange(3,(float) i);
 
             }
 
@@ -187,7 +187,7 @@ void SignalGeneratorEditor::sliderEvent(Slider* slider)
     {
 
         p->setCurrentChannel(chans[n]);
-        p->setParameter(paramIndex, slider->getValue());
+        p->queueParameterChange(paramIndex, slider->getValue());
 
     }
 
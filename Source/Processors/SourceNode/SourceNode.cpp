@@ -30,12 +30,17 @@
 #include "../DataThreads/EcubeEditor.h" // Added by Michael Borisov
 #include "../Channel/Channel.h"
 #include <stdio.h>
+#if JUCE_MSVC
+#include <intrin.h>
+#endif
 #include "../../AccessClass.h"
+#include "../../Audio/AudioComponent.h"
+#include "../ProcessorGraph/LatencyMonitor.h"
 
 SourceNode::SourceNode(const String& name_)
     : GenericProcessor(name_),
       sourceCheckInterval(2000), wasDisabled(true), dataThread(0),
-      inputBuffer(0), ttlState(0)
+      inputBuffer(0), eventChannelState(0), ttlState(0)
 {
 
     std::cout << "creating source node." << std::endl;
@@ -67,17 +72,11 @@ SourceNode::SourceNode(const String& name_)
         }
 
         numEventChannels = dataThread->getNumEventChannels();
-        eventChannelState = new int[numEventChannels];
-        for (int i = 0; i < numEventChannels; i++)
-        {
-            eventChannelState[i] = 0;
-        }
 
     }
     else
     {
         enabledState(false);
-        eventChannelState = 0;
         numEventChannels = 0;
     }
 
@@ -85,7 +84,6 @@ SourceNode::SourceNode(const String& name_)
     startTimer(sourceCheckInterval);
 
     timestamp = 0;
-    eventCodeBuffer = new uint64[10000]; //10000 samples per buffer max?
 
 
 }
@@ -98,10 +96,6 @@ SourceNode::~SourceNode()
         std::cout << "Forcing thread to stop." << std::endl;
         dataThread->stopThread(500);
     }
-
-
-    if (eventChannelState)
-        delete[] eventChannelState;
 }
 
 DataThread* SourceNode::getThread()
@@ -215,6 +209,14 @@ float SourceNode::getBitVolts(Channel* chan)
         return 1.0f;
 }
 
+float SourceNode::getOffsetVolts(Channel* chan)
+{
+    if (dataThread != 0)
+        return dataThread->getOffsetVolts(chan);
+    else
+        return 0.0f;
+}
+
 
 void SourceNode::enabledState(bool t)
 {
@@ -316,6 +318,23 @@ bool SourceNode::enable()
 
     if (dataThread != 0)
     {
+        if (inputBuffer != 0)
+        {
+            inputBuffer->setRecordsArrivalTimes(LatencyMonitor::getActive() != nullptr);
+            inputBuffer->setDataAddedEvent(AccessClass::getAudioComponent()->getDataAddedEvent());
+
+            // compact samples are stored in steps of their channel's bitVolts
+            const int numDataChannels = jmin(channels.size(), inputBuffer->getNumChannels());
+
+            for (int chan = 0; chan < numDataChannels; chan++)
+                inputBuffer->setChannelStep(chan, channels[chan]->bitVolts, channels[chan]->offsetVolts);
+
+            if (inputBuffer->getFormat() != CompactSampleBuffer::FLOAT32)
+                std::cout << "Source node buffer holds "
+                          << CompactSampleBuffer::getFormatName(inputBuffer->getFormat())
+                          << " samples" << std::endl;
+        }
+
         dataThread->startAcquisition();
         return true;
     }
@@ -359,84 +378,126 @@ void SourceNode::acquisitionStopped()
 }
 
 
+namespace
+{
+    inline int lowestSetBit(uint32 x)
+    {
+#if JUCE_MSVC
+        unsigned long index;
+        _BitScanForward(&index, x);
+        return (int) index;
+#else
+        return __builtin_ctz(x);
+#endif
+    }
+
+    /** Index of the lowest set bit of a nonzero word */
+    inline int lowestSetBit(uint64 x)
+    {
+        const uint32 low = (uint32) x;
+
+        return low != 0 ? lowestSetBit(low) : 32 + lowestSetBit((uint32)(x >> 32));
+    }
+}
+
 void SourceNode::process(AudioSampleBuffer& buffer,
                          MidiBuffer& events)
 {
 
     //std::cout << "SOURCE NODE" << std::endl;
 
-    // clear the input buffers
     events.clear();
-    buffer.clear();
 
-    int nSamples = inputBuffer->readAllFromBuffer(buffer, &timestamp, eventCodeBuffer, buffer.getNumSamples());
+    // read the samples straight into the output buffer (converting them if
+    // the DataBuffer holds compact samples), rather than through a copy
+    int startIndex1, blockSize1, startIndex2, blockSize2;
+    const int nSamples = inputBuffer->prepareToRead(buffer.getNumSamples(),
+                                                    startIndex1, blockSize1, startIndex2, blockSize2);
 
-    setNumSamples(events, nSamples);
-    setTimestamp(events, timestamp);
+    const int numDataChannels = jmin(buffer.getNumChannels(), inputBuffer->getNumChannels());
 
-    //std::cout << *buffer.getReadPointer(0) << std::endl;
+    for (int chan = 0; chan < numDataChannels; chan++)
+    {
+        if (blockSize1 > 0)
+            inputBuffer->readSamples(chan, startIndex1, buffer.getWritePointer(chan), blockSize1);
 
-    //std::cout << "Source node timestamp: " << timestamp << std::endl;
+        if (blockSize2 > 0)
+            inputBuffer->readSamples(chan, startIndex2, buffer.getWritePointer(chan, blockSize1), blockSize2);
+    }
 
-    //std::cout << "Samples per buffer: " << nSamples << std::endl;
+    // only clear what wasn't overwritten
+    if (nSamples < buffer.getNumSamples())
+        buffer.clear(nSamples, buffer.getNumSamples() - nSamples);
 
+    for (int chan = numDataChannels; chan < buffer.getNumChannels(); chan++)
+        buffer.clear(chan, 0, nSamples);
 
+    if (nSamples > 0)
+        timestamp = (uint64) *inputBuffer->getTimestamps(startIndex1);
+
+    setNumSamples(events, nSamples);
+    setTimestamp(events, timestamp);
 
+    //std::cout << "Source node timestamp: " << timestamp << std::endl;
 
-    // std::cout << (int) *(data + 7) << " " <<
-    //                 (int) *(data + 6) << " " <<
-    //                 (int) *(data + 5) << " " <<
-    //                 (int) *(data + 4) << " " <<
-    //                 (int) *(data + 3) << " " <<
-    //                 (int) *(data + 2) << " " <<
-    //                 (int) *(data + 1) << " " <<
-    //                 (int) *(data + 0) << std::endl;
+    //std::cout << "Samples per buffer: " << nSamples << std::endl;
 
+    if (LatencyMonitor* latencyMonitor = LatencyMonitor::getActive())
+    {
+        latencyMonitor->setBlockArrivals(getNodeId(),
+                                         inputBuffer->getArrivalTimes(startIndex1), blockSize1,
+                                         inputBuffer->getArrivalTimes(startIndex2), blockSize2);
+    }
 
     // fill event buffer
-    for (int i = 0; i < nSamples; i++)
+    if (numEventChannels > 0)
     {
-        for (int c = 0; c < numEventChannels; c++)
-        {
-            int state = eventCodeBuffer[i] & (1 << c);
+        addTtlEvents(events, inputBuffer->getEventCodes(startIndex1), blockSize1, 0);
+        addTtlEvents(events, inputBuffer->getEventCodes(startIndex2), blockSize2, blockSize1);
+    }
 
-            if (eventChannelState[c] != state)
-            {
-                if (state == 0)
-                {
+    inputBuffer->finishedRead(nSamples);
 
-                    //std::cout << "OFF" << std::endl;
-                    //std::cout << c << std::endl;
-                    // signal channel state is OFF
-                    addEvent(events, // MidiBuffer
-                             TTL,    // eventType
-                             i,      // sampleNum
-                             0,	     // eventID
-                             c		 // eventChannel
-                            );
-                }
-                else
-                {
+}
+
+void SourceNode::addTtlEvents(MidiBuffer& events, const uint64* eventCodes, int numSamples, int firstSampleNum)
+{
+    const uint64 mask = numEventChannels >= 64 ? ~(uint64) 0 : ((uint64) 1 << numEventChannels) - 1;
+
+    uint64 state = eventChannelState;
 
-                    // std::cout << "ON" << std::endl;
-                    // std::cout << c << std::endl;
+    for (int i = 0; i < numSamples; i++)
+    {
+        // skip unchanged event codes four at a time
+        if (i + 4 <= numSamples
+            && (((eventCodes[i] ^ state) | (eventCodes[i + 1] ^ state)
+                 | (eventCodes[i + 2] ^ state) | (eventCodes[i + 3] ^ state)) & mask) == 0)
+        {
+            i += 3;
+            continue;
+        }
 
-                    // signal channel state is ON
-                    addEvent(events, // MidiBuffer
-                             TTL,    // eventType
-                             i,      // sampleNum
-                             1,		 // eventID
-                             c		 // eventChannel
-                            );
+        uint64 changed = (eventCodes[i] ^ state) & mask;
 
+        // one event per changed bit, in channel order
+        while (changed != 0)
+        {
+            const int c = lowestSetBit(changed);
 
-                }
+            addEvent(events,                         // MidiBuffer
+                     TTL,                            // eventType
+                     firstSampleNum + i,             // sampleNum
+                     (uint8)((eventCodes[i] >> c) & 1), // eventID (1 = ON, 0 = OFF)
+                     (uint8) c                       // eventChannel
+                    );
 
-                eventChannelState[c] = state;
-            }
+            changed &= changed - 1;
         }
+
+        state = eventCodes[i] & mask;
     }
 
+    eventChannelState = state;
 }
 
 
@@ -64,6 +64,7 @@ public:
 
     int getNumEventChannels();
     float getBitVolts(Channel* chan);
+    float getOffsetVolts(Channel* chan);
 
     void requestChainUpdate();
 
@@ -118,13 +119,17 @@ private:
     DataBuffer* inputBuffer;
 
     uint64 timestamp;
-    uint64* eventCodeBuffer;
-    int* eventChannelState;
+
+    /** Last state of the event channels, one bit per channel */
+    uint64 eventChannelState;
 
     int ttlState;
 
     void updateSettings();
 
+    /** Adds a TTL event for every bit of the event codes that changed.*/
+    void addTtlEvents(MidiBuffer& events, const uint64* eventCodes, int numSamples, int firstSampleNum);
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SourceNode);
 
 };
@@ -0,0 +1,391 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SpectralAnalyzer.h"
+#include "SpectralAnalyzerEditor.h"
+#include "../Channel/Channel.h"
+
+static const char* bandNames[SpectralAnalyzer::NUM_BANDS] = { "theta", "gamma", "ripple" };
+static const float bandEdges[SpectralAnalyzer::NUM_BANDS][2] = { { 4.0f, 12.0f }, { 30.0f, 80.0f }, { 150.0f, 250.0f } };
+
+SpectralAnalyzer::SpectralAnalyzer()
+    : GenericProcessor("Spectral Analyzer"), fftSize(1024), hopSize(256), numAverages(4),
+      inputSampleRate(30000.0), inputSourceNodeId(-1), numInputChannels(0), powerScale(0),
+      historyIndex(0), samplesUntilHop(256), averageIndex(0), numSegments(0),
+      outputTimestamp(0), needsTimestamp(true),
+      spectrogramFifo(SPECTROGRAM_FIFO_ROWS), spectrogramRowSize(0)
+{
+    Array<var> fftSizes;
+    fftSizes.add(256);
+    fftSizes.add(512);
+    fftSizes.add(1024);
+    fftSizes.add(2048);
+    fftSizes.add(4096);
+    fftSizes.add(8192);
+
+    parameters.add(Parameter("FFT size", fftSizes, 2, 0, true));
+
+    Array<var> averages;
+    averages.add(1);
+    averages.add(2);
+    averages.add(4);
+    averages.add(8);
+
+    parameters.add(Parameter("Averages", averages, 2, 1, true));
+
+    spectrogramChannel.set(-1);
+}
+
+SpectralAnalyzer::~SpectralAnalyzer()
+{
+}
+
+AudioProcessorEditor* SpectralAnalyzer::createEditor()
+{
+    editor = new SpectralAnalyzerEditor(this, true);
+    return editor;
+}
+
+String SpectralAnalyzer::getBandName(int band)
+{
+    return bandNames[band];
+}
+
+float SpectralAnalyzer::getBandLow(int band)
+{
+    return bandEdges[band][0];
+}
+
+float SpectralAnalyzer::getBandHigh(int band)
+{
+    return bandEdges[band][1];
+}
+
+void SpectralAnalyzer::setParameter(int parameterIndex, float newValue)
+{
+    editor->updateParameterButtons(parameterIndex);
+
+    if (parameterIndex == 0)
+    {
+        const int newSize = (int) newValue;
+
+        if (newSize != fftSize && isPowerOfTwo(newSize))
+        {
+            fftSize = newSize;
+            hopSize = fftSize / 4;
+
+            // the output rate changed
+            CoreServices::updateSignalChain(editor);
+        }
+    }
+    else if (parameterIndex == 1)
+    {
+        numAverages = jmax(1, (int) newValue);
+        allocate();
+    }
+}
+
+void SpectralAnalyzer::updateSettings()
+{
+    numInputChannels = getNumInputs();
+    inputSourceNodeId = (channels.size() > 0) ? channels[0]->sourceNodeId : -1;
+    inputSampleRate = (channels.size() > 0) ? channels[0]->sampleRate : settings.sampleRate;
+
+    const double outputSampleRate = getOutputSampleRate();
+
+    // one output channel per input channel and band, as a new stream
+    inputChannelNames.clear();
+
+    OwnedArray<Channel> bandChannels;
+
+    for (int i = 0; i < channels.size(); i++)
+    {
+        inputChannelNames.add(channels[i]->getName());
+
+        for (int band = 0; band < NUM_BANDS; band++)
+        {
+            Channel* ch = new Channel(*channels[i]);
+            ch->setProcessor(this);
+            ch->setName(channels[i]->getName() + " " + getBandName(band));
+            ch->sampleRate = (float) outputSampleRate;
+            ch->sourceNodeId = nodeId;
+            ch->nodeIndex = bandChannels.size();
+            ch->mappedIndex = bandChannels.size();
+            bandChannels.add(ch);
+        }
+    }
+
+    channels.clear();
+
+    while (bandChannels.size() > 0)
+        channels.add(bandChannels.removeAndReturn(0));
+
+    settings.sampleRate = (float) outputSampleRate;
+    settings.numOutputs = channels.size();
+
+    allocate();
+
+    for (int band = 0; band < NUM_BANDS; band++)
+    {
+        if (getBandHigh(band) > inputSampleRate / 2)
+            std::cout << "Spectral Analyzer: the " << getBandName(band) << " band is above the Nyquist frequency." << std::endl;
+        else if (getBandHigh(band) - getBandLow(band) < getBinWidth())
+            std::cout << "Spectral Analyzer: the " << getBandName(band) << " band is narrower than one FFT bin ("
+                      << getBinWidth() << " Hz)." << std::endl;
+    }
+}
+
+void SpectralAnalyzer::allocate()
+{
+    const int numChannels = jmax(1, numInputChannels);
+    const int numBins = fftSize / 2 + 1;
+
+    if (fft == nullptr || fft->getSize() != fftSize)
+        fft = new FastFourierTransform(fftSize);
+
+    // Hann window; the power scale gives one-sided band powers in (input units)^2
+    window.malloc(fftSize);
+    double sumSquares = 0;
+
+    for (int i = 0; i < fftSize; i++)
+    {
+        window[i] = (float)(0.5 - 0.5 * cos(2.0 * double_Pi * i / fftSize));
+        sumSquares += window[i] * window[i];
+    }
+
+    powerScale = (float)(2.0 / (fftSize * sumSquares));
+
+    history.calloc(numChannels * fftSize);
+    fftBuffer.malloc(2 * fftSize);
+    powerA.malloc(numBins);
+    powerB.malloc(numBins);
+
+    const double binWidth = getBinWidth();
+
+    for (int band = 0; band < NUM_BANDS; band++)
+    {
+        bandStartBin[band] = jlimit(1, numBins - 1, (int) ceil(getBandLow(band) / binWidth));
+        bandEndBin[band] = jlimit(1, numBins - 1, (int) floor(getBandHigh(band) / binWidth));
+
+        if (bandEndBin[band] < bandStartBin[band]) // narrower than a bin: use the nearest one
+            bandStartBin[band] = bandEndBin[band] = jlimit(1, numBins - 1,
+                                                           roundToInt(0.5 * (getBandLow(band) + getBandHigh(band)) / binWidth));
+    }
+
+    bandHistory.calloc(numChannels * NUM_BANDS * numAverages);
+    spectrumHistory.calloc(numAverages * numBins);
+
+    spectrogramRowSize = numBins;
+    spectrogramRows.malloc(SPECTROGRAM_FIFO_ROWS * numBins);
+    spectrogramFifo.reset();
+
+    historyIndex = 0;
+    samplesUntilHop = hopSize;
+    averageIndex = 0;
+    numSegments = 0;
+}
+
+bool SpectralAnalyzer::enable()
+{
+    allocate();
+    needsTimestamp = true;
+
+    return true;
+}
+
+int SpectralAnalyzer::getNumSpectrumBins()
+{
+    return fftSize / 2 + 1;
+}
+
+double SpectralAnalyzer::getBinWidth()
+{
+    return inputSampleRate / fftSize;
+}
+
+double SpectralAnalyzer::getOutputSampleRate()
+{
+    return inputSampleRate / hopSize;
+}
+
+void SpectralAnalyzer::setSpectrogramChannel(int channel)
+{
+    spectrogramChannel.set(channel);
+}
+
+int SpectralAnalyzer::readSpectrogramRows(float* dest, int maxRows)
+{
+    int start1, size1, start2, size2;
+    spectrogramFifo.prepareToRead(maxRows, start1, size1, start2, size2);
+
+    if (size1 > 0)
+        memcpy(dest, spectrogramRows + start1 * spectrogramRowSize, size1 * spectrogramRowSize * sizeof(float));
+    if (size2 > 0)
+        memcpy(dest + size1 * spectrogramRowSize, spectrogramRows + start2 * spectrogramRowSize,
+               size2 * spectrogramRowSize * sizeof(float));
+
+    spectrogramFifo.finishedRead(size1 + size2);
+
+    return size1 + size2;
+}
+
+void SpectralAnalyzer::pushSpectrogramRow(const float* power)
+{
+    const int numBins = getNumSpectrumBins();
+
+    // Welch average of the displayed channel's last windows
+    FloatVectorOperations::copy(spectrumHistory + averageIndex * numBins, power, numBins);
+
+    int start1, size1, start2, size2;
+    spectrogramFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+        return; // the canvas is not reading; drop the row
+
+    float* row = spectrogramRows + start1 * spectrogramRowSize;
+    FloatVectorOperations::clear(row, numBins);
+
+    for (int s = 0; s < numSegments; s++)
+        FloatVectorOperations::add(row, spectrumHistory + s * numBins, numBins);
+
+    FloatVectorOperations::multiply(row, powerScale / numSegments, numBins);
+
+    spectrogramFifo.finishedWrite(1);
+}
+
+void SpectralAnalyzer::readWindow(int channel, float* dest, int stride)
+{
+    // the oldest sample is at historyIndex
+    const float* h = history + channel * fftSize;
+    const int firstPart = fftSize - historyIndex;
+
+    for (int i = 0; i < firstPart; i++)
+        dest[i * stride] = h[historyIndex + i] * window[i];
+
+    for (int i = firstPart; i < fftSize; i++)
+        dest[i * stride] = h[i - firstPart] * window[i];
+}
+
+void SpectralAnalyzer::computeHop(AudioSampleBuffer& buffer, int outputIndex)
+{
+    numSegments = jmin(numSegments + 1, numAverages);
+
+    const int displayChannel = spectrogramChannel.get();
+
+    // two real channels per complex transform
+    for (int ch = 0; ch < numInputChannels; ch += 2)
+    {
+        const bool hasPair = ch + 1 < numInputChannels;
+
+        readWindow(ch, fftBuffer, 2);
+
+        if (hasPair)
+            readWindow(ch + 1, fftBuffer + 1, 2);
+        else
+            for (int i = 0; i < fftSize; i++)
+                fftBuffer[2 * i + 1] = 0;
+
+        fft->perform(fftBuffer);
+        fft->powerSpectra(fftBuffer, powerA, hasPair ? powerB.getData() : nullptr);
+
+        for (int p = 0; p < (hasPair ? 2 : 1); p++)
+        {
+            const int channel = ch + p;
+            const float* power = (p == 0) ? powerA : powerB;
+
+            for (int band = 0; band < NUM_BANDS; band++)
+            {
+                float bandPower = 0;
+
+                for (int k = bandStartBin[band]; k <= bandEndBin[band]; k++)
+                    bandPower += power[k];
+
+                float* segments = bandHistory + (channel * NUM_BANDS + band) * numAverages;
+                segments[averageIndex] = bandPower * powerScale;
+
+                float average = 0;
+                for (int s = 0; s < numSegments; s++)
+                    average += segments[s];
+
+                // output as an RMS amplitude, in the units of the input
+                buffer.setSample(channel * NUM_BANDS + band, outputIndex, sqrt(average / numSegments));
+            }
+
+            if (channel == displayChannel)
+                pushSpectrogramRow(power);
+        }
+    }
+
+    averageIndex = (averageIndex + 1) % numAverages;
+}
+
+void SpectralAnalyzer::process(AudioSampleBuffer& buffer, MidiBuffer& events)
+{
+    if (numInputChannels == 0 || buffer.getNumChannels() < getNumOutputs())
+        return;
+
+    const int nSamples = jmin(blockMetadata->getNumSamples(inputSourceNodeId), buffer.getNumSamples());
+
+    if (needsTimestamp)
+    {
+        outputTimestamp = (int64)((double) blockMetadata->getTimestamp(inputSourceNodeId) / hopSize);
+        needsTimestamp = false;
+    }
+
+    int numOutputs = 0;
+    int position = 0;
+
+    while (position < nSamples)
+    {
+        const int chunk = jmin(samplesUntilHop, nSamples - position);
+        const int firstPart = jmin(chunk, fftSize - historyIndex);
+
+        for (int ch = 0; ch < numInputChannels; ch++)
+        {
+            float* h = history + ch * fftSize;
+            const float* input = buffer.getReadPointer(ch, position);
+
+            memcpy(h + historyIndex, input, firstPart * sizeof(float));
+
+            if (chunk > firstPart)
+                memcpy(h, input + firstPart, (chunk - firstPart) * sizeof(float));
+        }
+
+        historyIndex = (historyIndex + chunk) % fftSize;
+        samplesUntilHop -= chunk;
+        position += chunk;
+
+        if (samplesUntilHop == 0)
+        {
+            // output sample n is written at index n, which is behind every
+            // input sample that has not been copied to the history yet
+            computeHop(buffer, numOutputs++);
+            samplesUntilHop = hopSize;
+        }
+    }
+
+    setTimestamp(events, outputTimestamp);
+    setNumSamples(events, numOutputs);
+
+    outputTimestamp += numOutputs;
+}
@@ -0,0 +1,149 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SPECTRALANALYZER_H_A4C2E817__
+#define __SPECTRALANALYZER_H_A4C2E817__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../GenericProcessor/GenericProcessor.h"
+#include "../Visualization/FastFourierTransform.h"
+
+#define SPECTROGRAM_FIFO_ROWS 128
+
+/**
+
+  Computes the power in the theta, gamma and ripple bands of every input
+  channel with a streaming short-time Fourier transform.
+
+  Every hop (a quarter of the FFT size), the last FFT-size samples of each
+  channel are Hann-windowed and transformed, two channels per complex FFT.
+  The band powers are averaged over the last few windows (Welch's method)
+  and output as RMS amplitudes, in the input's units: one channel per input
+  channel and band, at the hop rate. Like the Resampler, the outputs are a
+  new stream with their own sample counts and timestamps.
+
+  The cost per channel is one half-size FFT per hop, whatever the number of
+  bands, instead of one filter and rectifier chain per band. For theta at
+  acquisition rates, decimate first with a Resampler so that a small FFT
+  still resolves a few Hz.
+
+  While its canvas is open, the averaged spectrum of one channel is also
+  sent to the SpectrogramCanvas through a lock-free FIFO.
+
+  @see SpectralAnalyzerEditor, SpectrogramCanvas, FastFourierTransform
+
+*/
+
+class SpectralAnalyzer : public GenericProcessor
+{
+public:
+    SpectralAnalyzer();
+    ~SpectralAnalyzer();
+
+    AudioProcessorEditor* createEditor();
+    bool hasEditor() const
+    {
+        return true;
+    }
+
+    void process(AudioSampleBuffer& buffer, MidiBuffer& events);
+    void setParameter(int parameterIndex, float newValue);
+
+    void updateSettings();
+    bool enable();
+
+    enum Band { THETA, GAMMA, RIPPLE, NUM_BANDS };
+
+    /** Name and edges (Hz) of a band */
+    static String getBandName(int band);
+    static float getBandLow(int band);
+    static float getBandHigh(int band);
+
+    /** Selects the channel shown by the spectrogram (-1 for none).*/
+    void setSpectrogramChannel(int channel);
+
+    /** Copies up to maxRows averaged power spectra of the spectrogram channel,
+        getNumSpectrumBins() values each, and returns the number copied.*/
+    int readSpectrogramRows(float* dest, int maxRows);
+
+    int getNumSpectrumBins();
+    double getBinWidth();
+    double getOutputSampleRate();
+
+    /** Names of the input channels, for the spectrogram's channel list */
+    StringArray inputChannelNames;
+
+private:
+
+    /** Allocates the tables and buffers for the current FFT size.*/
+    void allocate();
+
+    /** Transforms the current windows of all channels and writes one output sample.*/
+    void computeHop(AudioSampleBuffer& buffer, int outputIndex);
+
+    /** Copies one channel's window out of its history ring, Hann-windowed.*/
+    void readWindow(int channel, float* dest, int stride);
+
+    void pushSpectrogramRow(const float* power);
+
+    int fftSize;
+    int hopSize;
+    int numAverages;
+
+    double inputSampleRate;
+    int inputSourceNodeId;
+    int numInputChannels;
+
+    ScopedPointer<FastFourierTransform> fft;
+    HeapBlock<float> window;
+    float powerScale;
+
+    /** The last fftSize samples of each channel */
+    HeapBlock<float> history;
+    int historyIndex;
+    int samplesUntilHop;
+
+    HeapBlock<float> fftBuffer;
+    HeapBlock<float> powerA, powerB;
+
+    int bandStartBin[NUM_BANDS];
+    int bandEndBin[NUM_BANDS];
+
+    /** Band powers of the last numAverages windows, per channel and band */
+    HeapBlock<float> bandHistory;
+    int averageIndex;
+    int numSegments;
+
+    int64 outputTimestamp;
+    bool needsTimestamp;
+
+    Atomic<int> spectrogramChannel;
+    HeapBlock<float> spectrumHistory;
+    HeapBlock<float> spectrogramRows;
+    AbstractFifo spectrogramFifo;
+    int spectrogramRowSize;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectralAnalyzer);
+};
+
+#endif  // __SPECTRALANALYZER_H_A4C2E817__
@@ -0,0 +1,51 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SpectralAnalyzerEditor.h"
+#include "SpectralAnalyzer.h"
+#include "SpectrogramCanvas.h"
+
+
+SpectralAnalyzerEditor::SpectralAnalyzerEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors=true)
+    : VisualizerEditor(parentNode, useDefaultParameterEditors)
+
+{
+
+    tabText = "Spectrum";
+
+    desiredWidth = 250;
+
+}
+
+SpectralAnalyzerEditor::~SpectralAnalyzerEditor()
+{
+}
+
+
+Visualizer* SpectralAnalyzerEditor::createNewCanvas()
+{
+
+    SpectralAnalyzer* processor = (SpectralAnalyzer*) getProcessor();
+    return new SpectrogramCanvas(processor);
+
+}
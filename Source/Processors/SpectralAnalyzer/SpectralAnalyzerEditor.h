@@ -0,0 +1,55 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SPECTRALANALYZEREDITOR_H_5D17B2E9__
+#define __SPECTRALANALYZEREDITOR_H_5D17B2E9__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../Editors/VisualizerEditor.h"
+
+class Visualizer;
+
+/**
+
+  User interface for the SpectralAnalyzer: FFT size and number of averaged
+  windows, and a tab or window for the spectrogram.
+
+  @see SpectralAnalyzer, SpectrogramCanvas
+
+*/
+
+class SpectralAnalyzerEditor : public VisualizerEditor
+{
+public:
+    SpectralAnalyzerEditor(GenericProcessor*, bool useDefaultParameterEditors);
+    ~SpectralAnalyzerEditor();
+
+    Visualizer* createNewCanvas();
+
+private:
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectralAnalyzerEditor);
+
+};
+
+#endif  // __SPECTRALANALYZEREDITOR_H_5D17B2E9__
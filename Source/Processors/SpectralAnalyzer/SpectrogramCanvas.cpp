@@ -0,0 +1,236 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SpectrogramCanvas.h"
+#include "SpectralAnalyzer.h"
+
+#define SPECTROGRAM_COLUMNS 512
+#define DYNAMIC_RANGE_DB 50.0f
+#define PEAK_DECAY_DB 0.05f
+
+static const float maxFrequencies[] = { 100.0f, 300.0f, 1000.0f, 0.0f }; // 0 = Nyquist
+
+SpectrogramCanvas::SpectrogramCanvas(SpectralAnalyzer* processor_)
+    : processor(processor_), rowSize(0), peakDb(-200.0f), isAnimating(false)
+{
+    channelSelector = new ComboBox("Channel");
+    channelSelector->addListener(this);
+    addAndMakeVisible(channelSelector);
+
+    rangeSelector = new ComboBox("Range");
+    rangeSelector->addItem("0-100 Hz", 1);
+    rangeSelector->addItem("0-300 Hz", 2);
+    rangeSelector->addItem("0-1000 Hz", 3);
+    rangeSelector->addItem("Full", 4);
+    rangeSelector->setSelectedId(2, dontSendNotification);
+    rangeSelector->addListener(this);
+    addAndMakeVisible(rangeSelector);
+
+    update();
+}
+
+SpectrogramCanvas::~SpectrogramCanvas()
+{
+    processor->setSpectrogramChannel(-1);
+}
+
+void SpectrogramCanvas::update()
+{
+    const int selected = channelSelector->getSelectedId();
+
+    channelSelector->clear(dontSendNotification);
+
+    for (int i = 0; i < processor->inputChannelNames.size(); i++)
+        channelSelector->addItem(processor->inputChannelNames[i], i + 1);
+
+    if (channelSelector->getNumItems() > 0)
+        channelSelector->setSelectedId(jlimit(1, channelSelector->getNumItems(), selected), dontSendNotification);
+
+    image = Image();
+
+    if (isAnimating)
+        processor->setSpectrogramChannel(channelSelector->getSelectedId() - 1);
+}
+
+void SpectrogramCanvas::refreshState()
+{
+    repaint();
+}
+
+void SpectrogramCanvas::beginAnimation()
+{
+    isAnimating = true;
+    processor->setSpectrogramChannel(channelSelector->getSelectedId() - 1);
+    startCallbacks();
+}
+
+void SpectrogramCanvas::endAnimation()
+{
+    isAnimating = false;
+    processor->setSpectrogramChannel(-1);
+    stopCallbacks();
+}
+
+void SpectrogramCanvas::comboBoxChanged(ComboBox* comboBox)
+{
+    if (comboBox == channelSelector && isAnimating)
+        processor->setSpectrogramChannel(channelSelector->getSelectedId() - 1);
+
+    image = Image(); // start over
+    repaint();
+}
+
+int SpectrogramCanvas::getNumDisplayedBins()
+{
+    const float maxFrequency = maxFrequencies[jlimit(1, 4, rangeSelector->getSelectedId()) - 1];
+    const int numBins = processor->getNumSpectrumBins();
+
+    if (maxFrequency <= 0)
+        return numBins;
+
+    return jlimit(1, numBins, (int) ceil(maxFrequency / processor->getBinWidth()) + 1);
+}
+
+void SpectrogramCanvas::refresh()
+{
+    const int numBins = processor->getNumSpectrumBins();
+
+    if (numBins != rowSize)
+    {
+        rows.malloc(SPECTROGRAM_FIFO_ROWS * numBins);
+        rowSize = numBins;
+        image = Image();
+    }
+
+    const int numRows = processor->readSpectrogramRows(rows, SPECTROGRAM_FIFO_ROWS);
+
+    if (numRows == 0)
+        return;
+
+    for (int r = 0; r < numRows; r++)
+        addColumn(rows + r * rowSize);
+
+    repaint();
+}
+
+void SpectrogramCanvas::addColumn(const float* power)
+{
+    const int height = getNumDisplayedBins();
+
+    if (image.isNull() || image.getHeight() != height)
+        image = Image(Image::RGB, SPECTROGRAM_COLUMNS, height, true);
+
+    image.moveImageSection(0, 0, 1, 0, SPECTROGRAM_COLUMNS - 1, height);
+
+    float columnPeak = -200.0f;
+
+    for (int k = 0; k < height; k++)
+        columnPeak = jmax(columnPeak, 10.0f * log10f(power[k] + 1e-20f));
+
+    peakDb = jmax(columnPeak, peakDb - PEAK_DECAY_DB);
+
+    for (int k = 0; k < height; k++)
+    {
+        const float db = 10.0f * log10f(power[k] + 1e-20f);
+        const float level = jlimit(0.0f, 1.0f, (db - peakDb + DYNAMIC_RANGE_DB) / DYNAMIC_RANGE_DB);
+
+        // blue (quiet) to red (loud), low frequencies at the bottom
+        image.setPixelAt(SPECTROGRAM_COLUMNS - 1, height - 1 - k,
+                         level > 0 ? Colour::fromHSV(0.66f * (1.0f - level), 1.0f, 0.3f + 0.7f * level, 1.0f)
+                         : Colours::black);
+    }
+}
+
+void SpectrogramCanvas::resized()
+{
+    channelSelector->setBounds(60, 10, 150, 20);
+    rangeSelector->setBounds(220, 10, 100, 20);
+}
+
+void SpectrogramCanvas::paint(Graphics& g)
+{
+    g.fillAll(Colours::black);
+
+    const int left = 60, top = 40, right = 20, bottom = 30;
+    const int w = getWidth() - left - right;
+    const int h = getHeight() - top - bottom;
+
+    if (w <= 0 || h <= 0)
+        return;
+
+    if (!image.isNull())
+        g.drawImage(image, left, top, w, h, 0, 0, image.getWidth(), image.getHeight());
+
+    g.setColour(Colours::grey);
+    g.drawRect(left, top, w, h);
+    g.setFont(Font("Default", 12, Font::plain));
+
+    // frequency axis
+    const double maxFrequency = (getNumDisplayedBins() - 1) * processor->getBinWidth();
+
+    for (int i = 0; i <= 4; i++)
+    {
+        const int y = top + h - i * h / 4;
+        g.drawText(String(maxFrequency * i / 4, 0) + " Hz", 0, y - 7, left - 5, 14, Justification::right, false);
+    }
+
+    // band edges
+    for (int band = 0; band < SpectralAnalyzer::NUM_BANDS; band++)
+    {
+        if (SpectralAnalyzer::getBandHigh(band) > maxFrequency)
+            continue;
+
+        const int yLow = top + h - (int)(h * SpectralAnalyzer::getBandLow(band) / maxFrequency);
+        const int yHigh = top + h - (int)(h * SpectralAnalyzer::getBandHigh(band) / maxFrequency);
+
+        g.setColour(Colours::white.withAlpha(0.4f));
+        g.drawHorizontalLine(yLow, (float) left, (float)(left + w));
+        g.drawHorizontalLine(yHigh, (float) left, (float)(left + w));
+        g.drawText(SpectralAnalyzer::getBandName(band), left + 5, yHigh, 60, 14, Justification::left, false);
+    }
+
+    g.setColour(Colours::grey);
+    g.drawText(String(SPECTROGRAM_COLUMNS / processor->getOutputSampleRate(), 1) + " s, "
+               + String(DYNAMIC_RANGE_DB, 0) + " dB range, " + String(processor->getBinWidth(), 1) + " Hz bins",
+               left, top + h + 5, w, 20, Justification::right, false);
+}
+
+void SpectrogramCanvas::saveVisualizerParameters(XmlElement* xml)
+{
+    XmlElement* xmlNode = xml->createNewChildElement("SPECTROGRAM");
+
+    xmlNode->setAttribute("channel", channelSelector->getSelectedId());
+    xmlNode->setAttribute("range", rangeSelector->getSelectedId());
+}
+
+void SpectrogramCanvas::loadVisualizerParameters(XmlElement* xml)
+{
+    forEachXmlChildElement(*xml, xmlNode)
+    {
+        if (xmlNode->hasTagName("SPECTROGRAM"))
+        {
+            channelSelector->setSelectedId(xmlNode->getIntAttribute("channel", 1), dontSendNotification);
+            rangeSelector->setSelectedId(xmlNode->getIntAttribute("range", 2), dontSendNotification);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SPECTROGRAMCANVAS_H_E0B95A3D__
+#define __SPECTROGRAMCANVAS_H_E0B95A3D__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../Visualization/Visualizer.h"
+
+class SpectralAnalyzer;
+
+/**
+
+  Scrolling spectrogram of one channel of a SpectralAnalyzer.
+
+  Each averaged spectrum sent by the processor becomes one column of an
+  image, in dB relative to a slowly decaying peak. The processor only
+  computes the spectra while the canvas is animating.
+
+  @see SpectralAnalyzer
+
+*/
+
+class SpectrogramCanvas : public Visualizer, public ComboBox::Listener
+{
+public:
+    SpectrogramCanvas(SpectralAnalyzer* processor);
+    ~SpectrogramCanvas();
+
+    void paint(Graphics& g);
+    void resized();
+
+    void refresh();
+    void refreshState();
+    void update();
+
+    void beginAnimation();
+    void endAnimation();
+
+    void setParameter(int, float) {}
+    void setParameter(int, int, int, float) {}
+
+    void comboBoxChanged(ComboBox* comboBox);
+
+    void saveVisualizerParameters(XmlElement* xml);
+    void loadVisualizerParameters(XmlElement* xml);
+
+private:
+
+    /** Scrolls the image left and draws one spectrum in the last column.*/
+    void addColumn(const float* power);
+
+    /** Number of bins up to the selected maximum frequency.*/
+    int getNumDisplayedBins();
+
+    SpectralAnalyzer* processor;
+
+    ScopedPointer<ComboBox> channelSelector;
+    ScopedPointer<ComboBox> rangeSelector;
+
+    Image image;
+    HeapBlock<float> rows;
+    int rowSize;
+
+    float peakDb;
+    bool isAnimating;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrogramCanvas);
+};
+
+#endif  // __SPECTROGRAMCANVAS_H_E0B95A3D__
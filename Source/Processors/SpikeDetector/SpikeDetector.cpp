@@ -258,10 +258,13 @@ void SpikeDetector::setChannelActive(int electrodeIndex, int subChannel, bool ac
 
     std::cout << "Setting channel active to " << active << std::endl;
 
-    if (active)
-        setParameter(98, 1);
-    else
-        setParameter(98, 0);
+    ParameterChange change;
+    change.parameterIndex = 98;
+    change.newValue = active ? 1.0f : 0.0f;
+    change.channel = subChannel;
+    change.target = electrodeIndex;
+
+    queueParameterChange(change);
 
 }
 
@@ -276,7 +279,14 @@ void SpikeDetector::setChannelThreshold(int electrodeNum, int channelNum, float
     currentElectrode = electrodeNum;
     currentChannelIndex = channelNum;
     std::cout << "Setting electrode " << electrodeNum << " channel threshold " << channelNum << " to " << thresh << std::endl;
-    setParameter(99, thresh);
+
+    ParameterChange change;
+    change.parameterIndex = 99;
+    change.newValue = thresh;
+    change.channel = channelNum;
+    change.target = electrodeNum;
+
+    queueParameterChange(change);
 }
 
 double SpikeDetector::getChannelThreshold(int electrodeNum, int channelNum)
@@ -301,6 +311,22 @@ void SpikeDetector::setParameter(int parameterIndex, float newValue)
     }
 }
 
+void SpikeDetector::applyParameterChange(const ParameterChange& change)
+{
+    // currentElectrode belongs to the editor, so the electrode is taken from the change itself
+    if (change.target < 0 || change.target >= electrodes.size())
+        return;
+
+    SimpleElectrode* electrode = electrodes[change.target];
+
+    if (change.channel < 0 || change.channel >= electrode->numChannels)
+        return;
+
+    if (change.parameterIndex == 99)
+        *(electrode->thresholds+change.channel) = change.newValue;
+    else if (change.parameterIndex == 98)
+        *(electrode->isActive+change.channel) = (change.newValue != 0.0f);
+}
 
 bool SpikeDetector::enable()
 {
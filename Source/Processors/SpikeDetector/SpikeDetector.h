@@ -81,6 +81,10 @@ public:
     /** Used to alter parameters of data acquisition. */
     void setParameter(int parameterIndex, float newValue);
 
+    /** Applies a threshold (99) or channel-active (98) change to the electrode
+        given by change.target, channel change.channel. */
+    void applyParameterChange(const ParameterChange& change);
+
     /** Called whenever the signal chain is altered. */
     void updateSettings();
 
@@ -572,10 +572,13 @@ void SpikeSorter::setChannelActive(int electrodeIndex, int subChannel, bool acti
     currentElectrode = electrodeIndex;
     currentChannelIndex = subChannel;
 
-    if (active)
-        setParameter(98, 1);
-    else
-        setParameter(98, 0);
+    ParameterChange change;
+    change.parameterIndex = 98;
+    change.newValue = active ? 1.0f : 0.0f;
+    change.channel = subChannel;
+    change.target = electrodeIndex;
+
+    queueParameterChange(change);
 
     //getEditorViewport()->makeEditorVisible(this, true, true);
 }
@@ -594,23 +597,17 @@ void SpikeSorter::setChannelThreshold(int electrodeNum, int channelNum, float th
     mut.enter();
     currentElectrode = electrodeNum;
     currentChannelIndex = channelNum;
-    electrodes[electrodeNum]->thresholds[channelNum] = thresh;
     if (electrodes[electrodeNum]->spikePlot != nullptr)
         electrodes[electrodeNum]->spikePlot->setDisplayThresholdForChannel(channelNum,thresh);
+    mut.exit();
 
-    if (syncThresholds)
-    {
-        for (int k=0; k<electrodes.size(); k++)
-        {
-            for (int i=0; i<electrodes[k]->numChannels; i++)
-            {
-                electrodes[k]->thresholds[i] = thresh;
-            }
-        }
-    }
+    ParameterChange change;
+    change.parameterIndex = 99;
+    change.newValue = thresh;
+    change.channel = channelNum;
+    change.target = syncThresholds ? -1 : electrodeNum; // -1: every channel of every electrode
 
-    mut.exit();
-    setParameter(99, thresh);
+    queueParameterChange(change);
 }
 
 double SpikeSorter::getChannelThreshold(int electrodeNum, int channelNum)
@@ -639,6 +636,41 @@ void SpikeSorter::setParameter(int parameterIndex, float newValue)
     mut.exit();
 }
 
+void SpikeSorter::applyParameterChange(const ParameterChange& change)
+{
+    if (change.parameterIndex != 98 && change.parameterIndex != 99)
+    {
+        GenericProcessor::applyParameterChange(change);
+        return;
+    }
+
+    // currentElectrode belongs to the editor, so the electrode is taken from the change itself
+    mut.enter();
+
+    if (change.parameterIndex == 99 && change.target == -1)
+    {
+        for (int k=0; k<electrodes.size(); k++)
+        {
+            for (int i=0; i<electrodes[k]->numChannels; i++)
+            {
+                electrodes[k]->thresholds[i] = change.newValue;
+            }
+        }
+    }
+    else if (change.target >= 0 && change.target < electrodes.size()
+             && change.channel >= 0 && change.channel < electrodes[change.target]->numChannels)
+    {
+        Electrode* electrode = electrodes[change.target];
+
+        if (change.parameterIndex == 99)
+            electrode->thresholds[change.channel] = change.newValue;
+        else
+            electrode->isActive[change.channel] = (change.newValue != 0.0f);
+    }
+
+    mut.exit();
+}
+
 
 bool SpikeSorter::enable()
 {
@@ -1811,11 +1843,7 @@ Histogram::~Histogram()
 void ContinuousCircularBuffer::reallocate(int NumCh)
 {
     numCh =NumCh;
-    Buf.resize(numCh);
-    for (int k=0; k< numCh; k++)
-    {
-        Buf[k].resize(bufLen);
-    }
+    Buf.setSize(numCh, bufLen);
     numSamplesInBuf = 0;
     ptr = 0; // points to a valid position in the buffer.
 
@@ -1834,13 +1862,7 @@ ContinuousCircularBuffer::ContinuousCircularBuffer(int NumCh, float SamplingRate
     samplingRate = SamplingRate;
     numCh =NumCh;
     leftover_k = 0;
-    Buf.resize(numCh);
-
-
-    for (int k=0; k< numCh; k++)
-    {
-        Buf[k].resize(numSamplesToHoldPerChannel);
-    }
+    Buf.setSize(numCh, numSamplesToHoldPerChannel);
 
     hardwareTS.resize(numSamplesToHoldPerChannel);
     softwareTS.resize(numSamplesToHoldPerChannel);
@@ -1859,7 +1881,7 @@ void ContinuousCircularBuffer::update(int channel, int64 hardware_ts, int64 soft
     hardwareTS[ptr] = hardware_ts;
     softwareTS[ptr] = software_ts;
 
-    Buf[channel][ptr] = (rise) ? 1.0 : 0.0;
+    Buf.setSample(channel, ptr, (rise) ? 1.0f : 0.0f);
 
     ptr++;
     if (ptr == bufLen)
@@ -1891,7 +1913,7 @@ void ContinuousCircularBuffer::update(AudioSampleBuffer& buffer, int64 hardware_
 
         for (int ch = 0; ch < numCh; ch++)
         {
-            Buf[ch][ptr] = *(buffer.getReadPointer(ch,k));
+            Buf.setSample(ch, ptr, *(buffer.getReadPointer(ch,k)));
         }
         ptr++;
         if (ptr == bufLen)
@@ -1912,7 +1934,7 @@ void ContinuousCircularBuffer::update(AudioSampleBuffer& buffer, int64 hardware_
 }
 
 
-void ContinuousCircularBuffer::update(std::vector<std::vector<bool>> contdata, int64 hardware_ts, int64 software_ts, int numpts)
+void ContinuousCircularBuffer::update(const std::vector<std::vector<bool> >& contdata, int64 hardware_ts, int64 software_ts, int numpts)
 {
     mut.enter();
 
@@ -1929,7 +1951,7 @@ void ContinuousCircularBuffer::update(std::vector<std::vector<bool>> contdata, i
 
         for (int ch = 0; ch < numCh; ch++)
         {
-            Buf[ch][ptr] = contdata[ch][k];
+            Buf.setSample(ch, ptr, contdata[ch][k] ? 1.0f : 0.0f);
         }
         ptr++;
         if (ptr == bufLen)
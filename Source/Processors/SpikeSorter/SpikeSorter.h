@@ -27,6 +27,7 @@
 #include "../../../JuceLibraryCode/JuceHeader.h"
 
 #include "../GenericProcessor/GenericProcessor.h"
+#include "../GenericProcessor/CompactSampleBuffer.h"
 #include "SpikeSorterEditor.h"
 #include "SpikeSortBoxes.h"
 #include "../Visualization/SpikeObject.h"
@@ -189,7 +190,7 @@ class ContinuousCircularBuffer
 public:
     ContinuousCircularBuffer(int NumCh, float SamplingRate, int SubSampling, float NumSecInBuffer);
     void reallocate(int N);
-    void update(std::vector<std::vector<bool>> contdata, int64 hardware_ts, int64 software_ts, int numpts);
+    void update(const std::vector<std::vector<bool> >& contdata, int64 hardware_ts, int64 software_ts, int numpts);
     void update(AudioSampleBuffer& buffer, int64 hardware_ts, int64 software_ts, int numpts);
     void update(int channel, int64 hardware_ts, int64 software_ts, bool rise);
     int GetPtr();
@@ -205,7 +206,9 @@ public:
     int leftover_k;
     double buffer_dx;
 
-    std::vector<std::vector<float> > Buf;
+    /** One channel per numCh, bufLen samples each; may be held in 16 bits,
+        see CompactSampleBuffer */
+    CompactSampleBuffer Buf;
     std::vector<bool> valid;
     std::vector<int64> hardwareTS,softwareTS;
 };
@@ -237,6 +240,11 @@ public:
     /** Used to alter parameters of data acquisition. */
     void setParameter(int parameterIndex, float newValue);
 
+    /** Applies a threshold (99) or channel-active (98) change to the electrode
+        given by change.target (every electrode if it is -1, for thresholds),
+        channel change.channel. */
+    void applyParameterChange(const ParameterChange& change);
+
     /** Called whenever the signal chain is altered. */
     void updateSettings();
 
@@ -0,0 +1,132 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "FastFourierTransform.h"
+
+FastFourierTransform::FastFourierTransform(int size_) : size(size_)
+{
+    jassert(isPowerOfTwo(size));
+
+    bitReversed.malloc(size);
+
+    int bits = 0;
+    while ((1 << bits) < size)
+        bits++;
+
+    for (int i = 0; i < size; i++)
+    {
+        int reversed = 0;
+
+        for (int b = 0; b < bits; b++)
+            if (i & (1 << b))
+                reversed |= 1 << (bits - 1 - b);
+
+        bitReversed[i] = reversed;
+    }
+
+    // e^(-2 pi i k / size) for k < size / 2
+    twiddles.malloc(jmax(2, size));
+
+    for (int k = 0; k < size / 2; k++)
+    {
+        twiddles[2 * k] = (float) cos(2.0 * double_Pi * k / size);
+        twiddles[2 * k + 1] = (float) -sin(2.0 * double_Pi * k / size);
+    }
+}
+
+FastFourierTransform::~FastFourierTransform()
+{
+}
+
+void FastFourierTransform::perform(float* data) const
+{
+    for (int i = 0; i < size; i++)
+    {
+        const int j = bitReversed[i];
+
+        if (i < j)
+        {
+            std::swap(data[2 * i], data[2 * j]);
+            std::swap(data[2 * i + 1], data[2 * j + 1]);
+        }
+    }
+
+    for (int length = 2; length <= size; length <<= 1)
+    {
+        const int half = length / 2;
+        const int twiddleStep = size / length;
+
+        for (int start = 0; start < size; start += length)
+        {
+            float* a = data + 2 * start;
+            float* b = data + 2 * (start + half);
+
+            for (int k = 0; k < half; k++)
+            {
+                const float wRe = twiddles[2 * k * twiddleStep];
+                const float wIm = twiddles[2 * k * twiddleStep + 1];
+
+                const float tRe = b[2 * k] * wRe - b[2 * k + 1] * wIm;
+                const float tIm = b[2 * k] * wIm + b[2 * k + 1] * wRe;
+
+                b[2 * k] = a[2 * k] - tRe;
+                b[2 * k + 1] = a[2 * k + 1] - tIm;
+                a[2 * k] += tRe;
+                a[2 * k + 1] += tIm;
+            }
+        }
+    }
+}
+
+void FastFourierTransform::performInverse(float* data) const
+{
+    // ifft(x) = conj(fft(conj(x)))
+    for (int i = 0; i < size; i++)
+        data[2 * i + 1] = -data[2 * i + 1];
+
+    perform(data);
+
+    for (int i = 0; i < size; i++)
+        data[2 * i + 1] = -data[2 * i + 1];
+}
+
+void FastFourierTransform::powerSpectra(const float* data, float* powerA, float* powerB) const
+{
+    // A[k] = (Z[k] + conj(Z[-k])) / 2 and B[k] = (Z[k] - conj(Z[-k])) / 2i
+    for (int k = 0; k <= size / 2; k++)
+    {
+        const int m = (size - k) & (size - 1);
+
+        const float re = data[2 * k], im = data[2 * k + 1];
+        const float mirrorRe = data[2 * m], mirrorIm = data[2 * m + 1];
+
+        const float aRe = re + mirrorRe, aIm = im - mirrorIm;
+        powerA[k] = 0.25f * (aRe * aRe + aIm * aIm);
+
+        if (powerB != nullptr)
+        {
+            const float bRe = im + mirrorIm, bIm = re - mirrorRe;
+            powerB[k] = 0.25f * (bRe * bRe + bIm * bIm);
+        }
+    }
+}
@@ -0,0 +1,72 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __FASTFOURIERTRANSFORM_H_3E9A71C2__
+#define __FASTFOURIERTRANSFORM_H_3E9A71C2__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Radix-2 complex FFT of a fixed size, with precomputed bit-reversal and
+  twiddle tables (this version of JUCE has no FFT class).
+
+  Two real signals can be transformed at once by packing them into the real
+  and imaginary parts of one complex input; powerSpectra() then separates
+  their power spectra using the conjugate symmetry of real transforms.
+
+  @see SpectralAnalyzer, ResponseSmoother
+
+*/
+
+class FastFourierTransform
+{
+public:
+    /** size must be a power of two.*/
+    FastFourierTransform(int size);
+    ~FastFourierTransform();
+
+    int getSize() const
+    {
+        return size;
+    }
+
+    /** In-place forward transform of size interleaved (re, im) values.*/
+    void perform(float* data) const;
+
+    /** In-place inverse transform, without the 1/size scaling.*/
+    void performInverse(float* data) const;
+
+    /** Takes the transform of (a + i b) and writes |A[k]|^2 and |B[k]|^2
+        for k = 0 .. size/2. powerB may be null if b was zero.*/
+    void powerSpectra(const float* data, float* powerA, float* powerB) const;
+
+private:
+    int size;
+    HeapBlock<int> bitReversed;
+    HeapBlock<float> twiddles;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FastFourierTransform);
+};
+
+#endif  // __FASTFOURIERTRANSFORM_H_3E9A71C2__
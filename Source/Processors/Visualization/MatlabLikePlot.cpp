@@ -638,23 +638,24 @@ int XYline::getNumPoints()
 	return numpts;
 }
 
-void XYline::smooth(std::vector<float> smoothKernel)
+void XYline::smooth(const std::vector<float>& smoothKernel)
 {
-	std::vector<float> smoothy;
-	smoothy.resize(y.size());
-
 	int numKernelBins = smoothKernel.size();
 	int zeroIndex = (numKernelBins-1)/2;
 	int numXbins = y.size();
-	for (int k=0;k<numXbins;k++)
+	if (numXbins == 0 || numKernelBins == 0)
+		return;
+
+	std::vector<float> smoothy;
+	smoothy.resize(numXbins);
+
+	// one kernel tap at a time over the whole line, so the inner loop is a vector multiply-add
+	for (int j=-zeroIndex;j<numKernelBins-zeroIndex;j++)
 	{
-		float response = 0;
-		for (int j=-zeroIndex;j<zeroIndex;j++)
-		{
-			if (k+j >=0 && k+j < numXbins)
-				response+=y[k+j] * smoothKernel[j+zeroIndex];
-		}
-		smoothy[k] = response;
+		int start = MAX(0, -j);
+		int end = MIN(numXbins-1, numXbins-1-j);
+		if (end >= start)
+			FloatVectorOperations::addWithMultiply(&smoothy[start], &y[start+j], smoothKernel[j+zeroIndex], end-start+1);
 	}
 	y = smoothy;
 }
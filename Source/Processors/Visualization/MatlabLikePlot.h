@@ -54,7 +54,7 @@ public:
 	void draw(Graphics &g, float xmin, float xmax, float ymin, float ymax, int width, int height, bool showBounds);
 	void getYRange(float xmin, float xmax, double &lowestValue, double &highestValue);
 	void removeMean();
-	void smooth(std::vector<float> kernel);
+	void smooth(const std::vector<float>& kernel);
 	int getNumPoints();
 private:
 	void four1(std::vector<float> &data, int nn, int isign);
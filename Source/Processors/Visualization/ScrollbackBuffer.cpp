@@ -0,0 +1,522 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "ScrollbackBuffer.h"
+#include "../GenericProcessor/CompactSampleBuffer.h"
+
+ScrollbackBuffer::ScrollbackBuffer()
+    : Thread("Scrollback writer"), numChannels(0), sampleRate(0), numFileChunks(0),
+      chunkBytes(0), summaryOffset(0), dataBytes(0), stagingSamples(0), writePosition(0),
+      written(0), numDroppedChunks(0), reportedWriteError(false), newestChunk(-1)
+{
+}
+
+ScrollbackBuffer::~ScrollbackBuffer()
+{
+    close();
+}
+
+bool ScrollbackBuffer::getSettings(double& seconds, File& directory)
+{
+    const String settings = SystemStats::getEnvironmentVariable("OPEN_EPHYS_SCROLLBACK", String::empty);
+
+    if (settings.trim().isEmpty())
+        return false;
+
+    seconds = 120.0;
+    directory = File::getSpecialLocation(File::tempDirectory);
+
+    StringArray tokens;
+    tokens.addTokens(settings, " ;", "\"");
+    tokens.removeEmptyStrings();
+
+    for (int i = 0; i < tokens.size(); i++)
+    {
+        const String token = tokens[i].unquoted();
+
+        if (token.startsWithIgnoreCase("seconds="))
+            seconds = jmax(1.0, token.fromFirstOccurrenceOf("=", false, false).getDoubleValue());
+        else if (token.startsWithIgnoreCase("dir="))
+            directory = File::getCurrentWorkingDirectory().getChildFile(token.fromFirstOccurrenceOf("=", false, false));
+    }
+
+    return true;
+}
+
+bool ScrollbackBuffer::open(const File& directory, int numChannels_, double sampleRate_, double seconds)
+{
+    close();
+
+    if (numChannels_ <= 0 || sampleRate_ <= 0 || seconds <= 0)
+        return false;
+
+    numFileChunks = jmax((int64) 2, (int64) ceil(seconds * sampleRate_ / chunkSamples));
+
+    const int64 rawBytes = (int64) numChannels_ * chunkSamples * sizeof(int16);
+    const int64 summaryBytes = (int64) numChannels_ * (chunkSamples / summaryFactor) * 2 * sizeof(int16);
+
+    summaryOffset = rawBytes;
+    dataBytes = rawBytes + summaryBytes;
+    chunkBytes = (dataBytes + 65535) / 65536 * 65536;
+
+    const int64 totalBytes = chunkBytes * numFileChunks;
+
+    if (! directory.isDirectory())
+        directory.createDirectory();
+
+    if (directory.getBytesFreeOnVolume() < totalBytes)
+    {
+        std::cout << "Scrollback: " << totalBytes / (1 << 20) << " MB are needed for " << seconds
+                  << " s of " << numChannels_ << " channels, but " << directory.getFullPathName()
+                  << " has only " << directory.getBytesFreeOnVolume() / (1 << 20) << " MB free." << std::endl;
+        return false;
+    }
+
+    file = directory.getNonexistentChildFile("open-ephys-scrollback", ".bin", false);
+    output = new FileOutputStream(file);
+
+    // the file is created at its full size, but (where the file system
+    // allows it) only takes up disk space as the chunks are written
+    if (output->failedToOpen()
+        || ! output->setPosition(totalBytes - 1)
+        || ! output->writeByte(0))
+    {
+        std::cout << "Scrollback: could not create " << file.getFullPathName() << std::endl;
+        output = nullptr;
+        file.deleteFile();
+        return false;
+    }
+
+    output->flush();
+
+    numChannels = numChannels_;
+    sampleRate = sampleRate_;
+
+    steps.malloc(numChannels);
+    offsets.malloc(numChannels);
+
+    for (int c = 0; c < numChannels; c++)
+    {
+        steps[c] = 1.0f;
+        offsets[c] = 0.0f;
+    }
+
+    stagingSamples = numStagingChunks * chunkSamples;
+    staging.calloc((size_t) numChannels * stagingSamples);
+    writePosition = 0;
+    committed.set(0);
+    written = 0;
+    numDroppedChunks = 0;
+    reportedWriteError = false;
+
+    chunkData.calloc((size_t) dataBytes / sizeof(int16));
+    chunkRange.malloc(numChannels * 2);
+
+    storedChunks.malloc(numFileChunks);
+    storedSamples.calloc(numFileChunks);
+    storedRanges.calloc((size_t) numFileChunks * numChannels * 2);
+    newestChunk = -1;
+
+    for (int64 i = 0; i < numFileChunks; i++)
+        storedChunks[i] = -1;
+
+    std::cout << "Scrollback: keeping " << numFileChunks * chunkSamples / sampleRate << " s of "
+              << numChannels << " channels in " << file.getFullPathName() << " ("
+              << totalBytes / (1 << 20) << " MB)" << std::endl;
+
+    startThread();
+
+    return true;
+}
+
+void ScrollbackBuffer::close()
+{
+    stopThread(5000);
+
+    output = nullptr;
+
+    if (numChannels > 0)
+    {
+        file.deleteFile();
+
+        if (numDroppedChunks > 0)
+            std::cout << "Scrollback: " << numDroppedChunks << " chunks were lost because the writer fell behind." << std::endl;
+    }
+
+    numChannels = 0;
+}
+
+void ScrollbackBuffer::setStep(int channel, float step, float offset)
+{
+    if (channel >= 0 && channel < numChannels)
+    {
+        steps[channel] = step > 0.0f ? step : 1.0f;
+        offsets[channel] = offset;
+    }
+}
+
+void ScrollbackBuffer::write(int channel, const float* source, int numSamples)
+{
+    if (channel < 0 || channel >= numChannels)
+        return;
+
+    int16* const row = staging + (size_t) channel * stagingSamples;
+
+    const int offset = (int)(writePosition % stagingSamples);
+    const int n1 = jmin(numSamples, (int) stagingSamples - offset);
+
+    CompactSampleBuffer::convertToInt16(source, row + offset, n1, steps[channel], offsets[channel]);
+
+    if (numSamples > n1)
+        CompactSampleBuffer::convertToInt16(source + n1, row, numSamples - n1,
+                                            steps[channel], offsets[channel]);
+}
+
+void ScrollbackBuffer::writeZeros(int channel, int numSamples)
+{
+    if (channel < 0 || channel >= numChannels)
+        return;
+
+    const float zero = 0.0f;
+    int16 value;
+    CompactSampleBuffer::convertToInt16(&zero, &value, 1, steps[channel], offsets[channel]);
+
+    int16* const row = staging + (size_t) channel * stagingSamples;
+
+    int offset = (int)(writePosition % stagingSamples);
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        row[offset] = value;
+
+        if (++offset == stagingSamples)
+            offset = 0;
+    }
+}
+
+void ScrollbackBuffer::advance(int numSamples)
+{
+    writePosition += numSamples;
+    committed.set(writePosition);
+}
+
+void ScrollbackBuffer::finishAppending()
+{
+    stopThread(5000);
+}
+
+void ScrollbackBuffer::run()
+{
+    while (! threadShouldExit())
+    {
+        if (writeCompletedChunks(false) == 0)
+            wait(20);
+    }
+
+    writeCompletedChunks(true);
+}
+
+int ScrollbackBuffer::writeCompletedChunks(bool includeLast)
+{
+    int numWritten = 0;
+
+    const int64 end = committed.get();
+
+    while (written + chunkSamples <= end || (includeLast && written < end))
+    {
+        const int numSamples = (int) jmin((int64) chunkSamples, end - written);
+
+        writeChunk(written / chunkSamples, numSamples);
+
+        written += numSamples;
+        numWritten++;
+    }
+
+    return numWritten;
+}
+
+void ScrollbackBuffer::writeChunk(int64 chunk, int numSamples)
+{
+    const int64 start = chunk * chunkSamples;
+    const int offset = (int)(start % stagingSamples);
+    const int numSummaries = chunkSamples / summaryFactor;
+
+    int16* const summaries = chunkData + summaryOffset / sizeof(int16);
+
+    for (int c = 0; c < numChannels; c++)
+    {
+        int16* const raw = chunkData + (size_t) c * chunkSamples;
+
+        memcpy(raw, staging + (size_t) c * stagingSamples + offset, numSamples * sizeof(int16));
+        zeromem(raw + numSamples, (chunkSamples - numSamples) * sizeof(int16));
+
+        int16 chunkMin = 0;
+        int16 chunkMax = 0;
+
+        for (int s = 0; s < numSummaries; s++)
+        {
+            const int first = s * summaryFactor;
+            const int last = jmin(first + summaryFactor, numSamples);
+
+            int16 lo = 0;
+            int16 hi = 0;
+
+            if (first < last)
+            {
+                lo = hi = raw[first];
+
+                for (int i = first + 1; i < last; i++)
+                {
+                    lo = jmin(lo, raw[i]);
+                    hi = jmax(hi, raw[i]);
+                }
+
+                if (s == 0)
+                {
+                    chunkMin = lo;
+                    chunkMax = hi;
+                }
+                else
+                {
+                    chunkMin = jmin(chunkMin, lo);
+                    chunkMax = jmax(chunkMax, hi);
+                }
+            }
+
+            summaries[(c * numSummaries + s) * 2] = lo;
+            summaries[(c * numSummaries + s) * 2 + 1] = hi;
+        }
+
+        chunkRange[c * 2] = chunkMin;
+        chunkRange[c * 2 + 1] = chunkMax;
+    }
+
+    const int slot = (int)(chunk % numFileChunks);
+
+    {
+        const ScopedLock lock(storeLock);
+        storedChunks[slot] = -1;
+    }
+
+    // blocks of at most chunkSamples are written past the committed position,
+    // so if the processing thread is within one chunk of wrapping around to
+    // this one, the copy may be torn
+    if (committed.get() + chunkSamples > start + stagingSamples)
+    {
+        numDroppedChunks++;
+        return;
+    }
+
+    if (! output->setPosition(slot * chunkBytes)
+        || ! output->write(chunkData, (size_t) dataBytes))
+    {
+        if (! reportedWriteError)
+            std::cout << "Scrollback: could not write to " << file.getFullPathName() << std::endl;
+
+        reportedWriteError = true;
+        numDroppedChunks++;
+        return;
+    }
+
+    output->flush();
+
+    const ScopedLock lock(storeLock);
+
+    memcpy(storedRanges + (size_t) slot * numChannels * 2, chunkRange, numChannels * 2 * sizeof(int16));
+    storedSamples[slot] = numSamples;
+    storedChunks[slot] = chunk;
+    newestChunk = chunk;
+}
+
+int ScrollbackBuffer::findChunk(int64 chunk, int& numSamples)
+{
+    const ScopedLock lock(storeLock);
+
+    const int slot = (int)(chunk % numFileChunks);
+
+    if (storedChunks[slot] != chunk)
+        return -1;
+
+    numSamples = storedSamples[slot];
+    return slot;
+}
+
+Range<double> ScrollbackBuffer::getAvailableTime()
+{
+    const ScopedLock lock(storeLock);
+
+    if (numChannels == 0 || newestChunk < 0)
+        return Range<double>();
+
+    const int64 oldest = jmax((int64) 0, newestChunk - numFileChunks + 1);
+    const int64 end = newestChunk * chunkSamples + storedSamples[newestChunk % numFileChunks];
+
+    return Range<double>(oldest * chunkSamples / sampleRate, end / sampleRate);
+}
+
+int ScrollbackBuffer::readMinMax(int firstChannel, int numToRead, Range<double> time, int numBins,
+                                 float* const* mins, float* const* maxs)
+{
+    numToRead = jmin(numToRead, numChannels - firstChannel);
+
+    if (numToRead <= 0 || numBins <= 0 || firstChannel < 0)
+        return 0;
+
+    const int64 start = (int64) floor(time.getStart() * sampleRate);
+    const int64 end = (int64) ceil(time.getEnd() * sampleRate);
+    const int64 length = end - start;
+
+    if (length <= 0)
+        return 0;
+
+    // the coarsest level that still gives several values per bin
+    const double samplesPerBin = double(length) / numBins;
+    const int granularity = samplesPerBin >= chunkSamples ? chunkSamples
+                            : samplesPerBin >= summaryFactor ? summaryFactor : 1;
+
+    const int unitsPerChunk = chunkSamples / granularity;
+    const int valuesPerUnit = granularity == 1 ? 1 : 2;
+
+    HeapBlock<int> lo, hi;
+    lo.malloc(numToRead * numBins);
+    hi.malloc(numToRead * numBins);
+
+    for (int i = 0; i < numToRead * numBins; i++)
+    {
+        lo[i] = 32767 + 1;
+        hi[i] = -32768 - 1;
+    }
+
+    HeapBlock<int16> values;
+    HeapBlock<int> unitBins;
+    values.malloc((size_t) numToRead * unitsPerChunk * valuesPerUnit);
+    unitBins.malloc(unitsPerChunk);
+
+    for (int64 chunk = jmax((int64) 0, start / chunkSamples); chunk * chunkSamples < end; chunk++)
+    {
+        int numSamples = 0;
+        const int slot = findChunk(chunk, numSamples);
+
+        if (slot < 0)
+            continue;
+
+        const int64 chunkStart = chunk * chunkSamples;
+
+        // the units of this chunk that start within the time range
+        const int firstUnit = (int)((jmax(start, chunkStart) - chunkStart + granularity - 1) / granularity);
+        const int lastUnit = (int)((jmin(end, chunkStart + numSamples) - chunkStart + granularity - 1) / granularity);
+
+        if (firstUnit >= lastUnit)
+            continue;
+
+        if (granularity == chunkSamples)
+        {
+            const ScopedLock lock(storeLock);
+
+            if (storedChunks[slot] != chunk)
+                continue;
+
+            memcpy(values, storedRanges + ((size_t) slot * numChannels + firstChannel) * 2,
+                   numToRead * 2 * sizeof(int16));
+        }
+        else
+        {
+            // map only the raw samples or the summaries of these channels
+            const int64 unitBytes = valuesPerUnit * sizeof(int16);
+            const int64 offset = slot * chunkBytes + (granularity == 1 ? 0 : summaryOffset)
+                                 + (int64) firstChannel * unitsPerChunk * unitBytes;
+            const int64 size = (int64) numToRead * unitsPerChunk * unitBytes;
+
+            MemoryMappedFile map(file, Range<int64>(offset, offset + size), MemoryMappedFile::readOnly);
+
+            if (map.getData() == nullptr)
+                continue;
+
+            memcpy(values, (const char*) map.getData() + (offset - map.getRange().getStart()), (size_t) size);
+
+            // the writer may have started on this chunk of the file meanwhile
+            int stillStored = 0;
+
+            if (findChunk(chunk, stillStored) != slot)
+                continue;
+        }
+
+        for (int u = firstUnit; u < lastUnit; u++)
+            unitBins[u] = (int) jmin((int64) numBins - 1, (chunkStart + (int64) u * granularity - start) * numBins / length);
+
+        for (int c = 0; c < numToRead; c++)
+        {
+            int* const channelLo = lo + c * numBins;
+            int* const channelHi = hi + c * numBins;
+
+            if (granularity == 1)
+            {
+                const int16* const samples = values + (size_t) c * chunkSamples;
+
+                for (int u = firstUnit; u < lastUnit; u++)
+                {
+                    const int b = unitBins[u];
+                    channelLo[b] = jmin(channelLo[b], (int) samples[u]);
+                    channelHi[b] = jmax(channelHi[b], (int) samples[u]);
+                }
+            }
+            else
+            {
+                const int16* const ranges = values + (size_t) c * unitsPerChunk * 2;
+
+                for (int u = firstUnit; u < lastUnit; u++)
+                {
+                    const int b = unitBins[u];
+                    channelLo[b] = jmin(channelLo[b], (int) ranges[u * 2]);
+                    channelHi[b] = jmax(channelHi[b], (int) ranges[u * 2 + 1]);
+                }
+            }
+        }
+    }
+
+    int numWithData = 0;
+
+    for (int b = 0; b < numBins; b++)
+    {
+        if (lo[b] <= hi[b])
+            numWithData++;
+    }
+
+    for (int c = 0; c < numToRead; c++)
+    {
+        const float step = steps[firstChannel + c];
+        const float zero = offsets[firstChannel + c];
+
+        for (int b = 0; b < numBins; b++)
+        {
+            const int i = c * numBins + b;
+            const bool hasData = lo[i] <= hi[i];
+
+            mins[c][b] = hasData ? lo[i] * step + zero : 0.0f;
+            maxs[c][b] = hasData ? hi[i] * step + zero : 0.0f;
+        }
+    }
+
+    return numWithData;
+}
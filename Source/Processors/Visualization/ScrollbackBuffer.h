@@ -0,0 +1,199 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __SCROLLBACKBUFFER_H_7D04B3E9__
+#define __SCROLLBACKBUFFER_H_7D04B3E9__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  A long history of continuous data, kept in a file rather than in memory,
+  that a visualizer can query by time range (e.g. to scroll back through the
+  last minutes of an acquisition).
+
+  Samples are stored as int16, in steps of each channel's bitVolts from its
+  offsetVolts (see CompactSampleBuffer). The file is a ring of chunks of chunkSamples samples
+  of every channel. Each chunk holds its samples (channel after channel),
+  followed by the min and max of every summaryFactor samples of each channel,
+  and the min and max of each channel over the whole chunk are kept in
+  memory. A query reads whichever of the three is just fine enough for the
+  bins it asks for, so zoomed-out views only touch the summaries.
+
+  The processing thread only converts its samples into a staging ring in
+  memory, with no system calls. A writer thread summarizes each completed
+  chunk and writes it to the file in one sequential write; written chunks
+  live in the page cache, not in the process. (Writing through a mapping
+  would turn a full disk into a crash, so only reads are mapped.) Queries
+  map the part of a chunk they need, read-only, and unmap it afterwards.
+
+  Memory use is therefore bounded by the staging ring, one chunk being
+  written, one chunk being read and the per-chunk summaries, whatever the
+  length of the history.
+
+  Enabled by setting the OPEN_EPHYS_SCROLLBACK environment variable to a
+  list of space-separated tokens:
+
+  - on: keep the last 120 s, in the temporary directory;
+  - seconds=S: keep the last S seconds;
+  - dir=PATH: put the file in PATH.
+
+  @see LfpDisplayNode, LfpDisplayCanvas
+
+*/
+
+class ScrollbackBuffer : public Thread
+{
+public:
+    ScrollbackBuffer();
+    ~ScrollbackBuffer();
+
+    /** Returns false if OPEN_EPHYS_SCROLLBACK is not set. */
+    static bool getSettings(double& seconds, File& directory);
+
+    /** Creates a file for the last `seconds` of numChannels channels at
+        sampleRate, and starts the writer thread. Any previous history is
+        discarded. Returns false, after saying why, if there is no room for
+        the file. Not to be called during acquisition. */
+    bool open(const File& directory, int numChannels, double sampleRate, double seconds);
+
+    /** Stops the writer thread and deletes the file. */
+    void close();
+
+    bool isOpen() const
+    {
+        return numChannels > 0;
+    }
+
+    int getNumChannels() const
+    {
+        return numChannels;
+    }
+
+    double getSampleRate() const
+    {
+        return sampleRate;
+    }
+
+    /** The value of one stored step (the bitVolts) of a channel, and the
+        value stored as 0 (the offsetVolts). Not to be called during
+        acquisition. */
+    void setStep(int channel, float step, float offset = 0.0f);
+
+    /** Converts numSamples samples (at most chunkSamples) of a channel into
+        the staging ring, at the current position. Processing thread only. */
+    void write(int channel, const float* source, int numSamples);
+
+    /** Same as write(), for numSamples samples of 0. */
+    void writeZeros(int channel, int numSamples);
+
+    /** Moves the current position on by numSamples, once every channel has
+        been written. Processing thread only. */
+    void advance(int numSamples);
+
+    /** Hands the last, incomplete chunk to the writer thread, and stops it
+        once everything is written. Called after acquisition. */
+    void finishAppending();
+
+    /** The times (in seconds from the start of acquisition) that can be
+        queried */
+    Range<double> getAvailableTime();
+
+    /** Fills the min and max of numChannels channels, from firstChannel, in
+        numBins bins spanning the time range, and returns the number of bins
+        that hold data (bins without data are set to 0). Not for the
+        processing thread. */
+    int readMinMax(int firstChannel, int numChannels, Range<double> time, int numBins,
+                   float* const* mins, float* const* maxs);
+
+    /** Chunks lost because the writer thread fell behind */
+    int getNumDroppedChunks() const
+    {
+        return numDroppedChunks;
+    }
+
+    /** Writes completed chunks until the thread is asked to stop, then
+        writes the rest. */
+    void run();
+
+    static const int chunkSamples = 4096;
+    static const int summaryFactor = 64;
+    static const int numStagingChunks = 4;
+
+private:
+
+    /** Writes every chunk the processing thread has completed (and the
+        incomplete one, if includeLast is true), and returns the number
+        written. */
+    int writeCompletedChunks(bool includeLast);
+
+    /** Summarizes one chunk and writes it to its place in the file. */
+    void writeChunk(int64 chunk, int numSamples);
+
+    /** The chunk of the file that holds this chunk, or -1 if it is no longer
+        (or not yet) there. Sets numSamples to the samples it holds. */
+    int findChunk(int64 chunk, int& numSamples);
+
+    File file;
+    ScopedPointer<FileOutputStream> output;
+
+    int numChannels;
+    double sampleRate;
+    int64 numFileChunks;
+
+    /** Bytes from one chunk of the file to the next (a multiple of 64 kB, so
+        that each can be mapped on its own), the offset of the summaries
+        within it, and the bytes actually written */
+    int64 chunkBytes;
+    int64 summaryOffset;
+    int64 dataBytes;
+
+    HeapBlock<float> steps;
+    HeapBlock<float> offsets;
+
+    /** Samples of the last numStagingChunks chunks, channel after channel */
+    HeapBlock<int16> staging;
+    int64 stagingSamples;
+    int64 writePosition;
+    Atomic<int64> committed;
+    int64 written;
+    int numDroppedChunks;
+    bool reportedWriteError;
+
+    /** One chunk as laid out in the file, and its min and max per channel */
+    HeapBlock<int16> chunkData;
+    HeapBlock<int16> chunkRange;
+
+    /** Which chunk each chunk of the file holds (-1 while it is written),
+        how many samples it has, and the min and max of each channel */
+    CriticalSection storeLock;
+    HeapBlock<int64> storedChunks;
+    HeapBlock<int> storedSamples;
+    HeapBlock<int16> storedRanges;
+    int64 newestChunk;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ScrollbackBuffer);
+};
+
+#endif  // __SCROLLBACKBUFFER_H_7D04B3E9__
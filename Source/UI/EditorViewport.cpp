@@ -34,7 +34,7 @@ EditorViewport::EditorViewport()
       somethingIsBeingDraggedOver(false), shiftDown(false), canEdit(true),
       lastEditorClicked(0), selectionIndex(0), borderSize(6), tabSize(30),
       tabButtonSize(15), insertionPoint(0), componentWantsToMove(false),
-      indexOfMovingComponent(-1), currentTab(-1)
+      indexOfMovingComponent(-1), currentTab(-1), isLoading(false), isBenchmarking(false)
 {
 
     addMouseListener(this, true);
@@ -259,12 +259,15 @@ void EditorViewport::itemDropped(const SourceDetails& dragSourceDetails)
 
             signalChainManager->updateVisibleEditors(activeEditor, indexOfMovingComponent, insertionPoint, ADD);
 
-            for (int i = 0; i < editorArray.size(); i++)
+            if (!isLoading) // loadState() lays out the editors once at the end
             {
-                if (editorArray[i] == activeEditor)
-                    editorArray[i]->select();
-                else
-                    editorArray[i]->deselect();
+                for (int i = 0; i < editorArray.size(); i++)
+                {
+                    if (editorArray[i] == activeEditor)
+                        editorArray[i]->select();
+                    else
+                        editorArray[i]->deselect();
+                }
             }
 
             // Instructions below were enclosed into the if block by Michael Borisov
@@ -272,13 +275,16 @@ void EditorViewport::itemDropped(const SourceDetails& dragSourceDetails)
 
             insertionPoint = -1; // make sure all editors are left-justified
             indexOfMovingComponent = -1;
-            refreshEditors();
+
+            if (!isLoading)
+                refreshEditors();
 
             somethingIsBeingDraggedOver = false;
 
             AccessClass::getGraphViewer()->addNode(activeEditor);
 
-            repaint();
+            if (!isLoading)
+                repaint();
 
             currentId++;
         }
@@ -1396,6 +1402,50 @@ const String EditorViewport::saveState(File fileToUse)
     return error;
 }
 
+/** Returns the milliseconds since ticks, and resets ticks to now. */
+static double lapMilliseconds(int64& ticks)
+{
+    const int64 now = Time::getHighResolutionTicks();
+    const double ms = Time::highResolutionTicksToSeconds(now - ticks) * 1000.0;
+    ticks = now;
+    return ms;
+}
+
+/** Checks a configuration's signal chain before anything is loaded. Returns
+a description of the first problem, or an empty string. */
+static String validateSignalChain(XmlElement* xml)
+{
+    int numProcessors = 0;
+
+    forEachXmlChildElementWithTagName(*xml, chain, "SIGNALCHAIN")
+    {
+        forEachXmlChildElement(*chain, processor)
+        {
+            if (processor->hasTagName("PROCESSOR"))
+            {
+                const String name = processor->getStringAttribute("name");
+
+                if (! name.containsChar('/'))
+                    return "processor " + String(numProcessors) + " has no valid name";
+
+                if (! processor->hasAttribute("NodeId"))
+                    return name + " has no node ID";
+
+                numProcessors++;
+            }
+            else if (processor->hasTagName("SWITCH"))
+            {
+                const int number = processor->getIntAttribute("number", -1);
+
+                if (number < 0 || number >= numProcessors)
+                    return "switch refers to missing processor " + String(number);
+            }
+        }
+    }
+
+    return String::empty;
+}
+
 const String EditorViewport::loadState(File fileToLoad)
 {
 
@@ -1417,6 +1467,8 @@ const String EditorViewport::loadState(File fileToLoad)
 
     std::cout << "Loading processor graph." << std::endl;
 
+    int64 ticks = Time::getHighResolutionTicks();
+
     Array<GenericProcessor*> splitPoints;
 
     XmlDocument doc(currentFile);
@@ -1429,6 +1481,18 @@ const String EditorViewport::loadState(File fileToLoad)
         return "Not a valid file.";
     }
 
+    // check everything before the current signal chain is cleared
+    const String problem = validateSignalChain(xml);
+
+    if (problem.isNotEmpty())
+    {
+        std::cout << "Not loading " << currentFile.getFileName() << ": " << problem << std::endl;
+        delete xml;
+        return "Not a valid file: " + problem;
+    }
+
+    lastLoadTimes.parse = lapMilliseconds(ticks);
+
     bool sameVersion = false;
     String versionString;
 
@@ -1451,7 +1515,7 @@ const String EditorViewport::loadState(File fileToLoad)
             break;
         }
     }
-    if (!sameVersion)
+    if (!sameVersion && !isBenchmarking)
     {
         String responseString = "Your configuration file was saved from a different version of the GUI than the one you're using. \n";
         responseString += "The current software is version ";
@@ -1473,8 +1537,12 @@ const String EditorViewport::loadState(File fileToLoad)
                                                      "Version mismatch", responseString,
                                                      "Yes", "No", 0, 0);
         if (!response)
+        {
+            delete xml;
             return "Failed To Open " + fileToLoad.getFileName();
+        }
 
+        ticks = Time::getHighResolutionTicks(); // don't count the time spent in the prompt
     }
     clearSignalChain();
 
@@ -1483,6 +1551,15 @@ const String EditorViewport::loadState(File fileToLoad)
 
     GenericProcessor* p;
 
+    // Processors are only created and linked here. Their settings, parameters
+    // and editor layout are updated once the whole signal chain exists.
+    Array<GenericProcessor*> loadedProcessors;
+    Array<XmlElement*> loadedProcessorXml;
+    String failure;
+
+    isLoading = true;
+    signalChainManager->setSettingsUpdatesEnabled(false);
+
     forEachXmlChildElement(*xml, element)
     {
 
@@ -1514,14 +1591,21 @@ const String EditorViewport::loadState(File fileToLoad)
                                                      0,
                                                      Point<int>(0,0));
 
+                    lastEditor = 0;
                     itemDropped(sd);
 
+                    if (lastEditor == 0)
+                    {
+                        failure = "could not create " + processor->getStringAttribute("name");
+                        break;
+                    }
+
                     p = (GenericProcessor*) lastEditor->getProcessor();
                     p->loadOrder = loadOrder;
                     p->parametersAsXml = processor;
 
-                    //Sets parameters based on XML files
-                    setParametersByXML(p, processor);
+                    loadedProcessors.add(p);
+                    loadedProcessorXml.add(processor);
                     loadOrder++;
 
                     if (p->isSplitter() || p->isMerger())
@@ -1570,6 +1654,9 @@ const String EditorViewport::loadState(File fileToLoad)
 
             }
 
+            if (failure.isNotEmpty())
+                break;
+
         }
         else if (element->hasTagName("AUDIO"))
         {
@@ -1579,12 +1666,32 @@ const String EditorViewport::loadState(File fileToLoad)
 
     }
 
-    for (int i = 0; i < editorArray.size(); i++)
+    isLoading = false;
+    signalChainManager->setSettingsUpdatesEnabled(true);
+
+    currentId=maxID+1; // make sure future processors don't have overlapping id numbers
+
+    if (failure.isNotEmpty())
     {
-        // deselect everything initially
-        editorArray[i]->deselect();
+        // don't leave half a signal chain behind
+        std::cout << "Failed to load " << currentFile.getFileName() << ": " << failure << std::endl;
+        clearSignalChain();
+        delete xml;
+        return "Failed To Open " + currentFile.getFileName() + ": " + failure;
     }
 
+    lastLoadTimes.processors = lapMilliseconds(ticks);
+
+    // one pass through the whole signal chain, in order
+    if (editorArray.size() > 0)
+        signalChainManager->updateVisibleEditors(editorArray[0], 0, 0, UPDATE);
+
+    lastLoadTimes.settings = lapMilliseconds(ticks);
+
+    //Sets parameters based on XML files
+    for (int i = 0; i < loadedProcessors.size(); i++)
+        setParametersByXML(loadedProcessors[i], loadedProcessorXml[i]);
+
     AccessClass::getProcessorGraph()->restoreParameters();
 
     AccessClass::getControlPanel()->loadStateFromXml(xml); // save the control panel settings
@@ -1592,23 +1699,172 @@ const String EditorViewport::loadState(File fileToLoad)
     AccessClass::getMessageCenter()->loadStateFromXml(xml);
     AccessClass::getUIComponent()->loadStateFromXml(xml);  // save the UI settings
 
+    // restored parameters can change the number of channels (e.g. a file
+    // reader's file), so settings are passed down once more
     if (editorArray.size() > 0)
         signalChainManager->updateVisibleEditors(editorArray[0], 0, 0, UPDATE);
 
+    AccessClass::getProcessorGraph()->restoreParameters();
+
+    lastLoadTimes.parameters = lapMilliseconds(ticks);
+
+    for (int i = 0; i < editorArray.size(); i++)
+    {
+        // deselect everything initially
+        editorArray[i]->deselect();
+    }
+
     refreshEditors();
+    repaint();
 
-    AccessClass::getProcessorGraph()->restoreParameters();
+    lastLoadTimes.editors = lapMilliseconds(ticks);
+
+    lastLoadTimes.numProcessors = loadedProcessors.size();
+    lastLoadTimes.numChannels = 0;
 
+    for (int i = 0; i < loadedProcessors.size(); i++)
+        lastLoadTimes.numChannels += loadedProcessors[i]->getNumOutputs();
+
+    std::cout << "Loaded " << currentFile.getFileName() << " ("
+              << lastLoadTimes.numProcessors << " processors, "
+              << lastLoadTimes.numChannels << " channels) in "
+              << lastLoadTimes.parse + lastLoadTimes.processors + lastLoadTimes.settings
+                 + lastLoadTimes.parameters + lastLoadTimes.editors << " ms: parse "
+              << lastLoadTimes.parse << ", processors " << lastLoadTimes.processors
+              << ", settings " << lastLoadTimes.settings << ", parameters "
+              << lastLoadTimes.parameters << ", editors " << lastLoadTimes.editors
+              << std::endl;
 
     String error = "Opened ";
     error += currentFile.getFileName();
 
     delete xml;
 
-    currentId=maxID+1; // make sure future processors don't have overlapping id numbers
-
     return error;
 }
+
+bool EditorViewport::runLoadBenchmark(File directory, int repetitions, File baselineFile, double tolerance)
+{
+    Array<File> files;
+    directory.findChildFiles(files, File::findFiles, false);
+
+    DefaultElementComparator<File> byName;
+    files.sort(byName);
+
+    // mean total load time of each configuration in the baseline
+    StringPairArray baseline;
+
+    if (baselineFile.existsAsFile())
+    {
+        StringArray lines;
+        baselineFile.readLines(lines);
+
+        for (int i = 0; i < lines.size(); i++)
+        {
+            if (lines[i].contains(","))
+                baseline.set(lines[i].upToLastOccurrenceOf(",", false, false).trim(),
+                             lines[i].fromLastOccurrenceOf(",", false, false).trim());
+        }
+    }
+
+    std::cout << "Load benchmark: " << directory.getFullPathName()
+              << " (" << repetitions << " runs each, mean ms)" << std::endl;
+    std::cout << "configuration, processors, channels, parse, processors, settings, parameters, editors, total, baseline" << std::endl;
+
+    isBenchmarking = true;
+
+    bool passed = true;
+    int numConfigurations = 0;
+    String results;
+
+    for (int f = 0; f < files.size(); f++)
+    {
+        // skips images and anything else that isn't a saved configuration
+        ScopedPointer<XmlElement> xml = XmlDocument::parse(files[f]);
+
+        if (xml == nullptr || ! xml->hasTagName("SETTINGS"))
+            continue;
+
+        numConfigurations++;
+
+        LoadTimes sum = { 0.0, 0.0, 0.0, 0.0, 0.0, 0, 0 };
+        int numLoaded = 0;
+
+        for (int r = 0; r < repetitions; r++)
+        {
+            if (! loadState(files[f]).startsWith("Opened"))
+                break;
+
+            sum.parse += lastLoadTimes.parse;
+            sum.processors += lastLoadTimes.processors;
+            sum.settings += lastLoadTimes.settings;
+            sum.parameters += lastLoadTimes.parameters;
+            sum.editors += lastLoadTimes.editors;
+            numLoaded++;
+        }
+
+        if (numLoaded == 0)
+        {
+            std::cout << files[f].getFileName() << ", failed to load" << std::endl;
+            passed = false;
+            continue;
+        }
+
+        const double total = (sum.parse + sum.processors + sum.settings + sum.parameters + sum.editors) / numLoaded;
+
+        std::cout << files[f].getFileName() << ", "
+                  << lastLoadTimes.numProcessors << ", " << lastLoadTimes.numChannels << ", "
+                  << sum.parse / numLoaded << ", " << sum.processors / numLoaded << ", "
+                  << sum.settings / numLoaded << ", " << sum.parameters / numLoaded << ", "
+                  << sum.editors / numLoaded << ", " << total;
+
+        if (baseline.containsKey(files[f].getFileName()))
+        {
+            // a few ms of slack, so that configurations that load in no time don't fail on noise
+            const double baselineTotal = baseline[files[f].getFileName()].getDoubleValue();
+            const double limit = baselineTotal * (1.0 + tolerance / 100.0) + 5.0;
+
+            std::cout << ", " << baselineTotal;
+
+            if (total > limit)
+            {
+                std::cout << " -- slower than the limit of " << limit << " ms";
+                passed = false;
+            }
+        }
+
+        std::cout << std::endl;
+
+        results << files[f].getFileName() << "," << String(total, 3) << "\n";
+    }
+
+    isBenchmarking = false;
+
+    clearSignalChain();
+
+    if (numConfigurations == 0)
+    {
+        std::cout << "Load benchmark: no configurations in " << directory.getFullPathName() << std::endl;
+        return false;
+    }
+
+    if (baselineFile != File::nonexistent && baseline.size() == 0)
+    {
+        // the first run on a machine records its baseline
+        if (baselineFile.replaceWithText(results))
+            std::cout << "Load benchmark: wrote the baseline to " << baselineFile.getFullPathName() << std::endl;
+        else
+            std::cout << "Load benchmark: could not write " << baselineFile.getFullPathName() << std::endl;
+    }
+    else if (baseline.size() > 0)
+    {
+        std::cout << "Load benchmark against " << baselineFile.getFullPathName() << " (tolerance "
+                  << tolerance << "%): " << (passed ? "PASS" : "FAIL") << std::endl;
+    }
+
+    return passed;
+}
+
 /* Set parameters based on XML.*/
 void EditorViewport::setParametersByXML(GenericProcessor* targetProcessor, XmlElement* processorXML)
 {
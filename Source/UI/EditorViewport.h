@@ -152,6 +152,15 @@ public:
     /** Load a saved configuration from an XML file. */
     const String loadState(File filename);
 
+    /** Loads every configuration in a directory a few times and prints how
+    long each phase of loadState() took. If a baseline file (lines of
+    configuration name and mean total ms) exists, returns false when a
+    configuration takes more than tolerance percent longer than its
+    baseline; otherwise the times are written to it as the new baseline.
+    Also returns false if a configuration fails to load. */
+    bool runLoadBenchmark(File directory, int repetitions = 3,
+                          File baselineFile = File::nonexistent, double tolerance = 50.0);
+
     /** Converts information about a given editor to XML. */
     XmlElement* createNodeXml(GenericEditor*, int);
 
@@ -215,6 +224,27 @@ private:
     int currentId;
     int maxId;
 
+    /** True while loadState() is adding processors. Editors are laid out and
+    settings updated once at the end, instead of after every processor. */
+    bool isLoading;
+
+    /** Skips the version mismatch prompt while benchmarking. */
+    bool isBenchmarking;
+
+    /** Time spent in each phase of the last loadState(), in ms */
+    struct LoadTimes
+    {
+        double parse;
+        double processors;
+        double settings;
+        double parameters;
+        double editors;
+        int numProcessors;
+        int numChannels;
+    };
+
+    LoadTimes lastLoadTimes;
+
     Label editorNamingLabel;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EditorViewport);
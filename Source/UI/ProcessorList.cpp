@@ -72,18 +72,19 @@ ProcessorList::ProcessorList()
     filters->addSubItem(new ProcessorListItem("Bandpass Filter"));
     filters->addSubItem(new ProcessorListItem("Spike Detector"));
     filters->addSubItem(new ProcessorListItem("Spike Sorter"));
-    //filters->addSubItem(new ProcessorListItem("Resampler"));
+    filters->addSubItem(new ProcessorListItem("Resampler"));
     filters->addSubItem(new ProcessorListItem("Phase Detector"));
     //filters->addSubItem(new ProcessorListItem("Digital Ref"));
     filters->addSubItem(new ProcessorListItem("Channel Map"));
     filters->addSubItem(new ProcessorListItem("Common Avg Ref"));
     filters->addSubItem(new ProcessorListItem("Rectifier"));
+    filters->addSubItem(new ProcessorListItem("Spectral Analyzer"));
     //filters->addSubItem(new ProcessorListItem("Eye Tracking"));
 
 
     ProcessorListItem* sinks = new ProcessorListItem("Sinks");
     sinks->addSubItem(new ProcessorListItem("LFP Viewer"));
-    //sinks->addSubItem(new ProcessorListItem("LFP Trig. Avg."));
+    sinks->addSubItem(new ProcessorListItem("LFP Trig. Avg."));
     sinks->addSubItem(new ProcessorListItem("Spike Viewer"));
     sinks->addSubItem(new ProcessorListItem("PSTH"));
     //sinks->addSubItem(new ProcessorListItem("Network Sink"));
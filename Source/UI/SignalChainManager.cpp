@@ -32,7 +32,7 @@ SignalChainManager::SignalChainManager
  Array<GenericEditor*, CriticalSection>& editorArray_,
  Array<SignalChainTabButton*, CriticalSection>& signalChainArray_)
     : editorArray(editorArray_), signalChainArray(signalChainArray_),
-      ev(ev_), tabSize(30)
+      ev(ev_), tabSize(30), settingsUpdatesEnabled(true)
 {
     topTab = 0;
 }
@@ -83,6 +83,11 @@ void SignalChainManager::clearSignalChain()
 
 }
 
+void SignalChainManager::setSettingsUpdatesEnabled(bool enabled)
+{
+    settingsUpdatesEnabled = enabled;
+}
+
 void SignalChainManager::createNewTab(GenericEditor* editor)
 {
 
@@ -505,7 +510,7 @@ void SignalChainManager::updateVisibleEditors(GenericEditor* activeEditor,
     }
 
     // Step 7: update all settings
-    if (action != ACTIVATE)
+    if (action != ACTIVATE && settingsUpdatesEnabled)
     {
 
         // std::cout << "Updating settings." << std::endl;
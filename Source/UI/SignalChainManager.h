@@ -69,6 +69,11 @@ public:
     /** Clears the signal chain.*/
     void clearSignalChain();
 
+    /** While disabled, updateVisibleEditors() only rearranges the editors and
+    leaves the processors' settings alone. Used by the EditorViewport to update
+    them once after loading a whole configuration.*/
+    void setSettingsUpdatesEnabled(bool enabled);
+
 private:
 
     /** An array of all currently visible editors.*/
@@ -89,6 +94,7 @@ private:
 
     const int tabSize;
 
+    bool settingsUpdatesEnabled;
 
 };
 
@@ -0,0 +1,102 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "../Source/Processors/GenericProcessor/BlockMetadata.h"
+
+/**
+
+  Checks that every stream of a signal chain gets its own sample count and
+  timestamp, whatever the node IDs are.
+
+*/
+
+class BlockMetadataTest : public UnitTest
+{
+public:
+    BlockMetadataTest() : UnitTest("BlockMetadata") { }
+
+    void runTest()
+    {
+        beginTest("Node IDs that share their low byte are separate streams");
+        {
+            BlockMetadata metadata;
+
+            Array<int> nodeIds;
+
+            for (int id = 100; id < 700; id++)
+                nodeIds.add(id);
+
+            metadata.setStreams(nodeIds);
+            expectEquals(metadata.getNumStreams(), nodeIds.size());
+
+            for (int i = 0; i < nodeIds.size(); i++)
+            {
+                metadata.setNumSamples(nodeIds[i], i);
+                metadata.setTimestamp(nodeIds[i], (int64) i * 1000000007);
+            }
+
+            int numWrong = 0;
+
+            for (int i = 0; i < nodeIds.size(); i++)
+            {
+                if (metadata.getNumSamples(nodeIds[i]) != i
+                    || metadata.getTimestamp(nodeIds[i]) != (int64) i * 1000000007)
+                    numWrong++;
+            }
+
+            expectEquals(numWrong, 0, "streams that read another stream's entry");
+        }
+
+        beginTest("Unknown streams read as empty and ignore writes");
+        {
+            BlockMetadata metadata;
+
+            Array<int> nodeIds;
+            nodeIds.add(100);
+            nodeIds.add(901);
+            nodeIds.add(100);
+            metadata.setStreams(nodeIds);
+
+            expectEquals(metadata.getNumStreams(), 2);
+
+            metadata.setNumSamples(100, 1024);
+            metadata.setNumSamples(101, 512);
+            metadata.setNumSamples(5000, 512);
+            metadata.setTimestamp(-1, 7);
+
+            expectEquals(metadata.getNumSamples(100), 1024);
+            expectEquals(metadata.getNumSamples(101), 0);
+            expectEquals(metadata.getNumSamples(5000), 0);
+            expectEquals(metadata.getNumSamples(-1), 0);
+            expectEquals(metadata.getTimestamp(-1), (int64) 0);
+            expectEquals(metadata.getNumSamples(901), 0);
+
+            // rebuilding the chain starts every stream again
+            metadata.setStreams(nodeIds);
+            expectEquals(metadata.getNumSamples(100), 0);
+        }
+    }
+};
+
+static BlockMetadataTest blockMetadataTest;
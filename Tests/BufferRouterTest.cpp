@@ -0,0 +1,648 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "../Source/Processors/ProcessorGraph/BufferRouter.h"
+#include "../Source/Processors/Channel/Channel.h"
+
+/**
+
+  Runs small signal chains twice, once through AudioProcessorGraph
+  connections (as the ProcessorGraph does by default) and once through a
+  BufferRouter, and expects the same audio output, the same samples and
+  events at the record and audio taps, and the same input at every
+  processor. The chains are wired as ProcessorGraph::updateConnections()
+  wires them: a linear chain run in place, a splitter, a merger, and a sink
+  that overwrites a tapped buffer.
+
+  GenericProcessor needs the whole GUI, so the processors are stand-ins
+  with the same roles: sources, filters that may add channels, and taps
+  that read their inputs like the RecordNode and AudioNode. Tapped
+  channels that are neither recorded nor monitored aren't saved by the
+  router before their buffer is reused, so they aren't compared.
+
+*/
+
+// Channel's constructor asks its processor for its node id; GenericProcessor
+// isn't linked here, and the channels below have no processor
+int GenericProcessor::getNodeId()
+{
+    return 0;
+}
+
+namespace
+{
+
+const double testSampleRate = 30000.0;
+const int maxBlockSize = 1024;
+const int maxTappedChannels = 32;
+
+/** An AudioProcessor with nothing but processBlock(), connected as a
+    GenericProcessor would be */
+class StubProcessor : public AudioProcessor
+{
+public:
+    StubProcessor(int id_, int numInputs, int numOutputs, int firstChannel = 0)
+        : id(id_), numBlocks(0), nextChannel(firstChannel), inputSum(0)
+    {
+        setPlayConfigDetails(numInputs, numOutputs, testSampleRate, maxBlockSize);
+    }
+
+    /** The next free input channel, as GenericProcessor::getNextChannel() */
+    int getNextChannel()
+    {
+        return nextChannel++;
+    }
+
+    void processBlock(AudioSampleBuffer& buffer, MidiBuffer& events)
+    {
+        const int numSamples = buffer.getNumSamples();
+
+        for (int c = 0; c < getNumInputChannels(); c++)
+        {
+            const float* in = buffer.getReadPointer(c);
+
+            for (int n = 0; n < numSamples; n++)
+                inputSum += in[n] * (c + 1);
+        }
+
+        inputSum += events.getNumEvents();
+
+        process(buffer, events, numSamples);
+
+        numBlocks++;
+    }
+
+    const int id;
+    int numBlocks;
+    int nextChannel;
+
+    /** The weighted sum of every input sample and the number of events */
+    double inputSum;
+
+    const String getName() const { return "Stub " + String(id); }
+    void prepareToPlay(double, int) { }
+    void releaseResources() { }
+    const String getInputChannelName(int) const { return String::empty; }
+    const String getOutputChannelName(int) const { return String::empty; }
+    bool isInputChannelStereoPair(int) const { return false; }
+    bool isOutputChannelStereoPair(int) const { return false; }
+    bool silenceInProducesSilenceOut() const { return false; }
+    double getTailLengthSeconds() const { return 0; }
+    bool acceptsMidi() const { return true; }
+    bool producesMidi() const { return true; }
+    AudioProcessorEditor* createEditor() { return nullptr; }
+    bool hasEditor() const { return false; }
+    int getNumParameters() { return 0; }
+    const String getParameterName(int) { return String::empty; }
+    float getParameter(int) { return 0; }
+    const String getParameterText(int) { return String::empty; }
+    void setParameter(int, float) { }
+    int getNumPrograms() { return 0; }
+    int getCurrentProgram() { return 0; }
+    void setCurrentProgram(int) { }
+    const String getProgramName(int) { return String::empty; }
+    void changeProgramName(int, const String&) { }
+    void getStateInformation(juce::MemoryBlock&) { }
+    void setStateInformation(const void*, int) { }
+
+protected:
+    virtual void process(AudioSampleBuffer& buffer, MidiBuffer& events, int numSamples) = 0;
+
+    /** Adds this processor's event for the block */
+    void addEvent(MidiBuffer& events, int numSamples)
+    {
+        events.addEvent(MidiMessage::noteOn(1, id, (uint8) (1 + numBlocks % 100)),
+                        (id * 37 + numBlocks * 13) % numSamples);
+    }
+};
+
+/** Writes a different sawtooth to every channel, and one event per block */
+class StubSource : public StubProcessor
+{
+public:
+    StubSource(int id, int numOutputs)
+        : StubProcessor(id, 0, numOutputs), sampleCount(0) { }
+
+    void process(AudioSampleBuffer& buffer, MidiBuffer& events, int numSamples)
+    {
+        for (int c = 0; c < getNumOutputChannels(); c++)
+        {
+            float* out = buffer.getWritePointer(c);
+
+            for (int n = 0; n < numSamples; n++)
+                out[n] = (float) ((sampleCount + n) * (c + 3) % (200 + id)) * 0.01f - 1.0f;
+        }
+
+        sampleCount += numSamples;
+        addEvent(events, numSamples);
+    }
+
+    int64 sampleCount;
+};
+
+/** Filters its channels in place, with state carried between blocks, and
+    writes any extra output channels from the inputs. Takes the planar path
+    when the channels are laid out that way, as the CAR does. */
+class StubFilter : public StubProcessor
+{
+public:
+    StubFilter(int id, int numInputs, int numOutputs)
+        : StubProcessor(id, numInputs, numOutputs), numPlanarBlocks(0)
+    {
+        last.insertMultiple(0, 0.0f, numInputs);
+    }
+
+    void process(AudioSampleBuffer& buffer, MidiBuffer& events, int numSamples)
+    {
+        const int numInputs = getNumInputChannels();
+
+        for (int c = numInputs; c < getNumOutputChannels(); c++)
+        {
+            const float* a = buffer.getReadPointer(c % numInputs);
+            const float* b = buffer.getReadPointer((c + 1) % numInputs);
+            float* out = buffer.getWritePointer(c);
+
+            for (int n = 0; n < numSamples; n++)
+                out[n] = a[n] - b[n];
+        }
+
+        ChannelBlock::PlanarView view;
+
+        if (ChannelBlock::getPlanarView(buffer, getNumOutputChannels(), numSamples, view))
+            numPlanarBlocks++;
+
+        for (int c = 0; c < numInputs; c++)
+        {
+            float* x = buffer.getWritePointer(c);
+
+            for (int n = 0; n < numSamples; n++)
+            {
+                const float y = 0.5f * x[n] + 0.25f * last[c];
+                last.set(c, x[n]);
+                x[n] = y;
+            }
+        }
+
+        // events that arrive from upstream change the signal
+        FloatVectorOperations::add(buffer.getWritePointer(0), 0.125f * events.getNumEvents(), numSamples);
+
+        addEvent(events, numSamples);
+    }
+
+    Array<float> last;
+    int numPlanarBlocks;
+};
+
+/** Keeps every sample and event it is given, like the RecordNode */
+class RecordTap : public StubProcessor
+{
+public:
+    RecordTap() : StubProcessor(100, maxTappedChannels, 0)
+    {
+        for (int c = 0; c < maxTappedChannels; c++)
+            samples.add(new Array<float>());
+    }
+
+    void process(AudioSampleBuffer& buffer, MidiBuffer& events, int numSamples)
+    {
+        for (int c = 0; c < maxTappedChannels; c++)
+            samples[c]->addArray(buffer.getReadPointer(c), numSamples);
+
+        MidiBuffer::Iterator i(events);
+        MidiMessage message;
+        int samplePosition;
+
+        while (i.getNextEvent(message, samplePosition))
+        {
+            eventCodes.add(((int64) numBlocks << 32) | (samplePosition << 16)
+                           | (message.getNoteNumber() << 8) | message.getVelocity());
+        }
+    }
+
+    OwnedArray<Array<float> > samples;
+    Array<int64> eventCodes;
+};
+
+/** Mixes the monitored channels into its first two channels, like the
+    AudioNode */
+class AudioTap : public StubProcessor
+{
+public:
+    AudioTap() : StubProcessor(101, 2 + maxTappedChannels, 2, 2)
+    {
+        channels.insertMultiple(0, nullptr, 2 + maxTappedChannels);
+    }
+
+    void process(AudioSampleBuffer& buffer, MidiBuffer& events, int numSamples)
+    {
+        buffer.clear(0, 0, numSamples);
+        buffer.clear(1, 0, numSamples);
+
+        for (int c = 2; c < channels.size(); c++)
+        {
+            if (channels[c] != nullptr && channels[c]->isMonitored)
+            {
+                buffer.addFrom(0, 0, buffer, c, 0, numSamples);
+                buffer.addFrom(1, 0, buffer, c, 0, numSamples, (float) c);
+            }
+        }
+
+        FloatVectorOperations::add(buffer.getWritePointer(1), (float) events.getNumEvents(), numSamples);
+    }
+
+    Array<Channel*> channels;
+};
+
+/** Connects processors either in an AudioProcessorGraph or in a BufferRouter */
+class Wiring
+{
+public:
+    Wiring() : numRefused(0) { }
+    virtual ~Wiring() { }
+
+    virtual void addProcessor(AudioProcessor* processor, bool isTap, int numOwnedChannels) = 0;
+    virtual bool connect(AudioProcessor* source, int sourceChannel,
+                         AudioProcessor* dest, int destChannel, Channel* channel) = 0;
+    virtual void connectEvents(AudioProcessor* source, AudioProcessor* dest) = 0;
+    virtual void setOutput(AudioProcessor* audioNode) = 0;
+    virtual void prepare() = 0;
+    virtual void process(AudioSampleBuffer& output, MidiBuffer& midiMessages) = 0;
+
+    int numRefused;
+};
+
+class GraphWiring : public Wiring
+{
+public:
+    GraphWiring()
+    {
+        graph.setPlayConfigDetails(0, 2, testSampleRate, maxBlockSize);
+        outputNode = graph.addNode(new AudioProcessorGraph::AudioGraphIOProcessor(
+                                       AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode));
+    }
+
+    void addProcessor(AudioProcessor* processor, bool, int)
+    {
+        graph.addNode(processor);
+    }
+
+    bool connect(AudioProcessor* source, int sourceChannel,
+                 AudioProcessor* dest, int destChannel, Channel*)
+    {
+        return graph.addConnection(getNodeId(source), sourceChannel, getNodeId(dest), destChannel);
+    }
+
+    void connectEvents(AudioProcessor* source, AudioProcessor* dest)
+    {
+        if (!graph.addConnection(getNodeId(source), AudioProcessorGraph::midiChannelIndex,
+                                 getNodeId(dest), AudioProcessorGraph::midiChannelIndex))
+            numRefused++;
+    }
+
+    void setOutput(AudioProcessor* audioNode)
+    {
+        for (int c = 0; c < 2; c++)
+        {
+            if (!graph.addConnection(getNodeId(audioNode), c, outputNode->nodeId, c))
+                numRefused++;
+        }
+    }
+
+    void prepare()
+    {
+        graph.prepareToPlay(testSampleRate, maxBlockSize);
+    }
+
+    void process(AudioSampleBuffer& output, MidiBuffer& midiMessages)
+    {
+        graph.processBlock(output, midiMessages);
+    }
+
+private:
+    uint32 getNodeId(AudioProcessor* processor)
+    {
+        for (int i = 0; i < graph.getNumNodes(); i++)
+        {
+            if (graph.getNode(i)->getProcessor() == processor)
+                return graph.getNode(i)->nodeId;
+        }
+
+        return 0;
+    }
+
+    AudioProcessorGraph graph;
+    AudioProcessorGraph::Node* outputNode;
+};
+
+class RouterWiring : public Wiring
+{
+public:
+    void addProcessor(AudioProcessor* processor, bool isTap, int numOwnedChannels)
+    {
+        processors.add(processor);
+
+        if (isTap)
+            router.addTap(processor, numOwnedChannels);
+        else
+            router.addProcessor(processor);
+    }
+
+    bool connect(AudioProcessor* source, int sourceChannel,
+                 AudioProcessor* dest, int destChannel, Channel* channel)
+    {
+        return router.addConnection(source, sourceChannel, dest, destChannel, channel);
+    }
+
+    void connectEvents(AudioProcessor* source, AudioProcessor* dest)
+    {
+        router.addEventConnection(source, dest);
+    }
+
+    void setOutput(AudioProcessor* audioNode)
+    {
+        router.setOutput(audioNode);
+    }
+
+    void prepare()
+    {
+        router.build();
+        router.prepare(maxBlockSize);
+    }
+
+    void process(AudioSampleBuffer& output, MidiBuffer& midiMessages)
+    {
+        router.process(output, midiMessages);
+    }
+
+private:
+    OwnedArray<AudioProcessor> processors;
+    BufferRouter router;
+};
+
+/** Builds a chain with either wiring, connecting processors as
+    ProcessorGraph::connectProcessors() and
+    ProcessorGraph::connectProcessorToAudioAndRecordNodes() do. The nth
+    tapped channel is described by channels[n] in both. */
+class Chain
+{
+public:
+    Chain(Wiring& wiring_, const OwnedArray<Channel>& channels_)
+        : wiring(wiring_), channels(channels_), numTapped(0)
+    {
+        audio = new AudioTap();
+        record = new RecordTap();
+
+        wiring.addProcessor(audio, true, 2);
+        wiring.addProcessor(record, true, 0);
+        wiring.setOutput(audio);
+    }
+
+    StubProcessor* add(StubProcessor* processor)
+    {
+        processors.add(processor);
+        wiring.addProcessor(processor, false, 0);
+        return processor;
+    }
+
+    void connect(StubProcessor* source, StubProcessor* dest)
+    {
+        for (int c = 0; c < source->getNumOutputChannels(); c++)
+        {
+            if (!wiring.connect(source, c, dest, dest->getNextChannel(), nullptr))
+                wiring.numRefused++;
+        }
+
+        wiring.connectEvents(source, dest);
+    }
+
+    void tap(StubProcessor* source)
+    {
+        for (int c = 0; c < source->getNumOutputChannels(); c++)
+        {
+            Channel* channel = channels[numTapped++];
+
+            const int audioChannel = audio->getNextChannel();
+            audio->channels.set(audioChannel, channel);
+
+            if (!wiring.connect(source, c, audio, audioChannel, channel)
+                || !wiring.connect(source, c, record, record->getNextChannel(), channel))
+                wiring.numRefused++;
+        }
+
+        wiring.connectEvents(source, record);
+        wiring.connectEvents(source, audio);
+    }
+
+    Wiring& wiring;
+    const OwnedArray<Channel>& channels;
+    int numTapped;
+
+    AudioTap* audio;
+    RecordTap* record;
+    Array<StubProcessor*> processors;
+
+    /** Every block of the audio output, one channel after the other */
+    Array<float> output;
+};
+
+enum ChainType { linearChain, splitterChain, mergerChain };
+
+void buildChain(Chain& chain, ChainType type)
+{
+    if (type == linearChain)
+    {
+        // each filter runs in place on the buffer of the one before, which
+        // is tapped; the last one adds two channels, and a sink that isn't
+        // tapped overwrites its buffer
+        StubProcessor* source = chain.add(new StubSource(1, 4));
+        StubProcessor* filter = chain.add(new StubFilter(2, 4, 4));
+        StubProcessor* expander = chain.add(new StubFilter(3, 4, 6));
+        StubProcessor* sink = chain.add(new StubFilter(4, 6, 6));
+
+        chain.tap(source);
+        chain.connect(source, filter);
+        chain.tap(filter);
+        chain.connect(filter, expander);
+        chain.tap(expander);
+        chain.connect(expander, sink);
+    }
+    else if (type == splitterChain)
+    {
+        // both paths read the source, and the first continues in place
+        StubProcessor* source = chain.add(new StubSource(1, 4));
+        StubProcessor* first = chain.add(new StubFilter(2, 4, 4));
+        StubProcessor* next = chain.add(new StubFilter(3, 4, 4));
+        StubProcessor* second = chain.add(new StubFilter(4, 4, 4));
+
+        chain.tap(source);
+        chain.connect(source, first);
+        chain.tap(first);
+        chain.connect(first, next);
+        chain.tap(next);
+        chain.connect(source, second);
+        chain.tap(second);
+    }
+    else
+    {
+        // the merged channels follow each other, with the events of both
+        // sources, and the chain continues in place after the merger
+        StubProcessor* sourceA = chain.add(new StubSource(1, 3));
+        StubProcessor* sourceB = chain.add(new StubSource(2, 2));
+        StubProcessor* merged = chain.add(new StubFilter(3, 5, 5));
+        StubProcessor* next = chain.add(new StubFilter(4, 5, 5));
+
+        chain.tap(sourceA);
+        chain.connect(sourceA, merged);
+        chain.tap(sourceB);
+        chain.connect(sourceB, merged);
+        chain.tap(merged);
+        chain.connect(merged, next);
+        chain.tap(next);
+    }
+}
+
+}
+
+class BufferRouterTest : public UnitTest
+{
+public:
+    BufferRouterTest() : UnitTest("BufferRouter") { }
+
+    void runTest()
+    {
+        // every combination of recorded and monitored, including neither
+        for (int n = 0; n < maxTappedChannels; n++)
+        {
+            Channel* channel = new Channel(nullptr, n, HEADSTAGE_CHANNEL);
+            channel->setRecordState(n % 3 != 1);
+            channel->isMonitored = (n % 4 == 3);
+            channels.add(channel);
+        }
+
+        beginTest("Linear chain");
+        check(linearChain);
+
+        beginTest("Splitter");
+        check(splitterChain);
+
+        beginTest("Merger");
+        check(mergerChain);
+    }
+
+private:
+
+    void check(ChainType type)
+    {
+        GraphWiring graphWiring;
+        RouterWiring routerWiring;
+
+        Chain graphChain(graphWiring, channels);
+        Chain routerChain(routerWiring, channels);
+
+        buildChain(graphChain, type);
+        buildChain(routerChain, type);
+
+        expectEquals(graphWiring.numRefused, 0);
+        expectEquals(routerWiring.numRefused, 0);
+
+        run(graphChain);
+        run(routerChain);
+
+        expect(graphChain.output == routerChain.output, "audio output differs");
+
+        int numCompared = 0;
+        int numWrong = 0;
+
+        for (int n = 0; n < graphChain.numTapped; n++)
+        {
+            if (!channels[n]->getRecordState() && !channels[n]->isMonitored)
+                continue;
+
+            const Array<float>& expected = *graphChain.record->samples[n];
+            const Array<float>& actual = *routerChain.record->samples[n];
+
+            expectEquals(actual.size(), expected.size());
+
+            for (int i = 0; i < expected.size() && i < actual.size(); i++)
+            {
+                if (actual[i] != expected[i])
+                    numWrong++;
+            }
+
+            numCompared++;
+        }
+
+        expect(numCompared > 0);
+        expectEquals(numWrong, 0);
+
+        // events arriving in the same sample may be merged in either order
+        DefaultElementComparator<int64> sorter;
+        graphChain.record->eventCodes.sort(sorter);
+        routerChain.record->eventCodes.sort(sorter);
+
+        expect(graphChain.record->eventCodes.size() > 0);
+        expect(graphChain.record->eventCodes == routerChain.record->eventCodes, "recorded events differ");
+
+        for (int i = 0; i < graphChain.processors.size(); i++)
+        {
+            StubProcessor* expected = graphChain.processors[i];
+            StubProcessor* actual = routerChain.processors[i];
+
+            expectEquals(actual->numBlocks, expected->numBlocks);
+            expect(actual->inputSum == expected->inputSum, actual->getName() + " had different input");
+
+            // each processor's channels are consecutive in the router's block
+            if (StubFilter* filter = dynamic_cast<StubFilter*>(actual))
+                expectEquals(filter->numPlanarBlocks, filter->numBlocks);
+        }
+    }
+
+    /** Processes blocks of different sizes, keeping the output */
+    void run(Chain& chain)
+    {
+        const int blockSizes[] = { maxBlockSize, 512, 1, 333, maxBlockSize, 100, 777 };
+
+        chain.wiring.prepare();
+
+        AudioSampleBuffer output(2, maxBlockSize);
+        MidiBuffer midiMessages;
+
+        for (int repeat = 0; repeat < 3; repeat++)
+        {
+            for (int b = 0; b < numElementsInArray(blockSizes); b++)
+            {
+                const int numSamples = blockSizes[b];
+
+                AudioSampleBuffer block(output.getArrayOfWritePointers(), 2, numSamples);
+                chain.wiring.process(block, midiMessages);
+
+                for (int c = 0; c < 2; c++)
+                    chain.output.addArray(block.getReadPointer(c), numSamples);
+            }
+        }
+    }
+
+    OwnedArray<Channel> channels;
+};
+
+static BufferRouterTest bufferRouterTest;
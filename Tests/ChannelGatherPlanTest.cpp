@@ -0,0 +1,285 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "../Source/Processors/ChannelMappingNode/ChannelGatherPlan.h"
+
+/**
+
+  Maps random data with a ChannelGatherPlan and compares the result with the
+  straightforward way of doing it: copying the whole buffer, then writing
+  each output from the copy. Covers identity maps, swaps, cycles, references
+  that are overwritten or referenced themselves, disabled channels, and
+  random mappings.
+
+*/
+
+namespace
+{
+
+const int maxReferences = 4;
+const int blockSize = 256;
+
+/** out[j] = in[sources[j]] - in[references[j]], from a copy of the input */
+void mapNaively(AudioSampleBuffer& buffer, const Array<int>& sources,
+                const Array<int>& references, const int* numSamples)
+{
+    AudioSampleBuffer input(buffer);
+
+    for (int j = 0; j < sources.size(); j++)
+    {
+        float* out = buffer.getWritePointer(j);
+        const float* in = input.getReadPointer(sources[j]);
+
+        for (int n = 0; n < numSamples[j]; n++)
+        {
+            if (references[j] == -1)
+                out[n] = in[n];
+            else
+                out[n] = in[n] - input.getReadPointer(references[j])[n];
+        }
+    }
+}
+
+/** Channel order of a mapping in which the given channels are disabled */
+Array<int> withoutChannels(int numChannels, const Array<int>& disabled)
+{
+    Array<int> sources;
+
+    for (int i = 0; i < numChannels; i++)
+    {
+        if (! disabled.contains(i))
+            sources.add(i);
+    }
+
+    return sources;
+}
+
+Array<int> noReferences(int numOutputs)
+{
+    Array<int> references;
+    references.insertMultiple(0, -1, numOutputs);
+    return references;
+}
+
+Array<int> makeArray(const int* values, int numValues)
+{
+    return Array<int>(values, numValues);
+}
+
+}
+
+class ChannelGatherPlanTest : public UnitTest
+{
+public:
+    ChannelGatherPlanTest() : UnitTest("ChannelGatherPlan"), random(1) { }
+
+    void runTest()
+    {
+        beginTest("Identity");
+        {
+            Array<int> sources = withoutChannels(16, Array<int>());
+
+            const int numOps = check(16, sources, noReferences(16));
+            expectEquals(numOps, 0);
+        }
+
+        beginTest("Swap");
+        {
+            const int sources[] = { 1, 0, 2, 3 };
+            check(4, makeArray(sources, 4), noReferences(4));
+        }
+
+        beginTest("Cycles");
+        {
+            const int three[] = { 1, 2, 0, 3, 4 };
+            check(5, makeArray(three, 5), noReferences(5));
+
+            // two cycles share the cycle slot, with outputs that read from them
+            const int two[] = { 1, 2, 0, 4, 5, 3, 0, 4 };
+            check(8, makeArray(two, 8), noReferences(8));
+
+            Array<int> rotated;
+
+            for (int j = 0; j < 64; j++)
+                rotated.add((j + 1) % 64);
+
+            check(64, rotated, noReferences(64));
+
+            Array<int> reversed;
+
+            for (int j = 0; j < 64; j++)
+                reversed.add(63 - j);
+
+            check(64, reversed, noReferences(64));
+        }
+
+        beginTest("Overwritten references");
+        {
+            // the reference moves
+            const int swapped[] = { 1, 0, 2, 3 };
+            Array<int> references;
+            references.insertMultiple(0, 0, 4);
+            check(4, makeArray(swapped, 4), references);
+
+            // the reference stays, but is referenced itself
+            check(4, withoutChannels(4, Array<int>()), references);
+
+            // the reference is part of a cycle, and every output uses one of
+            // four references
+            const int cycle[] = { 1, 2, 3, 0, 5, 4, 6, 7 };
+            const int groups[] = { 0, 3, 6, -1, 0, 5, 3, 6 };
+            check(8, makeArray(cycle, 8), makeArray(groups, 8));
+
+            const int fourGroups[] = { 2, 2, 7, 1, 7, 4, 1, 4 };
+            check(8, makeArray(cycle, 8), makeArray(fourGroups, 8));
+        }
+
+        beginTest("Disabled channels");
+        {
+            Array<int> disabled;
+            disabled.add(2);
+            disabled.add(5);
+
+            Array<int> sources = withoutChannels(8, disabled);
+            check(8, sources, noReferences(sources.size()));
+
+            // referenced against a disabled channel, which isn't overwritten
+            Array<int> references;
+            references.insertMultiple(0, 5, sources.size());
+            check(8, sources, references);
+
+            // and against one that is
+            references.clearQuick();
+            references.insertMultiple(0, 3, sources.size());
+            check(8, sources, references);
+
+            // only the last channels are disabled: nothing moves
+            disabled.clear();
+            disabled.add(6);
+            disabled.add(7);
+
+            sources = withoutChannels(8, disabled);
+            const int numOps = check(8, sources, noReferences(sources.size()));
+            expectEquals(numOps, 0);
+        }
+
+        beginTest("Outputs of different lengths");
+        {
+            const int sources[] = { 3, 0, 1, 2 };
+            const int references[] = { 1, -1, 3, 1 };
+            const int numSamples[] = { blockSize, 10, blockSize / 2, 0 };
+
+            check(4, makeArray(sources, 4), makeArray(references, 4), numSamples);
+        }
+
+        beginTest("Random mappings");
+        {
+            for (int iteration = 0; iteration < 500; iteration++)
+            {
+                const int numChannels = 1 + random.nextInt(96);
+
+                // a channel order, with some channels disabled, as set in
+                // the editor
+                Array<int> order = withoutChannels(numChannels, Array<int>());
+
+                for (int i = numChannels - 1; i > 0; i--)
+                    order.swap(i, random.nextInt(i + 1));
+
+                Array<int> sources;
+
+                for (int i = 0; i < numChannels; i++)
+                {
+                    if (random.nextInt(4) != 0)
+                        sources.add(order[i]);
+                }
+
+                // a few reference groups, each with its own reference
+                // channel, which may be disabled
+                int groupChannels[maxReferences];
+
+                for (int g = 0; g < maxReferences; g++)
+                    groupChannels[g] = random.nextInt(numChannels);
+
+                Array<int> references;
+
+                for (int j = 0; j < sources.size(); j++)
+                {
+                    int group = random.nextInt(maxReferences + 1) - 1;
+                    references.add(group < 0 ? -1 : groupChannels[group]);
+                }
+
+                check(numChannels, sources, references);
+            }
+        }
+    }
+
+private:
+
+    /** Maps the same random data with the plan and naively, expects the
+        same result, and returns the number of copies made by the plan. */
+    int check(int numChannels, const Array<int>& sources, const Array<int>& references,
+              const int* numSamples = nullptr)
+    {
+        Array<int> fullBlocks;
+        fullBlocks.insertMultiple(0, blockSize, numChannels);
+
+        if (numSamples == nullptr)
+            numSamples = fullBlocks.getRawDataPointer();
+
+        AudioSampleBuffer expected(numChannels, blockSize);
+
+        for (int c = 0; c < numChannels; c++)
+        {
+            for (int n = 0; n < blockSize; n++)
+                expected.setSample(c, n, random.nextFloat() * 2 - 1);
+        }
+
+        AudioSampleBuffer mapped(expected);
+
+        ChannelGatherPlan plan(maxReferences, blockSize);
+        plan.prepare(numChannels);
+        plan.build(sources, references, numChannels);
+        plan.apply(mapped, numSamples);
+
+        mapNaively(expected, sources, references, numSamples);
+
+        int numWrong = 0;
+
+        for (int c = 0; c < numChannels; c++)
+        {
+            for (int n = 0; n < blockSize; n++)
+            {
+                if (mapped.getSample(c, n) != expected.getSample(c, n))
+                    numWrong++;
+            }
+        }
+
+        expectEquals(numWrong, 0);
+
+        return plan.getNumOps();
+    }
+
+    Random random;
+};
+
+static ChannelGatherPlanTest channelGatherPlanTest;
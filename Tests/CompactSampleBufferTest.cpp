@@ -0,0 +1,124 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "../Source/Processors/GenericProcessor/CompactSampleBuffer.h"
+
+/**
+
+  Stores every code of the RHD2000 converters in an INT16 buffer, scaled
+  as RHD2000UsbPipeline scales them, and checks that each one comes back as
+  the value it was written as.
+
+*/
+
+namespace
+{
+
+const float adcBitVolts = 0.00015258789f;
+
+/** Largest difference between what was written and what was read, in steps,
+    over all 65536 codes */
+double getLargestError(CompactSampleBuffer& buffer, const float* values)
+{
+    HeapBlock<float> readBack(65536);
+    buffer.read(0, 0, readBack, 65536);
+
+    double largest = 0;
+
+    for (int code = 0; code < 65536; code++)
+        largest = jmax(largest, std::abs((double) readBack[code] - values[code]) / buffer.getStep(0));
+
+    return largest;
+}
+
+}
+
+class CompactSampleBufferTest : public UnitTest
+{
+public:
+    CompactSampleBufferTest() : UnitTest("CompactSampleBuffer") { }
+
+    void runTest()
+    {
+        CompactSampleBuffer buffer(CompactSampleBuffer::INT16);
+        buffer.setSize(1, 65536);
+
+        HeapBlock<float> values(65536);
+
+        beginTest("Headstage and AUX channels (signed codes) are stored exactly");
+        {
+            const float scales[2] = { 0.195f, 0.0000374f };
+
+            for (int k = 0; k < 2; k++)
+            {
+                for (int code = 0; code < 65536; code++)
+                    values[code] = float(code - 32768) * scales[k];
+
+                buffer.setStep(0, scales[k], 0.0f);
+                buffer.write(0, 0, values, 65536);
+
+                expect(getLargestError(buffer, values) < 0.01, "scale " + String(scales[k], 7));
+            }
+        }
+
+        beginTest("ADC channels (unsigned codes with an offset) are stored exactly");
+        {
+            for (int code = 0; code < 65536; code++)
+                values[code] = (float)(0.00015258789 * float(code) - 5 - 0.4096);
+
+            // the step and offset that RHD2000Thread gives ADC channels
+            buffer.setStep(0, adcBitVolts, adcBitVolts * 32768.0f - 5.0f - 0.4096f);
+            buffer.write(0, 0, values, 65536);
+
+            expect(getLargestError(buffer, values) < 0.01, "largest error "
+                   + String(getLargestError(buffer, values)) + " steps");
+
+            // the ends of the range do not saturate
+            expect(std::abs(buffer.getSample(0, 0) + 5.4096f) < adcBitVolts * 0.01f);
+            expect(std::abs(buffer.getSample(0, 65535) - values[65535]) < adcBitVolts * 0.01f);
+        }
+
+        beginTest("Without the offset, ADC channels saturate");
+        {
+            buffer.setStep(0, adcBitVolts, 0.0f);
+            buffer.write(0, 0, values, 65536);
+
+            expect(getLargestError(buffer, values) > 1000.0);
+        }
+
+        beginTest("A cleared channel reads as zero whatever its offset");
+        {
+            buffer.setStep(0, adcBitVolts, -0.4096f);
+            buffer.clear();
+
+            float sample[1];
+            buffer.read(0, 1000, sample, 1);
+
+            expect(std::abs(sample[0]) < adcBitVolts);
+            expect(std::abs(buffer.getSample(0, 0)) < adcBitVolts);
+        }
+    }
+};
+
+static CompactSampleBufferTest compactSampleBufferTest;
@@ -0,0 +1,203 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "../Source/Processors/Visualization/FastFourierTransform.h"
+#include "../Source/Processors/PSTH/ResponseSmoother.h"
+
+/**
+
+  Checks the shared FastFourierTransform against a direct DFT: the power
+  spectra of two real channels packed into one transform (as the
+  SpectralAnalyzer does for each pair of channels), of a single channel
+  (the last one of an odd number), and the inverse transform. The
+  ResponseSmoother's FFT convolution is compared with the direct one.
+
+*/
+
+namespace
+{
+
+/** |X[k]|^2 of a real signal, for k = 0 .. n/2 */
+void directPowerSpectrum(const float* x, int n, double* power)
+{
+    for (int k = 0; k <= n / 2; k++)
+    {
+        double re = 0.0, im = 0.0;
+
+        for (int t = 0; t < n; t++)
+        {
+            const double angle = -2.0 * double_Pi * (double) k * t / n;
+            re += x[t] * cos(angle);
+            im += x[t] * sin(angle);
+        }
+
+        power[k] = re * re + im * im;
+    }
+}
+
+/** Number of bins that differ from the direct spectrum by more than a
+    small fraction of its largest bin */
+int countWrongBins(const float* power, const double* expected, int numBins)
+{
+    double largest = 0.0;
+
+    for (int k = 0; k < numBins; k++)
+        largest = jmax(largest, expected[k]);
+
+    int numWrong = 0;
+
+    for (int k = 0; k < numBins; k++)
+    {
+        if (std::abs(power[k] - expected[k]) > 1e-4 * largest + 1e-6)
+            numWrong++;
+    }
+
+    return numWrong;
+}
+
+}
+
+class FastFourierTransformTest : public UnitTest
+{
+public:
+    FastFourierTransformTest() : UnitTest("FastFourierTransform"), random(1) { }
+
+    void runTest()
+    {
+        const int sizes[] = { 2, 8, 64, 1024 };
+
+        for (int s = 0; s < 4; s++)
+        {
+            const int n = sizes[s];
+            FastFourierTransform fft(n);
+
+            HeapBlock<float> a(n), b(n), data(2 * n), powerA(n / 2 + 1), powerB(n / 2 + 1);
+            HeapBlock<double> expectedA(n / 2 + 1), expectedB(n / 2 + 1);
+
+            beginTest("Two channels in one transform, size " + String(n));
+
+            for (int trial = 0; trial < 10; trial++)
+            {
+                for (int t = 0; t < n; t++)
+                {
+                    // one with an offset, so that bin 0 dominates
+                    a[t] = random.nextFloat() * 2 - 1;
+                    b[t] = random.nextFloat() + 3;
+                    data[2 * t] = a[t];
+                    data[2 * t + 1] = b[t];
+                }
+
+                fft.perform(data);
+                fft.powerSpectra(data, powerA, powerB);
+
+                directPowerSpectrum(a, n, expectedA);
+                directPowerSpectrum(b, n, expectedB);
+
+                expectEquals(countWrongBins(powerA, expectedA, n / 2 + 1), 0, "first channel");
+                expectEquals(countWrongBins(powerB, expectedB, n / 2 + 1), 0, "second channel");
+            }
+
+            beginTest("Single channel, size " + String(n));
+            {
+                for (int t = 0; t < n; t++)
+                {
+                    a[t] = random.nextFloat() * 2 - 1;
+                    data[2 * t] = a[t];
+                    data[2 * t + 1] = 0.0f;
+                }
+
+                fft.perform(data);
+                fft.powerSpectra(data, powerA, nullptr);
+
+                directPowerSpectrum(a, n, expectedA);
+
+                expectEquals(countWrongBins(powerA, expectedA, n / 2 + 1), 0);
+            }
+
+            beginTest("Inverse transform, size " + String(n));
+            {
+                HeapBlock<float> original(2 * n);
+
+                for (int i = 0; i < 2 * n; i++)
+                    original[i] = data[i] = random.nextFloat() * 2 - 1;
+
+                fft.perform(data);
+                fft.performInverse(data);
+
+                int numWrong = 0;
+
+                for (int i = 0; i < 2 * n; i++)
+                {
+                    if (std::abs(data[i] / n - original[i]) > 1e-5f)
+                        numWrong++;
+                }
+
+                expectEquals(numWrong, 0);
+            }
+        }
+
+        beginTest("ResponseSmoother: FFT convolution matches the direct one");
+        {
+            std::vector<float> y(700);
+            std::vector<float> wideKernel(3 * ResponseSmoother::FFT_KERNEL_THRESHOLD + 1);
+
+            for (size_t i = 0; i < y.size(); i++)
+                y[i] = random.nextFloat() * 10;
+
+            for (size_t i = 0; i < wideKernel.size(); i++)
+                wideKernel[i] = random.nextFloat();
+
+            ResponseSmoother smoother;
+            std::vector<float> result;
+
+            smoother.smooth(y, wideKernel, -50, 750, result);
+            expectEquals((int) result.size(), 801);
+
+            const int zeroIndex = (wideKernel.size() - 1) / 2;
+            int numWrong = 0;
+
+            for (int x = -50; x <= 750; x++)
+            {
+                double expected = 0.0;
+
+                for (int j = 0; j < (int) wideKernel.size(); j++)
+                {
+                    const int index = x + j - zeroIndex;
+
+                    if (index >= 0 && index < (int) y.size())
+                        expected += wideKernel[j] * y[index];
+                }
+
+                if (std::abs(result[x + 50] - expected) > 1e-3 * (1.0 + std::abs(expected)))
+                    numWrong++;
+            }
+
+            expectEquals(numWrong, 0);
+        }
+    }
+
+private:
+    Random random;
+};
+
+static FastFourierTransformTest fastFourierTransformTest;
@@ -0,0 +1,137 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "../Source/Processors/ProcessorGraph/LatencyMonitor.h"
+
+/**
+
+  A loopback through the LatencyMonitor without hardware: two sources hand
+  it blocks whose samples arrived 2 ms and 500 ms ago, and TTL events laid
+  out as GenericProcessor::addEvent() lays them out reach an output. Each
+  event must be timed against the block of the source its source ID byte
+  names, whichever source sent the last block.
+
+*/
+
+namespace
+{
+
+const int fastSourceId = 101;
+const int slowSourceId = 102;
+const int outputId = 105;
+const int blockSize = 1024;
+
+/** Hands the monitor a block of a source whose samples arrived msAgo ago */
+void sendBlock(LatencyMonitor& monitor, int sourceNodeId, double msAgo)
+{
+    HeapBlock<int64> arrivals(blockSize);
+
+    const int64 arrival = Time::getHighResolutionTicks() - Time::secondsToHighResolutionTicks(msAgo / 1000.0);
+
+    for (int i = 0; i < blockSize; i++)
+        arrivals[i] = arrival;
+
+    monitor.setBlockArrivals(sourceNodeId, arrivals, blockSize / 2, arrivals + blockSize / 2, blockSize / 2);
+}
+
+/** A TTL event as GenericProcessor::addEvent() builds it */
+void sendEvent(LatencyMonitor& monitor, int sourceNodeId, int sampleNum)
+{
+    const uint8 event[6] = { 3,                     // TTL
+                             (uint8)(outputId - 1), // node that added the event
+                             1,                     // event ID
+                             0,                     // channel
+                             1,                     // saving flag
+                             (uint8) sourceNodeId
+                           };
+
+    monitor.eventReachedOutput(outputId, event, sizeof(event), sampleNum);
+}
+
+}
+
+class LatencyMonitorTest : public UnitTest
+{
+public:
+    LatencyMonitorTest() : UnitTest("LatencyMonitor") { }
+
+    void runTest()
+    {
+        LatencyMonitor monitor("budget=100");
+        LatencyStats stats;
+
+        beginTest("Events are timed against the source named in the event");
+        {
+            monitor.start();
+
+            // the slow source sends the last block before each event
+            for (int i = 0; i < 20; i++)
+            {
+                sendBlock(monitor, fastSourceId, 2.0);
+                sendBlock(monitor, slowSourceId, 500.0);
+                sendEvent(monitor, fastSourceId, i * 10);
+            }
+
+            monitor.stop();
+
+            expect(monitor.getStats(stats));
+            expectEquals((int) stats.numEvents, 20);
+            expectEquals((int) stats.unmatched, 0);
+            expect(stats.maxMs >= 2.0 && stats.maxMs < 100.0, "max " + String(stats.maxMs) + " ms");
+            expectEquals((int) stats.overBudget, 0);
+        }
+
+        beginTest("Events of the other source are timed against its blocks");
+        {
+            monitor.start();
+
+            sendBlock(monitor, slowSourceId, 500.0);
+            sendBlock(monitor, fastSourceId, 2.0);
+            sendEvent(monitor, slowSourceId, 0);
+
+            monitor.stop();
+
+            expect(monitor.getStats(stats));
+            expectEquals((int) stats.numEvents, 1);
+            expect(stats.meanMs >= 500.0, "mean " + String(stats.meanMs) + " ms");
+            expectEquals((int) stats.overBudget, 1);
+        }
+
+        beginTest("Events from a source that sent no block are counted, not timed");
+        {
+            monitor.start();
+
+            sendBlock(monitor, fastSourceId, 2.0);
+            sendEvent(monitor, 200, 0);
+            sendEvent(monitor, fastSourceId, 0);
+
+            monitor.stop();
+
+            expect(monitor.getStats(stats));
+            expectEquals((int) stats.numEvents, 1);
+            expectEquals((int) stats.unmatched, 1);
+        }
+    }
+};
+
+static LatencyMonitorTest latencyMonitorTest;
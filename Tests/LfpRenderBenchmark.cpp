@@ -0,0 +1,552 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#define GL_GLEXT_PROTOTYPES 1
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../Source/Processors/LfpDisplayNode/LfpLineBatch.h"
+
+/**
+
+  Measures the frame times of the LfpOpenGLRenderer without a display,
+  next to those of the canvas it replaces.
+
+  Frames of N channels are built into an LfpLineBatch as the renderer
+  builds them (grid, one baseline and one trace per channel, cursor) from
+  synthetic screen buffers, and drawn into an offscreen framebuffer with
+  the renderer's shaders, through a surfaceless EGL context (Mesa's
+  llvmpipe when there is no GPU). As a baseline, the same frames are
+  painted into a software Image of the same size with the Graphics calls
+  of LfpDisplayCanvas::paint() and LfpChannelDisplay::paint() (a full
+  redraw of every channel). For each channel count and draw method the
+  mean and maximum time per frame of both paths, and the speedup, are
+  printed.
+
+    lfp-render-benchmark [-w width] [-h height] [-f frames] [channels...]
+
+  The default is a 1920 x 1080 screen, 30 frames, and 64, 256 and 1024
+  channels. The channels share the screen height (at least one pixel
+  each), so every channel is drawn.
+
+  Returns a non-zero status if no OpenGL context can be created, the
+  shaders do not compile, or a frame comes out blank.
+
+*/
+
+// juce_graphics calls this when fonts change, if the AppConfig has
+// juce_opengl (which isn't linked here)
+namespace juce { void clearOpenGLGlyphCache() {} }
+
+namespace
+{
+
+struct FrameTimes
+{
+    FrameTimes() : total(0), max(0), count(0) { }
+
+    void add(double ms)
+    {
+        total += ms;
+        max = jmax(max, ms);
+        count++;
+    }
+
+    double total;
+    double max;
+    int count;
+};
+
+double getMsSince(int64 start)
+{
+    return Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1000.0;
+}
+
+/** A surfaceless EGL context drawing into a framebuffer of its own */
+class OffscreenContext
+{
+public:
+    OffscreenContext(int width_, int height_)
+        : width(width_), height(height_), display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT),
+          framebuffer(0), renderbuffer(0)
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay
+            = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+        if (getPlatformDisplay != nullptr)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+        EGLint major, minor;
+
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)
+            || !eglBindAPI(EGL_OPENGL_API))
+        {
+            std::cout << "Could not initialise EGL." << std::endl;
+            return;
+        }
+
+        const EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+
+        EGLConfig config;
+        EGLint numConfigs = 0;
+
+        if (!eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0)
+        {
+            std::cout << "No EGL configuration supports OpenGL." << std::endl;
+            return;
+        }
+
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+
+        if (context == EGL_NO_CONTEXT
+            || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+        {
+            std::cout << "Could not create a surfaceless OpenGL context." << std::endl;
+            context = EGL_NO_CONTEXT;
+            return;
+        }
+
+        glGenRenderbuffers(1, &renderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "Could not create a " << width << " x " << height << " framebuffer." << std::endl;
+            release();
+        }
+    }
+
+    ~OffscreenContext()
+    {
+        release();
+    }
+
+    bool isValid() const
+    {
+        return context != EGL_NO_CONTEXT;
+    }
+
+    /** Returns the number of pixels that differ from the background colour
+        (the top left pixel) */
+    int countDrawnPixels()
+    {
+        HeapBlock<uint32> pixels((size_t) width * height);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+        int count = 0;
+
+        for (int i = 0; i < width * height; i++)
+        {
+            if (pixels[i] != pixels[(height - 1) * width])
+                count++;
+        }
+
+        return count;
+    }
+
+private:
+    void release()
+    {
+        if (context == EGL_NO_CONTEXT)
+            return;
+
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &renderbuffer);
+
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+
+        context = EGL_NO_CONTEXT;
+    }
+
+    int width, height;
+    EGLDisplay display;
+    EGLContext context;
+    GLuint framebuffer, renderbuffer;
+};
+
+/** The renderer's shader program and vertex buffer */
+class LineProgram
+{
+public:
+    LineProgram() : program(0), vertexBuffer(0)
+    {
+        const GLuint vertexShader = compile(GL_VERTEX_SHADER, LfpLineBatch::getVertexShader(""));
+        const GLuint fragmentShader = compile(GL_FRAGMENT_SHADER, LfpLineBatch::getFragmentShader(""));
+
+        if (vertexShader == 0 || fragmentShader == 0)
+            return;
+
+        program = glCreateProgram();
+        glAttachShader(program, vertexShader);
+        glAttachShader(program, fragmentShader);
+        glLinkProgram(program);
+
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+
+        GLint linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+
+        if (!linked)
+        {
+            std::cout << "Could not link the shaders." << std::endl;
+            glDeleteProgram(program);
+            program = 0;
+            return;
+        }
+
+        position = glGetAttribLocation(program, "position");
+        colour = glGetAttribLocation(program, "colour");
+        screenSize = glGetUniformLocation(program, "screenSize");
+
+        glGenBuffers(1, &vertexBuffer);
+    }
+
+    ~LineProgram()
+    {
+        if (program != 0)
+        {
+            glDeleteBuffers(1, &vertexBuffer);
+            glDeleteProgram(program);
+        }
+    }
+
+    bool isValid() const
+    {
+        return program != 0;
+    }
+
+    /** Draws a frame as LfpOpenGLRenderer::renderOpenGL() does */
+    void draw(const LfpLineBatch& batch, int width, int height)
+    {
+        glViewport(0, 0, width, height);
+
+        glClearColor(0.0f, 18.0f / 255.0f, 43.0f / 255.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        glUseProgram(program);
+        glUniform2f(screenSize, (GLfloat) width, (GLfloat) height);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, batch.getNumFloats() * sizeof(GLfloat), batch.getData(), GL_STREAM_DRAW);
+
+        const GLsizei stride = LfpLineBatch::floatsPerVertex * sizeof(GLfloat);
+
+        glVertexAttribPointer(position, 2, GL_FLOAT, GL_FALSE, stride, 0);
+        glEnableVertexAttribArray(position);
+
+        glVertexAttribPointer(colour, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(2 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(colour);
+
+        glDrawArrays(GL_LINES, 0, batch.getNumVertices());
+
+        glDisableVertexAttribArray(position);
+        glDisableVertexAttribArray(colour);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glFinish();
+    }
+
+private:
+    static GLuint compile(GLenum type, const String& source)
+    {
+        const GLuint shader = glCreateShader(type);
+        const GLchar* text = source.toRawUTF8();
+
+        glShaderSource(shader, 1, &text, nullptr);
+        glCompileShader(shader);
+
+        GLint compiled = 0;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+
+        if (!compiled)
+        {
+            GLchar log[1024] = { 0 };
+            glGetShaderInfoLog(shader, sizeof(log) - 1, nullptr, log);
+            std::cout << "Could not compile a shader: " << log << std::endl;
+
+            glDeleteShader(shader);
+            return 0;
+        }
+
+        return shader;
+    }
+
+    GLuint program;
+    GLuint vertexBuffer;
+    GLint position, colour, screenSize;
+};
+
+/** Synthetic screen buffers: one value per pixel and channel, in the
+    display's units (microvolts), as LfpDisplayCanvas fills them */
+struct ScreenBuffers
+{
+    ScreenBuffers(int numChannels, int width) : values(numChannels, width), mins(numChannels, width),
+        maxs(numChannels, width)
+    {
+        Random random(1);
+
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            for (int i = 0; i < width; i++)
+            {
+                const float value = 100.0f * std::sin(0.05f * i + chan) + 20.0f * (random.nextFloat() - 0.5f);
+                const float spread = 30.0f * random.nextFloat();
+
+                values.setSample(chan, i, value);
+                mins.setSample(chan, i, value - spread);
+                maxs.setSample(chan, i, value + spread);
+            }
+        }
+    }
+
+    AudioSampleBuffer values, mins, maxs;
+};
+
+/** Paints a frame the way the Graphics canvas does: the background and
+    grid of LfpDisplayCanvas::paint(), then LfpChannelDisplay::paint() of
+    every channel in its own area, with drawLine() for traces or setPixel()
+    columns for min/max */
+void paintFrame(Graphics& g, const ScreenBuffers& buffers, int numChannels,
+                int width, int height, bool drawRange, int cursor)
+{
+    g.setColour(Colour(0,18,43));
+    g.fillRect(0, 0, width, height);
+
+    g.setColour(Colour(25,25,60));
+
+    for (int i = 0; i < 10; i++)
+        g.drawLine(width/10*i, 0, width/10*i, height, (i == 5 || i == 0) ? 3.0f : 1.0f);
+
+    const int channelHeight = jmax(1, height / numChannels);
+    const float range = 250.0f;
+
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        Graphics::ScopedSaveState state(g);
+
+        g.setOrigin(0, chan * channelHeight);
+        g.reduceClipRegion(0, 0, width, channelHeight);
+
+        g.setColour(Colours::yellow);
+        g.drawLine(cursor + 1, 0, cursor + 1, channelHeight);
+
+        const int center = channelHeight/2;
+
+        g.setColour(Colour(40,40,40));
+        g.drawLine(0, center, width, center);
+
+        g.setColour(Colour(0xff000000 | (uint32)((chan * 0x3f1d27) & 0xffffff)));
+
+        const float* values = buffers.values.getReadPointer(chan);
+        const float* mins = buffers.mins.getReadPointer(chan);
+        const float* maxs = buffers.maxs.getReadPointer(chan);
+
+        for (int i = 0; i < width - 1; i++)
+        {
+            if (! drawRange)
+            {
+                g.drawLine(i, values[i]/range*channelHeight + center,
+                           i + 1, values[i+1]/range*channelHeight + center);
+            }
+            else
+            {
+                const int a = (int)(maxs[i]/range*channelHeight + center);
+                const int b = (int)(mins[i]/range*channelHeight + center);
+
+                for (int j = jmin(a, b); j <= jmax(a, b); j++)
+                    g.setPixel(i, j);
+            }
+        }
+    }
+}
+
+/** Builds a frame the way LfpOpenGLRenderer::refresh() does */
+void buildFrame(LfpLineBatch& batch, const ScreenBuffers& buffers, int numChannels,
+                int width, int height, bool drawRange, int cursor)
+{
+    batch.clear();
+    batch.reserve(numChannels * (width + 1) + 32);
+
+    const uint32 gridColour = 0xff19193c;
+
+    for (int i = 0; i < 10; i++)
+    {
+        const float x = (float)(width / 10 * i) + 0.5f;
+
+        batch.addLine(x, 0, x, height, gridColour);
+
+        if (i == 5 || i == 0)
+        {
+            batch.addLine(x - 1, 0, x - 1, height, gridColour);
+            batch.addLine(x + 1, 0, x + 1, height, gridColour);
+        }
+    }
+
+    const float channelHeight = jmax(1.0f, (float) height / numChannels);
+    const float scale = channelHeight / 250.0f; // a 250 uV range
+
+    for (int chan = 0; chan < numChannels; chan++)
+    {
+        const float center = (chan + 0.5f) * channelHeight;
+        const uint32 lineColour = 0xff000000 | (uint32)((chan * 0x3f1d27) & 0xffffff);
+
+        batch.addLine(0, center, width, center, 0xff282828);
+
+        if (drawRange)
+            batch.addRange(buffers.mins.getReadPointer(chan), buffers.maxs.getReadPointer(chan),
+                           width, center, scale, lineColour);
+        else
+            batch.addTrace(buffers.values.getReadPointer(chan), width, center, scale, lineColour);
+    }
+
+    batch.addLine(cursor + 0.5f, 0, cursor + 0.5f, height, 0xffffff00);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    int width = 1920;
+    int height = 1080;
+    int numFrames = 30;
+    Array<int> channelCounts;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const String arg(argv[i]);
+
+        if (arg == "-w" && i + 1 < argc)
+            width = String(argv[++i]).getIntValue();
+        else if (arg == "-h" && i + 1 < argc)
+            height = String(argv[++i]).getIntValue();
+        else if (arg == "-f" && i + 1 < argc)
+            numFrames = String(argv[++i]).getIntValue();
+        else if (arg.getIntValue() > 0)
+            channelCounts.add(arg.getIntValue());
+        else
+        {
+            std::cout << "Usage: lfp-render-benchmark [-w width] [-h height] [-f frames] [channels...]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (channelCounts.size() == 0)
+    {
+        channelCounts.add(64);
+        channelCounts.add(256);
+        channelCounts.add(1024);
+    }
+
+    width = jmax(16, width);
+    height = jmax(16, height);
+    numFrames = jmax(1, numFrames);
+
+    OffscreenContext context(width, height);
+
+    if (!context.isValid())
+        return 1;
+
+    std::cout << "OpenGL renderer: " << (const char*) glGetString(GL_RENDERER)
+              << ", " << width << " x " << height << ", " << numFrames << " frames" << std::endl;
+
+    LineProgram program;
+
+    if (!program.isValid())
+        return 1;
+
+    LfpLineBatch batch;
+    bool allDrawn = true;
+
+    Image image(Image::RGB, width, height, true, SoftwareImageType());
+
+    for (int c = 0; c < channelCounts.size(); c++)
+    {
+        const int numChannels = channelCounts[c];
+        const ScreenBuffers buffers(numChannels, width);
+
+        for (int method = 0; method < 2; method++)
+        {
+            const bool drawRange = (method == 1);
+
+            FrameTimes paint, build, draw;
+
+            {
+                Graphics g(image);
+
+                for (int frame = 0; frame < numFrames; frame++)
+                {
+                    const int64 start = Time::getHighResolutionTicks();
+                    paintFrame(g, buffers, numChannels, width, height, drawRange, frame % width);
+                    paint.add(getMsSince(start));
+                }
+            }
+
+            for (int frame = 0; frame < numFrames; frame++)
+            {
+                int64 start = Time::getHighResolutionTicks();
+                buildFrame(batch, buffers, numChannels, width, height, drawRange, frame % width);
+                build.add(getMsSince(start));
+
+                start = Time::getHighResolutionTicks();
+                program.draw(batch, width, height);
+                draw.add(getMsSince(start));
+            }
+
+            const int drawnPixels = context.countDrawnPixels();
+            allDrawn = allDrawn && drawnPixels > 0;
+
+            const double openGLFrame = (build.total + draw.total) / numFrames;
+            const double graphicsFrame = paint.total / paint.count;
+
+            std::cout << String(numChannels).paddedLeft(' ', 5) << " channels, "
+                      << (drawRange ? "min/max" : "traces ") << ": Graphics "
+                      << String(graphicsFrame, 3) << " ms (max " << String(paint.max, 3) << "); OpenGL "
+                      << batch.getNumVertices() / 2 << " lines, build "
+                      << String(build.total / build.count, 3) << " ms (max " << String(build.max, 3)
+                      << "), draw " << String(draw.total / draw.count, 3) << " ms (max " << String(draw.max, 3)
+                      << "), frame " << String(openGLFrame, 3) << " ms; speedup "
+                      << String(graphicsFrame / openGLFrame, 2) << "x"
+                      << (drawnPixels > 0 ? "" : "  -- BLANK FRAME") << std::endl;
+        }
+    }
+
+    return allDrawn ? 0 : 1;
+}
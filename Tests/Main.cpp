@@ -0,0 +1,81 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Runs the unit tests named on the command line, or all of them, and
+  returns the number of failures.
+
+  Each test is a juce::UnitTest declared as a static object in its own
+  source file (see the Makefile). None of them opens a window or runs the
+  message loop, so the tests run headless.
+
+*/
+
+// juce_graphics calls this when fonts change, if the AppConfig has
+// juce_opengl (which isn't linked here)
+namespace juce { void clearOpenGLGlyphCache() {} }
+
+int main(int argc, char* argv[])
+{
+    Array<UnitTest*> tests;
+
+    for (int i = 0; i < UnitTest::getAllTests().size(); i++)
+    {
+        UnitTest* test = UnitTest::getAllTests()[i];
+
+        bool selected = argc < 2;
+
+        for (int arg = 1; arg < argc; arg++)
+            selected = selected || test->getName() == argv[arg];
+
+        if (selected)
+            tests.add(test);
+    }
+
+    if (tests.size() == 0)
+    {
+        std::cout << "No tests match the arguments." << std::endl;
+        return 1;
+    }
+
+    UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    runner.runTests(tests);
+
+    int numPasses = 0;
+    int numFailures = 0;
+
+    for (int i = 0; i < runner.getNumResults(); i++)
+    {
+        numPasses += runner.getResult(i)->passes;
+        numFailures += runner.getResult(i)->failures;
+    }
+
+    std::cout << std::endl << numPasses << " checks passed, " << numFailures << " failed." << std::endl;
+
+    return numFailures > 0 ? 1 : 0;
+}
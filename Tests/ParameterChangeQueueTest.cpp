@@ -0,0 +1,237 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "../Source/Processors/GenericProcessor/ParameterChangeQueue.h"
+
+/**
+
+  Hammers a ParameterChangeQueue from one thread while another applies the
+  changes between "blocks", as GenericProcessor::processBlock() does, and
+  checks that no change is torn, reordered, duplicated or silently lost,
+  and that the state seen by each block is never half-updated.
+
+*/
+
+namespace
+{
+
+/** The kind of state a processor's setParameter() updates in several steps
+    (a gain and the filter coefficients derived from it, for one channel) */
+struct ProcessorState
+{
+    float gain;
+    float coefficients[16];
+    int channel;
+
+    void apply(const ParameterChange& change)
+    {
+        gain = change.newValue;
+
+        for (int k = 0; k < 16; k++)
+            coefficients[k] = gain * (k + 1);
+
+        channel = change.channel;
+    }
+
+    bool isConsistent() const
+    {
+        for (int k = 0; k < 16; k++)
+        {
+            if (coefficients[k] != gain * (k + 1))
+                return false;
+        }
+
+        return channel == ((int) gain) % 64;
+    }
+};
+
+/** Every field of change n is derived from n, so a change assembled from
+    two different pushes is detected. */
+ParameterChange makeChange(int n)
+{
+    ParameterChange change;
+    change.parameterIndex = n % 7;
+    change.newValue = (float) n;
+    change.channel = n % 64;
+    change.target = n * 3;
+    return change;
+}
+
+bool isIntact(const ParameterChange& change)
+{
+    const int n = (int) change.newValue;
+
+    return change.parameterIndex == n % 7 && change.channel == n % 64 && change.target == n * 3;
+}
+
+void spin(double seconds)
+{
+    const int64 end = Time::getHighResolutionTicks() + Time::secondsToHighResolutionTicks(seconds);
+
+    while (Time::getHighResolutionTicks() < end)
+    {
+    }
+}
+
+class ProcessingThread : public Thread
+{
+public:
+    ProcessingThread(ParameterChangeQueue& queue_)
+        : Thread("Processing"), queue(queue_), numApplied(0), lastApplied(-1),
+          numTorn(0), numOutOfOrder(0), numInconsistentBlocks(0), numBlocks(0)
+    {
+        state.apply(makeChange(0));
+    }
+
+    void run()
+    {
+        while (! threadShouldExit())
+        {
+            processBlock();
+
+            // a block takes a few microseconds, and now and then the
+            // thread stalls long enough for the queue to fill up
+            if (numBlocks % 500 == 0)
+                Thread::sleep(1);
+            else
+                spin(0.00002);
+        }
+
+        processBlock(); // whatever was pushed before the producer stopped
+    }
+
+    void processBlock()
+    {
+        // as GenericProcessor::applyQueuedParameterChanges()
+        ParameterChange change;
+
+        for (int n = queue.getNumReady(); n > 0 && queue.pop(change); n--)
+        {
+            if (! isIntact(change))
+                numTorn++;
+
+            if ((int) change.newValue <= lastApplied)
+                numOutOfOrder++;
+
+            lastApplied = (int) change.newValue;
+            state.apply(change);
+            numApplied++;
+        }
+
+        // process()
+        if (! state.isConsistent())
+            numInconsistentBlocks++;
+
+        numBlocks++;
+    }
+
+    ParameterChangeQueue& queue;
+    ProcessorState state;
+
+    int numApplied;
+    int lastApplied;
+    int numTorn;
+    int numOutOfOrder;
+    int numInconsistentBlocks;
+    int numBlocks;
+};
+
+}
+
+class ParameterChangeQueueTest : public UnitTest
+{
+public:
+    ParameterChangeQueueTest() : UnitTest("ParameterChangeQueue") { }
+
+    void runTest()
+    {
+        beginTest("Changes come out in order");
+        {
+            ParameterChangeQueue queue(16);
+            ParameterChange change;
+
+            for (int round = 0; round < 5; round++)
+            {
+                for (int n = 0; n < 10; n++)
+                    expect(queue.push(makeChange(round * 10 + n)));
+
+                for (int n = 0; n < 10; n++)
+                {
+                    expect(queue.pop(change));
+                    expect(isIntact(change));
+                    expectEquals((int) change.newValue, round * 10 + n);
+                }
+
+                expect(! queue.pop(change));
+            }
+        }
+
+        beginTest("A full queue drops and counts changes");
+        {
+            ParameterChangeQueue queue(16);
+            int numPushed = 0;
+
+            for (int n = 0; n < 40; n++)
+                numPushed += queue.push(makeChange(n)) ? 1 : 0;
+
+            // an AbstractFifo holds one item less than its size
+            expectEquals(numPushed, 15);
+            expectEquals(queue.getNumDropped(), 40 - numPushed);
+
+            queue.clearNumDropped();
+            expectEquals(queue.getNumDropped(), 0);
+        }
+
+        beginTest("No torn state while changes are hammered during processing");
+        {
+            ParameterChangeQueue queue(256);
+            ProcessingThread processing(queue);
+            processing.startThread();
+
+            const int numChanges = 200000;
+            int numSent = 0;
+
+            for (int n = 1; n <= numChanges; n++)
+            {
+                queue.push(makeChange(n));
+                numSent++;
+
+                spin(0.000002); // a slider being dragged very fast
+            }
+
+            processing.stopThread(10000);
+
+            logMessage(String(processing.numApplied) + " changes applied in " + String(processing.numBlocks)
+                       + " blocks, " + String(queue.getNumDropped()) + " dropped");
+
+            expectEquals(processing.numTorn, 0, "torn changes");
+            expectEquals(processing.numOutOfOrder, 0, "changes out of order");
+            expectEquals(processing.numInconsistentBlocks, 0, "blocks that saw a half-updated state");
+            expectEquals(processing.numApplied + queue.getNumDropped(), numSent, "changes lost");
+            expect(processing.numApplied > 0);
+        }
+    }
+};
+
+static ParameterChangeQueueTest parameterChangeQueueTest;
@@ -0,0 +1,317 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "../Source/Processors/DataThreads/RHD2000UsbPipeline.h"
+#include "../Source/Processors/DataThreads/RHD2000SimulatedBoard.h"
+#include "../Source/Processors/DataThreads/rhythm-api/rhd2000datablock.h"
+
+/**
+
+  Drives an RHD2000UsbPipeline from stand-ins for the evaluation board,
+  without any hardware.
+
+  The RHD2000SimulatedBoard runs unthrottled with up to 2048 amplifier
+  channels (more than a board's 512), and every parsed amplifier, ADC and
+  TTL sample is compared with the simulated signal. The time taken to parse
+  a block is printed next to the time the block spans.
+
+  The RHD2000FileSource replays frames of the simulated board from a file
+  shorter than the data read, both as fast as possible and at the sample
+  rate, and is checked the same way.
+
+*/
+
+namespace
+{
+
+/** A board whose reads take longer than the pipeline waits for its reader
+    when it is stopped, as a USB read does until its transfer times out */
+class SlowSource : public RHD2000BlockSource
+{
+public:
+    SlowSource(Atomic<int>& readsInProgress_) : readsInProgress(readsInProgress_) { }
+
+    bool readBlock(unsigned char*, int)
+    {
+        readsInProgress += 1;
+        Thread::sleep(1500);
+        readsInProgress -= 1;
+
+        return false;
+    }
+
+    unsigned int numWordsInFifo()
+    {
+        return 0;
+    }
+
+    bool needsFifoPolling()
+    {
+        return false;
+    }
+
+private:
+    Atomic<int>& readsInProgress;
+};
+
+RHD2000StreamLayout getLayout(int numStreams, bool usb3 = true)
+{
+    RHD2000StreamLayout layout;
+    layout.usb3 = usb3;
+    layout.acquireAdcChannels = true;
+    layout.sampleRate = 30000.0;
+
+    for (int i = 0; i < numStreams; i++)
+    {
+        layout.chipId.add(CHIP_ID_RHD2132);
+        layout.numChannels.add(32);
+    }
+
+    return layout;
+}
+
+/** One headstage of each kind: RHD2164 (two streams), RHD2132 used as a
+    16-channel headstage, and RHD2216 */
+RHD2000StreamLayout getMixedLayout(bool usb3)
+{
+    RHD2000StreamLayout layout = getLayout(0, usb3);
+
+    layout.chipId.add(CHIP_ID_RHD2164);
+    layout.numChannels.add(32);
+    layout.chipId.add(CHIP_ID_RHD2164_B);
+    layout.numChannels.add(32);
+    layout.chipId.add(CHIP_ID_RHD2132);
+    layout.numChannels.add(16);
+    layout.chipId.add(CHIP_ID_RHD2216);
+    layout.numChannels.add(16);
+
+    return layout;
+}
+
+int getNumAmplifierChannels(const RHD2000StreamLayout& layout)
+{
+    int numChannels = 0;
+
+    for (int i = 0; i < layout.numChannels.size(); i++)
+        numChannels += layout.numChannels[i];
+
+    return numChannels;
+}
+
+}
+
+class RHD2000UsbPipelineTest : public UnitTest
+{
+public:
+    RHD2000UsbPipelineTest() : UnitTest("RHD2000UsbPipeline") { }
+
+    void runTest()
+    {
+        beginTest("stop() waits for a read in progress to return");
+        {
+            Atomic<int> readsInProgress;
+
+            ScopedPointer<RHD2000UsbPipeline> pipeline
+                = new RHD2000UsbPipeline(new SlowSource(readsInProgress), getLayout(1));
+
+            pipeline->start();
+
+            for (int ms = 0; ms < 1000 && readsInProgress.get() == 0; ms++)
+                Thread::sleep(1);
+
+            expectEquals(readsInProgress.get(), 1);
+
+            pipeline->stop();
+
+            expectEquals(readsInProgress.get(), 0);
+
+            pipeline = nullptr;
+        }
+
+        beginTest("Simulated board, USB2, mixed headstages");
+        checkSimulatedBoard(getMixedLayout(false), 1);
+
+        beginTest("Simulated board, USB3, mixed headstages on two parser threads");
+        checkSimulatedBoard(getMixedLayout(true), 2);
+
+        beginTest("Simulated board, 16 streams (512 channels, a full board)");
+        checkSimulatedBoard(getLayout(16), 4);
+
+        beginTest("Simulated board, 32 streams (1024 channels)");
+        checkSimulatedBoard(getLayout(32), 4);
+
+        beginTest("Simulated board, 64 streams (2048 channels)");
+        checkSimulatedBoard(getLayout(64), 8);
+
+        beginTest("File source, USB3");
+        checkFileSource(getMixedLayout(true), false);
+
+        beginTest("File source, USB2, real time");
+        checkFileSource(getMixedLayout(false), true);
+    }
+
+private:
+
+    /** Parses 8 blocks of an unthrottled simulated board and compares them
+        with the simulated signals. */
+    void checkSimulatedBoard(const RHD2000StreamLayout& layout, int numParserThreads)
+    {
+        checkPipeline(new RHD2000SimulatedBoard(layout, false), layout, numParserThreads, 0);
+    }
+
+    /** Writes 5 blocks of simulated frames to a file and parses 8 blocks
+        replayed from it, so the file source starts over once. */
+    void checkFileSource(const RHD2000StreamLayout& layout, bool realtime)
+    {
+        const int samplesPerBlock = (int) Rhd2000DataBlock::getSamplesPerDataBlock(layout.usb3);
+        const int numStreams = layout.numChannels.size();
+        const int bytesPerFrame = 2 * (int) Rhd2000DataBlock::calculateDataBlockSizeInWords(numStreams, layout.usb3)
+                                  / samplesPerBlock;
+        const int samplesInFile = 5 * samplesPerBlock;
+
+        TemporaryFile file;
+
+        {
+            RHD2000SimulatedBoard board(layout, false);
+            HeapBlock<unsigned char> frames(samplesInFile * bytesPerFrame);
+            board.generateFrames(frames, samplesInFile);
+
+            FileOutputStream output(file.getFile());
+            expect(output.write(frames, samplesInFile * bytesPerFrame), "could not write the frames");
+        }
+
+        RHD2000FileSource* source = new RHD2000FileSource(file.getFile(), bytesPerFrame,
+                                                          realtime ? layout.sampleRate : 0);
+        expect(source->isOpen());
+        expect(source->needsFifoPolling() == realtime);
+
+        const double startTime = Time::getMillisecondCounterHiRes();
+
+        checkPipeline(source, layout, 1, samplesInFile);
+
+        if (realtime)
+        {
+            // the data are released at the sample rate
+            const double durationMs = 8 * samplesPerBlock * 1000.0 / layout.sampleRate;
+            expect(Time::getMillisecondCounterHiRes() - startTime > 0.9 * durationMs,
+                   "the file source did not wait for the data");
+        }
+    }
+
+    /** Parses 8 blocks from source and compares them with the simulated
+        signals. A source that starts over after samplesInSource samples
+        (0 if it doesn't) starts the signals over too. */
+    void checkPipeline(RHD2000BlockSource* source, const RHD2000StreamLayout& layout,
+                       int numParserThreads, int samplesInSource)
+    {
+        const int numBlocks = 8;
+        const int samplesPerBlock = (int) Rhd2000DataBlock::getSamplesPerDataBlock(layout.usb3);
+        const int numSamples = numBlocks * samplesPerBlock;
+        const int numStreams = layout.numChannels.size();
+        const int period = samplesInSource > 0 ? samplesInSource : numSamples;
+
+        RHD2000UsbPipeline pipeline(source, layout, numParserThreads);
+
+        const int numChannels = pipeline.getNumChannels();
+        const int numAmplifierChannels = getNumAmplifierChannels(layout);
+
+        DataBuffer dataBuffer(numChannels, numSamples + 1);
+
+        pipeline.start();
+
+        for (int block = 0; block < numBlocks; block++)
+            expect(pipeline.parseNextBlock(&dataBuffer, 1000), "parseNextBlock() failed");
+
+        pipeline.stop();
+
+        RHD2000PipelineMetrics metrics;
+        pipeline.getMetrics(metrics);
+
+        std::cout << numAmplifierChannels << " amplifier channels on " << pipeline.getNumParserThreads()
+                  << " thread(s): parse " << String(metrics.meanParseMs, 3) << " ms (max "
+                  << String(metrics.maxParseMs, 3) << ") per " << String(metrics.blockDurationMs, 2)
+                  << " ms block" << std::endl;
+
+        expectEquals(dataBuffer.getNumSamples(), numSamples);
+
+        AudioSampleBuffer data(numChannels, numSamples);
+        HeapBlock<uint64> eventCodes(numSamples);
+        uint64 firstTimestamp;
+
+        expectEquals(dataBuffer.readAllFromBuffer(data, &firstTimestamp, eventCodes, numSamples), numSamples);
+        expectEquals((int) firstTimestamp, 0);
+
+        int channel = 0;
+        int wrongSamples = 0;
+
+        for (int stream = 0; stream < numStreams; stream++)
+        {
+            const int firstChipChannel = (layout.chipId[stream] == CHIP_ID_RHD2132
+                                          && layout.numChannels[stream] == 16) ? RHD2132_16CH_OFFSET : 0;
+
+            for (int chan = 0; chan < layout.numChannels[stream]; chan++, channel++)
+            {
+                const float* samples = data.getReadPointer(channel);
+
+                for (int ts = 0; ts < numSamples; ts++)
+                {
+                    const uint16 word = RHD2000SimulatedBoard::amplifierWord(stream, firstChipChannel + chan, ts % period);
+
+                    if (std::abs(samples[ts] - float(word - 32768) * 0.195f) > 0.01f)
+                        wrongSamples++;
+                }
+            }
+        }
+
+        expectEquals(wrongSamples, 0, "amplifier samples");
+
+        wrongSamples = 0;
+
+        for (int adcChan = 0; adcChan < 8; adcChan++)
+        {
+            const float* samples = data.getReadPointer(numChannels - 8 + adcChan);
+
+            for (int ts = 0; ts < numSamples; ts++)
+            {
+                const float expected = 0.00015258789f * RHD2000SimulatedBoard::adcWord(adcChan, ts % period) - 5.0f - 0.4096f;
+
+                if (std::abs(samples[ts] - expected) > 0.0001f)
+                    wrongSamples++;
+            }
+        }
+
+        expectEquals(wrongSamples, 0, "ADC samples");
+
+        wrongSamples = 0;
+
+        for (int ts = 0; ts < numSamples; ts++)
+        {
+            if (eventCodes[ts] != RHD2000SimulatedBoard::ttlInWord(ts % period))
+                wrongSamples++;
+        }
+
+        expectEquals(wrongSamples, 0, "TTL inputs");
+    }
+};
+
+static RHD2000UsbPipelineTest rhd2000UsbPipelineTest;
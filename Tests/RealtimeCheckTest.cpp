@@ -0,0 +1,208 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "../Source/Processors/GenericProcessor/AllocationTrap.h"
+#include "../Source/Processors/GenericProcessor/BlockArena.h"
+#include "../Source/Processors/GenericProcessor/CompactSampleBuffer.h"
+#include "../Source/Processors/GenericProcessor/ParameterChangeQueue.h"
+#include "../Source/Processors/ResamplingNode/PolyphaseResampler.h"
+#include "../Source/Processors/Visualization/ScrollbackBuffer.h"
+
+/**
+
+  The headless form of the real-time check: runs the code that processors
+  call inside processBlock() between AllocationTrap::enterBlock() and
+  exitBlock(), and fails if anything allocates or takes a lock. The Makefile
+  builds the tests with OPEN_EPHYS_REALTIME_CHECK_BUILD, so the C library's
+  allocator is interposed as in the RealtimeCheck configuration of the GUI.
+
+  A first test makes sure the trap actually sees each kind of operation,
+  so that a PASS cannot come from a trap that catches nothing.
+
+  To check a whole signal chain instead, run a RealtimeCheck build of the
+  GUI with OPEN_EPHYS_REALTIME_CHECK="on file=report.txt", and look for
+  "Real-time check: PASS" in the report after acquisition stops.
+
+*/
+
+namespace
+{
+
+const int numChannels = 32;
+const int blockSize = 1024;
+const int numBlocks = 2000;
+
+/** Each operation is made through a volatile pointer, so the compiler cannot
+    remove a pair of them. */
+void allocateAndLock()
+{
+    void* volatile p = malloc(100);
+    free(p);
+
+    p = calloc(10, 10);
+    p = realloc(p, 200);
+    free(p);
+
+    void* aligned = nullptr;
+
+    if (posix_memalign(&aligned, 64, 256) == 0)
+        free(aligned);
+
+    float* volatile array = new float[100];
+    delete[] array;
+
+    CriticalSection lock;
+    lock.enter();
+    lock.exit();
+}
+
+}
+
+class RealtimeCheckTest : public UnitTest
+{
+public:
+    RealtimeCheckTest() : UnitTest("RealtimeCheck") { }
+
+    void runTest()
+    {
+        beginTest("The trap sees allocations and locks");
+        {
+            AllocationTrap::configure("on");
+            expect(AllocationTrap::isEnabled());
+
+            int numHeapOperations = 0;
+
+            AllocationTrap::start();
+            AllocationTrap::enterBlock("Allocating processor", 100, &numHeapOperations);
+            allocateAndLock();
+            AllocationTrap::exitBlock();
+
+            // outside a block nothing is counted
+            allocateAndLock();
+
+            expect(! AllocationTrap::stop(), "a block that allocates passes the check");
+
+            // malloc, free, calloc, realloc, free, posix_memalign, free, new[], delete[]
+            expect(numHeapOperations >= 9, String(numHeapOperations) + " heap operations caught");
+        }
+
+        beginTest("Real-time code makes no allocations or locks per block");
+        {
+            BlockArena arena;
+            arena.reserve(BlockArena::getPaddedSize(sizeof(float) * blockSize) * 2);
+
+            ParameterChangeQueue changes(64);
+
+            PolyphaseResampler resampler;
+            resampler.setRates(30000.0, 1000.0, numChannels, blockSize);
+
+            CompactSampleBuffer compact(CompactSampleBuffer::INT16);
+            compact.setSize(numChannels, blockSize);
+
+            ScrollbackBuffer scrollback;
+            const bool scrollbackIsOpen = scrollback.open(File::getSpecialLocation(File::tempDirectory),
+                                                          numChannels, 30000.0, 10.0);
+            expect(scrollbackIsOpen, "could not open the scrollback file");
+
+            for (int c = 0; c < numChannels; c++)
+            {
+                compact.setStep(c, 0.195f);
+
+                if (scrollbackIsOpen)
+                    scrollback.setStep(c, 0.195f);
+            }
+
+            AudioSampleBuffer input(numChannels, blockSize);
+            AudioSampleBuffer output(numChannels, blockSize);
+
+            Random random(1);
+
+            for (int c = 0; c < numChannels; c++)
+            {
+                for (int i = 0; i < blockSize; i++)
+                    input.setSample(c, i, random.nextFloat() * 200.0f - 100.0f);
+            }
+
+            int numHeapOperations = 0;
+            int numProduced = 0;
+            int numArenaOverflows = 0;
+
+            AllocationTrap::start();
+
+            for (int block = 0; block < numBlocks; block++)
+            {
+                AllocationTrap::enterBlock("Real-time code", 101, &numHeapOperations);
+
+                arena.reset();
+
+                ParameterChange change;
+                change.parameterIndex = 0;
+                change.newValue = (float) block;
+                change.channel = block % numChannels;
+                change.target = 0;
+                changes.push(change);
+
+                while (changes.pop(change))
+                {
+                }
+
+                // expect() takes the test runner's lock, so failures are only counted here
+                float* scratch = (float*) arena.allocate(sizeof(float) * blockSize);
+
+                if (scratch == nullptr)
+                {
+                    AllocationTrap::exitBlock();
+                    numArenaOverflows++;
+                    continue;
+                }
+
+                numProduced += resampler.process(input.getArrayOfReadPointers(), blockSize,
+                                                 output.getArrayOfWritePointers(), blockSize);
+
+                for (int c = 0; c < numChannels; c++)
+                {
+                    compact.write(c, 0, input.getReadPointer(c), blockSize);
+                    compact.read(c, 0, scratch, blockSize);
+
+                    if (scrollbackIsOpen)
+                        scrollback.write(c, input.getReadPointer(c), blockSize);
+                }
+
+                if (scrollbackIsOpen)
+                    scrollback.advance(blockSize);
+
+                AllocationTrap::exitBlock();
+            }
+
+            expect(AllocationTrap::stop(), "allocations or locks on the processing thread (see the report)");
+            expectEquals(numHeapOperations, 0, "heap operations");
+            expectEquals(numArenaOverflows, 0, "blocks that ran out of scratch space");
+            expect(numProduced > 0);
+
+            scrollback.close();
+        }
+    }
+};
+
+static RealtimeCheckTest realtimeCheckTest;
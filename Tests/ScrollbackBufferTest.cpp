@@ -0,0 +1,126 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "../Source/Processors/Visualization/ScrollbackBuffer.h"
+
+/**
+
+  Writes a ramp over the whole range of an RHD2000 ADC channel through a
+  ScrollbackBuffer, and checks that the min and max read back, per sample
+  and over the chunk, are the values that were written. A second channel
+  with the same step and offset is filled with writeZeros(), as the TTL
+  channels of the LFP Viewer are when it has no scratch space, and must
+  read back as 0.
+
+*/
+
+namespace
+{
+
+const float adcBitVolts = 0.00015258789f;
+
+}
+
+class ScrollbackBufferTest : public UnitTest
+{
+public:
+    ScrollbackBufferTest() : UnitTest("ScrollbackBuffer") { }
+
+    void runTest()
+    {
+        const int numSamples = ScrollbackBuffer::chunkSamples;
+        const double sampleRate = 1000.0;
+
+        HeapBlock<float> values(numSamples);
+
+        for (int i = 0; i < numSamples; i++)
+            values[i] = (float)(0.00015258789 * float(i * 16) - 5 - 0.4096);
+
+        values[numSamples - 1] = (float)(0.00015258789 * 65535.0 - 5 - 0.4096);
+
+        ScrollbackBuffer scrollback;
+        const bool isOpen = scrollback.open(File::getSpecialLocation(File::tempDirectory),
+                                            2, sampleRate, 10.0);
+
+        beginTest("Opens a file in the temporary directory");
+        expect(isOpen);
+
+        if (! isOpen)
+            return;
+
+        // the step and offset that RHD2000Thread gives ADC channels
+        scrollback.setStep(0, adcBitVolts, adcBitVolts * 32768.0f - 5.0f - 0.4096f);
+        scrollback.setStep(1, adcBitVolts, adcBitVolts * 32768.0f - 5.0f - 0.4096f);
+        scrollback.write(0, values, numSamples);
+        scrollback.writeZeros(1, numSamples);
+        scrollback.advance(numSamples);
+        scrollback.finishAppending();
+
+        const Range<double> time(0.0, numSamples / sampleRate);
+
+        beginTest("ADC samples read back at full resolution are the values written");
+        {
+            HeapBlock<float> mins(numSamples), maxs(numSamples);
+            float* minRows[1] = { mins };
+            float* maxRows[1] = { maxs };
+
+            expectEquals(scrollback.readMinMax(0, 1, time, numSamples, minRows, maxRows), numSamples);
+
+            double largest = 0;
+
+            for (int i = 0; i < numSamples; i++)
+            {
+                largest = jmax(largest, std::abs((double) mins[i] - values[i]) / adcBitVolts);
+                largest = jmax(largest, std::abs((double) maxs[i] - values[i]) / adcBitVolts);
+            }
+
+            expect(largest < 0.01, "largest error " + String(largest) + " steps");
+        }
+
+        beginTest("The range of the chunk covers the whole ADC range");
+        {
+            float min, max;
+            float* minRows[1] = { &min };
+            float* maxRows[1] = { &max };
+
+            expectEquals(scrollback.readMinMax(0, 1, time, 1, minRows, maxRows), 1);
+            expect(std::abs(min - values[0]) < adcBitVolts * 0.01f, "min " + String(min, 6));
+            expect(std::abs(max - values[numSamples - 1]) < adcBitVolts * 0.01f, "max " + String(max, 6));
+        }
+
+        beginTest("A channel written with writeZeros() reads back as 0");
+        {
+            float min, max;
+            float* minRows[1] = { &min };
+            float* maxRows[1] = { &max };
+
+            expectEquals(scrollback.readMinMax(1, 1, time, 1, minRows, maxRows), 1);
+            expect(std::abs(min) <= adcBitVolts * 0.5f && std::abs(max) <= adcBitVolts * 0.5f,
+                   "min " + String(min, 6) + ", max " + String(max, 6));
+        }
+
+        scrollback.close();
+    }
+};
+
+static ScrollbackBufferTest scrollbackBufferTest;
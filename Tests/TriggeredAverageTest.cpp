@@ -0,0 +1,153 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2015 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "../Source/Processors/LfpTriggeredAverageNode/TriggeredAverage.h"
+
+/**
+
+  Feeds ramps through a TriggeredAverage in blocks of varying size, with
+  triggers at known samples, and checks the mean and standard error of
+  every bin against the values computed directly from the ramps, with one
+  sample per bin and with several.
+
+*/
+
+namespace
+{
+
+const int numChannels = 3;
+
+/** The signal of channel c at sample n: a ramp, plus a slower one so that
+    the triggers don't all see the same shape */
+float signal(int c, int64 n)
+{
+    return (float)((c + 1) * 0.01 * (double) n + 0.5 * (double)((n / 7) % 5));
+}
+
+}
+
+class TriggeredAverageTest : public UnitTest
+{
+public:
+    TriggeredAverageTest() : UnitTest("TriggeredAverage") { }
+
+    void runTest()
+    {
+        beginTest("One sample per bin");
+        check(500);
+
+        beginTest("Several samples per bin");
+        check(3 * TriggeredAverage::maxBins + 2);
+    }
+
+private:
+
+    void check(int windowSamples)
+    {
+        TriggeredAverage average;
+        average.setNumChannels(numChannels);
+        average.setWindow(windowSamples);
+
+        const int binSize = (windowSamples + TriggeredAverage::maxBins - 1) / TriggeredAverage::maxBins;
+        const int numBins = jmax(2, windowSamples / binSize);
+        const int preBins = numBins / 2;
+
+        // triggers after the first half window, some close enough to overlap
+        Array<int64> triggers;
+        triggers.add(windowSamples + 17);
+        triggers.add(windowSamples + 40);
+        triggers.add(3 * windowSamples + 5);
+        triggers.add(5 * windowSamples + 333);
+        triggers.add(5 * windowSamples + 334);
+
+        const int64 totalSamples = 7 * windowSamples;
+        const int blockSizes[] = { 1, 64, 1024, 137, 5000, 7 };
+
+        AudioSampleBuffer block(numChannels, 5000);
+        int64 position = 0;
+
+        for (int b = 0; position < totalSamples; b++)
+        {
+            const int numSamples = (int) jmin((int64) blockSizes[b % 6], totalSamples - position);
+
+            for (int c = 0; c < numChannels; c++)
+            {
+                for (int n = 0; n < numSamples; n++)
+                    block.setSample(c, n, signal(c, position + n));
+            }
+
+            for (int t = 0; t < triggers.size(); t++)
+            {
+                if (triggers[t] >= position && triggers[t] < position + numSamples)
+                    average.addTrigger((int)(triggers[t] - position));
+            }
+
+            average.addSamples(block, numSamples);
+            position += numSamples;
+        }
+
+        AudioSampleBuffer mean(numChannels, TriggeredAverage::maxBins);
+        AudioSampleBuffer standardError(numChannels, TriggeredAverage::maxBins);
+        int binsCopied = 0;
+
+        expectEquals(average.copyAverages(mean, standardError, binsCopied), triggers.size());
+        expectEquals(binsCopied, numBins);
+        expectEquals(average.getNumDroppedTriggers(), 0);
+
+        int numWrong = 0;
+
+        for (int c = 0; c < numChannels; c++)
+        {
+            for (int k = 0; k < numBins; k++)
+            {
+                // bins are aligned to multiples of binSize since the reset
+                double sum = 0.0, sumOfSquares = 0.0;
+                const int n = triggers.size();
+
+                for (int t = 0; t < n; t++)
+                {
+                    const int64 first = (triggers[t] / binSize - preBins + k) * binSize;
+                    double value = 0.0;
+
+                    for (int i = 0; i < binSize; i++)
+                        value += signal(c, first + i);
+
+                    value /= binSize;
+                    sum += value;
+                    sumOfSquares += value * value;
+                }
+
+                const double expectedMean = sum / n;
+                const double expectedError = std::sqrt((sumOfSquares - sum * sum / n) / ((n - 1) * (double) n));
+
+                if (std::abs(mean.getSample(c, k) - expectedMean) > 1e-4 * (1.0 + std::abs(expectedMean))
+                    || std::abs(standardError.getSample(c, k) - expectedError) > 1e-3 * (1.0 + expectedError))
+                    numWrong++;
+            }
+        }
+
+        expectEquals(numWrong, 0);
+    }
+};
+
+static TriggeredAverageTest triggeredAverageTest;